@@ -52,8 +52,10 @@ extern MyMonitor myMonitor;
 
 
 // defined in other files
-boolean initialiseWifi(const char *pSSID, const char *pPassword, const unsigned char bRetry);
-boolean tcpConnect(const char * pIPAddress, const int nPort, const unsigned char bRetry);
+void startWifi(void);
+void processConnection(void);
+boolean wifiConnected(void);
+void checkWifiLink(const char c);
 void displayRainbow(void);
 void flashColour(unsigned char bRGB);
 void displayClear(void);
@@ -63,7 +65,9 @@ unsigned char initialiseVocaliser(const char *pFirstWords);
 boolean addElementName(Instinct::instinctID bRuntime_ElementID, char *pElementName);
 
 // defines for the Ultrasonic rangefinder
-#define ULTRASONIC_PIN 8
+// the echo is timed by interrupt, so the sensor needs one of the Mega's interrupt pins (2, 3, 18-21).
+// 18 and 19 are the encoders and 20, 21 the I2C bus, so it is on pin 2. On any other pin pulseIn() blocks for up to 35mS
+#define ULTRASONIC_PIN 2
 #define ULTRASONIC_MIN_INTERVAL 300
 
 #define PIR_PIN 9
@@ -72,25 +76,82 @@ boolean addElementName(Instinct::instinctID bRuntime_ElementID, char *pElementNa
 void processSerial(void);
 unsigned char parseRobotCommand(const char *pCmd);
 void writeOutput(const Instinct::PlanNode * pPlanNode, const char *pType, const Instinct::ReleaserType *pReleaser, const int nSenseValue);
-void reportSensorValues(void);
+void reportChannels(const unsigned char bEvents);
+void reportHeadMatrix(const unsigned long ulMillis, const unsigned char bFull);
+void applyReportFlags(void);
 void processWifi(void);
+void reportPlanImage(unsigned char bStatus);
+
+// output is buffered so that a busy link never holds up the loop. Each buffer is drained in loop()
+// The WiFly passes data straight through in its connected mode, so its buffer drains into Serial2
+#define OUTPUT_BUFFER_SIZE 256
+// The WiFly makes a TCP packet of whatever arrives together, so Wifi output goes in batches of at least
+// WIFI_BATCH_SIZE bytes, or whatever has waited WIFI_BATCH_MS. Half the buffer leaves room for the next batch
+#define WIFI_BATCH_SIZE 128
+#define WIFI_BATCH_MS 20
+R5BufferedOutput mySerialOut(&Serial, OUTPUT_BUFFER_SIZE, R5_OUTPUT_DROP_OLDEST, true);
+R5BufferedOutput myWifiOut(&Serial2, OUTPUT_BUFFER_SIZE, R5_OUTPUT_DROP_OLDEST, false);
 
 class MyOutput : public R5Output {
 public:
  virtual void outputData(const char *pszData);
  virtual void outputVocaliseData(const char *pszData);
+ virtual void outputFrame(const unsigned char *pFrame, const unsigned int uiLength);
+ void drain(void);
 };
 
 MyOutput myOutput;
 
-// store strings in flash memory to save RAM. Accessed via getProgmemStr
+// encodes X and Y records as binary frames when REPORT Binary is on
+R5Telemetry myTelemetry(&myOutput);
+
+// when each channel is reported - REPORT turns X, Y and the plan monitor on and off, SUB and UNSUB set any channel
+R5Subscriptions mySubs(&myOutput, &myTelemetry);
+
+// store strings in flash memory to save RAM. A table of them, so getRobotMessage() goes straight to the one wanted
 #define R5_MSG_BUFF_SIZE 100
-const char PROGMEM szRobotMessages[] = "Use HELP for command options.!Invalid Command !PLAN commands: A D M R S U!RESET in 1s, then hang, Damn it.!" //
-                                        "Wifi Parameters Sucessfully Updated.!";
-const char PROGMEM szRobotSetupMessages[] = "RTC not running.!Wire1.begin()!Robot Initialising ...!EasyVR not detected.!Robot Running ...!" //
-                                        "Established InstinctServer Connection.!Established Wifi Connection!Loading Plan from EEPROM!Emic2 Not Detected!" //
-                                        "Hello. This is the R5 Robot. Please Watch, and Listen Carefully.!" //
-                                        "Hello. I am Buddy the Robot. Nice to meet you. Please Watch, and Listen Carefully.!";
+enum {MSG_USE_HELP, MSG_INVALID_COMMAND, MSG_PLAN_COMMANDS, MSG_RESET, MSG_WIFI_UPDATED,
+      MSG_RTC_NOT_RUNNING, MSG_WIRE1_BEGIN, MSG_INITIALISING, MSG_NO_EASYVR, MSG_RUNNING,
+      MSG_SERVER_CONNECTED, MSG_WIFI_CONNECTED, MSG_LOADING_PLAN, MSG_NO_EMIC2, MSG_HELLO, MSG_HELLO_BUDDY, MSG_NO_ECHO_INT,
+      MSG_WIFI_RETRY, MSG_SERVER_LOST, MSG_WIFI_BAUD_WRONG, MSG_WIFI_BAUD_FAILED, MSG_WIFI_BAUD_SAVED, MSG_WIFI_NOT_ASSOCIATED,
+      MSG_WIFI_NOT_ASSOCIATED_WITH, MSG_WIFI_SAVED, MSG_WIFI_SAVE_FAILED, MSG_TCP_FAILED, MSG_COUNT};
+const char PROGMEM szMsgUseHelp[] = "Use HELP for command options.";
+const char PROGMEM szMsgInvalidCommand[] = "Invalid Command ";
+const char PROGMEM szMsgPlanCommands[] = "PLAN commands: A D M R S U";
+const char PROGMEM szMsgReset[] = "RESET in 1s, then hang, Damn it.";
+const char PROGMEM szMsgWifiUpdated[] = "Wifi Parameters Sucessfully Updated.";
+const char PROGMEM szMsgRTCNotRunning[] = "RTC not running.";
+const char PROGMEM szMsgWire1Begin[] = "Wire1.begin()";
+const char PROGMEM szMsgInitialising[] = "Robot Initialising ...";
+const char PROGMEM szMsgNoEasyVR[] = "EasyVR not detected.";
+const char PROGMEM szMsgRunning[] = "Robot Running ...";
+const char PROGMEM szMsgServerConnected[] = "Established InstinctServer Connection.";
+const char PROGMEM szMsgWifiConnected[] = "Established Wifi Connection";
+const char PROGMEM szMsgLoadingPlan[] = "Loading Plan from EEPROM";
+const char PROGMEM szMsgNoEmic2[] = "Emic2 Not Detected";
+const char PROGMEM szMsgHello[] = "Hello. This is the R5 Robot. Please Watch, and Listen Carefully.";
+const char PROGMEM szMsgHelloBuddy[] = "Hello. I am Buddy the Robot. Nice to meet you. Please Watch, and Listen Carefully.";
+const char PROGMEM szMsgNoEchoInt[] = "Ultrasonic pin has no interrupt, ranging will block.";
+const char PROGMEM szMsgWifiRetry[] = "Wifi retry in mS ";
+const char PROGMEM szMsgServerLost[] = "InstinctServer connection lost";
+const char PROGMEM szMsgWifiBaudWrong[] = "Wifi commandMode failed. Probably wrong baud rate.";
+const char PROGMEM szMsgWifiBaudFailed[] = "set u b 230400 Failed.";
+const char PROGMEM szMsgWifiBaudSaved[] = "Saved baud rate 230400";
+const char PROGMEM szMsgWifiNotAssociated[] = "Wifi not associated";
+const char PROGMEM szMsgWifiNotAssociatedWith[] = "Wifi not associated with ";
+const char PROGMEM szMsgWifiSaved[] = "save wifi config success.";
+const char PROGMEM szMsgWifiSaveFailed[] = "save wifi config failed.";
+const char PROGMEM szMsgTCPFailed[] = "TCP connect failed to ";
+const char * const PROGMEM szRobotMessages[MSG_COUNT] = {szMsgUseHelp, szMsgInvalidCommand, szMsgPlanCommands, szMsgReset, szMsgWifiUpdated,
+      szMsgRTCNotRunning, szMsgWire1Begin, szMsgInitialising, szMsgNoEasyVR, szMsgRunning,
+      szMsgServerConnected, szMsgWifiConnected, szMsgLoadingPlan, szMsgNoEmic2, szMsgHello, szMsgHelloBuddy, szMsgNoEchoInt,
+      szMsgWifiRetry, szMsgServerLost, szMsgWifiBaudWrong, szMsgWifiBaudFailed, szMsgWifiBaudSaved, szMsgWifiNotAssociated,
+      szMsgWifiNotAssociatedWith, szMsgWifiSaved, szMsgWifiSaveFailed, szMsgTCPFailed};
+
+char * getRobotMessage(char *pBuff, const int nBuffLen, const unsigned char bMsg)
+{
+  return getProgmemTableStr(pBuff, nBuffLen, bMsg, szRobotMessages, MSG_COUNT);
+}
 
 // ******** these are the static structures that comprise the robot *********
 
@@ -100,6 +161,8 @@ const char PROGMEM szRobotSetupMessages[] = "RTC not running.!Wire1.begin()!Robo
 // Bit 8 - load stored vocalisation params on boot
 // Bit 9 - enable reporting of plan monitor data
 // Bit 10 - enable reporting of vocalisation data
+// Bit 11 - enable the raw sensor trace (T records), for replay on the host
+// Bit 12 - send sensor and head matrix reports as binary telemetry frames rather than X and Y text records
 
 
 unsigned int uiGlobalFlags = 0x13; // Default just output to Serial, Wifi & Instinct Server connection on boot
@@ -130,10 +193,14 @@ SoftwareSerial VRPort(12,13);
 EasyVR easyVR(VRPort);
 #endif
 
+// the ADC scheduler converts the corner sensor and motor current inputs in the background
+// it must be declared before the classes that register their analog pins with it
+R5AdcScheduler myAdc;
+
 // sensor structures
 const unsigned char cornerInputs[] = {A0, A1, A2, A3};
 const unsigned char cornerOutputs[] = {24, 25, 26, 27};
-R5CornerSensors sensors(cornerInputs, cornerOutputs); 
+R5CornerSensors sensors(cornerInputs, cornerOutputs, &myAdc); 
 R5Ultrasonic myRanger(ULTRASONIC_PIN, ULTRASONIC_MIN_INTERVAL);
 R5PIR myPIR(PIR_PIN);
 
@@ -146,13 +213,23 @@ Encoder rightEncoder(18, 22);
 const unsigned char motorSpeeds[] = {4, 5};
 const unsigned char motorDirections[] = {29, 28};
 const unsigned char motorCurrents[] = {A4, A5};
-R5MotorControl motors(motorSpeeds, motorDirections, motorCurrents);
+R5MotorControl motors(motorSpeeds, motorDirections, motorCurrents, &myAdc);
 
 // Head Controller central head position is 75' and forward looking is 180'
 // 12H*3V array of sensor readings, smoothing set to take weighted average of current and last readings
 // 10% of old value and 90% of new one
 R5SensingHead myHead(&servoHHead, &servoVHead, 75, 180, &myRanger, 5, 2, 10);
 
+// snapshot of the sensors taken before each plan cycle. The senses and the X report are served from it
+// the head matrix summary is for row 0 (ahead) and column 2 (centre)
+R5SensorFrame myFrame(&sensors, &motors, &myHead, &myRanger, &myPIR, 0, 2);
+
+// records the raw sensor inputs as T records, so that a run can be replayed by extras/sim/r5replay
+R5Trace myTrace(&myOutput, &sensors, &motors, &myRanger, &myPIR);
+
+// loads a plan sent in one go as a binary image by the PIMAGE command, see extras/plan/r5plan
+R5PlanImage myPlanImage(&myPlan, &myNames);
+
 // the setup routine runs once when you press reset:
 void setup()
 {
@@ -161,6 +238,7 @@ void setup()
     wdt_reset(); // this code fails because on reboot the Watchdog is set to 15mS and reboots too quickly, before it gets this far.
     wdt_disable(); // the watchdog is used by the RESET command, so we must disable it on reboot
     Serial.begin(115200);    
+    myAdc.begin(); // start sampling the analog inputs
    
     myPixelStrip.begin();
     displayClear();
@@ -168,15 +246,17 @@ void setup()
     myMemory.getServerParams(&myServerParams);
     uiGlobalFlags = myMemory.getGlobalFlags();
     uiPlanRate = myMemory.getPlanRate();
+    applyReportFlags();
+    myWifiOut.setBatch(WIFI_BATCH_SIZE, WIFI_BATCH_MS);
 
     displayRainbow(); // start the rainbow effect
 
-    Serial.println(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 2, szRobotSetupMessages));
+    Serial.println(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_INITIALISING));
     delay(2000); // give the boards a chance to initialise after power on
     
-    // check if we must try to connect to Instinct Server
+    // check if we must try to connect to Instinct Server. loop() makes the connection, so setup() doesn't wait for it
     if (uiGlobalFlags & 0x10)
-      connectInstinctServer(szMsgBuff);
+      startWifi();
     else
       uiGlobalFlags = uiGlobalFlags & 0xFFFD; // don't to write the the wifi board if its not connected         
 
@@ -184,7 +264,7 @@ void setup()
 #ifdef AVR
     Wire.begin(); // the SPI bus is needed to talk to the RTC
 #else
-    myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 1, szRobotSetupMessages));
+    myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIRE1_BEGIN));
     Wire1.begin(); // Shield I2C pins connect to alt I2C bus on Arduino Due
 #endif
 
@@ -192,7 +272,7 @@ void setup()
     
     rtc.begin();
     if (! rtc.isrunning()) {
-      myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 0, szRobotSetupMessages));
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_RTC_NOT_RUNNING));
     }
     else
     {
@@ -217,6 +297,8 @@ void setup()
     myHead.setVScanInterval(0);  
     myHead.lookAhead();
     myHead.setParalyse(true); // stop head moving    
+    if (!myRanger.setAsync(true)) // don't stall the loop waiting for echoes
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_NO_ECHO_INT));
     motors.setParalyse(true); // stop robot moving until its sensors are working
     
 #ifdef R5_EASYVR
@@ -226,7 +308,7 @@ void setup()
     VRPort.begin(9600);
     if (!easyVR.detect())
     {  
-        myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 3, szRobotSetupMessages));
+        myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_NO_EASYVR));
     }
 #endif
 
@@ -239,7 +321,7 @@ void setup()
     // voice 3 = Uppity Ursula, voice 2 = Beautiful Betty
     if (!myVoice.initialiseVoice(18, 180, 0))
     {
-        myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 8, szRobotSetupMessages));
+        myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_NO_EMIC2));
     }
 
     displayRainbow();
@@ -248,9 +330,9 @@ void setup()
     if(uiGlobalFlags & 0x80)
     {
 #ifdef R5_BUDDY
-        myVoice.speak(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 10, szRobotSetupMessages), 3000, false, 0, true);
+        myVoice.speak(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_HELLO_BUDDY), 3000, false, 0, true);
 #else
-        myVoice.speak(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 9, szRobotSetupMessages), 3000, false, 0, true);
+        myVoice.speak(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_HELLO), 3000, false, 0, true);
 #endif
     }
     
@@ -259,7 +341,7 @@ void setup()
     // check if we should restore the plan from EEPROM on boot
     if(uiGlobalFlags & 0x20)
     {
-      myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 7, szRobotSetupMessages));
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_LOADING_PLAN));
       myMemory.readData(&myPlan, myNames.elementBufferSize(), myNames.elementBuffer());
 
       if(uiGlobalFlags & 0x40) // turn on global plan monitoring
@@ -276,25 +358,6 @@ void setup()
     }
 }
 
-// connect to the InstinctServer
-unsigned char connectInstinctServer(char *pMsgBuff)
-{
-    // disable the flag that writes monitor output to wifi. Stops the wifi commands being interrupted by outputData()
-    uiGlobalFlags = uiGlobalFlags & 0xFFFD;         
-    if (initialiseWifi(myServerParams.szWifiSSID, myServerParams.szWifiPassword, myServerParams.bWifiRetry))
-    {
-      myOutput.outputData(getProgmemStr(pMsgBuff, R5_MSG_BUFF_SIZE, 6, szRobotSetupMessages));
-      if(tcpConnect(myServerParams.szServerIP, myServerParams.uiServerPort, myServerParams.bServerRetry))
-      {
-        uiGlobalFlags = uiGlobalFlags | 0x02; // enable the flag that writes monitor output to wifi
-        myOutput.outputData(getProgmemStr(pMsgBuff, R5_MSG_BUFF_SIZE, 5, szRobotSetupMessages));
-        return true;
-      }
-    }
-    return false;
-}
-
-
 // the loop routine runs over and over again forever:
 void loop()
 {
@@ -330,7 +393,7 @@ void loop()
        motors.setParalyse(false);
        myHead.setParalyse(false);
        // report that the robot is running - this initiates cmdfile.txt in InstinctServer
-       myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 4, szRobotSetupMessages));
+       myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_RUNNING));
        displayClear(); // clear the display to indicate we are ready to go
     }  
     else if ( nStartupLoopCounter > 50 ) // ready to execute behaviours
@@ -350,31 +413,36 @@ void loop()
         sensors.sense();
       }
 
+      unsigned char bPlanCycle = false;
       if (uiPlanRate) // if uiPlanRate is zero then we do not run the plan at all
       {
         if ((ulMilliSecs - ulOldRateMilliSecs) >= (1000/uiPlanRate))
         {
           ulOldRateMilliSecs = ulMilliSecs;
-          if (uiGlobalFlags & 0x04)
-          {
-            reportSensorValues();
-          }
-          if (uiGlobalFlags & 0x08)
-          {
-            reportHeadMatrix();
-          }
+          myFrame.capture(); // everything the plan sees this cycle is read now
+          reportChannels(R5_EVENT_PLAN);
+          bPlanCycle = true;
           myPlan.runPlan();
           // displayRainbow(); // enable just for testing
           // flashColour(0x06); // 6 = yellow
         }
       }
+      if (!bPlanCycle)
+        reportChannels(0); // channels with their own rate, or waiting for the end of a sweep
     }
 
-    motors.driveMotors(leftEncoder.read(), rightEncoder.read());
+    long lLeftCount = leftEncoder.read();
+    long lRightCount = rightEncoder.read();
+    myTrace.setEnable(uiGlobalFlags & 0x0800);
+    myTrace.record(lLeftCount, lRightCount);
+    motors.driveMotors(lLeftCount, lRightCount);
     myHead.driveHead();
 
     processSerial();
+    processConnection();
     processWifi();
+    reportPlanImage(myPlanImage.checkTimeout());
+    myOutput.drain();
 
     myVoice.processVoice();
 }
@@ -388,6 +456,11 @@ void processSerial()
     while ( Serial.available() > 0 )
     {
       char c = Serial.read();
+      if (myPlanImage.isLoading()) // the bytes after PIMAGE are the image, not commands
+      {
+        reportPlanImage(myPlanImage.addByte(c));
+        continue;
+      }
       if (c == 10) // NL
       {
         cmd[cmdLen] = 0; // zero term the string
@@ -412,14 +485,25 @@ void processWifi()
   static char cmd[80];
   static unsigned char cmdLen = 0;
 
+    // until the connection is made the WiFly is in command mode, and what it says is for processConnection()
+    if (!wifiConnected())
+      return;
+
     while ( wifly.available() > 0 )
     {
       char c = wifly.read();
+      checkWifiLink(c);
+      if (myPlanImage.isLoading()) // the bytes after PIMAGE are the image, not commands
+      {
+        reportPlanImage(myPlanImage.addByte(c));
+        continue;
+      }
       if (c == 10) // NL
       {
         cmd[cmdLen] = 0; // zero term the string
         myOutput.outputData(cmd);
         parseRobotCommand(cmd);
+        myWifiOut.flush(); // the reply goes straight away, rather than waiting for a batch
         cmdLen = 0;
       }
       else
@@ -433,432 +517,632 @@ void processWifi()
 }
 
 
+// report the end of a PIMAGE load, whether it worked or not
+void reportPlanImage(unsigned char bStatus)
+{
+  char szMsgBuff[R5_MSG_BUFF_SIZE];
 
-// Process the various types of commands PLAN, STOP, START, RESET, DUMP
-// 
-unsigned char parseRobotCommand(const char *pCmd)
+  if (bStatus == R5_PLANIMAGE_DONE)
+  {
+    static const char PROGMEM szFmt[] = {"Plan image loaded %u nodes"};
+    snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, myPlanImage.getNodes());
+    myOutput.outputData(szMsgBuff);
+    myOutput.outputData("OK");
+  }
+  else if (bStatus == R5_PLANIMAGE_ERROR)
+  {
+    static const char PROGMEM szFmt[] = {"Plan image error %u"};
+    snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, (unsigned int)myPlanImage.getError());
+    myOutput.outputData(szMsgBuff);
+    myOutput.outputData("Fail");
+  }
+}
+
+// The robot commands. Each is a handler, see R5CommandHandler in R5Command.h, and an entry in R5RobotCommands.h
+// pArgs is the rest of the command line, after the command word and a space
+
+unsigned char cmdPlan(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // PLAN - execute one of the Instinct CmdPlanner commands
+{
+  if (!*pArgs)
+  {
+    myOutput.outputData(getRobotMessage(pMsgBuff, uiBuffLen, MSG_PLAN_COMMANDS));
+    return R5_COMMAND_FAIL;
+  }
+  unsigned char bRtn = myPlan.executeCommand(pArgs, pMsgBuff, uiBuffLen);
+  myOutput.outputData(pMsgBuff);
+  return bRtn ? R5_COMMAND_DONE : R5_COMMAND_FAIL;
+}
+
+unsigned char cmdStop(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // STOP - Disable the robot motors
+{
+  motors.setParalyse(true);
+  return R5_COMMAND_OK;
+}
+
+unsigned char cmdStart(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // START - Enable the robot motors
+{
+  motors.setParalyse(false);
+  return R5_COMMAND_OK;
+}
+
+// RESET - this annoyingly does not work due to watchdog resetting too fast after reboot - needs a bootloader fix
+unsigned char cmdReset(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  myOutput.outputData(getRobotMessage(pMsgBuff, uiBuffLen, MSG_RESET));
+  wdt_enable(WDTO_1S);
+  return R5_COMMAND_DONE;
+}
+
+unsigned char cmdDump(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // DUMP - Dump a complete listing of the Instinct Plan
 {
   char szCmd[20];
-  char szMsgBuff[R5_MSG_BUFF_SIZE];
-  unsigned char bRtn = true;
-  unsigned char bSayOK = false;
+  Instinct::PlanNode aNode;
+  Instinct::instinctID nMaxID = myPlan.maxElementID();
+  for (Instinct::instinctID i = 0; i < nMaxID; i++)
+  { 
+    static const char PROGMEM szFmt[] = {"D N %i"};
+    snprintf_P(szCmd, sizeof(szCmd), szFmt, i+1);
+    if (myPlan.executeCommand(szCmd, pMsgBuff, uiBuffLen))
+    {
+      myOutput.outputData(pMsgBuff);
+    }
+  }
+  return nMaxID ? R5_COMMAND_DONE : R5_COMMAND_OK; // just say OK if the plan is empty
+}
 
-  static const char PROGMEM szFmt[] = {"%s "};
-  szCmd[0] = 0;
-  int nRtn = sscanf_P(pCmd, szFmt, szCmd);
+unsigned char cmdTime(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // TIME - Report the time
+{
+  DateTime now = rtc.now();
+  static const char PROGMEM szFmt[] = {"%04u/%02u/%02u %02u:%02u:%02u"};
+  snprintf_P(pMsgBuff, uiBuffLen, szFmt, now.year(), now.month(), now.day(), now.hour(), now.minute(), now.second());
+  myOutput.outputData(pMsgBuff);
+  return R5_COMMAND_DONE;
+}
 
-  if (!nRtn || !strlen(szCmd))
+unsigned char cmdSetTime(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // SETTIME - Set the time
+{
+  int nYr, nMth, nDay, nHr, nMin, nSec;
+  nYr = nMth = nDay = nHr = nMin = nSec = 0;
+  static const char PROGMEM szFmt[] = {"%u %u %u %u %u %u"};
+  sscanf_P(pArgs, szFmt, &nYr, &nMth, &nDay, &nHr, &nMin, &nSec);
+  rtc.adjust(DateTime(nYr, nMth, nDay, nHr, nMin, nSec));
+  return R5_COMMAND_OK;
+}
+
+// REPORT - Turn on/off reporting to Serial port and wifi and also sensor value reporting
+// e.g. REPORT 1 0 1 0 enables Serial, Disables Wifi, enables sensor value reporting, disables reporting of the head matrix
+// uiGlobalFlags Bit 0 - write to Serial, Bit 1 - write to Wifi, Bit 2 - Report Sensors, Bit 3 - Report HeadMatrix
+// Bit 9 - enable reporting of plan monitor data, Bit 10 - enable reporting of vocalisation data, Bit 11 - raw sensor trace
+// Bit 12 - binary telemetry frames in place of X and Y records
+// The ninth argument is the shortest mS between trace records of the motor current, see R5Trace.h. 0 records every change
+unsigned char cmdReport(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  int nSerial, nWifi, nSensors, nHeadMatrix, nReportPlan, nReportVocalise, nTrace, nBinary;
+  unsigned int uiTraceInterval = R5_TRACE_MOTOR_INTERVAL;
+  nSerial = nWifi = nSensors = nHeadMatrix = nReportPlan = nReportVocalise = nTrace = nBinary = 0;
+  static const char PROGMEM szFmt[] = {"%i %i %i %i %i %i %i %i %u"};
+  sscanf_P(pArgs, szFmt, &nSerial, &nWifi, &nSensors, &nHeadMatrix, &nReportPlan, &nReportVocalise, &nTrace, &nBinary, &uiTraceInterval);
+  uiGlobalFlags = (uiGlobalFlags & 0xE1F0) | ((nSerial ? 0x01 : 0x0) | (nWifi ? 0x02 : 0x0) |
+        (nSensors ? 0x04 : 0x0) | (nHeadMatrix ? 0x08 : 0x0) | (nReportPlan ? 0x0200 : 0x0) | (nReportVocalise ? 0x0400 : 0x0) |
+        (nTrace ? 0x0800 : 0x0) | (nBinary ? 0x1000 : 0x0) );
+  myTrace.setMotorInterval(uiTraceInterval);
+  applyReportFlags();
+  myTelemetry.reset(); // the host may have just started listening, so start each type with a key message
+  return R5_COMMAND_OK;
+}
+
+// RATE - how many times per second do we process the plan? 0 stops plan processing
+unsigned char cmdRate(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  uiPlanRate = 0;
+  static const char PROGMEM szFmt[] = {"%u"};
+  sscanf_P(pArgs, szFmt, &uiPlanRate);
+  return R5_COMMAND_OK;
+}
+
+unsigned char cmdCal(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // CAL - recalibrate sensors
+{
+  sensors.calibrateBleed();    
+  return R5_COMMAND_OK;
+}
+
+// CON - connect to wifi - useful if server started after robot is booted
+// the connection is made by loop(), which reports when it has been established
+unsigned char cmdCon(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  if (wifiConnected())
   {
-    myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 0, szRobotMessages));
-    return false;
+    myOutput.outputData(getRobotMessage(pMsgBuff, uiBuffLen, MSG_SERVER_CONNECTED));
+    return R5_COMMAND_DONE;
   }
+  startWifi();
+  return R5_COMMAND_OK;
+}
 
-  static const char PROGMEM szCommands[] = {"PLAN!STOP!START!RESET!DUMP!TIME!SETTIME!REPORT!RATE!CAL!CON!PELEM!RSENSE!RACTION!HSTOP!HSTART!"
-            "SPLAN!RPLAN!SCONF!RCONF!SWIFI!CONF!HELP!VER!SHOWIFI!SHOCONF!SHOREPORT!SHORATE!SHONAMES!SPEAKRULE!SHORULES!SRULES!RRULES!CNAMES!"};
+// PELEM - associating a name with a plan element ID
+unsigned char cmdPElem(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  static const char PROGMEM szFmt[] = {"%s %u"};
+  char szName[30];
+  unsigned int uiRuntime_ElementID = 0;
+  char * pParams = (char *)pArgs;
+  // allow both space and = as delimeter between element name and its ID
+  char * pDelim = strchr(pParams, '=');
+  if (pDelim)
+    *pDelim = ' ';          
+  sscanf_P(pParams, szFmt, szName, &uiRuntime_ElementID);
+  return myNames.addElementName((Instinct::instinctID)uiRuntime_ElementID, szName) ? R5_COMMAND_OK : R5_COMMAND_DONE;
+}
 
-  strupr(szCmd); // make command words case insensitive
-  nRtn = findProgmemStr(szCmd, szCommands);
+// RSENSE and RACTION - associating a name with a robot sense or action ID
+// we just ignore these for now
+unsigned char cmdRName(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  return R5_COMMAND_DONE;
+}
+
+unsigned char cmdHStop(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // HSTOP - stop robot head from scanning
+{
+  myHead.setParalyse(true);
+  return R5_COMMAND_OK;
+}
+
+unsigned char cmdHStart(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // HSTART - allow robot head to scan
+{
+  myHead.setParalyse(false);
+  return R5_COMMAND_OK;
+}
+
+unsigned char cmdSPlan(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // SPLAN - save robot plan in EEPROM
+{
+  return myMemory.writeData(&myPlan, myNames.elementBufferSize(), myNames.elementBuffer()) ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
+
+unsigned char cmdRPlan(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // RPLAN - read robot plan from EEPROM
+{
+  return myMemory.readData(&myPlan, myNames.elementBufferSize(), myNames.elementBuffer()) ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
+
+unsigned char cmdSConf(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // SCONF - save robot config in EEPROM
+{
+  myMemory.setServerParams(&myServerParams);
+  myMemory.setGlobalFlags(uiGlobalFlags);
+  myMemory.setPlanRate(uiPlanRate);
+  return R5_COMMAND_OK;
+}
+
+unsigned char cmdRConf(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // RCONF - read robot config from EEPROM
+{
+  myMemory.getServerParams(&myServerParams);
+  uiGlobalFlags = myMemory.getGlobalFlags();
+  uiPlanRate = myMemory.getPlanRate();
+  applyReportFlags();
+  return R5_COMMAND_OK;
+}
+
+// SWIFI - set the Wifi params - SSID, Password, Wifi Retries, ServerIP, ServerPort, ServerRetries
+unsigned char cmdSWifi(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  unsigned int uiWifiRetry, uiServerRetry;
+  uiWifiRetry = uiServerRetry = 1;
+  static const char PROGMEM szFmt[] = {"%s %s %u %s %u %u"};
+  if (sscanf_P(pArgs, szFmt, myServerParams.szWifiSSID, myServerParams.szWifiPassword, &uiWifiRetry,
+        myServerParams.szServerIP, &myServerParams.uiServerPort, &uiServerRetry) != 6)
+    return R5_COMMAND_SAY;
+
+  myServerParams.bWifiRetry = uiWifiRetry;
+  myServerParams.bServerRetry = uiServerRetry;
+  myOutput.outputData(getRobotMessage(pMsgBuff, uiBuffLen, MSG_WIFI_UPDATED));
+  return R5_COMMAND_DONE;
+}
+
+// CONF - sets config flags - Bit 4 - attempt Wifi & Instinct Server Connection on boot, Bit 5 - attempt restore of plan from EEPROM on boot
+// Bit 6 - enable full plan monitoring on boot, Bit 7 - vocalise monitor trace, Bit 8 - read speak rules from EEPROM on boot
+unsigned char cmdConf(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  int nConWifi, nReadPlan, nMonitorPlan, nVocalise, nReadRules;
+  nConWifi = nReadPlan = nMonitorPlan = nVocalise = nReadRules = 0;
+  static const char PROGMEM szFmt[] = {"%i %i %i %i %i"};
+  if ( sscanf_P(pArgs, szFmt, &nConWifi, &nReadPlan, &nMonitorPlan, &nVocalise, &nReadRules) != 5)
+    return R5_COMMAND_DONE;
+
+  uiGlobalFlags = (uiGlobalFlags & 0xFE0F) | ((nConWifi ? 0x10 : 0x0) | (nReadPlan ? 0x20 : 0x0) | (nMonitorPlan ? 0x40 : 0x0) | 
+        (nVocalise ? 0x80 : 0x0) | (nReadRules ? 0x100 : 0x0));
+  return R5_COMMAND_OK;
+}
+
+unsigned char cmdHelp(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen); // HELP needs robotCommands[], so it comes after
+
+unsigned char cmdVer(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // VER - report the date and time of last compilation
+{
+  DateTime compileTime(F(__DATE__), F(__TIME__));
+  static const char PROGMEM szFmt[] = {"%04u/%02u/%02u %02u:%02u:%02u"};
+  snprintf_P(pMsgBuff, uiBuffLen, szFmt, compileTime.year(), compileTime.month(), compileTime.day(),
+                            compileTime.hour(), compileTime.minute(), compileTime.second());
+  myOutput.outputData(pMsgBuff);            
+  return R5_COMMAND_DONE;
+}
+
+// SHOWIFI - report the current wifi params - SSID PW WifiRetry IP Port ServerRetry
+unsigned char cmdShoWifi(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  static const char PROGMEM szFmt[] = {"%s %s %u %s %u %u"};
+  snprintf_P(pMsgBuff, uiBuffLen, szFmt, myServerParams.szWifiSSID, myServerParams.szWifiPassword, (unsigned int)myServerParams.bWifiRetry,
+      myServerParams.szServerIP, myServerParams.uiServerPort, (unsigned int)myServerParams.bServerRetry);
+  myOutput.outputData(pMsgBuff);            
+  return R5_COMMAND_DONE;
+}
+
+// SHOCONF - show config startup flags - ConnectWifi ReadPlan MonitorPlan Vocalise ReadSpeakRules
+unsigned char cmdShoConf(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  int nConWifi = (uiGlobalFlags & 0x10) ? 1 : 0;
+  int nReadPlan = (uiGlobalFlags & 0x20) ? 1 : 0;
+  int nMonitorPlan = (uiGlobalFlags & 0x40) ? 1 : 0;
+  int nVocalise = (uiGlobalFlags & 0x80) ? 1 : 0;
+  int nReadRules = (uiGlobalFlags & 0x100) ? 1 : 0;
+  static const char PROGMEM szFmt[] = {"%i %i %i %i %i"};
+  snprintf_P(pMsgBuff, uiBuffLen, szFmt, nConWifi, nReadPlan, nMonitorPlan, nVocalise, nReadRules);
+  myOutput.outputData(pMsgBuff);            
+  return R5_COMMAND_DONE;
+}
 
-  switch (nRtn)
+// SHOREPORT - show report flags - Serial, Wifi, sensor value reporting, head matrix reporting
+unsigned char cmdShoReport(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  int nSerial = (uiGlobalFlags & 0x01) ? 1 : 0;
+  int nWifi = (uiGlobalFlags & 0x02) ? 1 : 0;
+  int nSensors = (uiGlobalFlags & 0x04) ? 1 : 0;
+  int nHeadMatrix = (uiGlobalFlags & 0x08) ? 1 : 0;
+  int nReportPlan = (uiGlobalFlags & 0x0200) ? 1 : 0;
+  int nReportVocalise = (uiGlobalFlags & 0x0400) ? 1 : 0;
+  int nTrace = (uiGlobalFlags & 0x0800) ? 1 : 0;
+  int nBinary = (uiGlobalFlags & 0x1000) ? 1 : 0;
+  static const char PROGMEM szFmt[] = {"%i %i %i %i %i %i %i %i %u"};
+  snprintf_P(pMsgBuff, uiBuffLen, szFmt, nSerial, nWifi, nSensors, nHeadMatrix, nReportPlan, nReportVocalise, nTrace, nBinary,
+        myTrace.getMotorInterval());
+  myOutput.outputData(pMsgBuff);            
+  return R5_COMMAND_DONE;
+}
+
+// SHORATE - show how many times per second do we process the plan? 0 means no plan processing
+unsigned char cmdShoRate(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  static const char PROGMEM szFmt[] = {"%u"};
+  snprintf_P(pMsgBuff, uiBuffLen, szFmt, uiPlanRate);
+  myOutput.outputData(pMsgBuff);      
+  return R5_COMMAND_DONE;
+}
+
+unsigned char cmdShoNames(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // SHONAMES - show the stored plan element names
+{
+  Instinct::instinctID bMaxID = myNames.maxElementNameID();
+  for (Instinct::instinctID i = 1; i <= bMaxID; i++)
   {
-  case 0: // PLAN - execute one of the Instinct CmdPlanner commands
-     if (strlen(pCmd) > (strlen(szCmd)+1))
-     {
-        bRtn = myPlan.executeCommand(pCmd + strlen(szCmd)+1, szMsgBuff, sizeof(szMsgBuff));
-        myOutput.outputData(szMsgBuff);
-     }
-     else
-     {
-        myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 2, szRobotMessages));
-        bRtn = false;
-     }
-     bSayOK = false;      
-     break;
-  case 1: // STOP - Disable the robot motors
-      motors.setParalyse(true);
-      bSayOK = true;
-      break;
-  case 2: // START - Enable the robot motors
-      motors.setParalyse(false);
-      bSayOK = true;
-      break;
-  case 3: // RESET - this annoyingly does not work due to watchdog resetting too fast after reboot - needs a bootloader fix
-      myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 3, szRobotMessages));
-      wdt_enable(WDTO_1S);
-      bSayOK = false;      
-      break;
-  case 4: // DUMP - Dump a complete listing of the Instinct Plan
-      {
-        Instinct::PlanNode aNode;
-        Instinct::instinctID nMaxID = myPlan.maxElementID();
-        for (Instinct::instinctID i = 0; i < nMaxID; i++)
-        { 
-          static const char PROGMEM szFmt[] = {"D N %i"};
-          snprintf_P(szCmd, sizeof(szCmd), szFmt, i+1);
-          if (myPlan.executeCommand(szCmd, szMsgBuff, sizeof(szMsgBuff)))
-          {
-            myOutput.outputData(szMsgBuff);
-          }
-        }
-        bSayOK = nMaxID ? 0 : 1; // just say OK if the plan is empty
-      }    
-      break;
-  case 5: // TIME - Report the time
-      {
-        DateTime now = rtc.now();
-        static const char PROGMEM szFmt[] = {"%04u/%02u/%02u %02u:%02u:%02u"};
-        snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, now.year(), now.month(), now.day(), now.hour(), now.minute(), now.second());
-        myOutput.outputData(szMsgBuff);
-        bSayOK = false;            
-      }
-      break;
-  case 6: // SETTIME - Set the time
-      if (strlen(pCmd) > (strlen(szCmd)+1))
-      {
-        int nYr, nMth, nDay, nHr, nMin, nSec;
-        nYr = nMth = nDay = nHr = nMin = nSec = 0;
-        static const char PROGMEM szFmt[] = {"%u %u %u %u %u %u"};
-        sscanf_P(pCmd + strlen(szCmd), szFmt, &nYr, &nMth, &nDay, &nHr, &nMin, &nSec);
-        rtc.adjust(DateTime(nYr, nMth, nDay, nHr, nMin, nSec));
-        bSayOK = true;           
-      }
-      break;
-  case 7: // REPORT - Turn on/off reporting to Serial port and wifi and also sensor value reporting
-          // e.g. REPORT 1 0 1 0 enables Serial, Disables Wifi, enables sensor value reporting, disables reporting of the head matrix
-          // uiGlobalFlags Bit 0 - write to Serial, Bit 1 - write to Wifi, Bit 2 - Report Sensors, Bit 3 - Report HeadMatrix
-          // Bit 9 - enable reporting of plan monitor data, Bit 10 - enable reporting of vocalisation data
+    char *pName;
+    if ( pName = myNames.getElementName(i) )
+    {
+      static const char PROGMEM szFmt[] = {"%s=%u"};
+      snprintf_P(pMsgBuff, uiBuffLen, szFmt, pName, i);
+      myOutput.outputData(pMsgBuff);
+    }
+  }
+  return R5_COMMAND_DONE;
+}
 
-      if (strlen(pCmd) > (strlen(szCmd)+1))
-      {
-        int nSerial, nWifi, nSensors, nHeadMatrix, nReportPlan, nReportVocalise;
-        nSerial = nWifi = nSensors = nHeadMatrix = nReportPlan = nReportVocalise = 0;
-        static const char PROGMEM szFmt[] = {"%i %i %i %i %i %i"};
-        sscanf_P(pCmd + strlen(szCmd), szFmt, &nSerial, &nWifi, &nSensors, &nHeadMatrix, &nReportPlan, &nReportVocalise);
-        uiGlobalFlags = (uiGlobalFlags & 0xF9F0) | ((nSerial ? 0x01 : 0x0) | (nWifi ? 0x02 : 0x0) |
-              (nSensors ? 0x04 : 0x0) | (nHeadMatrix ? 0x08 : 0x0) | (nReportPlan ? 0x0200 : 0x0) | (nReportVocalise ? 0x0400 : 0x0) );
-        bSayOK = true;      
-      }
-      break;
-  case 8: // RATE - how many times per second do we process the plan? 0 stops plan processing
-      if (strlen(pCmd) > (strlen(szCmd)+1))
-      {
-        uiPlanRate = 0;
-        static const char PROGMEM szFmt[] = {"%u"};
-        sscanf_P(pCmd + strlen(szCmd), szFmt, &uiPlanRate);
-        bSayOK = true;      
-      }
-      break;
-  case 9: // CAL - recalibrate sensors
-      sensors.calibrateBleed();    
-      bSayOK = true;      
-      break;
-  case 10: // CON - connect to wifi - useful if server started after robot is booted
-      bSayOK = true;
-      if(bRtn = tcpConnect(myServerParams.szServerIP, myServerParams.uiServerPort, 1)) // just try once
-      {
-        uiGlobalFlags = uiGlobalFlags | 0x02; // enable the flag that writes monitor output to wifi
-        myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 5, szRobotSetupMessages));
-        bSayOK = false;
-      }      
-      break;
-  case 11: // PELEM - associating a name with a plan element ID
-      if (strlen(pCmd) > (strlen(szCmd)+1))
-      {
-        static const char PROGMEM szFmt[] = {"%s %u"};
-        char szName[30];
-        unsigned int uiRuntime_ElementID = 0;
-        char * pParams = (char *)pCmd + strlen(szCmd);
-        // allow both space and = as delimeter between element name and its ID
-        char * pDelim = strchr(pParams, '=');
-        if (pDelim)
-          *pDelim = ' ';          
-        sscanf_P(pParams, szFmt, szName, &uiRuntime_ElementID);
-        bSayOK = myNames.addElementName((Instinct::instinctID)uiRuntime_ElementID, szName);      
-      }
-      break;
-  case 12: // RSENSE - associating a name with a robot sense ID
-      break;
-  case 13: // RACTION - associating a name with a robot action ID
-    // we just ignore this for now
-      break;
-  case 14: // HSTOP - stop robot head from scanning
-      myHead.setParalyse(true);
-      bSayOK = true;      
-      break;
-  case 15: // HSTART - allow robot head to scan
-      myHead.setParalyse(false);
-      bSayOK = true;      
-      break;
-  case 16: // SPLAN - save robot plan in EEPROM
-      bRtn = myMemory.writeData(&myPlan, myNames.elementBufferSize(), myNames.elementBuffer());
-      bSayOK = true;      
-      break;
-  case 17: // RPLAN - read robot plan from EEPROM
-      bRtn = myMemory.readData(&myPlan, myNames.elementBufferSize(), myNames.elementBuffer());
-      bSayOK = true;      
-      break;
-  case 18: // SCONF - save robot config in EEPROM
-      myMemory.setServerParams(&myServerParams);
-      myMemory.setGlobalFlags(uiGlobalFlags);
-      myMemory.setPlanRate(uiPlanRate);
-      bSayOK = true;      
-      break;
-  case 19: // RCONF - read robot config from EEPROM
-      myMemory.getServerParams(&myServerParams);
-      uiGlobalFlags = myMemory.getGlobalFlags();
-      uiPlanRate = myMemory.getPlanRate();
-      bSayOK = true;      
-      break;
-  case 20: // SWIFI - set the Wifi params - SSID, Password, Wifi Retries, ServerIP, ServerPort, ServerRetries
-    bRtn = false;
-    bSayOK = true;      
-    if (strlen(pCmd) > (strlen(szCmd)+1))
+// SPEAKRULE N N N N N N - set rule - NodeType Status Timeout RepeatMyself RptTimeout AlwaysSpeak
+unsigned char cmdSpeakRule(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  unsigned int uiNodeType, uiStatus, uiTimeout, uiRepeatMyself, uiRptTimeout, uiAlwaysSpeak;
+  uiNodeType = uiStatus = uiTimeout = uiRepeatMyself = uiRptTimeout = uiAlwaysSpeak = 0;
+  static const char PROGMEM szFmt[] = {"%u %u %u %u %u %u"};
+  if ( sscanf_P(pArgs, szFmt, &uiNodeType, &uiStatus, &uiTimeout, &uiRepeatMyself, &uiRptTimeout, &uiAlwaysSpeak) != 6)
+    return R5_COMMAND_OK;
+
+  return myMonitor.setSpeakRule((unsigned char)uiNodeType, (unsigned char)uiStatus,
+                   uiTimeout, (unsigned char)uiRepeatMyself, uiRptTimeout, (unsigned char)uiAlwaysSpeak) ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
+
+unsigned char cmdShoRules(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // SHORULES - show speak rules
+{
+  for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+  {
+    char szNodeTypeName[5];
+    getNodeTypeName(szNodeTypeName, sizeof(szNodeTypeName), i);
+    
+    for (unsigned char j = 0; j < INSTINCT_RUNTIME_NOT_RELEASED; j++)
     {
-      unsigned int uiWifiRetry, uiServerRetry;
-      uiWifiRetry = uiServerRetry = 1;
-      static const char PROGMEM szFmt[] = {"%s %s %u %s %u %u"};
-      if (sscanf_P(pCmd + strlen(szCmd), szFmt, myServerParams.szWifiSSID, myServerParams.szWifiPassword, &uiWifiRetry,
-            myServerParams.szServerIP, &myServerParams.uiServerPort, &uiServerRetry) == 6)
-      {
-        myServerParams.bWifiRetry = uiWifiRetry;
-        myServerParams.bServerRetry = uiServerRetry;
-        myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 4, szRobotMessages));
-        bSayOK = false;
-        bRtn = true;
-      } 
+      R5SpeakRulesType *pRule = myMonitor.getSpeakRule(i, j); 
+      static const char PROGMEM szFmt[] = {"%s %u %u %u %u %u"};
+      snprintf_P(pMsgBuff, uiBuffLen, szFmt, szNodeTypeName, j, pRule->uiTimeout, pRule->bRepeatMyself, pRule->uiRptTimeout, pRule->bAlwaysSpeak);
+      myOutput.outputData(pMsgBuff);
     }
-    break;
-  case 21: // CONF - sets config flags - Bit 4 - attempt Wifi & Instinct Server Connection on boot, Bit 5 - attempt restore of plan from EEPROM on boot
-          // Bit 6 - enable full plan monitoring on boot, Bit 7 - vocalise monitor trace, Bit 8 - read speak rules from EEPROM on boot
-      if (strlen(pCmd) > (strlen(szCmd)+1))
-      {
-        int nConWifi, nReadPlan, nMonitorPlan, nVocalise, nReadRules;
-        nConWifi = nReadPlan = nMonitorPlan = nVocalise = nReadRules = 0;
-        static const char PROGMEM szFmt[] = {"%i %i %i %i %i"};
-        if ( sscanf_P(pCmd + strlen(szCmd), szFmt, &nConWifi, &nReadPlan, &nMonitorPlan, &nVocalise, &nReadRules) == 5)
-        {
-          uiGlobalFlags = (uiGlobalFlags & 0xFE0F) | ((nConWifi ? 0x10 : 0x0) | (nReadPlan ? 0x20 : 0x0) | (nMonitorPlan ? 0x40 : 0x0) | 
-                (nVocalise ? 0x80 : 0x0) | (nReadRules ? 0x100 : 0x0));
-          bSayOK = true;
-        }      
-      }
-      break;
- case 22: // HELP - return help to the user
-      if (strlen(pCmd) > (strlen(szCmd)+1))
-      {
-        char szOption[20];
-        unsigned char nOption;
-        static const char PROGMEM szFmt[] = {"%s"};
-        szOption[0] = 0;
-        sscanf_P(pCmd + strlen(szCmd), szFmt, szOption);
-        strupr(szOption); // command words are case insensitive
-        nOption = findProgmemStr(szOption, szCommands);
-        bRtn = helpCommand(szMsgBuff, nOption);
-      }
-      else
-      {
-        char szOption[20];
-        unsigned char nOption = 0;
-        szMsgBuff[0] = 0;
-        while (strlen(getProgmemStr(szOption, sizeof(szOption), nOption, szCommands)) > 0)
-        {
-          nOption++;
-          bRtn = true;
-          if ((strlen(szMsgBuff)+ strlen(szOption) + 3) > sizeof(szMsgBuff))
-          {
-            myOutput.outputData(szMsgBuff);
-            szMsgBuff[0] = 0;
-          }
-          strncat(szMsgBuff, szOption, sizeof(szMsgBuff));
-          strncat(szMsgBuff, " ", sizeof(szMsgBuff));         
-        }
-        if (strlen(szMsgBuff) > 0)
-          myOutput.outputData(szMsgBuff);
-      }
-      bSayOK = !bRtn;
-              
-      break;
-  case 23: // VER - report the date and time of last compilation
-      {
-        DateTime compileTime(F(__DATE__), F(__TIME__));
-        static const char PROGMEM szFmt[] = {"%04u/%02u/%02u %02u:%02u:%02u"};
-        snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, compileTime.year(), compileTime.month(), compileTime.day(),
-                                  compileTime.hour(), compileTime.minute(), compileTime.second());
-        myOutput.outputData(szMsgBuff);            
-      }
-      break;
- case 24: // SHOWIFI - report the current wifi params - SSID PW WifiRetry IP Port ServerRetry
-      {
-        static const char PROGMEM szFmt[] = {"%s %s %u %s %u %u"};
-        snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, myServerParams.szWifiSSID, myServerParams.szWifiPassword, (unsigned int)myServerParams.bWifiRetry,
-            myServerParams.szServerIP, myServerParams.uiServerPort, (unsigned int)myServerParams.bServerRetry);
-        myOutput.outputData(szMsgBuff);            
-      }
-      break;
-case 25: // SHOCONF - show config startup flags - ConnectWifi ReadPlan MonitorPlan Vocalise ReadSpeakRules
-      {
-        int nConWifi = (uiGlobalFlags & 0x10) ? 1 : 0;
-        int nReadPlan = (uiGlobalFlags & 0x20) ? 1 : 0;
-        int nMonitorPlan = (uiGlobalFlags & 0x40) ? 1 : 0;
-        int nVocalise = (uiGlobalFlags & 0x80) ? 1 : 0;
-        int nReadRules = (uiGlobalFlags & 0x100) ? 1 : 0;
-        static const char PROGMEM szFmt[] = {"%i %i %i %i %i"};
-        snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, nConWifi, nReadPlan, nMonitorPlan, nVocalise, nReadRules);
-        myOutput.outputData(szMsgBuff);            
-      }
-      break;
-case 26: // SHOREPORT - show report flags - Serial, Wifi, sensor value reporting, head matrix reporting
-      {
-        int nSerial = (uiGlobalFlags & 0x01) ? 1 : 0;
-        int nWifi = (uiGlobalFlags & 0x02) ? 1 : 0;
-        int nSensors = (uiGlobalFlags & 0x04) ? 1 : 0;
-        int nHeadMatrix = (uiGlobalFlags & 0x08) ? 1 : 0;
-        int nReportPlan = (uiGlobalFlags & 0x0200) ? 1 : 0;
-        int nReportVocalise = (uiGlobalFlags & 0x0400) ? 1 : 0;
-        static const char PROGMEM szFmt[] = {"%i %i %i %i %i %i"};
-        snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, nSerial, nWifi, nSensors, nHeadMatrix, nReportPlan, nReportVocalise);
-        myOutput.outputData(szMsgBuff);            
-      }
-      break;
-  case 27: // SHORATE - show how many times per second do we process the plan? 0 means no plan processing
-      {
-        static const char PROGMEM szFmt[] = {"%u"};
-        snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, uiPlanRate);
-        myOutput.outputData(szMsgBuff);      
-      }
-      break;
-  case 28: // SHONAMES - show the stored plan element names
-      {
-        Instinct::instinctID bMaxID = myNames.maxElementNameID();
-        for (Instinct::instinctID i = 1; i <= bMaxID; i++)
-        {
-          char *pName;
-          if ( pName = myNames.getElementName(i) )
-          {
-            static const char PROGMEM szFmt[] = {"%s=%u"};
-            snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, pName, i);
-            myOutput.outputData(szMsgBuff);
-          }
-        }
-      }
-      break;
-  case 29: // SPEAKRULE N N N N N N - set rule - NodeType Status Timeout RepeatMyself RptTimeout AlwaysSpeak
-      bSayOK = true;
-      if (strlen(pCmd) > (strlen(szCmd)+1))
-      {
-        unsigned int uiNodeType, uiStatus, uiTimeout, uiRepeatMyself, uiRptTimeout, uiAlwaysSpeak;
-        uiNodeType = uiStatus = uiTimeout = uiRepeatMyself = uiRptTimeout = uiAlwaysSpeak = 0;
-        static const char PROGMEM szFmt[] = {"%u %u %u %u %u %u"};
-        if ( sscanf_P(pCmd + strlen(szCmd), szFmt, &uiNodeType, &uiStatus, &uiTimeout, &uiRepeatMyself, &uiRptTimeout, &uiAlwaysSpeak) == 6)
-        {
-          bRtn = myMonitor.setSpeakRule((unsigned char)uiNodeType, (unsigned char)uiStatus,
-                         uiTimeout, (unsigned char)uiRepeatMyself, uiRptTimeout, (unsigned char)uiAlwaysSpeak);
-        }      
-      }
-      break;
-  case 30: // SHORULES - show speak rules
-      for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
-      {
-        char szNodeTypeName[5];
-        getNodeTypeName(szNodeTypeName, sizeof(szNodeTypeName), i);
-        
-        for (unsigned char j = 0; j < INSTINCT_RUNTIME_NOT_RELEASED; j++)
-        {
-          R5SpeakRulesType *pRule = myMonitor.getSpeakRule(i, j); 
-          static const char PROGMEM szFmt[] = {"%s %u %u %u %u %u"};
-          snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, szNodeTypeName, j, pRule->uiTimeout, pRule->bRepeatMyself, pRule->uiRptTimeout, pRule->bAlwaysSpeak);
-          myOutput.outputData(szMsgBuff);
-        }
-      }
-      break;
-  case 31: // SRULES - save speak rules in EEPROM
-      bSayOK = true;
-      bRtn = myMemory.setSpeakRules(myMonitor.getSpeakRule(0,0));
-      break;
-  case 32: // RRULES - read speak rules from EEPROM
-      bSayOK = true;
-      bRtn = myMemory.getSpeakRules(myMonitor.getSpeakRule(0,0));
-      break;
-  case 33: // CNAMES - clear plan element names
-      bSayOK = true;
-      bRtn = myNames.clearElementNames();
-      break;
-  default:
-    getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 1, szRobotMessages);
-    strncat(szMsgBuff, szCmd, sizeof(szMsgBuff));
-    myOutput.outputData(szMsgBuff);
-    myOutput.outputData(getProgmemStr(szMsgBuff, sizeof(szMsgBuff), 0, szRobotMessages));
-    bRtn = false;
-    break;
   }
+  return R5_COMMAND_DONE;
+}
+
+unsigned char cmdSRules(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // SRULES - save speak rules in EEPROM
+{
+  return myMemory.setSpeakRules(myMonitor.getSpeakRule(0,0)) ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
+
+unsigned char cmdRRules(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // RRULES - read speak rules from EEPROM
+{
+  return myMemory.getSpeakRules(myMonitor.getSpeakRule(0,0)) ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
+
+unsigned char cmdCNames(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen) // CNAMES - clear plan element names
+{
+  return myNames.clearElementNames() ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
+
+// PID N [N N N] - enable/disable closed loop track speed control, optionally setting the Kp Ki Kd gains (1/16ths)
+unsigned char cmdPID(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  int nEnable, nKp, nKi, nKd;
+  motors.getSpeedGains(&nKp, &nKi, &nKd);
+  static const char PROGMEM szFmt[] = {"%i %i %i %i"};
+  if (!*pArgs)
+  {
+    snprintf_P(pMsgBuff, uiBuffLen, szFmt, motors.getSpeedControl(), nKp, nKi, nKd);
+    myOutput.outputData(pMsgBuff);
+    return R5_COMMAND_DONE;
+  }
+  nEnable = 0;
+  sscanf_P(pArgs, szFmt, &nEnable, &nKp, &nKi, &nKd);
+  unsigned char bRtn = motors.setSpeedGains(nKp, nKi, nKd);
+  motors.setSpeedControl(nEnable);
+  return bRtn ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
 
-  if (bSayOK)
+// MLIMITS N N - set the maximum speed % and acceleration %/s used by move and turn. Acceleration 0 uses fixed speeds
+unsigned char cmdMLimits(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  int nMaxSpeed, nAccel;
+  motors.getMotionLimits(&nMaxSpeed, &nAccel);
+  static const char PROGMEM szFmt[] = {"%i %i"};
+  if (!*pArgs)
   {
-    myOutput.outputData(bRtn ? "OK" : "Fail");
-  }  
-  return bRtn;  
-}
-
-// return help details for a specific command line option
-// use pMsgBuff as a char buffer 
-unsigned char helpCommand(char *pMsgBuff, unsigned char nOption)
-{
-  unsigned char bRtn = false;
-  unsigned char bHelpLine = 0;
-
-  static const char PROGMEM szCommandHelp[] = {"PLAN!"
-"STOP - Disable the robot motors!"
-"START - Enable the robot motors!"
-"RESET - does not work - needs a bootloader fix!"
-"DUMP - Dump a complete listing of the Instinct Plan!"
-"TIME - Report the time!"
-"SETTIME YYYY MM DD HH MM SS - Set the time!"
-"REPORT N N N N N N - Enable/disable reporting - Serial Wifi Sensors HeadMatrix Plan Vocalise!"
-"RATE N - Set plan rate - cycles per second - 0 to stop plan execution!"
-"CAL - recalibrate sensors!"
-"CON - connect to wifi - useful if server started after robot is booted!"
-"PELEM [name]=[ID] - associate a name with a plan element ID!"
-"RSENSE [name]=[ID] - associate a name with a robot sense ID!"
-"RACTION [name]=[ID] - associate a name with a robot action ID!"
-"HSTOP - stop robot head from scanning!"
-"HSTART - allow robot head to scan!"
-"SPLAN - save robot plan in EEPROM!"
-"RPLAN - read robot plan from EEPROM!"
-"SCONF - save robot config in EEPROM!"
-"RCONF - read robot config from EEPROM!"
-"SWIFI SSID PW WifiRetry IP Port ServerRetry - set wifi params!"
-"CONF N N N N N - set config flags - ConnectWifi ReadPlan MonitorPlan Vocalise ReadSpeakRules!"
-"HELP - return command list to the user - HELP [CMD] - command help!"
-"VER - return date and time of last compilation!"
-"SHOWIFI - show wifi params - SSID PW WifiRetry IP Port ServerRetry!"
-"SHOCONF - show startup flags - ConnectWifi ReadPlan MonitorPlan Vocalise ReadSpeakRules!"
-"SHOREPORT - show report flags - Serial, Wifi, sensor values, head matrix values!"
-"SHORATE - show plan cycle rate. 0 means no plan processing!"
-"SHONAMES - show plan element names stored in the robot!"
-"SPEAKRULE N N N N N N - set rule - NodeType Status Timeout RepeatMyself RptTimeout AlwaysSpeak!"
-"SHORULES - show speak rules!"
-"SRULES - save speak rules in EEPROM!"
-"RRULES - read speak rules from EEPROM!"
-"CNAMES - clear plan element names!"
+    snprintf_P(pMsgBuff, uiBuffLen, szFmt, nMaxSpeed, nAccel);
+    myOutput.outputData(pMsgBuff);
+    return R5_COMMAND_DONE;
+  }
+  sscanf_P(pArgs, szFmt, &nMaxSpeed, &nAccel);
+  if ((nAccel < 0) || (nAccel > R5_PROFILE_MAXACCEL))
+    return R5_COMMAND_SAY;
+  return motors.setMotionLimits(nMaxSpeed, nAccel) ? R5_COMMAND_OK : R5_COMMAND_SAY;
+}
+
+// PIMAGE N - the next N bytes are a binary plan image made by r5plan. OK or Fail comes once it is loaded
+unsigned char cmdPImage(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  unsigned int uiLength = 0;
+  static const char PROGMEM szFmt[] = {"%u"};
+  sscanf_P(pArgs, szFmt, &uiLength);
+  myPlanImage.begin(uiLength);
+  return myPlanImage.isLoading() ? R5_COMMAND_DONE : R5_COMMAND_SAY;
+}
+
+// OUTPUT [N] - set the policy when the Serial or Wifi output buffer is full, 0 drop oldest, 1 drop newest, 2 wait
+// OUTPUT alone shows, for Serial then Wifi, the policy, bytes waiting, most bytes ever waiting, records and bytes dropped
+// and then the Wifi batches sent, the bytes in them, and how many were sent short because the oldest record had waited
+unsigned char cmdOutput(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  if (!*pArgs)
+  {
+    static const char PROGMEM szFmt[] = {"%u %u %u %lu %lu %u %u %u %lu %lu"};
+    snprintf_P(pMsgBuff, uiBuffLen, szFmt,
+          mySerialOut.getPolicy(), mySerialOut.getUsed(), mySerialOut.getHighWater(), mySerialOut.getDropped(), mySerialOut.getDroppedBytes(),
+          myWifiOut.getPolicy(), myWifiOut.getUsed(), myWifiOut.getHighWater(), myWifiOut.getDropped(), myWifiOut.getDroppedBytes());
+    myOutput.outputData(pMsgBuff);
+    static const char PROGMEM szBatchFmt[] = {"%lu %lu %lu"};
+    snprintf_P(pMsgBuff, uiBuffLen, szBatchFmt, myWifiOut.getBatches(), myWifiOut.getBatchedBytes(), myWifiOut.getLateBatches());
+    myOutput.outputData(pMsgBuff);
+    return R5_COMMAND_DONE;
+  }
+  int nPolicy = R5_OUTPUT_DROP_OLDEST;
+  static const char PROGMEM szFmt[] = {"%i"};
+  sscanf_P(pArgs, szFmt, &nPolicy);
+  if ((nPolicy < R5_OUTPUT_DROP_OLDEST) || (nPolicy > R5_OUTPUT_BLOCK))
+    return R5_COMMAND_SAY;
+  mySerialOut.setPolicy(nPolicy);
+  myWifiOut.setPolicy(nPolicy);
+  return R5_COMMAND_OK;
+}
+
+// REPORT Sensors HeadMatrix and Plan subscribe to X and Y each plan cycle, and to every plan monitor record
+// A channel already subscribed is left as it is, so that REPORT does not undo SUB
+void applyReportFlags(void)
+{
+  const static unsigned char PROGMEM bChannels[] = {R5_CHANNEL_SENSORS, R5_CHANNEL_HEADMATRIX, R5_CHANNEL_MONITOR};
+  const static unsigned int PROGMEM uiFlags[] = {0x04, 0x08, 0x0200};
+  const static unsigned char PROGMEM bTriggers[] = {R5_TRIGGER_PLAN, R5_TRIGGER_PLAN, R5_TRIGGER_CHANGE};
+
+  for (unsigned char i = 0; i < sizeof(bChannels); i++)
+  {
+    unsigned char bChannel = pgm_read_byte(bChannels + i);
+    if (!(uiGlobalFlags & pgm_read_word(uiFlags + i)))
+      mySubs.unsubscribe(bChannel);
+    else if (!mySubs.isActive(bChannel))
+      mySubs.subscribe(bChannel, pgm_read_byte(bTriggers + i), 0, 1);
+  }
+  mySubs.setBinary(uiGlobalFlags & 0x1000);
+}
+
+// after SUB or UNSUB, keep the REPORT flags for X, Y and the plan monitor in step with the channels
+void setReportFlags(void)
+{
+  uiGlobalFlags = (uiGlobalFlags & ~0x020C) | (mySubs.isActive(R5_CHANNEL_SENSORS) ? 0x04 : 0x0) |
+        (mySubs.isActive(R5_CHANNEL_HEADMATRIX) ? 0x08 : 0x0) | (mySubs.isActive(R5_CHANNEL_MONITOR) ? 0x0200 : 0x0);
+}
+
+// SUB L T [mS [N]] - report channel L (X Y C G O M H P) when trigger T fires, 0 off 1 plan cycle 2 every mS
+// 3 on change, no more often than every mS, 4 end of head sweep. N sends every Nth time. SUB alone lists the channels
+unsigned char cmdSub(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  R5SubscriptionType sub;
+
+  if (!*pArgs)
+  {
+    static const char PROGMEM szFmt[] = {"%c %u %u %u"};
+    for (unsigned char i = 0; i < R5_CHANNELS; i++)
+    {
+      mySubs.getSubscription(i, &sub);
+      snprintf_P(pMsgBuff, uiBuffLen, szFmt, R5_CHANNEL_LETTERS[i], sub.bTrigger, sub.uiPeriod, sub.bDecimation);
+      myOutput.outputData(pMsgBuff);
+    }
+    return R5_COMMAND_DONE;
+  }
+  char szChannel[2];
+  unsigned int uiTrigger, uiPeriod, uiDecimation;
+  uiTrigger = uiPeriod = 0;
+  uiDecimation = 1;
+  static const char PROGMEM szFmt[] = {"%1s %u %u %u"};
+  if (sscanf_P(pArgs, szFmt, szChannel, &uiTrigger, &uiPeriod, &uiDecimation) < 2)
+    return R5_COMMAND_SAY;
+  if ((uiTrigger > R5_TRIGGER_SWEEP) || (uiDecimation > 255) || !mySubs.subscribe(mySubs.getChannel(toupper(szChannel[0])), uiTrigger, uiPeriod, uiDecimation))
+    return R5_COMMAND_SAY;
+  setReportFlags();
+  return R5_COMMAND_OK;
+}
+
+// UNSUB [L] - stop reporting channel L. UNSUB alone stops them all
+unsigned char cmdUnsub(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  char szChannel[2];
+  static const char PROGMEM szFmt[] = {"%1s"};
+
+  if (!*pArgs)
+  {
+    for (unsigned char i = 0; i < R5_CHANNELS; i++)
+      mySubs.unsubscribe(i);
+  }
+  else
+  {
+    szChannel[0] = 0;
+    sscanf_P(pArgs, szFmt, szChannel);
+    unsigned char bChannel = mySubs.getChannel(toupper(szChannel[0]));
+    if (bChannel >= R5_CHANNELS)
+      return R5_COMMAND_SAY;
+    mySubs.unsubscribe(bChannel);
+  }
+  setReportFlags();
+  return R5_COMMAND_OK;
+}
+
+// the command words and help, in flash, made from the list in R5RobotCommands.h. The table must stay in
+// alphabetical order, which is checked when it compiles
+#define ROBOT_COMMAND_STRINGS(name, word, handler, args, help) \
+  constexpr char PROGMEM szCmd##name[] = word; \
+  const char PROGMEM szHelp##name[] = help;
+R5_ROBOT_COMMANDS(ROBOT_COMMAND_STRINGS)
+
+#define ROBOT_COMMAND_ENTRY(name, word, handler, args, help) {szCmd##name, handler, args, szHelp##name},
+constexpr R5CommandType PROGMEM robotCommands[] = {
+  R5_ROBOT_COMMANDS(ROBOT_COMMAND_ENTRY)
 };
-  
+#define ROBOT_COMMANDS (sizeof(robotCommands) / sizeof(R5CommandType))
+static_assert(commandsSorted(robotCommands, ROBOT_COMMANDS), "robotCommands[] must be in alphabetical order");
 
-  if (nOption == 0) // this is the PLAN command, so help comes from the CmdPlanner class
+// HELP - return help to the user. HELP alone lists the commands
+unsigned char cmdHelp(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen)
+{
+  char szOption[20];
+  R5CommandType command;
+
+  if (*pArgs)
+  {
+    static const char PROGMEM szFmt[] = {"%s"};
+    szOption[0] = 0;
+    sscanf_P(pArgs, szFmt, szOption);
+    strupr(szOption); // command words are case insensitive
+    int nOption = findCommand(szOption, robotCommands, ROBOT_COMMANDS);
+    if (nOption < 0)
+      return R5_COMMAND_SAY;
+
+    getCommand(&command, robotCommands, nOption);
+    if (command.pfnHandler == cmdPlan) // help for the PLAN command comes from the CmdPlanner class
+    {
+      unsigned char bHelpLine = 0;
+      while(strlen(getProgmemStr(pMsgBuff, uiBuffLen, bHelpLine, myPlan.help())) > 0)
+      {
+        bHelpLine++;
+        myOutput.outputData(pMsgBuff);
+      }
+      return bHelpLine ? R5_COMMAND_DONE : R5_COMMAND_SAY;
+    }
+    strncpy_P(pMsgBuff, command.pszHelp, uiBuffLen - 1);
+    pMsgBuff[uiBuffLen - 1] = 0;
+    myOutput.outputData(pMsgBuff);
+    return R5_COMMAND_DONE;
+  }
+
+  pMsgBuff[0] = 0;
+  for (unsigned char i = 0; i < ROBOT_COMMANDS; i++)
   {
-    while(strlen(getProgmemStr(pMsgBuff, R5_MSG_BUFF_SIZE, bHelpLine, myPlan.help())) > 0)
+    getCommand(&command, robotCommands, i);
+    strncpy_P(szOption, command.pszName, sizeof(szOption) - 1);
+    szOption[sizeof(szOption) - 1] = 0;
+    if ((strlen(pMsgBuff)+ strlen(szOption) + 3) > uiBuffLen)
     {
-      bHelpLine++;
-      bRtn = true;
       myOutput.outputData(pMsgBuff);
+      pMsgBuff[0] = 0;
     }
+    strcat(pMsgBuff, szOption);
+    strcat(pMsgBuff, " ");         
+  }
+  if (strlen(pMsgBuff) > 0)
+    myOutput.outputData(pMsgBuff);
+  return R5_COMMAND_DONE;
+}
+
+// Process a command line - the command word, found in robotCommands[], then its arguments
+// 
+unsigned char parseRobotCommand(const char *pCmd)
+{
+  char szCmd[20];
+  char szMsgBuff[R5_MSG_BUFF_SIZE];
+  R5CommandType command;
+  unsigned char bRtn;
+
+  static const char PROGMEM szFmt[] = {"%s "};
+  szCmd[0] = 0;
+  int nRtn = sscanf_P(pCmd, szFmt, szCmd);
+
+  if (!nRtn || !strlen(szCmd))
+  {
+    myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_USE_HELP));
+    return false;
   }
-  else if (strlen(getProgmemStr(pMsgBuff, R5_MSG_BUFF_SIZE, nOption, szCommandHelp)) > 0)
+
+  strupr(szCmd); // make command words case insensitive
+  nRtn = findCommand(szCmd, robotCommands, ROBOT_COMMANDS);
+  if (nRtn < 0)
   {
-    bRtn = true;
-    myOutput.outputData(pMsgBuff);      
+    getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_INVALID_COMMAND);
+    strncat(szMsgBuff, szCmd, sizeof(szMsgBuff) - strlen(szMsgBuff) - 1);
+    myOutput.outputData(szMsgBuff);
+    myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_USE_HELP));
+    return false;
   }
 
-  return bRtn;
+  getCommand(&command, robotCommands, nRtn);
+  const char *pArgs = pCmd + strlen(szCmd);
+  if (*pArgs) // skip the space after the command word
+    pArgs++;
+  if (command.bArgs == R5_COMMAND_NONE)
+    pArgs = "";
+
+  if ((command.bArgs == R5_COMMAND_REQUIRED) && !*pArgs)
+    bRtn = R5_COMMAND_SAY; // Fail
+  else
+    bRtn = (*command.pfnHandler)(pArgs, szMsgBuff, sizeof(szMsgBuff));
+
+  if (bRtn & R5_COMMAND_SAY)
+  {
+    myOutput.outputData((bRtn & R5_COMMAND_DONE) ? "OK" : "Fail");
+  }  
+  return bRtn & R5_COMMAND_DONE;  
 }
 
 // log execution type and node data
@@ -869,7 +1153,7 @@ void writeOutput(const Instinct::PlanNode * pPlanNode, const char *pType, const
   const static char PROGMEM szFmt[] = {" %i"};
 
   // if we are not writing to console or wifi, then save time
-  if (!(uiGlobalFlags & 0x03) || !(uiGlobalFlags & 0x0200))
+  if (!(uiGlobalFlags & 0x03) || !mySubs.due(R5_CHANNEL_MONITOR, millis(), R5_EVENT_CHANGE))
     return;
   
   strcpy(szDisplayBuff, pType);
@@ -893,86 +1177,150 @@ void writeOutput(const Instinct::PlanNode * pPlanNode, const char *pType, const
   myOutput.outputData(szDisplayBuff);
 }
 
-// report the values of the 4 corner sensors, plus the rudder in degrees and distance travelled in mm
-// 0 = sensor 1 FR, 1 = sensor 2 FL, 2 = sensor 3 RL, 4 = sensor 4 RR  -- distances are in mm
-// edges: 0 = front, 1 = left, 2 = rear, 3 = right
-void reportSensorValues(void)
+// report the channels subscribed by SUB or REPORT. bEvents is R5_EVENT_PLAN on a plan cycle, the end of a head sweep is noticed here
+// X - corners 0 = sensor 1 FR, 1 = sensor 2 FL, 2 = sensor 3 RL, 4 = sensor 4 RR, then edge distances and angles, 0 = front,
+// 1 = left, 2 = rear, 3 = right, then rudder, distance travelled, motor current, PIR, ultrasonic range and head min range
+// X comes from myFrame, so it is exactly what the plan sees this cycle. The other channels are read as they are now
+void reportChannels(const unsigned char bEvents)
 {
-  char szDisplayBuff[100];
-  int nCornerDist[4];
-  int nEdgeDist[4];
-  int nEdgeAngle[4];
-  
-  for (int i = 0; i < 4; i++)
+  static unsigned int uiSweeps = 0;
+  static unsigned char bSweepEnded = false;
+  long lValues[R5_TELEMETRY_FIELDS];
+  unsigned char bAllEvents = bEvents;
+  unsigned long ulMillis = millis();
+  unsigned char n;
+  R5PoseType pose;
+
+  if (myHead.getSweeps() != uiSweeps)
   {
-      nCornerDist[i] = sensors.getCornerDistance(i);
-      nEdgeDist[i] = sensors.getEdgeDistance(i);
-      nEdgeAngle[i] = sensors.getEdgeAngle(i);
+    uiSweeps = myHead.getSweeps();
+    bAllEvents |= R5_EVENT_SWEEP;
+  }
+
+  if (mySubs.isActive(R5_CHANNEL_SENSORS))
+  {
+    n = 0;
+    for (int i = 0; i < 4; i++)
+      lValues[n++] = myFrame.getCornerDistance(i);
+    for (int i = 0; i < 4; i++)
+      lValues[n++] = myFrame.getEdgeDistance(i);
+    for (int i = 0; i < 4; i++)
+      lValues[n++] = myFrame.getEdgeAngle(i);
+    lValues[n++] = myFrame.getRudder();
+    lValues[n++] = myFrame.getDistanceTravelled();
+    lValues[n++] = myFrame.getMotorCurrent(0);
+    lValues[n++] = myFrame.getPIRActivated();
+    lValues[n++] = myFrame.getUltrasonicRange();
+    lValues[n++] = myFrame.getHMinRange();
+    mySubs.send(R5_CHANNEL_SENSORS, ulMillis, bAllEvents, lValues, n);
+  }
+  if (bAllEvents & R5_EVENT_SWEEP)
+    bSweepEnded = true;
+  // the head marks the cells that change, so Y is only sent when there is something new
+  if (mySubs.isActive(R5_CHANNEL_HEADMATRIX) && myHead.getDirtyCells() &&
+      mySubs.due(R5_CHANNEL_HEADMATRIX, ulMillis, bAllEvents | R5_EVENT_CHANGE))
+  {
+    reportHeadMatrix(ulMillis, bSweepEnded);
+    bSweepEnded = false;
+  }
+  if (mySubs.isActive(R5_CHANNEL_CORNERS))
+  {
+    for (n = 0; n < 4; n++)
+      lValues[n] = sensors.getCornerDistance(n);
+    mySubs.send(R5_CHANNEL_CORNERS, ulMillis, bAllEvents, lValues, n);
+  }
+  if (mySubs.isActive(R5_CHANNEL_EDGES))
+  {
+    for (n = 0; n < 4; n++)
+    {
+      lValues[n] = sensors.getEdgeDistance(n);
+      lValues[n + 4] = sensors.getEdgeAngle(n);
+    }
+    mySubs.send(R5_CHANNEL_EDGES, ulMillis, bAllEvents, lValues, 8);
+  }
+  if (mySubs.isActive(R5_CHANNEL_ODOMETRY))
+  {
+    motors.getPose(&pose);
+    lValues[0] = motors.getDistanceTravelled();
+    lValues[1] = pose.lX;
+    lValues[2] = pose.lY;
+    lValues[3] = pose.nHeading;
+    lValues[4] = motors.getWheelVelocity(1);
+    lValues[5] = motors.getWheelVelocity(2);
+    mySubs.send(R5_CHANNEL_ODOMETRY, ulMillis, bAllEvents, lValues, 6);
+  }
+  if (mySubs.isActive(R5_CHANNEL_MOTORS))
+  {
+    lValues[0] = motors.getMotorCurrent(1);
+    lValues[1] = motors.getMotorCurrent(2);
+    lValues[2] = motors.getSpeed();
+    lValues[3] = motors.getRudder();
+    mySubs.send(R5_CHANNEL_MOTORS, ulMillis, bAllEvents, lValues, 4);
+  }
+  if (mySubs.isActive(R5_CHANNEL_PIR))
+  {
+    lValues[0] = myPIR.activated();
+    mySubs.send(R5_CHANNEL_PIR, ulMillis, bAllEvents, lValues, 1);
   }
-  static const char PROGMEM szFmt[] = {"X %i %i %i %i %i %i %i %i %i %i %i %i %i %li %i %i %i %i"};
-  snprintf_P(szDisplayBuff, sizeof(szDisplayBuff), szFmt, nCornerDist[0], nCornerDist[1], nCornerDist[2], nCornerDist[3],
-                                                                  nEdgeDist[0], nEdgeDist[1], nEdgeDist[2], nEdgeDist[3],
-                                                                  nEdgeAngle[0], nEdgeAngle[1], nEdgeAngle[2], nEdgeAngle[3],
-                                                                  motors.getRudder(), motors.getDistanceTravelled(),
-                                                                  motors.getMotorCurrent(0), myPIR.activated(),
-                                                                  myRanger.range(), myHead.getHMinRange(0) );
-  myOutput.outputData(szDisplayBuff);
 }
 
-// report all the cells in the head sensor matrix as a Y record
-void reportHeadMatrix(void)
+// report the head matrix. The whole of it goes as a Y record at the end of each sweep, or when sending h v range for each
+// changed cell would be longer. Otherwise only the changed cells go, as a D record of h v range for each, and any that
+// don't fit are left for next time. Binary telemetry already sends only the fields that changed, so it always sends Y
+void reportHeadMatrix(const unsigned long ulMillis, const unsigned char bFull)
 {
-  char szDisplayBuff[100];
-  char szElemBuff[12];
-  static const char PROGMEM szFmt1[] = {"Y"};
-  static const char PROGMEM szFmt2[] = {" %i"};
-  
-  strcpy_P(szDisplayBuff, szFmt1);
+  long lValues[R5_TELEMETRY_FIELDS];
+  unsigned char n = 0;
+  unsigned int uiCells = myHead.getHCells() * myHead.getVCells();
 
-  for (unsigned char v = myHead.getVCells(); v > 0; v--)
+  if (bFull || mySubs.getBinary() || (myHead.getDirtyCells() * 3 >= uiCells))
   {
-    for (unsigned char h = myHead.getHCells(); h > 0; h--)
-    {
-      unsigned int uiRange = myHead.getRangeAtCell(h-1, v-1);
-      snprintf_P(szElemBuff, sizeof(szElemBuff), szFmt2, uiRange);
-      if (sizeof(szDisplayBuff) - strlen(szDisplayBuff) > strlen(szElemBuff) )
-        strcat(szDisplayBuff, szElemBuff);
-    }
-    
+    for (unsigned char v = myHead.getVCells(); v > 0; v--)
+      for (unsigned char h = myHead.getHCells(); (h > 0) && (n < R5_TELEMETRY_FIELDS); h--)
+        lValues[n++] = myHead.getRangeAtCell(h-1, v-1);
+    mySubs.write(R5_CHANNEL_HEADMATRIX, ulMillis, lValues, n);
+    myHead.clearDirtyCells();
+    return;
   }
+
+  char szDisplayBuff[100];
+  unsigned char bHCoord, bVCoord;
+  unsigned int uiLen = 1;
+  static const char PROGMEM szFmt[] = {" %u %u %u"};
+  szDisplayBuff[0] = 'D';
+  // leave room for the longest h v range
+  while ((uiLen < sizeof(szDisplayBuff) - 16) && myHead.takeDirtyCell(&bHCoord, &bVCoord))
+    uiLen += snprintf_P(szDisplayBuff + uiLen, sizeof(szDisplayBuff) - uiLen, szFmt, bHCoord, bVCoord, myHead.getRangeAtCell(bHCoord, bVCoord));
   myOutput.outputData(szDisplayBuff);
 }
 
 // send output data to both the Serial monitor and the Wifi, depending on the bit settings from the REPORT command
-// prefix a millisecond timestamp
+// each buffered output prefixes a millisecond timestamp
 void MyOutput::outputData(const char *pszData)
 {
-  unsigned long uiMillis = millis();
-  char szMillisBuff[15];
-
-  static const char PROGMEM szFmt[] = {"%010lu "};
-  snprintf_P(szMillisBuff, sizeof(szMillisBuff), szFmt, uiMillis);
-  
   if (uiGlobalFlags & 0x01)
-  {
-    if ( Serial.print(szMillisBuff) != strlen(szMillisBuff) )
-    {
-        Serial.flush();
-        Serial.println(F("szMillisBuff lost data"));
-    }
-    if ( Serial.println(pszData) != (strlen(pszData)+2) )
-    {
-        Serial.flush();
-        Serial.println(F("pszData lost data"));
-    }
- }
+    mySerialOut.outputData(pszData);
   
   if (uiGlobalFlags & 0x02)
-  {
-    wifly.send(szMillisBuff);
-    wifly.send(pszData);
-    wifly.send("\n");
-  }
+    myWifiOut.outputData(pszData);
+}
+
+// send on whatever the Serial and Wifi links will take without waiting
+void MyOutput::drain(void)
+{
+  mySerialOut.drain();
+  if (wifiConnected()) // otherwise the WiFly would take it as commands
+    myWifiOut.drain();
+}
+
+// send a binary telemetry frame, unprefixed, to wherever text output is going
+void MyOutput::outputFrame(const unsigned char *pFrame, const unsigned int uiLength)
+{
+  if (uiGlobalFlags & 0x01)
+    mySerialOut.outputFrame(pFrame, uiLength);
+
+  if (uiGlobalFlags & 0x02)
+    myWifiOut.outputFrame(pFrame, uiLength);
 }
 
 // log textual data from the vocaliser
@@ -15,101 +15,208 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
+
 // Global functions defined in this file
-boolean initialiseWifi(const char *pSSID, const char *pPassword, const unsigned char bRetry);
-boolean tcpConnect(const char * pIPAddress, const int nPort, const unsigned char bRetry);
+void startWifi(void);
+void processConnection(void);
+boolean wifiConnected(void);
+void checkWifiLink(const char c);
+
+// The connection to the InstinctServer is made a step at a time by processConnection(), called from loop(),
+// so that the robot carries on sensing and driving while the network comes up. Each step is at most one
+// or two short exchanges with the WiFly, and the waits between steps are timed rather than delayed. If the connection
+// cannot be made, or is lost, it is tried again after a wait that doubles each time, up to WIFI_BACKOFF_MAX_MS.
+// These run in the middle of loop(), so progress goes through myOutput like everything else, never straight to Serial
+enum {WIFI_IDLE, WIFI_BAUD_PROBE, WIFI_BAUD_SET, WIFI_ASSOCIATE, WIFI_JOIN, WIFI_PACKETS, WIFI_TCP_CONNECT, WIFI_CONNECTED, WIFI_BACKOFF};
+
+#define WIFI_SETTLE_MS 100				// after changing the baud rate, and between join attempts
+#define WIFI_BACKOFF_MIN_MS 1000UL		// the first wait after a failed attempt
+#define WIFI_BACKOFF_MAX_MS 64000UL
+// the WiFly sends a packet when this many bytes have arrived, or none have for WIFI_BATCH_MS,
+// so that each batch from myWifiOut goes as one packet
+#define WIFI_PACKET_SIZE OUTPUT_BUFFER_SIZE
+
+static unsigned char bWifiState = WIFI_IDLE;
+static unsigned char bWifiBaudChecked = false;
+static unsigned char bWifiRetryCount = 0;
+static unsigned long ulWifiWaitStart = 0;
+static unsigned long ulWifiWait = 0;
+static unsigned long ulWifiBackoff = WIFI_BACKOFF_MIN_MS;
+
+// the WiFly says this when the TCP connection closes, which includes losing the wifi
+const char PROGMEM szWifiClosed[] = "*CLOS*";
+
+// go to the next state once ulWait mS have passed
+void wifiWait(const unsigned char bNextState, const unsigned long ulWait)
+{
+  bWifiState = bNextState;
+  ulWifiWaitStart = millis();
+  ulWifiWait = ulWait;
+}
+
+// the connection has failed, so start again after a wait that doubles each time
+void wifiBackoff(void)
+{
+  char szMsgBuff[R5_MSG_BUFF_SIZE];
+  static const char PROGMEM szFmt[] = {"%lu"};
+  int nLen = strlen(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_RETRY));
+
+  snprintf_P(szMsgBuff + nLen, sizeof(szMsgBuff) - nLen, szFmt, ulWifiBackoff);
+  myOutput.outputData(szMsgBuff);
+  wifiWait(WIFI_BACKOFF, ulWifiBackoff);
+  ulWifiBackoff = min(ulWifiBackoff * 2, WIFI_BACKOFF_MAX_MS);
+}
+
+// start connecting to the InstinctServer. The baud rate is checked the first time the WiFly is used
+void startWifi(void)
+{
+  uiGlobalFlags = uiGlobalFlags & 0xFFFD; // stops output to the wifi interrupting the wifi commands
+  bWifiRetryCount = 0;
+  ulWifiBackoff = WIFI_BACKOFF_MIN_MS;
+  if (bWifiBaudChecked)
+  {
+    wifiWait(WIFI_ASSOCIATE, 0);
+    return;
+  }
+  Serial2.end();
+  Serial2.begin(230400);
+  wifiWait(WIFI_BAUD_PROBE, WIFI_SETTLE_MS);
+}
+
+boolean wifiConnected(void)
+{
+  return (bWifiState == WIFI_CONNECTED);
+}
+
+// called by processWifi() with each character received, to notice the connection closing
+void checkWifiLink(const char c)
+{
+  static unsigned char bMatched = 0;
 
+  if (c == pgm_read_byte(szWifiClosed + bMatched))
+    bMatched++;
+  else
+    bMatched = (c == pgm_read_byte(szWifiClosed)) ? 1 : 0;
 
-// handles the initial config of the wifi module and returns when it is connected
-boolean initialiseWifi(const char *pSSID, const char *pPassword, const unsigned char bRetry)
+  if (bMatched < sizeof(szWifiClosed) - 1)
+    return;
+  bMatched = 0;
+  uiGlobalFlags = uiGlobalFlags & 0xFFFD;
+  char szMsgBuff[R5_MSG_BUFF_SIZE];
+  myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_SERVER_LOST));
+  wifiBackoff();
+}
+
+// take the next step towards connecting, if it is time to
+void processConnection(void)
 {
-    unsigned char bRetryCount = 0;
-      
+  char szMsgBuff[R5_MSG_BUFF_SIZE];
+
+  if ((bWifiState == WIFI_IDLE) || (bWifiState == WIFI_CONNECTED) || ((millis() - ulWifiWaitStart) < ulWifiWait))
+    return;
+
+  switch (bWifiState)
+  {
+  case WIFI_BAUD_PROBE: // check if we can talk to wifi module
+    if (wifly.commandMode())
+    {
+      bWifiBaudChecked = true;
+      wifiWait(WIFI_ASSOCIATE, 0);
+      break;
+    }
+    // this code should only execute the first time the wifi module is accessed
+    myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_BAUD_WRONG));
     Serial2.end();
-    delay(100);
-    Serial2.begin(230400);
-    
-    if ( !wifly.commandMode() ) // check if we can talk to wifi module
+    Serial2.begin(9600);
+    wifiWait(WIFI_BAUD_SET, WIFI_SETTLE_MS);
+    break;
+
+  case WIFI_BAUD_SET: // need to change the baud rate to 230400
+    bWifiBaudChecked = true;
+    if ( !wifly.sendCommand("set u b 230400\r", "AOK"))
     {
-       // this code should only execute the first time the wifi module is accessed
-      Serial.println(F("Wifi commandMode failed. Probably wrong baud rate."));
-      // need to change the baud rate to 230400
-      Serial2.end();
-      delay(100);
-      Serial2.begin(9600);
-      if ( !wifly.sendCommand("set u b 230400\r", "AOK"))
-      {
-        Serial.println(F("set u b 230400\r Failed."));
-      }
-      else
-      {
-        if ( wifly.save()); // save config with faster baud rate for next reboot
-          Serial.println(F("Saved baud rate 230400"));
-        wifly.sendCommand("set u i 230400\r", "AOK"); // set immediate baud rate
-        Serial2.end();
-        delay(100);
-        Serial2.begin(230400);
-      }
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_BAUD_FAILED));
+      wifiWait(WIFI_ASSOCIATE, 0);
+      break;
     }
-   
-    // check if WiFly is associated with AP(SSID)
-    if (wifly.isAssociated(pSSID))
-      return true;
-      
-    Serial.print(F("Wifi not associated with "));
-    Serial.println(pSSID);
+    if ( wifly.save()) // save config with faster baud rate for next reboot
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_BAUD_SAVED));
+    wifly.sendCommand("set u i 230400\r", "AOK"); // set immediate baud rate
+    Serial2.end();
+    Serial2.begin(230400);
+    wifiWait(WIFI_ASSOCIATE, WIFI_SETTLE_MS);
+    break;
 
+  case WIFI_ASSOCIATE: // check if WiFly is associated with AP(SSID)
+    bWifiRetryCount = 0;
+    if (wifly.isAssociated(myServerParams.szWifiSSID))
+    {
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_CONNECTED));
+      wifiWait(WIFI_PACKETS, 0);
+      break;
+    }
+    getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_NOT_ASSOCIATED_WITH);
+    strncat(szMsgBuff, myServerParams.szWifiSSID, sizeof(szMsgBuff) - strlen(szMsgBuff) - 1);
+    myOutput.outputData(szMsgBuff);
     wifly.sendCommand("set w j 1\r", "AOK"); //turn on auto join
-    
+    wifiWait(WIFI_JOIN, 0);
+    break;
+
+  case WIFI_JOIN: // one attempt each step
     // WIFLY_AUTH_OPEN / WIFLY_AUTH_WPA1 / WIFLY_AUTH_WPA1_2 / WIFLY_AUTH_WPA2_PSK
-    while (bRetryCount < bRetry)
+    if (wifly.join(myServerParams.szWifiSSID, myServerParams.szWifiPassword, WIFLY_AUTH_WPA1_2))
     {
-      if (wifly.join(pSSID, pPassword, WIFLY_AUTH_WPA1_2))
-      {
-        Serial.print(F("save wifi config "));
-        if ( wifly.save())    // connection successful, so save configuration
-           Serial.print(F("success."));
-        else
-           Serial.print(F("failed."));
-        
-        return true;
-        
-      } else
-      {
-         // Serial.print("Failed to join ");
-         // Serial.println(szSSID);
-         // Serial.println("Wait 0.1 second and try again...");
-         delay(100);
-         bRetryCount++;
-      }
+      // connection successful, so save configuration
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), wifly.save() ? MSG_WIFI_SAVED : MSG_WIFI_SAVE_FAILED));
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_CONNECTED));
+      bWifiRetryCount = 0;
+      wifiWait(WIFI_PACKETS, 0);
     }
-    return false;
-}
+    else if (++bWifiRetryCount < myServerParams.bWifiRetry)
+      wifiWait(WIFI_JOIN, WIFI_SETTLE_MS);
+    else
+      wifiBackoff();
+    break;
 
-// establish the TCP connection to the remote InstinctServer
-boolean tcpConnect(const char * pIPAddress, const int nPort, const unsigned char bRetry)
-{
-    unsigned char bRetryCount = 0;
-    
+  case WIFI_PACKETS: // set how the WiFly groups what it is sent into packets
+    {
+      static const char PROGMEM szFmt[] = {"set comm %s %u\r"};
+      snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, "size", WIFI_PACKET_SIZE);
+      wifly.sendCommand(szMsgBuff, "AOK");
+      snprintf_P(szMsgBuff, sizeof(szMsgBuff), szFmt, "time", WIFI_BATCH_MS);
+      wifly.sendCommand(szMsgBuff, "AOK");
+    }
+    wifiWait(WIFI_TCP_CONNECT, 0);
+    break;
+
+  case WIFI_TCP_CONNECT: // establish the TCP connection to the remote InstinctServer
     if (!wifly.isAssociated())
     {
-      Serial.println(F("Wifi not associated"));
-      return false; // cannot connect if no wifi
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_WIFI_NOT_ASSOCIATED));
+      wifiBackoff(); // cannot connect if no wifi
+      break;
+    }
+    if (wifly.connect(myServerParams.szServerIP, myServerParams.uiServerPort))
+    {
+      //connected to the remote service
+      bWifiState = WIFI_CONNECTED;
+      ulWifiBackoff = WIFI_BACKOFF_MIN_MS;
+      uiGlobalFlags = uiGlobalFlags | 0x02; // enable the flag that writes monitor output to wifi
+      myOutput.outputData(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_SERVER_CONNECTED));
+      break;
     }
-    
-    while(bRetryCount < bRetry)
     {
-      if (wifly.connect(pIPAddress, nPort))
-      {
-        //connected to the remote service
-        return true;
-      }
-      Serial.print(F("TCP connect failed to "));
-      Serial.print(pIPAddress);
-      Serial.print(F(" port "));
-      Serial.println(nPort);
-      bRetryCount++;
+      static const char PROGMEM szFmt[] = {"%s port %u"};
+      int nLen = strlen(getRobotMessage(szMsgBuff, sizeof(szMsgBuff), MSG_TCP_FAILED));
+      snprintf_P(szMsgBuff + nLen, sizeof(szMsgBuff) - nLen, szFmt, myServerParams.szServerIP, myServerParams.uiServerPort);
+      myOutput.outputData(szMsgBuff);
     }
+    if (++bWifiRetryCount >= myServerParams.bServerRetry)
+      wifiBackoff();
+    break;
 
-    return false;    
+  case WIFI_BACKOFF: // start again from the association, the module is on the right baud rate by now
+    wifiWait(WIFI_ASSOCIATE, 0);
+    break;
+  }
 }
@@ -19,8 +19,8 @@
 // including the 3 required callback classes Senses, Actions & Monitor
 
 // Global functions defined in this file
-char * getProgmemStr(char *pStrBuff, const int nBuffLen, const unsigned char nStrOffset, char *progBuff);
 char * getNodeTypeName(char *pBuff, const int nBuffLen, const unsigned char bNodeType);
+// getProgmemStr() and findProgmemStr() are in the R5 library, see R5Progmem.h
 
 // define the available robot actions
 #define ACTION_SETSPEED 1
@@ -517,85 +517,5 @@ char * getNodeTypeName(char *pStrBuff, const int nBuffLen, const unsigned char b
   return getProgmemStr(pStrBuff, nBuffLen, bNodeType, szNodeType);
 }
 
-// access a string from progBuff with offset nStrOffset. Strings separated by '!'
-char * getProgmemStr(char *pStrBuff, const int nBuffLen, const unsigned char nStrOffset, const char *progBuff)
-{
-  char *pBuff = pStrBuff;
-  int i = 0;
-  int j = 0;
-  int len = 1;
-  unsigned char ch;
-
-  if (!pStrBuff || (nBuffLen < 1) || !progBuff) // no buffers
-    return pBuff;
-  
-  *pBuff = 0; // ensure the return string is always zero terminated
-  while (ch = pgm_read_byte_far(progBuff + i))
-  {
-    i++;
-    
-    if (len == nBuffLen)
-    {
-      break;
-    }
-    else if (ch == '!')
-    {
-      j++;
-      *pBuff = 0;
-    }
-    else if (j == nStrOffset)
-    {
-      *pBuff = ch;
-      pBuff++;
-      len++;
-      *pBuff = 0; // ensure the return string is always zero terminated
-    }
-    else if (j > nStrOffset)
-      break;
-  }
-  
-  return pStrBuff;
-}
-
-// search for a string from progBuff . If found return 0 based index. If not return -1. Strings separated by '!'
-int findProgmemStr(const char *pStrBuff, const char *progBuff)
-{
-  char *pBuff;
-  int i = 0;
-  int nString = 0;
-  unsigned char bMatch;
-  unsigned char ch;
-
-  if (!pStrBuff || !progBuff) // no buffer
-    return -1;
-  
-  pBuff = (char *)pStrBuff;
-  bMatch = 1;
-  while (ch = pgm_read_byte_far(progBuff + i))
-  {
-    i++;
-
-    if (bMatch && (ch == '!') && (*pBuff == 0))
-    {
-      // strings matched to the end
-      return nString;
-    }
-    else if (ch == '!')
-    {
-      // start on the next string
-      nString++;
-      pBuff = (char *)pStrBuff;
-      bMatch = 1;
-    }
-    else if (bMatch && (*pBuff == ch)) // matching so far
-    {
-      pBuff++;
-    }
-    else
-      bMatch = 0;    
-  }
-  
-  return -1;
-}
 
 
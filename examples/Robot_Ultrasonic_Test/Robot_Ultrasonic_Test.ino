@@ -1,10 +1,14 @@
 // Simple tester for Ultrasonic sensor
+// Reports the range, and the worst case loop time with the sensor in blocking and asynchronous modes.
+// Asynchronous mode needs the sensor on an interrupt pin (2, 3, 18-21 on the Mega). Send A to toggle the mode.
 #include <Servo.h>
 #include <EEPROM.h>
 #include <Instinct.h>
 #include <R5.h>
 
-R5Ultrasonic myRanger(8, 10);
+#define ULTRASONIC_PIN 3
+
+R5Ultrasonic myRanger(ULTRASONIC_PIN, 10);
 
 void setup()
 {
@@ -14,14 +18,38 @@ void setup()
 
 void loop()
 {
+    static unsigned long ulLastLoop = micros();
+    static unsigned long ulMaxLoop = 0;
+    static unsigned long ulLastReport = 0;
+
+    if (myRanger.getAsync())
+    {
+        myRanger.startPing();
+        myRanger.pollRange();
+    }
+    else
+        myRanger.measureRange();
+
     unsigned long ulTime = micros();
-    unsigned int nRangeMM = myRanger.measureRange();
-    unsigned long ulDelay = micros() - ulTime;   
-    Serial.print("Delay = ");
-    Serial.print(ulDelay);
-    Serial.print( " Distance = " );
-    Serial.print(nRangeMM);
-    Serial.println("mm");    
-    delay( 400 );
-}
+    ulMaxLoop = max(ulMaxLoop, ulTime - ulLastLoop);
+    ulLastLoop = ulTime;
+
+    if ((millis() - ulLastReport) >= 400)
+    {
+        ulLastReport = millis();
+        Serial.print(myRanger.getAsync() ? "Async" : "Blocking");
+        Serial.print(" Max loop = ");
+        Serial.print(ulMaxLoop);
+        Serial.print( "uS Distance = " );
+        Serial.print(myRanger.range());
+        Serial.println("mm");
+        ulMaxLoop = 0;
+        ulLastLoop = micros(); // don't count the time spent printing
+    }
 
+    if ((Serial.available() > 0) && (Serial.read() == 'A'))
+    {
+        if (!myRanger.setAsync(!myRanger.getAsync()))
+            Serial.println("No interrupt on this pin");
+    }
+}
@@ -0,0 +1,599 @@
+// 	Library for Rover 5 Platform Benchmarks
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Micro-benchmarks of the work the library does on every pass of loop(), run on the host build.
+// Each benchmark reaches the code through the public interface, the same way the sketch does.
+//
+// r5bench [-f filter] [-m mS per run] [-w baseline.csv] [-b baseline.csv] [-T tolerance %]
+//
+// The result of each benchmark is the fastest of R5_BENCH_REPEATS runs, in nS per operation, along
+// with the number of heap allocations per operation. -w writes the results as a baseline and -b
+// compares against one, exiting with 1 if anything is slower than the tolerance allows or
+// allocates more. extras/bench/baseline.csv is the checked in baseline.
+//
+// Built with R5_INSTINCT_DIR set, it also times R5ExecStackMonitor speaking plan elements. Those
+// have no rows in the checked in baseline, which is written without Instinct.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include "R5Hal.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5Progmem.h"
+#include "R5Command.h"
+#include "R5RobotCommands.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#if defined(R5_BENCH_INSTINCT)
+#include "Instinct.h"
+#include "R5Output.h"
+#include "R5Voice.h"
+#include "R5Vocalise.h"
+#endif
+
+#define R5_BENCH_REPEATS 7
+#define R5_BENCH_LINE 256
+
+// every operator new is counted. The benchmarks run on one thread
+static unsigned long ulAllocations = 0;
+
+void *operator new(size_t uiSize)
+{
+	void *p = malloc(uiSize ? uiSize : 1);
+
+	if (!p)
+		throw std::bad_alloc();
+	ulAllocations++;
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+// results are added in here so the compiler cannot throw the work away
+static volatile long lSink;
+
+// the robot as R5Robot.ino declares it, on its own host
+#define ULTRASONIC_PIN 2
+#define ULTRASONIC_MIN_INTERVAL 300
+static const unsigned char cornerInputs[] = {A0, A1, A2, A3};
+static const unsigned char cornerOutputs[] = {24, 25, 26, 27};
+static const unsigned char motorSpeeds[] = {4, 5};
+static const unsigned char motorDirections[] = {29, 28};
+static const unsigned char motorCurrents[] = {A4, A5};
+
+// the robot's commands, from the same list R5Robot.ino makes robotCommands[] from. The benchmarks never run a handler
+#define BENCH_COMMAND(name, word, handler, args, help) {word, 0, args, help},
+static const R5CommandType benchCommands[] = {R5_ROBOT_COMMANDS(BENCH_COMMAND)};
+#define BENCH_COMMANDS (sizeof(benchCommands) / sizeof(benchCommands[0]))
+
+// the command names as a table of strings. PROGMEM is nothing on the host, so they can be literals
+#define BENCH_COMMAND_NAME(name, word, handler, args, help) word,
+static const char * const szCommandNames[] = {R5_ROBOT_COMMANDS(BENCH_COMMAND_NAME)};
+
+// and as the one '!' separated string that parseRobotCommand() in R5Robot.ino used to scan
+#define BENCH_COMMAND_WORD(name, word, handler, args, help) word "!"
+static const char PROGMEM szCommands[] = {R5_ROBOT_COMMANDS(BENCH_COMMAND_WORD)};
+
+#if defined(R5_BENCH_INSTINCT)
+// plan elements for the vocalise benchmarks. The named ones have names like those in the robot's plans
+#define BENCH_NAMED_A 1
+#define BENCH_NAMED_B 2
+#define BENCH_UNNAMED_A 3
+#define BENCH_UNNAMED_B 4
+
+// the Emic2 is never ready, as when it is busy speaking
+class R5BenchVoiceStream : public Stream {
+public:
+	virtual size_t write(uint8_t b) { return 1; }
+	using Print::write;
+	virtual int available(void) { return 0; }
+	virtual int read(void) { return -1; }
+	virtual int peek(void) { return -1; }
+};
+
+// throws away what the monitor would send to the robot's output
+class R5BenchOutput : public R5Output {
+public:
+	void outputData(const char *pszData) { lSink += pszData[0]; }
+	void outputVocaliseData(const char *pszData) { lSink += pszData[0]; }
+};
+#endif
+
+// every ping comes back from 300mm
+static unsigned long echoHandler(void *pContext, const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout)
+{
+	return 1740;
+}
+
+class R5BenchRig {
+public:
+	R5BenchRig() :
+		sensors(cornerInputs, cornerOutputs),
+		ranger(ULTRASONIC_PIN, ULTRASONIC_MIN_INTERVAL),
+		motors(motorSpeeds, motorDirections, motorCurrents),
+		head(&servoHHead, &servoVHead, 75, 180, &ranger, 5, 2, 10)
+#if defined(R5_BENCH_INSTINCT)
+		, voice(&voiceStream), names(1500), monitor(&names, &voice, &output)
+#endif
+	{
+		lLeft = lRight = 0;
+		R5HalHost::current()->setPulseHandler(echoHandler, 0);
+		// something about 150mm from each corner, so the distances come from the middle of the curves
+		for (int i = 0; i < 4; i++)
+			R5HalHost::current()->setAnalogInput(cornerInputs[i], 150);
+		servoHHead.attach(6);
+		servoVHead.attach(7);
+		head.setHScanParams(30, 15, 135);
+		head.setVScanParams(45, 135, 180);
+		head.setHScanInterval(1000);
+		head.lookAhead();
+#if defined(R5_BENCH_INSTINCT)
+		static char szNameA[] = "ReverseTurn45LOrR";
+		static char szNameB[] = "AvoidObstacle";
+		names.addElementName(BENCH_NAMED_A, szNameA);
+		names.addElementName(BENCH_NAMED_B, szNameB);
+#endif
+	};
+
+	Servo servoHHead;
+	Servo servoVHead;
+	R5CornerSensors sensors;
+	R5Ultrasonic ranger;
+	R5MotorControl motors;
+	R5SensingHead head;
+	long lLeft;
+	long lRight;
+#if defined(R5_BENCH_INSTINCT)
+	R5BenchVoiceStream voiceStream;
+	R5BenchOutput output;
+	R5Voice voice;
+	Instinct::Names names;
+	R5ExecStackMonitor monitor;
+#endif
+};
+
+typedef void (*R5BenchFunction)(R5BenchRig *pRig, const unsigned long ulOps);
+
+typedef struct {
+	const char *pszName;
+	const char *pszCovers;
+	R5BenchFunction pfnRun;
+} R5BenchType;
+
+// one complete pass of the three sense() states, the last of which runs _calculateDistances()
+// and so _mapCornerSensor() and _mapSideCornerSensor() for every corner
+static void benchCornerSense(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		pRig->sensors.sense();
+		pRig->sensors.sense();
+		pRig->sensors.sense();
+		lSink += pRig->sensors.getEdgeAngle(i & 3);
+	}
+}
+
+// each call is due to move the head, so updates one cell of the sense matrix
+static void benchHeadCell(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	R5HalHost *pHost = R5HalHost::current();
+
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		pHost->advanceMicros(250000UL); // the time for one step of a 1S scan
+		pRig->head.driveHead();
+	}
+	lSink += pRig->head.getMinRange();
+}
+
+static void benchHeadHMinRange(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += pRig->head.getHMinRange(i & 1);
+}
+
+static void benchHeadMostOpen(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += pRig->head.getHMostOpenAngle(i & 1);
+}
+
+// a loop() of driveMotors() at constant speed, with and without closed loop speed control
+static void benchMotors(R5BenchRig *pRig, const unsigned long ulOps, const unsigned char bSpeedControl)
+{
+	R5HalHost *pHost = R5HalHost::current();
+
+	pRig->motors.setSpeedControl(bSpeedControl);
+	pRig->motors.setSpeed(60);
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		pHost->advanceMicros(2000);
+		pRig->lLeft += 3;
+		pRig->lRight += 3;
+		pRig->motors.driveMotors(pRig->lLeft, pRig->lRight);
+	}
+	lSink += pRig->motors.getWheelVelocity(0);
+}
+
+static void benchMotorsOpen(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	benchMotors(pRig, ulOps, false);
+}
+
+static void benchMotorsPID(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	benchMotors(pRig, ulOps, true);
+}
+
+// the estimate from full sample buffers, both wheels and the average as the sensor frame reads them
+static void benchMotorsVelocity(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	R5HalHost *pHost = R5HalHost::current();
+
+	pRig->motors.setSpeedControl(false);
+	for (int i = 0; i < R5_VEL_SAMPLES; i++)
+	{
+		pHost->advanceMicros(5000);
+		pRig->lLeft += 1;
+		pRig->lRight += 1;
+		pRig->motors.driveMotors(pRig->lLeft, pRig->lRight);
+	}
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		lSink += pRig->motors.getWheelVelocity(1);
+		lSink += pRig->motors.getWheelVelocity(2);
+	}
+}
+
+// driveMotors() on an arc, so the pose is moved along a new heading every call
+static void benchMotorsPose(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	R5HalHost *pHost = R5HalHost::current();
+	R5PoseType pose;
+
+	pRig->motors.setSpeedControl(false);
+	pRig->motors.setSpeed(60);
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		pHost->advanceMicros(2000);
+		pRig->lLeft += 3;
+		pRig->lRight += 2;
+		pRig->motors.driveMotors(pRig->lLeft, pRig->lRight);
+	}
+	pRig->motors.getPose(&pose);
+	lSink += pose.nHeading;
+}
+
+// driveMotors() running a profiled segment. The tracks follow the drive, so segments complete
+static void benchMotorsSegment(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	R5HalHost *pHost = R5HalHost::current();
+
+	pRig->motors.setSpeedControl(false);
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		if (!pRig->motors.getSegmentsQueued())
+			pRig->motors.queueDrive(200);
+		pHost->advanceMicros(2000);
+		pRig->lLeft += pHost->getAnalogOutput(motorSpeeds[0]) / 40;
+		pRig->lRight += pHost->getAnalogOutput(motorSpeeds[1]) / 40;
+		pRig->motors.driveMotors(pRig->lLeft, pRig->lRight);
+	}
+	pRig->motors.abortSegments();
+}
+
+// the pose update and the head use these, stepping round the circle so no two calls are the same
+static void benchFixedSin(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		long lCentiDegrees = (long)((i * 4099UL) % 72000UL) - 36000L;
+		lSink += R5FixedMath::sinDeg100(lCentiDegrees) + R5FixedMath::cosDeg100(lCentiDegrees);
+	}
+}
+
+static void benchFixedAtan2(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += R5FixedMath::atan2Deg100((int)((i * 4099UL) & 0x7FFF) - 16384, (int)((i * 7919UL) & 0x7FFF) - 16384);
+}
+
+static void benchProgmemGet(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	char szBuff[20];
+
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += strlen(getProgmemStr(szBuff, sizeof(szBuff), BENCH_COMMANDS - 1, szCommands));
+}
+
+static void benchProgmemTableGet(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	char szBuff[20];
+
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += strlen(getProgmemTableStr(szBuff, sizeof(szBuff), BENCH_COMMANDS - 1, szCommandNames, BENCH_COMMANDS));
+}
+
+static void benchProgmemFindFirst(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += findProgmemStr("CAL", szCommands);
+}
+
+static void benchProgmemFindLast(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += findProgmemStr("VER", szCommands);
+}
+
+static void benchCommandFindFirst(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += findCommand("CAL", benchCommands, BENCH_COMMANDS);
+}
+
+static void benchCommandFindLast(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	for (unsigned long i = 0; i < ulOps; i++)
+		lSink += findCommand("VER", benchCommands, BENCH_COMMANDS);
+}
+
+// what parseRobotCommand() does before it dispatches: split off the command word, upper case it and look it up
+static void benchCommandLookup(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	static const char PROGMEM szFmt[] = {"%s "};
+	char szCmd[20];
+	R5CommandType command;
+
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		szCmd[0] = 0;
+		sscanf_P("rate 10", szFmt, szCmd);
+		strupr(szCmd);
+		getCommand(&command, benchCommands, findCommand(szCmd, benchCommands, BENCH_COMMANDS));
+		lSink += command.bArgs;
+	}
+}
+
+#if defined(R5_BENCH_INSTINCT)
+// an action starting and finishing, alternating between two actions so that each one is new to the
+// monitor. Each operation is two calls to vocalise(), for NOT_TESTED and SUCCESS
+static void benchVocalise(R5BenchRig *pRig, const unsigned long ulOps, const Instinct::instinctID nIdA, const Instinct::instinctID nIdB)
+{
+	Instinct::PlanNode nodes[2];
+
+	memset(nodes, 0, sizeof(nodes));
+	nodes[0].bNodeType = nodes[1].bNodeType = INSTINCT_ACTION;
+	nodes[0].sElement.sReferences.bRuntime_ElementID = nIdA;
+	nodes[1].sElement.sReferences.bRuntime_ElementID = nIdB;
+	for (unsigned long i = 0; i < ulOps; i++)
+	{
+		lSink += pRig->monitor.nodeExecuted(&nodes[i & 1]);
+		lSink += pRig->monitor.nodeSuccess(&nodes[i & 1]);
+	}
+}
+
+static void benchVocaliseNamed(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	benchVocalise(pRig, ulOps, BENCH_NAMED_A, BENCH_NAMED_B);
+}
+
+// without names vocalise() says Step n, so the difference from vocalise_named is nameToWords
+static void benchVocaliseUnnamed(R5BenchRig *pRig, const unsigned long ulOps)
+{
+	benchVocalise(pRig, ulOps, BENCH_UNNAMED_A, BENCH_UNNAMED_B);
+}
+#endif
+
+static const R5BenchType benchmarks[] = {
+	{"corner_sense_cycle", "R5CornerSensors::sense x3, _calculateDistances, _mapCornerSensor", benchCornerSense},
+	{"head_update_cell", "R5SensingHead::driveHead, updateSenseMatrix, updateCell", benchHeadCell},
+	{"head_hminrange", "R5SensingHead::getHMinRange", benchHeadHMinRange},
+	{"head_most_open", "R5SensingHead::getHMostOpenAngle", benchHeadMostOpen},
+	{"motors_drive_open", "R5MotorControl::driveMotors, _calculateOutputs", benchMotorsOpen},
+	{"motors_drive_pid", "R5MotorControl::driveMotors with speed control", benchMotorsPID},
+	{"motors_velocity", "R5MotorControl::getWheelVelocity x2, _estimateVelocity", benchMotorsVelocity},
+	{"motors_drive_pose", "R5MotorControl::driveMotors on an arc, _updatePose", benchMotorsPose},
+	{"motors_drive_segment", "R5MotorControl::driveMotors running queued segments", benchMotorsSegment},
+	{"fixedmath_sincos", "R5FixedMath::sinDeg100 + cosDeg100", benchFixedSin},
+	{"fixedmath_atan2", "R5FixedMath::atan2Deg100", benchFixedAtan2},
+	{"progmem_get", "getProgmemStr, the last command", benchProgmemGet},
+	{"progmem_find_first", "findProgmemStr, the first command", benchProgmemFindFirst},
+	{"progmem_find_last", "findProgmemStr, the last command", benchProgmemFindLast},
+	{"progmem_table_get", "getProgmemTableStr, the last command", benchProgmemTableGet},
+	{"command_find_first", "findCommand, the first command", benchCommandFindFirst},
+	{"command_find_last", "findCommand, the last command", benchCommandFindLast},
+	{"command_lookup", "parseRobotCommand command word lookup", benchCommandLookup},
+#if defined(R5_BENCH_INSTINCT)
+	{"vocalise_named", "R5ExecStackMonitor::vocalise x2, nameToWords, R5Voice::speak", benchVocaliseNamed},
+	{"vocalise_unnamed", "R5ExecStackMonitor::vocalise x2 of Step n, R5Voice::speak", benchVocaliseUnnamed},
+#endif
+};
+
+typedef struct {
+	std::string strName;
+	double dNsPerOp;
+	double dAllocsPerOp;
+} R5BenchResultType;
+
+static double runOnce(const R5BenchType *pBench, R5BenchRig *pRig, const unsigned long ulOps, unsigned long *pulAllocs)
+{
+	unsigned long ulStartAllocs = ulAllocations;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	(*pBench->pfnRun)(pRig, ulOps);
+	double dNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	*pulAllocs = ulAllocations - ulStartAllocs;
+	return dNs;
+}
+
+// find how many operations take about ulMillis, then keep the fastest of the repeats
+static R5BenchResultType runBench(const R5BenchType *pBench, const unsigned long ulMillis)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	R5BenchRig *pRig = new R5BenchRig;
+	R5BenchResultType result;
+	unsigned long ulOps = 1;
+	unsigned long ulAllocs;
+	double dNs;
+
+	while ((dNs = runOnce(pBench, pRig, ulOps, &ulAllocs)) < ulMillis * 1e5) // a tenth of the time
+		ulOps *= 2;
+	ulOps = (unsigned long)(ulOps * (ulMillis * 1e6 / dNs)) + 1;
+
+	result.strName = pBench->pszName;
+	result.dNsPerOp = 1e18;
+	for (int i = 0; i < R5_BENCH_REPEATS; i++)
+	{
+		dNs = runOnce(pBench, pRig, ulOps, &ulAllocs) / ulOps;
+		if (dNs < result.dNsPerOp)
+			result.dNsPerOp = dNs;
+	}
+	result.dAllocsPerOp = (double)ulAllocs / ulOps;
+
+	delete pRig;
+	R5HalHost::setCurrent(0);
+	return result;
+}
+
+static unsigned char writeBaseline(const char *pszFile, const std::vector<R5BenchResultType> &results)
+{
+	FILE *pFile = fopen(pszFile, "w");
+
+	if (!pFile)
+		return false;
+	fprintf(pFile, "name,ns_per_op,allocs_per_op\n");
+	for (size_t i = 0; i < results.size(); i++)
+		fprintf(pFile, "%s,%.2f,%.3f\n", results[i].strName.c_str(), results[i].dNsPerOp, results[i].dAllocsPerOp);
+	fclose(pFile);
+	return true;
+}
+
+static unsigned char readBaseline(const char *pszFile, std::vector<R5BenchResultType> *pResults)
+{
+	char szLine[R5_BENCH_LINE];
+	char szName[R5_BENCH_LINE];
+	FILE *pFile = fopen(pszFile, "r");
+
+	if (!pFile)
+		return false;
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		R5BenchResultType result;
+		char *pComma = strchr(szLine, ',');
+
+		if (!pComma || ((size_t)(pComma - szLine) >= sizeof(szName)))
+			continue;
+		memcpy(szName, szLine, pComma - szLine);
+		szName[pComma - szLine] = 0;
+		if (sscanf(pComma + 1, "%lf,%lf", &result.dNsPerOp, &result.dAllocsPerOp) != 2)
+			continue; // the header
+		result.strName = szName;
+		pResults->push_back(result);
+	}
+	fclose(pFile);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *pszFilter = 0;
+	const char *pszWrite = 0;
+	const char *pszBaseline = 0;
+	unsigned long ulMillis = 100;
+	double dTolerance = 25;
+	std::vector<R5BenchResultType> results;
+	std::vector<R5BenchResultType> baseline;
+	int nRegressions = 0;
+	int nOpt;
+
+	while ((nOpt = getopt(argc, argv, "f:m:w:b:T:")) != -1)
+	{
+		switch (nOpt)
+		{
+			case 'f': pszFilter = optarg; break;
+			case 'm': ulMillis = strtoul(optarg, 0, 0); break;
+			case 'w': pszWrite = optarg; break;
+			case 'b': pszBaseline = optarg; break;
+			case 'T': dTolerance = atof(optarg); break;
+			default:
+				fprintf(stderr, "usage: r5bench [-f filter] [-m mS per run] [-w baseline.csv] [-b baseline.csv] [-T tolerance %%]\n");
+				return 2;
+		}
+	}
+	if (pszBaseline && !readBaseline(pszBaseline, &baseline))
+	{
+		fprintf(stderr, "r5bench: cannot read baseline %s\n", pszBaseline);
+		return 1;
+	}
+
+	printf("%-22s %12s %10s %9s  %s\n", "benchmark", "ns/op", "allocs/op", "baseline", "covers");
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+	{
+		const R5BenchType *pBench = &benchmarks[i];
+		char szChange[16] = "";
+
+		if (pszFilter && !strstr(pBench->pszName, pszFilter))
+			continue;
+		R5BenchResultType result = runBench(pBench, ulMillis ? ulMillis : 1);
+		results.push_back(result);
+
+		for (size_t j = 0; j < baseline.size(); j++)
+		{
+			if (baseline[j].strName != result.strName)
+				continue;
+			double dChange = (result.dNsPerOp / baseline[j].dNsPerOp - 1.0) * 100.0;
+			snprintf(szChange, sizeof(szChange), "%+.0f%%", dChange);
+			if ((dChange > dTolerance) || (result.dAllocsPerOp > baseline[j].dAllocsPerOp + 0.0005))
+			{
+				strncat(szChange, "!", sizeof(szChange) - strlen(szChange) - 1);
+				nRegressions++;
+			}
+		}
+		printf("%-22s %12.2f %10.3f %9s  %s\n", pBench->pszName, result.dNsPerOp, result.dAllocsPerOp, szChange, pBench->pszCovers);
+	}
+
+	if (pszWrite && !writeBaseline(pszWrite, results))
+	{
+		fprintf(stderr, "r5bench: cannot write baseline %s\n", pszWrite);
+		return 1;
+	}
+	if (nRegressions)
+	{
+		fprintf(stderr, "r5bench: %d regressions against %s\n", nRegressions, pszBaseline);
+		return 1;
+	}
+	return 0;
+}
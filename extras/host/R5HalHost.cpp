@@ -0,0 +1,683 @@
+// 	Library for Rover 5 Platform Host Hardware Abstraction
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+
+// Mega 2560 pins for interrupts 0 - 5
+static const uint8_t _bInterruptPins[R5_HOST_INTERRUPTS] = {2, 3, 21, 20, 19, 18};
+
+static R5HalHost _defaultHost;
+static thread_local R5HalHost *_pCurrentHost = 0;
+
+R5HostSerial Serial;
+EEPROMClass EEPROM;
+
+// channel number from a pin given as A0.. or as a channel number
+static uint8_t _analogChannel(const uint8_t bPin)
+{
+	return ((bPin >= A0) ? (bPin - A0) : bPin) & 0x0F;
+}
+
+R5HalHost::R5HalHost()
+{
+	_ulMicros = 0;
+	memset(_bPinMode, INPUT, sizeof(_bPinMode));
+	memset(_bPinOutput, LOW, sizeof(_bPinOutput));
+	memset(_bPinInput, LOW, sizeof(_bPinInput));
+	memset(_nAnalogOutput, 0, sizeof(_nAnalogOutput));
+	memset(_nAnalogInput, 0, sizeof(_nAnalogInput));
+	for (int i = 0; i < R5_HOST_INTERRUPTS; i++)
+	{
+		_pfnISR[i] = 0;
+		_pfnPinCallback[i] = 0;
+		_pPinContext[i] = 0;
+		_nISRMode[i] = CHANGE;
+		_bISRPending[i] = false;
+	}
+	_bInterruptsEnabled = true;
+	_pfnAdcCallback = 0;
+	_pAdcContext = 0;
+	_bAdcChannel = 0;
+	_bAdcBusy = false;
+	_ulAdcDue = 0;
+	_pfnPulseHandler = 0;
+	_pPulseContext = 0;
+	_pfnWriteHandler = 0;
+	_pWriteContext = 0;
+	memset(_events, 0, sizeof(_events));
+	_ulRandom = 1;
+	memset(_bEEPROM, 0xFF, sizeof(_bEEPROM)); // erased
+}
+
+R5HalHost *R5HalHost::current(void)
+{
+	return _pCurrentHost ? _pCurrentHost : &_defaultHost;
+}
+
+void R5HalHost::setCurrent(R5HalHost *pHost)
+{
+	_pCurrentHost = pHost;
+}
+
+unsigned long R5HalHost::getMicros(void)
+{
+	return _ulMicros;
+}
+
+// conversions and input changes that fall before the new time happen at their own time
+void R5HalHost::setMicros(const unsigned long ulMicros)
+{
+	unsigned long ulEvent;
+
+	while (_nextEvent(&ulEvent) && ((long)(ulMicros - ulEvent) >= 0))
+	{
+		_ulMicros = ulEvent;
+		for (int i = 0; i < R5_HOST_EVENTS; i++)
+		{
+			if (_events[i].bUsed && (_events[i].ulMicros == ulEvent))
+			{
+				_events[i].bUsed = false;
+				setDigitalInput(_events[i].bPin, _events[i].bValue);
+			}
+		}
+		_service();
+	}
+	_ulMicros = ulMicros;
+}
+
+void R5HalHost::advanceMicros(const unsigned long ulMicros)
+{
+	setMicros(_ulMicros + ulMicros);
+}
+
+void R5HalHost::setDigitalInput(const uint8_t bPin, const uint8_t bValue)
+{
+	if (bPin >= R5_HOST_PINS)
+		return;
+	uint8_t bOld = _bPinInput[bPin];
+	_bPinInput[bPin] = bValue ? HIGH : LOW;
+	_pinChanged(bPin, bOld, _bPinInput[bPin]);
+}
+
+void R5HalHost::setAnalogInput(const uint8_t bPin, const int nValue)
+{
+	_nAnalogInput[_analogChannel(bPin)] = constrain(nValue, 0, 1023);
+}
+
+void R5HalHost::setPulseHandler(R5HostPulseHandler pfnHandler, void *pContext)
+{
+	_pfnPulseHandler = pfnHandler;
+	_pPulseContext = pContext;
+}
+
+unsigned char R5HalHost::scheduleDigitalInput(const uint8_t bPin, const uint8_t bValue, const unsigned long ulMicros)
+{
+	for (int i = 0; i < R5_HOST_EVENTS; i++)
+	{
+		if (!_events[i].bUsed)
+		{
+			_events[i].ulMicros = ulMicros;
+			_events[i].bPin = bPin;
+			_events[i].bValue = bValue;
+			_events[i].bUsed = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+void R5HalHost::setWriteHandler(R5HostWriteHandler pfnHandler, void *pContext)
+{
+	_pfnWriteHandler = pfnHandler;
+	_pWriteContext = pContext;
+}
+
+uint8_t R5HalHost::getPinMode(const uint8_t bPin)
+{
+	return (bPin < R5_HOST_PINS) ? _bPinMode[bPin] : INPUT;
+}
+
+uint8_t R5HalHost::getDigitalOutput(const uint8_t bPin)
+{
+	return (bPin < R5_HOST_PINS) ? _bPinOutput[bPin] : LOW;
+}
+
+int R5HalHost::getAnalogOutput(const uint8_t bPin)
+{
+	return (bPin < R5_HOST_PINS) ? _nAnalogOutput[bPin] : 0;
+}
+
+void R5HalHost::putSerialInput(const char *psz)
+{
+	_strSerialIn += psz;
+}
+
+const std::string &R5HalHost::getSerialOutput(void)
+{
+	return _strSerialOut;
+}
+
+void R5HalHost::clearSerialOutput(void)
+{
+	_strSerialOut.clear();
+}
+
+// an output pin reads back what was written to it
+int R5HalHost::readPin(const uint8_t bPin)
+{
+	if (bPin >= R5_HOST_PINS)
+		return LOW;
+	return (_bPinMode[bPin] == OUTPUT) ? _bPinOutput[bPin] : _bPinInput[bPin];
+}
+
+void R5HalHost::writePin(const uint8_t bPin, const uint8_t bValue)
+{
+	if (bPin >= R5_HOST_PINS)
+		return;
+	_bPinOutput[bPin] = bValue ? HIGH : LOW;
+	_nAnalogOutput[bPin] = bValue ? 255 : 0;
+	if (_pfnWriteHandler)
+		(*_pfnWriteHandler)(_pWriteContext, bPin, _bPinOutput[bPin]);
+}
+
+int R5HalHost::readAnalog(const uint8_t bPin)
+{
+	return _nAnalogInput[_analogChannel(bPin)];
+}
+
+void R5HalHost::writeAnalog(const uint8_t bPin, const int nValue)
+{
+	if (bPin >= R5_HOST_PINS)
+		return;
+	_nAnalogOutput[bPin] = constrain(nValue, 0, 255);
+	_bPinOutput[bPin] = (nValue >= 128) ? HIGH : LOW;
+	if (_pfnWriteHandler)
+		(*_pfnWriteHandler)(_pWriteContext, bPin, _bPinOutput[bPin]);
+}
+
+void R5HalHost::setPinMode(const uint8_t bPin, const uint8_t bMode)
+{
+	if (bPin >= R5_HOST_PINS)
+		return;
+	_bPinMode[bPin] = bMode;
+	if (bMode == INPUT_PULLUP)
+		_bPinInput[bPin] = HIGH;
+}
+
+// the pulse takes the time it takes. Without a handler every pulse times out
+unsigned long R5HalHost::measurePulse(const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout)
+{
+	unsigned long ulPulse = 0;
+
+	if (_pfnPulseHandler)
+		ulPulse = (*_pfnPulseHandler)(_pPulseContext, bPin, bState, ulTimeout);
+	if (ulPulse > ulTimeout)
+		ulPulse = 0;
+	advanceMicros(ulPulse ? ulPulse : ulTimeout);
+	return ulPulse;
+}
+
+void R5HalHost::attachISR(const uint8_t bInterrupt, R5HostISR pfnISR, const int nMode)
+{
+	if (bInterrupt >= R5_HOST_INTERRUPTS)
+		return;
+	_pfnISR[bInterrupt] = pfnISR;
+	_pfnPinCallback[bInterrupt] = 0;
+	_nISRMode[bInterrupt] = nMode;
+	_bISRPending[bInterrupt] = false;
+}
+
+void R5HalHost::attachPinCallback(const uint8_t bInterrupt, R5HostPinCallback pfnCallback, void *pContext, const int nMode)
+{
+	if (bInterrupt >= R5_HOST_INTERRUPTS)
+		return;
+	_pfnISR[bInterrupt] = 0;
+	_pfnPinCallback[bInterrupt] = pfnCallback;
+	_pPinContext[bInterrupt] = pContext;
+	_nISRMode[bInterrupt] = nMode;
+	_bISRPending[bInterrupt] = false;
+}
+
+// interrupts that were raised while disabled run as soon as they are enabled again, as on the AVR
+void R5HalHost::enableInterrupts(const uint8_t bEnable)
+{
+	_bInterruptsEnabled = bEnable;
+	if (bEnable)
+		_service();
+}
+
+void R5HalHost::adcStart(const uint8_t bPin, R5HostAdcCallback pfnCallback, void *pContext)
+{
+	_pfnAdcCallback = pfnCallback;
+	_pAdcContext = pContext;
+	_bAdcChannel = _analogChannel(bPin);
+	_bAdcBusy = true;
+	_ulAdcDue = _ulMicros + R5_HOST_ADC_US;
+}
+
+void R5HalHost::adcStop(void)
+{
+	_pfnAdcCallback = 0;
+	_bAdcBusy = false;
+}
+
+// the same generator as avr-libc random()
+unsigned long R5HalHost::nextRandom(void)
+{
+	long lHi, lLo, x;
+
+	x = (long)(_ulRandom & 0x7FFFFFFF);
+	if (x == 0)
+		x = 123459876L;
+	lHi = x / 127773L;
+	lLo = x % 127773L;
+	x = 16807L * lLo - 2836L * lHi;
+	if (x < 0)
+		x += 0x7FFFFFFFL;
+	_ulRandom = (unsigned long)x;
+	return _ulRandom % 0x80000000UL;
+}
+
+void R5HalHost::seedRandom(const unsigned long ulSeed)
+{
+	_ulRandom = ulSeed;
+}
+
+int R5HalHost::serialRead(const uint8_t bRemove)
+{
+	if (_strSerialIn.empty())
+		return -1;
+	int nChar = (uint8_t)_strSerialIn[0];
+	if (bRemove)
+		_strSerialIn.erase(0, 1);
+	return nChar;
+}
+
+void R5HalHost::serialWrite(const uint8_t b)
+{
+	_strSerialOut += (char)b;
+}
+
+// the time of the next ADC completion or scheduled input. Conversions wait while interrupts are disabled
+unsigned char R5HalHost::_nextEvent(unsigned long *pulMicros)
+{
+	unsigned char bFound = false;
+
+	if (_bAdcBusy && _bInterruptsEnabled)
+	{
+		*pulMicros = _ulAdcDue;
+		bFound = true;
+	}
+	for (int i = 0; i < R5_HOST_EVENTS; i++)
+	{
+		if (_events[i].bUsed && (!bFound || ((long)(_events[i].ulMicros - *pulMicros) < 0)))
+		{
+			*pulMicros = _events[i].ulMicros;
+			bFound = true;
+		}
+	}
+	return bFound;
+}
+
+// run the pending interrupts, then a completed conversion
+void R5HalHost::_service(void)
+{
+	if (!_bInterruptsEnabled)
+		return;
+
+	for (int i = 0; i < R5_HOST_INTERRUPTS; i++)
+	{
+		if (_bISRPending[i])
+		{
+			_bISRPending[i] = false;
+			if (_pfnISR[i])
+				(*_pfnISR[i])();
+			else if (_pfnPinCallback[i])
+				(*_pfnPinCallback[i])(_pPinContext[i]);
+		}
+	}
+
+	if (_bAdcBusy && ((long)(_ulMicros - _ulAdcDue) >= 0))
+	{
+		R5HostAdcCallback pfnCallback = _pfnAdcCallback;
+		unsigned long ulDue = _ulAdcDue;
+
+		_bAdcBusy = false;
+		if (pfnCallback)
+			(*pfnCallback)(_pAdcContext, _nAnalogInput[_bAdcChannel]);
+		if (_bAdcBusy)
+			_ulAdcDue = ulDue + R5_HOST_ADC_US; // the next conversion starts when this one ended
+	}
+}
+
+void R5HalHost::_pinChanged(const uint8_t bPin, const uint8_t bOld, const uint8_t bNew)
+{
+	if (bOld == bNew)
+		return;
+
+	for (int i = 0; i < R5_HOST_INTERRUPTS; i++)
+	{
+		if ((_bInterruptPins[i] == bPin) && (_pfnISR[i] || _pfnPinCallback[i]))
+		{
+			if ((_nISRMode[i] == CHANGE) || ((_nISRMode[i] == RISING) && bNew) || ((_nISRMode[i] == FALLING) && !bNew))
+				_bISRPending[i] = true;
+		}
+	}
+	_service();
+}
+
+// the Arduino core, on the current context
+
+void pinMode(uint8_t bPin, uint8_t bMode)
+{
+	R5HalHost::current()->setPinMode(bPin, bMode);
+}
+
+void digitalWrite(uint8_t bPin, uint8_t bValue)
+{
+	R5HalHost::current()->writePin(bPin, bValue);
+}
+
+int digitalRead(uint8_t bPin)
+{
+	return R5HalHost::current()->readPin(bPin);
+}
+
+// a blocking conversion takes the conversion time
+int analogRead(uint8_t bPin)
+{
+	R5HalHost *pHost = R5HalHost::current();
+
+	pHost->advanceMicros(R5_HOST_ADC_US);
+	return pHost->readAnalog(bPin);
+}
+
+void analogWrite(uint8_t bPin, int nValue)
+{
+	R5HalHost::current()->writeAnalog(bPin, nValue);
+}
+
+unsigned long millis(void)
+{
+	return R5HalHost::current()->getMicros() / 1000UL;
+}
+
+unsigned long micros(void)
+{
+	return R5HalHost::current()->getMicros();
+}
+
+void delay(unsigned long ulMilliSecs)
+{
+	R5HalHost::current()->advanceMicros(ulMilliSecs * 1000UL);
+}
+
+void delayMicroseconds(unsigned int uiMicroSecs)
+{
+	R5HalHost::current()->advanceMicros(uiMicroSecs);
+}
+
+unsigned long pulseIn(uint8_t bPin, uint8_t bState, unsigned long ulTimeout)
+{
+	return R5HalHost::current()->measurePulse(bPin, bState, ulTimeout);
+}
+
+void attachInterrupt(uint8_t bInterrupt, void (*pfnISR)(void), int nMode)
+{
+	R5HalHost::current()->attachISR(bInterrupt, pfnISR, nMode);
+}
+
+void detachInterrupt(uint8_t bInterrupt)
+{
+	R5HalHost::current()->attachISR(bInterrupt, 0, CHANGE);
+}
+
+int digitalPinToInterrupt(uint8_t bPin)
+{
+	for (int i = 0; i < R5_HOST_INTERRUPTS; i++)
+	{
+		if (_bInterruptPins[i] == bPin)
+			return i;
+	}
+	return NOT_AN_INTERRUPT;
+}
+
+void interrupts(void)
+{
+	R5HalHost::current()->enableInterrupts(true);
+}
+
+void noInterrupts(void)
+{
+	R5HalHost::current()->enableInterrupts(false);
+}
+
+long random(long lMax)
+{
+	if (lMax == 0)
+		return 0;
+	return R5HalHost::current()->nextRandom() % lMax;
+}
+
+long random(long lMin, long lMax)
+{
+	if (lMin >= lMax)
+		return lMin;
+	return random(lMax - lMin) + lMin;
+}
+
+void randomSeed(unsigned long ulSeed)
+{
+	if (ulSeed != 0)
+		R5HalHost::current()->seedRandom(ulSeed);
+}
+
+long map(long lValue, long lFromLow, long lFromHigh, long lToLow, long lToHigh)
+{
+	return (lValue - lFromLow) * (lToHigh - lToLow) / (lFromHigh - lFromLow) + lToLow;
+}
+
+char *strupr(char *psz)
+{
+	for (char *p = psz; *p; p++)
+	{
+		if ((*p >= 'a') && (*p <= 'z'))
+			*p -= 'a' - 'A';
+	}
+	return psz;
+}
+
+size_t Print::write(const char *psz)
+{
+	size_t n = 0;
+
+	while (*psz)
+		n += write((uint8_t)*psz++);
+	return n;
+}
+
+size_t Print::write(const uint8_t *pBuffer, size_t nSize)
+{
+	size_t n = 0;
+
+	while (nSize--)
+		n += write(*pBuffer++);
+	return n;
+}
+
+size_t Print::print(const char *psz)
+{
+	return write(psz);
+}
+
+size_t Print::print(char c)
+{
+	return write((uint8_t)c);
+}
+
+size_t Print::print(int n)
+{
+	return print((long)n);
+}
+
+size_t Print::print(unsigned int n)
+{
+	return print((unsigned long)n);
+}
+
+size_t Print::print(long n)
+{
+	char szBuff[24];
+
+	snprintf(szBuff, sizeof(szBuff), "%ld", n);
+	return write(szBuff);
+}
+
+size_t Print::print(unsigned long n)
+{
+	char szBuff[24];
+
+	snprintf(szBuff, sizeof(szBuff), "%lu", n);
+	return write(szBuff);
+}
+
+size_t Print::println(void)
+{
+	return write("\r\n");
+}
+
+size_t R5HostSerial::write(uint8_t b)
+{
+	R5HalHost::current()->serialWrite(b);
+	return 1;
+}
+
+// the output is never held up on the host, so the transmit buffer of the Mega's Serial is always empty
+int R5HostSerial::availableForWrite(void)
+{
+	return 63;
+}
+
+int R5HostSerial::available(void)
+{
+	return (R5HalHost::current()->serialRead(false) >= 0) ? 1 : 0;
+}
+
+int R5HostSerial::read(void)
+{
+	return R5HalHost::current()->serialRead(true);
+}
+
+int R5HostSerial::peek(void)
+{
+	return R5HalHost::current()->serialRead(false);
+}
+
+Servo::Servo()
+{
+	_nPin = -1;
+	_nMicroSecs = 1500;
+}
+
+uint8_t Servo::attach(int nPin)
+{
+	_nPin = nPin;
+	pinMode(nPin, OUTPUT);
+	return 0;
+}
+
+void Servo::detach(void)
+{
+	_nPin = -1;
+}
+
+// same mapping as the Servo library, 0 - 180 degrees is 544 - 2400uS. Larger values are uS
+void Servo::write(int nAngle)
+{
+	if (nAngle < 544)
+	{
+		nAngle = constrain(nAngle, 0, 180);
+		nAngle = map(nAngle, 0, 180, 544, 2400);
+	}
+	writeMicroseconds(nAngle);
+}
+
+void Servo::writeMicroseconds(int nMicroSecs)
+{
+	_nMicroSecs = constrain(nMicroSecs, 544, 2400);
+}
+
+int Servo::read(void)
+{
+	return map(_nMicroSecs + 1, 544, 2400, 0, 180);
+}
+
+int Servo::readMicroseconds(void)
+{
+	return _nMicroSecs;
+}
+
+bool Servo::attached(void)
+{
+	return _nPin >= 0;
+}
+
+uint8_t EEPROMClass::read(int nAddress)
+{
+	return R5HalHost::current()->getEEPROM()[nAddress % R5_HOST_EEPROM_SIZE];
+}
+
+void EEPROMClass::write(int nAddress, uint8_t bValue)
+{
+	R5HalHost::current()->getEEPROM()[nAddress % R5_HOST_EEPROM_SIZE] = bValue;
+}
+
+void EEPROMClass::update(int nAddress, uint8_t bValue)
+{
+	if (read(nAddress) != bValue)
+		write(nAddress, bValue);
+}
+
+// the R5Hal asynchronous ADC and pin change interrupts on the host
+
+void R5Hal::adcStart(const unsigned char bPin, R5AdcCallback pfnCallback, void *pContext)
+{
+	R5HalHost::current()->adcStart(bPin, pfnCallback, pContext);
+}
+
+void R5Hal::adcStop(void)
+{
+	R5HalHost::current()->adcStop();
+}
+
+unsigned char R5Hal::attachPinChange(const unsigned char bPin, R5PinCallback pfnCallback, void *pContext)
+{
+	int nInterrupt = digitalPinToInterrupt(bPin);
+
+	if (nInterrupt == NOT_AN_INTERRUPT)
+		return false;
+	R5HalHost::current()->attachPinCallback(nInterrupt, pfnCallback, pContext, CHANGE);
+	return true;
+}
+
+void R5Hal::detachPinChange(const unsigned char bPin)
+{
+	int nInterrupt = digitalPinToInterrupt(bPin);
+
+	if (nInterrupt != NOT_AN_INTERRUPT)
+		R5HalHost::current()->attachPinCallback(nInterrupt, 0, 0, CHANGE);
+}
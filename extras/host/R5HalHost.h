@@ -0,0 +1,287 @@
+// 	Library for Rover 5 Platform Host Hardware Abstraction
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// The Linux backend for R5Hal. It provides the subset of the Arduino core that R5Hal.h lists,
+// backed by a simulated Mega 2560 so the library can be built and run on the host.
+//
+// Time only moves when it is told to. Everything the hardware would do happens against the virtual clock:
+// ADC conversions complete and pin change interrupts fire as the clock is advanced or inputs are changed.
+// delay() and pulseIn() advance the clock by the time they would have taken.
+//
+// All the state lives in an R5HalHost context. Each thread uses its own current context,
+// so several robots can be run at once on different threads.
+//
+// Note that int is 32 bits and long is 64 bits here, rather than 16 and 32 bits on the AVR.
+//
+#ifndef _R5HALHOST_H_
+#define _R5HALHOST_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#define R5_HOST_PINS		70	// digital pins on a Mega 2560
+#define R5_HOST_INTERRUPTS	6
+#define R5_HOST_EEPROM_SIZE	4096
+#define R5_HOST_ADC_US		112	// time for one conversion at the default 125kHz ADC clock
+#define R5_HOST_EVENTS		8	// scheduled input changes
+
+#define HIGH	0x1
+#define LOW		0x0
+#define INPUT			0x0
+#define OUTPUT			0x1
+#define INPUT_PULLUP	0x2
+#define CHANGE	1
+#define FALLING	2
+#define RISING	3
+#define DEFAULT	1
+#define NOT_AN_INTERRUPT	-1
+
+enum {A0 = 54, A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11, A12, A13, A14, A15};
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned int word;
+
+// GPIO
+void pinMode(uint8_t bPin, uint8_t bMode);
+void digitalWrite(uint8_t bPin, uint8_t bValue);
+int digitalRead(uint8_t bPin);
+int analogRead(uint8_t bPin);
+void analogWrite(uint8_t bPin, int nValue);
+
+// time
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ulMilliSecs);
+void delayMicroseconds(unsigned int uiMicroSecs);
+unsigned long pulseIn(uint8_t bPin, uint8_t bState, unsigned long ulTimeout = 1000000L);
+
+// interrupts
+void attachInterrupt(uint8_t bInterrupt, void (*pfnISR)(void), int nMode);
+void detachInterrupt(uint8_t bInterrupt);
+int digitalPinToInterrupt(uint8_t bPin);
+void interrupts(void);
+void noInterrupts(void);
+
+long random(long lMax);
+long random(long lMin, long lMax);
+void randomSeed(unsigned long ulSeed);
+long map(long lValue, long lFromLow, long lFromHigh, long lToLow, long lToHigh);
+
+// Arduino has these as macros. Templates do the same without breaking the standard library
+// The result has the type of the first argument
+template<class T, class U> inline T min(const T a, const U b) { return ((T)b < a) ? (T)b : a; }
+template<class T, class U> inline T max(const T a, const U b) { return (a < (T)b) ? (T)b : a; }
+template<class T, class U, class V> inline T constrain(const T x, const U lo, const V hi)
+	{ return (x < (T)lo) ? (T)lo : (((T)hi < x) ? (T)hi : x); }
+
+// program memory is ordinary memory
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+typedef char __FlashStringHelper;
+inline uint8_t pgm_read_byte(const void *p) { return *(const uint8_t *)p; }
+inline uint16_t pgm_read_word(const void *p) { uint16_t w; memcpy(&w, p, sizeof(w)); return w; }
+inline uint32_t pgm_read_dword(const void *p) { uint32_t dw; memcpy(&dw, p, sizeof(dw)); return dw; }
+inline const void *pgm_read_ptr(const void *p) { const void *pv; memcpy(&pv, p, sizeof(pv)); return pv; }
+#define pgm_read_byte_far(p) pgm_read_byte(p)
+#define pgm_read_word_far(p) pgm_read_word(p)
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcat_P strcat
+#define strlen_P strlen
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define sscanf_P sscanf
+#define vsnprintf_P vsnprintf
+char *strupr(char *psz);
+
+class Print {
+public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t b) = 0;
+	size_t write(const char *psz);
+	virtual size_t write(const uint8_t *pBuffer, size_t nSize);
+	virtual int availableForWrite(void) { return 0; }
+	size_t print(const char *psz);
+	size_t print(char c);
+	size_t print(int n);
+	size_t print(unsigned int n);
+	size_t print(long n);
+	size_t print(unsigned long n);
+	size_t println(void);
+	template<class T> size_t println(const T x) { size_t n = print(x); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+	virtual int available(void) = 0;
+	virtual int read(void) = 0;
+	virtual int peek(void) = 0;
+	virtual void flush(void) {}
+};
+
+// Serial reads and writes the serial buffers of the current context
+class R5HostSerial : public Stream {
+public:
+	void begin(unsigned long) {}
+	virtual size_t write(uint8_t b);
+	using Print::write;
+	virtual int availableForWrite(void);
+	virtual int available(void);
+	virtual int read(void);
+	virtual int peek(void);
+	operator bool() { return true; }
+};
+extern R5HostSerial Serial;
+
+class Servo {
+public:
+	Servo();
+	uint8_t attach(int nPin);
+	uint8_t attach(int nPin, int, int) { return attach(nPin); }
+	void detach(void);
+	void write(int nAngle);
+	void writeMicroseconds(int nMicroSecs);
+	int read(void);
+	int readMicroseconds(void);
+	bool attached(void);
+private:
+	int _nPin;
+	int _nMicroSecs;
+};
+
+// EEPROM reads and writes the EEPROM of the current context
+class EEPROMClass {
+public:
+	uint8_t read(int nAddress);
+	void write(int nAddress, uint8_t bValue);
+	void update(int nAddress, uint8_t bValue);
+	uint16_t length(void) { return R5_HOST_EEPROM_SIZE; }
+};
+extern EEPROMClass EEPROM;
+
+typedef void (*R5HostISR)(void);
+typedef void (*R5HostPinCallback)(void *pContext);
+typedef void (*R5HostAdcCallback)(void *pContext, const int nValue);
+
+// a pulseIn() handler returns the pulse length in uS, or 0 for a timeout
+typedef unsigned long (*R5HostPulseHandler)(void *pContext, const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout);
+// called after digitalWrite() or analogWrite() changes an output
+typedef void (*R5HostWriteHandler)(void *pContext, const uint8_t bPin, const uint8_t bValue);
+
+typedef struct {
+	unsigned long ulMicros;
+	uint8_t bPin;
+	uint8_t bValue;
+	uint8_t bUsed;
+} R5HostEventType;
+
+// the simulated hardware. Tests and simulators drive the inputs and read the outputs through this
+class R5HalHost {
+public:
+	R5HalHost();
+
+	static R5HalHost *current(void); // the context used by this thread
+	static void setCurrent(R5HalHost *pHost); // 0 restores the default context
+
+	// the virtual clock. Advancing it completes any ADC conversions and scheduled inputs that are due, in time order
+	unsigned long getMicros(void);
+	void setMicros(const unsigned long ulMicros);
+	void advanceMicros(const unsigned long ulMicros);
+
+	// inputs. A digital input change fires any interrupt attached to the pin
+	void setDigitalInput(const uint8_t bPin, const uint8_t bValue);
+	void setAnalogInput(const uint8_t bPin, const int nValue);	// 0 - 1023, pin may be A0.. or the channel number
+	void setPulseHandler(R5HostPulseHandler pfnHandler, void *pContext);
+	unsigned char scheduleDigitalInput(const uint8_t bPin, const uint8_t bValue, const unsigned long ulMicros); // false if full
+	void setWriteHandler(R5HostWriteHandler pfnHandler, void *pContext);
+
+	// outputs
+	uint8_t getPinMode(const uint8_t bPin);
+	uint8_t getDigitalOutput(const uint8_t bPin);
+	int getAnalogOutput(const uint8_t bPin); // the last analogWrite() value
+
+	// serial
+	void putSerialInput(const char *psz);
+	const std::string &getSerialOutput(void);
+	void clearSerialOutput(void);
+
+	uint8_t *getEEPROM(void) { return _bEEPROM; }
+
+	// used by the backend
+	int readPin(const uint8_t bPin);
+	void writePin(const uint8_t bPin, const uint8_t bValue);
+	int readAnalog(const uint8_t bPin);
+	void writeAnalog(const uint8_t bPin, const int nValue);
+	void setPinMode(const uint8_t bPin, const uint8_t bMode);
+	unsigned long measurePulse(const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout);
+	void attachISR(const uint8_t bInterrupt, R5HostISR pfnISR, const int nMode);
+	void attachPinCallback(const uint8_t bInterrupt, R5HostPinCallback pfnCallback, void *pContext, const int nMode);
+	void enableInterrupts(const uint8_t bEnable);
+	void adcStart(const uint8_t bPin, R5HostAdcCallback pfnCallback, void *pContext);
+	void adcStop(void);
+	unsigned long nextRandom(void);
+	void seedRandom(const unsigned long ulSeed);
+	int serialRead(const uint8_t bRemove);
+	void serialWrite(const uint8_t b);
+
+private:
+	void _service(void);
+	unsigned char _nextEvent(unsigned long *pulMicros);
+	void _pinChanged(const uint8_t bPin, const uint8_t bOld, const uint8_t bNew);
+
+	unsigned long _ulMicros;
+	uint8_t _bPinMode[R5_HOST_PINS];
+	uint8_t _bPinOutput[R5_HOST_PINS];
+	uint8_t _bPinInput[R5_HOST_PINS];
+	int _nAnalogOutput[R5_HOST_PINS];
+	int _nAnalogInput[16];
+
+	R5HostISR _pfnISR[R5_HOST_INTERRUPTS];			// attachInterrupt()
+	R5HostPinCallback _pfnPinCallback[R5_HOST_INTERRUPTS];	// or R5Hal::attachPinChange()
+	void *_pPinContext[R5_HOST_INTERRUPTS];
+	int _nISRMode[R5_HOST_INTERRUPTS];
+	uint8_t _bISRPending[R5_HOST_INTERRUPTS];
+	uint8_t _bInterruptsEnabled;
+
+	R5HostAdcCallback _pfnAdcCallback;
+	void *_pAdcContext;
+	uint8_t _bAdcChannel;
+	uint8_t _bAdcBusy;
+	unsigned long _ulAdcDue;
+
+	R5HostPulseHandler _pfnPulseHandler;
+	void *_pPulseContext;
+	R5HostWriteHandler _pfnWriteHandler;
+	void *_pWriteContext;
+	R5HostEventType _events[R5_HOST_EVENTS];
+
+	unsigned long _ulRandom;
+	std::string _strSerialIn;
+	std::string _strSerialOut;
+	uint8_t _bEEPROM[R5_HOST_EEPROM_SIZE];
+};
+
+#endif // _R5HALHOST_H_
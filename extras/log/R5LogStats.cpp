@@ -0,0 +1,442 @@
+// 	Library for Rover 5 Platform Log Analyser
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "R5LogStats.h"
+
+#define R5_LOG_READ_SIZE (1024 * 1024)	// block size when streaming
+
+static const char *szNodeTypes[R5_LOG_NODE_TYPES] = {"AP", "APE", "C", "CE", "D", "A"};
+
+unsigned char r5LogToken(const char **pp, const char *pEnd, R5LogTokenType *pToken)
+{
+	const char *p = *pp;
+
+	while ((p < pEnd) && ((*p == ' ') || (*p == '\t')))
+		p++;
+	pToken->p = p;
+	while ((p < pEnd) && (*p != ' ') && (*p != '\t'))
+		p++;
+	pToken->nLen = p - pToken->p;
+	*pp = p;
+	return (pToken->nLen > 0);
+}
+
+unsigned char r5LogNumber(const R5LogTokenType *pToken, unsigned long *pulValue)
+{
+	unsigned long ulValue = 0;
+
+	if (!pToken->nLen)
+		return false;
+	for (size_t i = 0; i < pToken->nLen; i++)
+	{
+		if ((pToken->p[i] < '0') || (pToken->p[i] > '9'))
+			return false;
+		ulValue = ulValue * 10 + (pToken->p[i] - '0');
+	}
+	*pulValue = ulValue;
+	return true;
+}
+
+static unsigned char _tokenIs(const R5LogTokenType *pToken, const char *pszWord)
+{
+	return (pToken->nLen == strlen(pszWord)) && !strncasecmp(pToken->p, pszWord, pToken->nLen);
+}
+
+R5LogStats::R5LogStats()
+{
+	_ulLines = 0;
+	_ullBytes = 0;
+	_ulRecords = 0;
+	_ulSenses = 0;
+	_ulStackErrors = 0;
+	_nDepth = 0;
+	memset(&_sCycles, 0, sizeof(_sCycles));
+	memset(&_sJitter, 0, sizeof(_sJitter));
+	_bCycleStarted = false;
+	_ulCycleStart = 0;
+	_ulLastInterval = 0;
+}
+
+size_t R5LogStats::parse(const char *pData, const size_t nLen)
+{
+	const char *p = pData;
+	const char *pEnd = pData + nLen;
+	const char *pEol;
+
+	while ((pEol = (const char *)memchr(p, '\n', pEnd - p)) != 0)
+	{
+		_line(p, ((pEol > p) && (pEol[-1] == '\r')) ? pEol - 1 : pEol);
+		p = pEol + 1;
+	}
+	_ullBytes += p - pData;
+	return p - pData;
+}
+
+unsigned char R5LogStats::parseFile(const char *pszFile)
+{
+	if (!strcmp(pszFile, "-"))
+	{
+		std::vector<char> buffer(R5_LOG_READ_SIZE);
+		size_t nHeld = 0;
+		size_t nRead;
+
+		while ((nRead = fread(&buffer[nHeld], 1, buffer.size() - nHeld, stdin)) > 0)
+		{
+			nHeld += nRead;
+			size_t nUsed = parse(&buffer[0], nHeld);
+			memmove(&buffer[0], &buffer[nUsed], nHeld - nUsed);
+			nHeld -= nUsed;
+			if (nHeld == buffer.size()) // a line longer than the buffer
+				buffer.resize(buffer.size() * 2);
+		}
+		if (nHeld)
+		{
+			_line(&buffer[0], &buffer[0] + nHeld);
+			_ullBytes += nHeld;
+		}
+		return !ferror(stdin);
+	}
+
+	int nFile = open(pszFile, O_RDONLY);
+	struct stat st;
+
+	if (nFile < 0)
+		return false;
+	if (fstat(nFile, &st) < 0)
+	{
+		close(nFile);
+		return false;
+	}
+	if (st.st_size > 0)
+	{
+		void *pMap = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, nFile, 0);
+		if (pMap == MAP_FAILED)
+		{
+			close(nFile);
+			return false;
+		}
+		madvise(pMap, st.st_size, MADV_SEQUENTIAL);
+		size_t nUsed = parse((const char *)pMap, st.st_size);
+		if (nUsed < (size_t)st.st_size) // no newline at the end
+		{
+			_line((const char *)pMap + nUsed, (const char *)pMap + st.st_size);
+			_ullBytes += st.st_size - nUsed;
+		}
+		munmap(pMap, st.st_size);
+	}
+	close(nFile);
+	return true;
+}
+
+unsigned char R5LogStats::loadNames(const char *pszPlanFile)
+{
+	FILE *pFile = fopen(pszPlanFile, "r");
+	char szLine[256];
+
+	if (!pFile)
+		return false;
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		const char *p = szLine;
+		const char *pEnd = szLine + strcspn(szLine, "\r\n");
+		R5LogTokenType token;
+
+		if (r5LogToken(&p, pEnd, &token) && _tokenIs(&token, "PELEM"))
+			_name(p, pEnd);
+	}
+	fclose(pFile);
+	return true;
+}
+
+void R5LogStats::merge(const R5LogStats *pOther)
+{
+	_ulLines += pOther->_ulLines;
+	_ullBytes += pOther->_ullBytes;
+	_ulRecords += pOther->_ulRecords;
+	_ulSenses += pOther->_ulSenses;
+	_ulStackErrors += pOther->_ulStackErrors;
+
+	const R5LogHistogramType *pFrom[] = {&pOther->_sCycles, &pOther->_sJitter};
+	R5LogHistogramType *pTo[] = {&_sCycles, &_sJitter};
+	for (int h = 0; h < 2; h++)
+	{
+		pTo[h]->ulCount += pFrom[h]->ulCount;
+		pTo[h]->ullSum += pFrom[h]->ullSum;
+		if (pFrom[h]->ulMax > pTo[h]->ulMax)
+			pTo[h]->ulMax = pFrom[h]->ulMax;
+		for (int i = 0; i < R5_LOG_BUCKETS; i++)
+			pTo[h]->ulBucket[i] += pFrom[h]->ulBucket[i];
+	}
+
+	for (unsigned int uiID = 0; uiID < pOther->_elements.size(); uiID++)
+	{
+		const R5LogElementType *pFrom = &pOther->_elements[uiID];
+		if (pFrom->nNodeType < 0)
+			continue;
+		R5LogElementType *pTo = _element(uiID);
+		pTo->nNodeType = pFrom->nNodeType;
+		pTo->ulExecuted += pFrom->ulExecuted;
+		pTo->ulSuccess += pFrom->ulSuccess;
+		pTo->ulInProgress += pFrom->ulInProgress;
+		pTo->ulFail += pFrom->ulFail;
+		pTo->ulError += pFrom->ulError;
+		pTo->sDuration.ulCount += pFrom->sDuration.ulCount;
+		pTo->sDuration.ullSum += pFrom->sDuration.ullSum;
+		if (pFrom->sDuration.ulMax > pTo->sDuration.ulMax)
+			pTo->sDuration.ulMax = pFrom->sDuration.ulMax;
+		for (int i = 0; i < R5_LOG_BUCKETS; i++)
+			pTo->sDuration.ulBucket[i] += pFrom->sDuration.ulBucket[i];
+	}
+
+	for (unsigned int uiID = 0; uiID < pOther->_names.size(); uiID++)
+	{
+		if (pOther->_names[uiID].empty())
+			continue;
+		if (_names.size() <= uiID)
+			_names.resize(uiID + 1);
+		if (_names[uiID].empty())
+			_names[uiID] = pOther->_names[uiID];
+	}
+}
+
+const R5LogElementType *R5LogStats::getElement(const unsigned int uiID)
+{
+	if ((uiID >= _elements.size()) || (_elements[uiID].nNodeType < 0))
+		return 0;
+	return &_elements[uiID];
+}
+
+const char *R5LogStats::getName(const unsigned int uiID)
+{
+	if ((uiID >= _names.size()) || _names[uiID].empty())
+		return 0;
+	return _names[uiID].c_str();
+}
+
+void R5LogStats::addSample(R5LogHistogramType *pHistogram, const unsigned long ulValue)
+{
+	unsigned long ulSample = (ulValue > 0xFFFFFFFFUL) ? 0xFFFFFFFFUL : ulValue;
+	int nBucket = (int)ulSample;
+
+	if (ulSample >= 8)
+	{
+		int nPower = 31 - __builtin_clz((unsigned int)ulSample);
+		nBucket = 8 + ((nPower - 3) << 2) + (int)((ulSample >> (nPower - 2)) & 3);
+	}
+	pHistogram->ulBucket[nBucket]++;
+	pHistogram->ulCount++;
+	pHistogram->ullSum += ulValue;
+	if (ulValue > pHistogram->ulMax)
+		pHistogram->ulMax = ulValue;
+}
+
+unsigned long R5LogStats::percentile(const R5LogHistogramType *pHistogram, const int nPercent)
+{
+	unsigned long ulWanted = (pHistogram->ulCount * nPercent + 99) / 100;
+	unsigned long ulSeen = 0;
+
+	if (!pHistogram->ulCount)
+		return 0;
+	for (int i = 0; i < R5_LOG_BUCKETS; i++)
+	{
+		ulSeen += pHistogram->ulBucket[i];
+		if (ulSeen >= ulWanted)
+		{
+			unsigned long ulEdge = bucketHigh(i);
+			return (ulEdge < pHistogram->ulMax) ? ulEdge : pHistogram->ulMax;
+		}
+	}
+	return pHistogram->ulMax;
+}
+
+unsigned long R5LogStats::bucketLow(const int nBucket)
+{
+	if (nBucket < 8)
+		return nBucket;
+	int nPower = ((nBucket - 8) >> 2) + 3;
+	return (4UL + ((nBucket - 8) & 3)) << (nPower - 2);
+}
+
+unsigned long R5LogStats::bucketHigh(const int nBucket)
+{
+	if (nBucket < 8)
+		return nBucket;
+	return bucketLow(nBucket) + (1UL << (((nBucket - 8) >> 2) + 1)) - 1;
+}
+
+const char *R5LogStats::nodeTypeName(const int nNodeType)
+{
+	return ((nNodeType >= 0) && (nNodeType < R5_LOG_NODE_TYPES)) ? szNodeTypes[nNodeType] : "?";
+}
+
+void R5LogStats::_line(const char *p, const char *pEnd)
+{
+	R5LogTokenType token;
+	unsigned long ulMillis;
+
+	_ulLines++;
+	if (!r5LogToken(&p, pEnd, &token) || !r5LogNumber(&token, &ulMillis) || !r5LogToken(&p, pEnd, &token))
+		return;
+
+	if (token.nLen == 1)
+	{
+		switch (token.p[0])
+		{
+			case 'E':
+			case 'S':
+			case 'P':
+			case 'F':
+			case 'Z':
+				_monitor(ulMillis, token.p[0], p, pEnd);
+				break;
+			case 'R':
+				_ulSenses++;
+				break;
+		}
+	}
+	else if (_tokenIs(&token, "PELEM"))
+		_name(p, pEnd);
+}
+
+void R5LogStats::_monitor(const unsigned long ulMillis, const char cType, const char *p, const char *pEnd)
+{
+	R5LogTokenType token;
+	unsigned long ulID;
+	int nNodeType;
+
+	if (!r5LogToken(&p, pEnd, &token))
+		return;
+	for (nNodeType = 0; nNodeType < R5_LOG_NODE_TYPES; nNodeType++)
+	{
+		if ((token.nLen == strlen(szNodeTypes[nNodeType])) && !memcmp(token.p, szNodeTypes[nNodeType], token.nLen))
+			break;
+	}
+	if ((nNodeType == R5_LOG_NODE_TYPES) || !r5LogToken(&p, pEnd, &token) || !r5LogNumber(&token, &ulID) || (ulID > 0xFFFF))
+		return;
+
+	_ulRecords++;
+	R5LogElementType *pElement = _element((unsigned int)ulID);
+	pElement->nNodeType = nNodeType;
+
+	if (cType == 'E')
+	{
+		if (!_nDepth)
+		{
+			// a new plan cycle
+			if (_bCycleStarted)
+			{
+				unsigned long ulInterval = ulMillis - _ulCycleStart;
+				if (_sCycles.ulCount)
+					addSample(&_sJitter, (ulInterval > _ulLastInterval) ? ulInterval - _ulLastInterval : _ulLastInterval - ulInterval);
+				addSample(&_sCycles, ulInterval);
+				_ulLastInterval = ulInterval;
+			}
+			_bCycleStarted = true;
+			_ulCycleStart = ulMillis;
+		}
+		if (_nDepth == R5_LOG_STACK_DEPTH)
+		{
+			_ulStackErrors++;
+			_nDepth = 0;
+		}
+		_uiStack[_nDepth++] = (unsigned int)ulID;
+		pElement->ulExecuted++;
+		if (!pElement->bRunning)
+		{
+			pElement->bRunning = true;
+			pElement->bWentInProgress = false;
+			pElement->ulRunStart = ulMillis;
+		}
+		return;
+	}
+
+	// the outcome is for the innermost element. If it isn't, outcomes have been lost from the log
+	int nFound = _nDepth - 1;
+	while ((nFound >= 0) && (_uiStack[nFound] != ulID))
+		nFound--;
+	if (nFound != (_nDepth - 1))
+		_ulStackErrors++;
+	if (nFound < 0)
+		return;
+	_nDepth = nFound;
+
+	switch (cType)
+	{
+		case 'P':
+			pElement->ulInProgress++;
+			pElement->bWentInProgress = true;
+			return; // the run goes on next cycle
+		case 'S':
+			pElement->ulSuccess++;
+			break;
+		case 'F':
+			pElement->ulFail++;
+			break;
+		case 'Z':
+			pElement->ulError++;
+			break;
+	}
+	if (pElement->bRunning && pElement->bWentInProgress)
+		addSample(&pElement->sDuration, ulMillis - pElement->ulRunStart);
+	pElement->bRunning = false;
+}
+
+// PELEM Name=ID or PELEM Name ID
+void R5LogStats::_name(const char *p, const char *pEnd)
+{
+	R5LogTokenType token;
+	R5LogTokenType id;
+	unsigned long ulID;
+
+	if (!r5LogToken(&p, pEnd, &token))
+		return;
+	const char *pEquals = (const char *)memchr(token.p, '=', token.nLen);
+	if (pEquals)
+	{
+		id.p = pEquals + 1;
+		id.nLen = token.p + token.nLen - id.p;
+		token.nLen = pEquals - token.p;
+	}
+	else if (!r5LogToken(&p, pEnd, &id))
+		return;
+	if (!token.nLen || !r5LogNumber(&id, &ulID) || (ulID > 0xFFFF))
+		return;
+
+	if (_names.size() <= ulID)
+		_names.resize(ulID + 1);
+	_names[ulID].assign(token.p, token.nLen);
+}
+
+R5LogElementType *R5LogStats::_element(const unsigned int uiID)
+{
+	if (_elements.size() <= uiID)
+	{
+		R5LogElementType unused;
+		memset(&unused, 0, sizeof(unused));
+		unused.nNodeType = -1;
+		_elements.resize(uiID + 1, unused);
+	}
+	return &_elements[uiID];
+}
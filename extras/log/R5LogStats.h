@@ -0,0 +1,129 @@
+// 	Library for Rover 5 Platform Log Analyser
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Statistics from the log a robot writes through MyOutput::outputData(). Every line starts with
+// a %010lu millis() stamp. The plan monitor writes a record each time a plan element is executed
+// (E) and for how it ended (S success, P in progress, F fail, Z error), as
+//
+//	0000012345 E CE 7 ...
+//
+// where CE is the node type from getNodeTypeName() and the first number from displayNodeCounters()
+// is the element's runtime ID. R records are sense readings. Each E is ended by exactly one
+// outcome, innermost first, so the execution stack is rebuilt from them. An element that returns P
+// is run again on later plan cycles, and the time from the E that started it to the S, F or Z that
+// ended it is its in progress duration. A plan cycle starts with an E on an empty stack.
+//
+// Element names come from PELEM commands, which the robot echoes into its log, or from a plan file.
+// Anything else in the log is skipped.
+//
+#ifndef _R5LOGSTATS_H_
+#define _R5LOGSTATS_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#define R5_LOG_BUCKETS		124	// histogram buckets of mS: 0-7 exactly, then each power of two in quarters
+#define R5_LOG_NODE_TYPES	6	// AP APE C CE D A, as szNodeType in Robot_Instinct.ino
+#define R5_LOG_STACK_DEPTH	32	// deeper than any plan. More means the log has lost outcomes
+
+// counts in buckets of 0, 1, 2-3, 4-7 ... mS
+typedef struct {
+	unsigned long ulCount;
+	unsigned long long ullSum;
+	unsigned long ulMax;
+	unsigned long ulBucket[R5_LOG_BUCKETS];
+} R5LogHistogramType;
+
+typedef struct {
+	int nNodeType;				// -1 until the element is seen
+	unsigned long ulExecuted;
+	unsigned long ulSuccess;
+	unsigned long ulInProgress;
+	unsigned long ulFail;
+	unsigned long ulError;
+	R5LogHistogramType sDuration; // in progress durations
+	// the run in progress
+	unsigned char bRunning;
+	unsigned char bWentInProgress;
+	unsigned long ulRunStart;
+} R5LogElementType;
+
+// a token in the log. It points into the log, nothing is copied
+typedef struct {
+	const char *p;
+	size_t nLen;
+} R5LogTokenType;
+
+class R5LogStats {
+public:
+	R5LogStats();
+
+	// parse whole lines. Returns how much was used, so a stream can keep a partial last line for later
+	size_t parse(const char *pData, const size_t nLen);
+	unsigned char parseFile(const char *pszFile); // memory maps the file, or streams it if it is -. false if it can't be read
+	unsigned char loadNames(const char *pszPlanFile); // the PELEM lines of a plan file
+	void merge(const R5LogStats *pOther); // adds another log's counts. Stacks and runs are per log
+
+	unsigned long getLines(void) {return _ulLines;};
+	unsigned long long getBytes(void) {return _ullBytes;};
+	unsigned long getRecords(void) {return _ulRecords;};
+	unsigned long getSenses(void) {return _ulSenses;};
+	unsigned long getStackErrors(void) {return _ulStackErrors;};
+	const R5LogHistogramType *getCycles(void) {return &_sCycles;};
+	const R5LogHistogramType *getJitter(void) {return &_sJitter;};
+	unsigned int getMaxElementID(void) {return (unsigned int)_elements.size();};
+	const R5LogElementType *getElement(const unsigned int uiID); // 0 if never seen
+	const char *getName(const unsigned int uiID); // 0 if not named
+
+	static void addSample(R5LogHistogramType *pHistogram, const unsigned long ulValue);
+	static unsigned long percentile(const R5LogHistogramType *pHistogram, const int nPercent); // upper edge of the bucket
+	static unsigned long bucketLow(const int nBucket);
+	static unsigned long bucketHigh(const int nBucket);
+	static const char *nodeTypeName(const int nNodeType);
+
+private:
+	void _line(const char *p, const char *pEnd);
+	void _monitor(const unsigned long ulMillis, const char cType, const char *p, const char *pEnd);
+	void _name(const char *p, const char *pEnd);
+	R5LogElementType *_element(const unsigned int uiID);
+
+	unsigned long _ulLines;
+	unsigned long long _ullBytes;
+	unsigned long _ulRecords;
+	unsigned long _ulSenses;
+	unsigned long _ulStackErrors;
+	std::vector<R5LogElementType> _elements; // indexed by runtime ID
+	std::vector<std::string> _names;
+
+	// the execution stack of element IDs
+	unsigned int _uiStack[R5_LOG_STACK_DEPTH];
+	int _nDepth;
+
+	// plan cycle intervals. The jitter is the difference from the last interval
+	R5LogHistogramType _sCycles;
+	R5LogHistogramType _sJitter;
+	unsigned char _bCycleStarted;
+	unsigned long _ulCycleStart;
+	unsigned long _ulLastInterval;
+};
+
+// the tokenizer. Skips spaces and returns false at the end of the line
+unsigned char r5LogToken(const char **pp, const char *pEnd, R5LogTokenType *pToken);
+unsigned char r5LogNumber(const R5LogTokenType *pToken, unsigned long *pulValue); // false if not all digits
+
+#endif // _R5LOGSTATS_H_
@@ -0,0 +1,185 @@
+// 	Library for Rover 5 Platform Log Analyser
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Reads the logs robots write, see R5LogStats.h, and reports how the plan ran: plan cycle
+// intervals and jitter as histograms, and for each plan element its executions, outcomes, failure
+// rate and how long it stayed in progress.
+//
+// r5log [-j threads] [-n plan.inst] [-c] log ...
+//
+// A log of - is read from stdin. Each log is one robot's run, so the logs are read in parallel
+// and their counts added. -n names the elements from the PELEM lines of a plan, for logs that
+// don't include the PELEM commands. -c writes the element table as CSV instead of the report.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "R5SimPool.h"
+#include "R5LogStats.h"
+
+#define R5_LOG_BAR_WIDTH 50
+
+typedef struct {
+	std::vector<const char *> files;
+	std::vector<R5LogStats> stats;
+	std::vector<unsigned char> ok;
+} R5LogJobType;
+
+static void _parseTask(void *pContext, const int nTask)
+{
+	R5LogJobType *pJob = (R5LogJobType *)pContext;
+
+	pJob->ok[nTask] = pJob->stats[nTask].parseFile(pJob->files[nTask]);
+}
+
+static void _printHistogram(const char *pszTitle, const R5LogHistogramType *pHistogram)
+{
+	unsigned long ulMost = 0;
+	int nFirst = -1;
+	int nLast = 0;
+
+	printf("%s: %lu, mean %.1f, p50 %lu, p90 %lu, p99 %lu, max %lu mS\n", pszTitle, pHistogram->ulCount,
+			pHistogram->ulCount ? (double)pHistogram->ullSum / pHistogram->ulCount : 0.0,
+			R5LogStats::percentile(pHistogram, 50), R5LogStats::percentile(pHistogram, 90),
+			R5LogStats::percentile(pHistogram, 99), pHistogram->ulMax);
+	for (int i = 0; i < R5_LOG_BUCKETS; i++)
+	{
+		if (pHistogram->ulBucket[i])
+		{
+			if (nFirst < 0)
+				nFirst = i;
+			nLast = i;
+		}
+		if (pHistogram->ulBucket[i] > ulMost)
+			ulMost = pHistogram->ulBucket[i];
+	}
+	for (int i = nFirst; (nFirst >= 0) && (i <= nLast); i++)
+	{
+		char szRange[48];
+		if (R5LogStats::bucketLow(i) == R5LogStats::bucketHigh(i))
+			snprintf(szRange, sizeof(szRange), "%lu", R5LogStats::bucketLow(i));
+		else
+			snprintf(szRange, sizeof(szRange), "%lu-%lu", R5LogStats::bucketLow(i), R5LogStats::bucketHigh(i));
+		int nBar = (int)((pHistogram->ulBucket[i] * R5_LOG_BAR_WIDTH + ulMost - 1) / ulMost);
+		printf("  %13s %10lu %.*s\n", szRange, pHistogram->ulBucket[i], nBar, "##################################################");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int nThreads = 0;
+	const char *pszPlan = 0;
+	unsigned char bCSV = false;
+	int nOpt;
+
+	while ((nOpt = getopt(argc, argv, "j:n:c")) != -1)
+	{
+		switch (nOpt)
+		{
+			case 'j': nThreads = atoi(optarg); break;
+			case 'n': pszPlan = optarg; break;
+			case 'c': bCSV = true; break;
+			default:
+				fprintf(stderr, "usage: r5log [-j threads] [-n plan.inst] [-c] log ...\n");
+				return 2;
+		}
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "usage: r5log [-j threads] [-n plan.inst] [-c] log ...\n");
+		return 2;
+	}
+
+	R5LogJobType job;
+	for (int i = optind; i < argc; i++)
+		job.files.push_back(argv[i]);
+	job.stats.resize(job.files.size());
+	job.ok.resize(job.files.size(), false);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	R5SimPool pool(nThreads);
+	pool.run((int)job.files.size(), _parseTask, &job);
+
+	R5LogStats total;
+	if (pszPlan && !total.loadNames(pszPlan))
+	{
+		fprintf(stderr, "r5log: cannot read plan %s\n", pszPlan);
+		return 1;
+	}
+	int nRtn = 0;
+	for (size_t i = 0; i < job.files.size(); i++)
+	{
+		if (!job.ok[i])
+		{
+			fprintf(stderr, "r5log: cannot read %s\n", job.files[i]);
+			nRtn = 1;
+		}
+		total.merge(&job.stats[i]);
+	}
+	double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (bCSV)
+	{
+		printf("id,name,type,executed,success,in_progress,fail,error,fail_rate,runs,run_p50,run_p90,run_p99,run_max\n");
+		for (unsigned int uiID = 0; uiID < total.getMaxElementID(); uiID++)
+		{
+			const R5LogElementType *pElement = total.getElement(uiID);
+			if (!pElement)
+				continue;
+			unsigned long ulEnded = pElement->ulSuccess + pElement->ulFail + pElement->ulError;
+			printf("%u,%s,%s,%lu,%lu,%lu,%lu,%lu,%.4f,%lu,%lu,%lu,%lu,%lu\n", uiID, total.getName(uiID) ? total.getName(uiID) : "",
+					R5LogStats::nodeTypeName(pElement->nNodeType), pElement->ulExecuted, pElement->ulSuccess,
+					pElement->ulInProgress, pElement->ulFail, pElement->ulError,
+					ulEnded ? (double)(pElement->ulFail + pElement->ulError) / ulEnded : 0.0, pElement->sDuration.ulCount,
+					R5LogStats::percentile(&pElement->sDuration, 50), R5LogStats::percentile(&pElement->sDuration, 90),
+					R5LogStats::percentile(&pElement->sDuration, 99), pElement->sDuration.ulMax);
+		}
+		return nRtn;
+	}
+
+	printf("%d logs, %lu lines, %.1f MB in %.2f s (%.0f MB/s), %d threads\n", (int)job.files.size(), total.getLines(),
+			total.getBytes() / 1e6, dSeconds, (dSeconds > 0) ? total.getBytes() / 1e6 / dSeconds : 0.0, pool.getThreads());
+	printf("%lu monitor records, %lu sense records, %lu stack errors\n\n", total.getRecords(), total.getSenses(), total.getStackErrors());
+	_printHistogram("plan cycle interval", total.getCycles());
+	printf("\n");
+	_printHistogram("plan cycle jitter (change in interval)", total.getJitter());
+	printf("\n%-24s %-3s %10s %10s %10s %10s %8s %6s %8s %8s %8s %8s\n", "element", "typ", "executed", "success",
+			"progress", "fail", "error", "fail%", "runs", "run p50", "run p99", "run max");
+	for (unsigned int uiID = 0; uiID < total.getMaxElementID(); uiID++)
+	{
+		const R5LogElementType *pElement = total.getElement(uiID);
+		if (!pElement)
+			continue;
+		char szName[32];
+		if (total.getName(uiID))
+			snprintf(szName, sizeof(szName), "%s", total.getName(uiID));
+		else
+			snprintf(szName, sizeof(szName), "#%u", uiID);
+		unsigned long ulEnded = pElement->ulSuccess + pElement->ulFail + pElement->ulError;
+		printf("%-24s %-3s %10lu %10lu %10lu %10lu %8lu %6.1f %8lu %8lu %8lu %8lu\n", szName,
+				R5LogStats::nodeTypeName(pElement->nNodeType), pElement->ulExecuted, pElement->ulSuccess,
+				pElement->ulInProgress, pElement->ulFail, pElement->ulError,
+				ulEnded ? 100.0 * (pElement->ulFail + pElement->ulError) / ulEnded : 0.0, pElement->sDuration.ulCount,
+				R5LogStats::percentile(&pElement->sDuration, 50), R5LogStats::percentile(&pElement->sDuration, 99),
+				pElement->sDuration.ulMax);
+	}
+	return nRtn;
+}
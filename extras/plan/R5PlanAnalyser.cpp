@@ -0,0 +1,305 @@
+// 	Library for Rover 5 Platform Plan Analyser
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "R5PlanIds.h"
+#include "R5PlanCompiler.h"
+#include "R5PlanAnalyser.h"
+
+#define R5_PLAN_COST_LINE	256
+
+R5PlanAnalyser::R5PlanAnalyser(R5PlanCompiler *pPlan)
+{
+	_pPlan = pPlan;
+	_ulNodeCost = R5_PLAN_NODE_COST;
+	for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+		_nNodeBytes[i] = 1 + (2 * R5PlanCompiler::argCount(i)) + R5_PLAN_NODE_STATE;
+	_nRecursiveID = 0;
+	_nDepth = 0;
+	_ulCycleMicros = 0;
+	_ulDriveSenseMicros = 0;
+
+	// the NeoPixel strip is written with interrupts off, about 30uS a pixel
+	setActionCost(ACTION_FLASH_COLOUR, 300);
+	setActionCost(ACTION_CONF_HUMAN, 300);
+	// these search the sense matrix of the head
+	setActionCost(ACTION_TURNTOMOSTOPEN, 120);
+	setActionCost(ACTION_TURNMOSTOPENDIR, 120);
+	setSenseCost(SENSE_RANDOM, 60);
+}
+
+void R5PlanAnalyser::setSenseCost(const int nSense, const unsigned long ulMicros)
+{
+	_senseCosts[nSense] = ulMicros;
+}
+
+void R5PlanAnalyser::setActionCost(const int nAction, const unsigned long ulMicros)
+{
+	_actionCosts[nAction] = ulMicros;
+}
+
+void R5PlanAnalyser::setNodeCost(const unsigned long ulMicros)
+{
+	_ulNodeCost = ulMicros;
+}
+
+void R5PlanAnalyser::setNodeBytes(const int nNodeType, const int nBytes)
+{
+	if ((nNodeType >= 0) && (nNodeType < R5_PLAN_NODE_TYPES))
+		_nNodeBytes[nNodeType] = nBytes;
+}
+
+int R5PlanAnalyser::getNodeBytes(const int nNodeType)
+{
+	return ((nNodeType >= 0) && (nNodeType < R5_PLAN_NODE_TYPES)) ? _nNodeBytes[nNodeType] : 0;
+}
+
+unsigned long R5PlanAnalyser::getSenseCost(const int nSense)
+{
+	std::map<int, unsigned long>::const_iterator it = _senseCosts.find(nSense);
+
+	return (it == _senseCosts.end()) ? R5_PLAN_SENSE_COST : it->second;
+}
+
+unsigned long R5PlanAnalyser::getActionCost(const int nAction)
+{
+	std::map<int, unsigned long>::const_iterator it = _actionCosts.find(nAction);
+
+	return (it == _actionCosts.end()) ? R5_PLAN_ACTION_COST : it->second;
+}
+
+// the planner sizes its buffers from PLAN R I, so that is what is counted
+unsigned long R5PlanAnalyser::getPlanBytes(void)
+{
+	unsigned long ulBytes = 0;
+
+	for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+		ulBytes += (unsigned long)_pPlan->getDeclared(i) * _nNodeBytes[i];
+	return ulBytes;
+}
+
+// each name is stored with its terminator and a 2 byte element ID
+unsigned long R5PlanAnalyser::getNameBytes(void)
+{
+	unsigned long ulBytes = 0;
+
+	for (std::map<int, std::string>::const_iterator it = _pPlan->getNames().begin(); it != _pPlan->getNames().end(); ++it)
+		ulBytes += it->second.size() + 1 + 2;
+	return ulBytes;
+}
+
+int R5PlanAnalyser::_lookup(const char *pszItem, const std::map<int, std::string> &names)
+{
+	char *pszEnd;
+	long lID = strtol(pszItem, &pszEnd, 10);
+
+	if (*pszItem && !*pszEnd)
+		return (int)lID;
+	for (std::map<int, std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+	{
+		if (it->second == pszItem)
+			return it->first;
+	}
+	return -1;
+}
+
+unsigned char R5PlanAnalyser::loadCosts(const char *pszFile)
+{
+	char szLine[R5_PLAN_COST_LINE];
+	char szItem[16];
+	char szName[64];
+	unsigned long ulMicros;
+	FILE *pFile = fopen(pszFile, "r");
+
+	if (!pFile)
+		return false;
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		char *pComment = strchr(szLine, '#');
+		if (pComment)
+			*pComment = 0;
+		int nItems = sscanf(szLine, "%15s %63s %lu", szItem, szName, &ulMicros);
+		if (nItems <= 0)
+			continue;
+
+		int nID;
+		if (!strcmp(szItem, "NODE") && (nItems == 2) && (sscanf(szName, "%lu", &ulMicros) == 1))
+			setNodeCost(ulMicros);
+		else if (!strcmp(szItem, "SENSE") && (nItems == 3) && ((nID = _lookup(szName, _pPlan->getSenses())) >= 0))
+			setSenseCost(nID, ulMicros);
+		else if (!strcmp(szItem, "ACTION") && (nItems == 3) && ((nID = _lookup(szName, _pPlan->getActions())) >= 0))
+			setActionCost(nID, ulMicros);
+		else
+		{
+			fclose(pFile);
+			return false;
+		}
+	}
+	fclose(pFile);
+	return true;
+}
+
+// nodes on the stack from nID down, with the deepest path in pPath
+int R5PlanAnalyser::_depth(const int nID, std::vector<int> *pPath)
+{
+	const R5PlanNodeType *pNode = _pPlan->getNode(nID);
+	int nDepth = 1;
+
+	pPath->clear();
+	pPath->push_back(nID);
+	if (!pNode || _nRecursiveID)
+		return nDepth;
+	if (_visiting[nID])
+	{
+		_nRecursiveID = nID;
+		return nDepth;
+	}
+	_visiting[nID] = true;
+
+	std::vector<int> path;
+	if (pNode->nNodeType == R5_PLAN_D)
+	{
+		nDepth += _depth(pNode->args[R5_PLAN_D_CHILD], &path);
+		pPath->insert(pPath->end(), path.begin(), path.end());
+	}
+	else if ((pNode->nNodeType == R5_PLAN_AP) || (pNode->nNodeType == R5_PLAN_C))
+	{
+		int nChildArg = (pNode->nNodeType == R5_PLAN_AP) ? R5_PLAN_APE_CHILD : R5_PLAN_CE_CHILD;
+		const std::vector<int> &elements = _elements[nID];
+		int nMost = 0;
+		for (size_t i = 0; i < elements.size(); i++)
+		{
+			int nElementDepth = 1 + _depth(_pPlan->getNode(elements[i])->args[nChildArg], &path);
+			if (nElementDepth > nMost)
+			{
+				nMost = nElementDepth;
+				pPath->resize(1);
+				pPath->push_back(elements[i]);
+				pPath->insert(pPath->end(), path.begin(), path.end());
+			}
+		}
+		nDepth += nMost;
+	}
+	_visiting[nID] = false;
+	return nDepth;
+}
+
+// the longest nID can take in one plan cycle. A Competence reads the senses of all its elements
+// to find the one to run, and an Action Pattern runs one element each cycle
+unsigned long R5PlanAnalyser::_cost(const int nID, std::vector<int> *pPath)
+{
+	const R5PlanNodeType *pNode = _pPlan->getNode(nID);
+	unsigned long ulCost = _ulNodeCost;
+
+	pPath->clear();
+	pPath->push_back(nID);
+	if (!pNode || _nRecursiveID)
+		return ulCost;
+	if (_visiting[nID])
+	{
+		_nRecursiveID = nID;
+		return ulCost;
+	}
+	_visiting[nID] = true;
+
+	std::vector<int> path;
+	switch (pNode->nNodeType)
+	{
+	case R5_PLAN_A:
+		ulCost += getActionCost(pNode->args[R5_PLAN_A_ACTION]);
+		break;
+	case R5_PLAN_D:
+		ulCost += _cost(pNode->args[R5_PLAN_D_CHILD], &path);
+		pPath->insert(pPath->end(), path.begin(), path.end());
+		break;
+	case R5_PLAN_AP:
+	case R5_PLAN_C:
+		{
+			int nChildArg = (pNode->nNodeType == R5_PLAN_AP) ? R5_PLAN_APE_CHILD : R5_PLAN_CE_CHILD;
+			const std::vector<int> &elements = _elements[nID];
+			unsigned long ulMost = 0;
+			for (size_t i = 0; i < elements.size(); i++)
+			{
+				const R5PlanNodeType *pElement = _pPlan->getNode(elements[i]);
+				if (pNode->nNodeType == R5_PLAN_C)
+					ulCost += getSenseCost(pElement->args[R5_PLAN_CE_SENSE]);
+				unsigned long ulElementCost = _ulNodeCost + _cost(pElement->args[nChildArg], &path);
+				if (ulElementCost > ulMost)
+				{
+					ulMost = ulElementCost;
+					pPath->resize(1);
+					pPath->push_back(elements[i]);
+					pPath->insert(pPath->end(), path.begin(), path.end());
+				}
+			}
+			ulCost += ulMost;
+		}
+		break;
+	}
+	_visiting[nID] = false;
+	return ulCost;
+}
+
+unsigned char R5PlanAnalyser::analyse(void)
+{
+	const std::map<int, R5PlanNodeType> &nodes = _pPlan->getNodes();
+	std::vector<int> path;
+
+	_elements.clear();
+	_visiting.clear();
+	_nRecursiveID = 0;
+	_nDepth = 0;
+	_deepestPath.clear();
+	_ulCycleMicros = 0;
+	_ulDriveSenseMicros = 0;
+	_costliestPath.clear();
+
+	for (std::map<int, R5PlanNodeType>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+	{
+		if (it->second.nNodeType == R5_PLAN_APE)
+			_elements[it->second.args[R5_PLAN_APE_PARENT]].push_back(it->first);
+		else if (it->second.nNodeType == R5_PLAN_CE)
+			_elements[it->second.args[R5_PLAN_CE_PARENT]].push_back(it->first);
+	}
+
+	// every Drive's sense is read each cycle, then one Drive runs
+	unsigned long ulMostDrive = 0;
+	for (std::map<int, R5PlanNodeType>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+	{
+		if (it->second.nNodeType != R5_PLAN_D)
+			continue;
+		_ulDriveSenseMicros += getSenseCost(it->second.args[R5_PLAN_D_SENSE]);
+
+		int nDepth = _depth(it->first, &path);
+		if (nDepth > _nDepth)
+		{
+			_nDepth = nDepth;
+			_deepestPath = path;
+		}
+		unsigned long ulCost = _cost(it->first, &path);
+		if (ulCost > ulMostDrive)
+		{
+			ulMostDrive = ulCost;
+			_costliestPath = path;
+		}
+	}
+	_ulCycleMicros = _ulDriveSenseMicros + ulMostDrive;
+	return !_nRecursiveID;
+}
@@ -0,0 +1,98 @@
+// 	Library for Rover 5 Platform Plan Analyser
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Works out, before a plan is sent to the robot, whether it fits:
+//
+// - depth, the most nodes on the execution stack at once, from a Drive down through its
+//   Competences and Action Patterns to an Action. R5ExecStackMonitor holds R5_EXEC_STACK_DEPTH
+// - RAM, the plan nodes sized by PLAN R I, plus the names in the Instinct::Names buffer
+// - cycle cost, the longest one plan cycle can take. Every Drive's sense is read, then the
+//   released Drive runs down one path, reading the senses of every CE of each Competence on the
+//   way and running one element of each Action Pattern, to one Action
+//
+// Costs come from a table of senses and actions in uS, with a cost for each node the planner
+// runs. The defaults are for Robot_Instinct.ino, where senses read the R5SensorFrame captured
+// before the cycle so none blocks, and the actions that light the NeoPixels cost the most. A
+// cost file changes them, one item per line, # starts a comment:
+//
+// SENSE id|name uS		an RSENSE name or sense ID
+// ACTION id|name uS	an RACTION name or action ID
+// NODE uS				each node run, including the monitor's records
+//
+// Node sizes are estimates for the AVR build: a byte of node type, 2 bytes for each PLAN A
+// argument and R5_PLAN_NODE_STATE bytes of run time state. setNodeBytes() changes them.
+//
+#ifndef _R5PLANANALYSER_H_
+#define _R5PLANANALYSER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define R5_PLAN_MAX_DEPTH		20		// R5_EXEC_STACK_DEPTH in R5Vocalise.h
+#define R5_PLAN_MAX_RAM			3000	// bytes for the plan nodes
+#define R5_PLAN_NAMES_BUFFER	1500	// myNames in Robot_Instinct.ino
+#define R5_PLAN_MAX_CYCLE		2000	// uS, a longer cycle delays driveMotors() and driveHead()
+#define R5_PLAN_NODE_STATE		11		// status and counters kept for each node
+#define R5_PLAN_SENSE_COST		15		// uS for a sense not in the table
+#define R5_PLAN_ACTION_COST		40		// uS for an action not in the table
+#define R5_PLAN_NODE_COST		25		// uS for each node run
+
+class R5PlanAnalyser {
+public:
+	R5PlanAnalyser(R5PlanCompiler *pPlan);
+	unsigned char loadCosts(const char *pszFile); // false if the file cannot be read or has an error
+	void setSenseCost(const int nSense, const unsigned long ulMicros);
+	void setActionCost(const int nAction, const unsigned long ulMicros);
+	void setNodeCost(const unsigned long ulMicros);
+	void setNodeBytes(const int nNodeType, const int nBytes);
+	unsigned char analyse(void); // false if the plan is recursive, so has no worst case
+
+	int getDepth(void) {return _nDepth;};
+	const std::vector<int> &getDeepestPath(void) {return _deepestPath;};
+	unsigned long getPlanBytes(void);
+	unsigned long getNameBytes(void);
+	unsigned long getCycleMicros(void) {return _ulCycleMicros;};
+	unsigned long getDriveSenseMicros(void) {return _ulDriveSenseMicros;};
+	const std::vector<int> &getCostliestPath(void) {return _costliestPath;};
+	int getRecursiveID(void) {return _nRecursiveID;}; // a node that contains itself, or 0
+	int getNodeBytes(const int nNodeType);
+	unsigned long getSenseCost(const int nSense);
+	unsigned long getActionCost(const int nAction);
+
+private:
+	int _depth(const int nID, std::vector<int> *pPath);
+	unsigned long _cost(const int nID, std::vector<int> *pPath);
+	int _lookup(const char *pszItem, const std::map<int, std::string> &names);
+
+	R5PlanCompiler *_pPlan;
+	std::map<int, std::vector<int> > _elements;	// the APEs of each AP and CEs of each C
+	std::map<int, unsigned long> _senseCosts;
+	std::map<int, unsigned long> _actionCosts;
+	unsigned long _ulNodeCost;
+	int _nNodeBytes[R5_PLAN_NODE_TYPES];
+	std::map<int, unsigned char> _visiting;
+	int _nRecursiveID;
+	int _nDepth;
+	std::vector<int> _deepestPath;
+	unsigned long _ulCycleMicros;
+	unsigned long _ulDriveSenseMicros;
+	std::vector<int> _costliestPath;
+};
+
+#endif // _R5PLANANALYSER_H_
@@ -0,0 +1,406 @@
+// 	Library for Rover 5 Platform Plan Compiler
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// only the image format is wanted from R5PlanImage.h, not the loader, so Instinct is not needed
+namespace Instinct { class CmdPlanner; class Names; }
+#include "R5PlanImage.h"
+#include "R5Crc.h"
+#include "R5PlanCompiler.h"
+
+#define R5_PLAN_LINE_SIZE	512
+
+static const char cNodeCommands[] = "PLCEDA";	// the PLAN A letter for each node type
+static const int nArgCounts[R5_PLAN_NODE_TYPES] = {1, 4, 2, 10, 12, 3};
+static const char *szNodeTypeNames[R5_PLAN_NODE_TYPES] = {"AP", "APE", "C", "CE", "D", "A"};
+
+R5PlanCompiler::R5PlanCompiler()
+{
+	_nPlanID = 0;
+	clear();
+}
+
+void R5PlanCompiler::clear(void)
+{
+	_errors.clear();
+	_warnings.clear();
+	_nodes.clear();
+	_names.clear();
+	_senses.clear();
+	_actions.clear();
+	for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+		_nDeclared[i] = 0;
+	_bInitialised = false;
+}
+
+void R5PlanCompiler::setPlanID(const int nPlanID)
+{
+	_nPlanID = nPlanID;
+}
+
+int R5PlanCompiler::argCount(const int nNodeType)
+{
+	return ((nNodeType >= 0) && (nNodeType < R5_PLAN_NODE_TYPES)) ? nArgCounts[nNodeType] : 0;
+}
+
+const char *R5PlanCompiler::nodeTypeName(const int nNodeType)
+{
+	return ((nNodeType >= 0) && (nNodeType < R5_PLAN_NODE_TYPES)) ? szNodeTypeNames[nNodeType] : "?";
+}
+
+const R5PlanNodeType *R5PlanCompiler::getNode(const int nID)
+{
+	std::map<int, R5PlanNodeType>::const_iterator it = _nodes.find(nID);
+
+	return (it == _nodes.end()) ? 0 : &it->second;
+}
+
+std::string R5PlanCompiler::getNodeName(const int nID)
+{
+	std::map<int, std::string>::const_iterator it = _names.find(nID);
+	char szName[24];
+
+	if (it != _names.end())
+		return it->second;
+	const R5PlanNodeType *pNode = getNode(nID);
+	snprintf(szName, sizeof(szName), "%s#%d", pNode ? nodeTypeName(pNode->nNodeType) : "", nID);
+	return szName;
+}
+
+int R5PlanCompiler::getDeclared(const int nNodeType)
+{
+	return ((nNodeType >= 0) && (nNodeType < R5_PLAN_NODE_TYPES)) ? _nDeclared[nNodeType] : 0;
+}
+
+int R5PlanCompiler::getCount(const int nNodeType)
+{
+	int nCount = 0;
+
+	for (std::map<int, R5PlanNodeType>::const_iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+		nCount += (it->second.nNodeType == nNodeType);
+	return nCount;
+}
+
+// nLine 0 is for the plan as a whole
+void R5PlanCompiler::_error(const int nLine, const char *pszFormat, ...)
+{
+	char szMsg[R5_PLAN_LINE_SIZE];
+	va_list args;
+
+	va_start(args, pszFormat);
+	int nLen = nLine ? snprintf(szMsg, sizeof(szMsg), "%s:%d: error: ", _strSource.c_str(), nLine)
+			: snprintf(szMsg, sizeof(szMsg), "%s: error: ", _strSource.c_str());
+	vsnprintf(szMsg + nLen, sizeof(szMsg) - nLen, pszFormat, args);
+	va_end(args);
+	_errors.push_back(szMsg);
+}
+
+void R5PlanCompiler::_warning(const int nLine, const char *pszFormat, ...)
+{
+	char szMsg[R5_PLAN_LINE_SIZE];
+	va_list args;
+
+	va_start(args, pszFormat);
+	int nLen = nLine ? snprintf(szMsg, sizeof(szMsg), "%s:%d: warning: ", _strSource.c_str(), nLine)
+			: snprintf(szMsg, sizeof(szMsg), "%s: warning: ", _strSource.c_str());
+	vsnprintf(szMsg + nLen, sizeof(szMsg) - nLen, pszFormat, args);
+	va_end(args);
+	_warnings.push_back(szMsg);
+}
+
+unsigned char R5PlanCompiler::parseFile(const char *pszFile)
+{
+	char szLine[R5_PLAN_LINE_SIZE];
+	int nLine = 0;
+	FILE *pFile = fopen(pszFile, "r");
+
+	if (!pFile)
+		return false;
+	_strSource = pszFile;
+	while (fgets(szLine, sizeof(szLine), pFile))
+		parseLine(szLine, ++nLine);
+	fclose(pFile);
+	return _errors.empty();
+}
+
+// one line of a .inst file. Comments and blank lines are skipped, and so are commands that are
+// not part of the plan, such as REPORT, with a warning
+unsigned char R5PlanCompiler::parseLine(const char *pszLine, const int nLine)
+{
+	char szCmd[16];
+	char szSub[4];
+	char szType[4] = "";
+	int nChars = 0;
+	size_t nErrors = _errors.size();
+
+	while ((*pszLine == ' ') || (*pszLine == '\t'))
+		pszLine++;
+	if (!*pszLine || (*pszLine == '\r') || (*pszLine == '\n') || !strncmp(pszLine, "//", 2))
+		return true;
+	if (sscanf(pszLine, "%15s%n", szCmd, &nChars) != 1)
+		return true;
+	const char *pszArgs = pszLine + nChars;
+
+	if (!strcmp(szCmd, "PELEM"))
+		return _parseName(pszArgs, nLine, &_names, "PELEM");
+	if (!strcmp(szCmd, "RSENSE"))
+		return _parseName(pszArgs, nLine, &_senses, "RSENSE");
+	if (!strcmp(szCmd, "RACTION"))
+		return _parseName(pszArgs, nLine, &_actions, "RACTION");
+	if (strcmp(szCmd, "PLAN"))
+	{
+		_warning(nLine, "%s is not part of a plan, left out", szCmd);
+		return true;
+	}
+
+	if (sscanf(pszArgs, "%3s%n", szSub, &nChars) != 1)
+	{
+		_error(nLine, "PLAN with no command");
+		return false;
+	}
+	pszArgs += nChars;
+	if (!strcmp(szSub, "R"))
+	{
+		if ((sscanf(pszArgs, "%3s%n", szType, &nChars) == 1) && !strcmp(szType, "C"))
+		{
+			if (!_nodes.empty())
+				_warning(nLine, "PLAN R C after %d nodes, they are discarded", (int)_nodes.size());
+			_nodes.clear();
+			_bInitialised = false;
+		}
+		else if (!strcmp(szType, "I"))
+		{
+			int n[R5_PLAN_NODE_TYPES];
+			if (sscanf(pszArgs + nChars, "%d %d %d %d %d %d", &n[0], &n[1], &n[2], &n[3], &n[4], &n[5]) != R5_PLAN_NODE_TYPES)
+				_error(nLine, "PLAN R I needs %d node counts", R5_PLAN_NODE_TYPES);
+			else
+			{
+				for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+				{
+					if ((n[i] < 0) || (n[i] > 0xFFFF))
+						_error(nLine, "%s count %d out of range", szNodeTypeNames[i], n[i]);
+					_nDeclared[i] = n[i];
+				}
+				_bInitialised = true;
+			}
+		}
+		else
+			_warning(nLine, "PLAN R %s is a run time command, left out", szType);
+		return (_errors.size() == nErrors);
+	}
+	if (strcmp(szSub, "A"))
+	{
+		_warning(nLine, "PLAN %s is a run time command, left out", szSub);
+		return true;
+	}
+
+	R5PlanNodeType node;
+	const char *pszType;
+	if ((sscanf(pszArgs, "%3s%n", szType, &nChars) != 1) || (strlen(szType) != 1) || !(pszType = strchr(cNodeCommands, szType[0])))
+	{
+		_error(nLine, "PLAN A needs a node type, one of %s", cNodeCommands);
+		return false;
+	}
+	pszArgs += nChars;
+	node.nNodeType = (int)(pszType - cNodeCommands);
+	node.nLine = nLine;
+	while (true)
+	{
+		char *pszEnd;
+		while ((*pszArgs == ' ') || (*pszArgs == '\t'))
+			pszArgs++;
+		if (!*pszArgs || (*pszArgs == '\r') || (*pszArgs == '\n') || !strncmp(pszArgs, "//", 2))
+			break;
+		long lValue = strtol(pszArgs, &pszEnd, 10);
+		if ((pszEnd == pszArgs) || (*pszEnd && !strchr(" \t\r\n", *pszEnd)))
+		{
+			_error(nLine, "PLAN A %c argument %d is not a number", szType[0], (int)node.args.size() + 1);
+			return false;
+		}
+		if ((lValue < -32768) || (lValue > 32767))
+			_error(nLine, "PLAN A %c argument %d, %ld, does not fit in 16 bits", szType[0], (int)node.args.size() + 1, lValue);
+		node.args.push_back((int)lValue);
+		pszArgs = pszEnd;
+	}
+	if ((int)node.args.size() != nArgCounts[node.nNodeType])
+	{
+		_error(nLine, "PLAN A %c needs %d arguments, not %d", szType[0], nArgCounts[node.nNodeType], (int)node.args.size());
+		return false;
+	}
+	if (!_bInitialised)
+		_error(nLine, "PLAN A before PLAN R I");
+	if (node.args[0] <= 0)
+		_error(nLine, "element ID %d must be more than 0", node.args[0]);
+	else if (_nodes.count(node.args[0]))
+		_error(nLine, "element ID %d is already used on line %d", node.args[0], _nodes[node.args[0]].nLine);
+	else
+		_nodes[node.args[0]] = node;
+	return (_errors.size() == nErrors);
+}
+
+// name=ID or name ID, as the robot accepts them
+unsigned char R5PlanCompiler::_parseName(const char *pszArgs, const int nLine, std::map<int, std::string> *pNames, const char *pszWhat)
+{
+	char szName[R5_PLAN_LINE_SIZE];
+	std::string strArgs(pszArgs);
+	int nID;
+
+	for (size_t i = 0; i < strArgs.size(); i++)
+	{
+		if (strArgs[i] == '=')
+			strArgs[i] = ' ';
+	}
+	if (sscanf(strArgs.c_str(), "%511s %d", szName, &nID) != 2)
+	{
+		_error(nLine, "%s needs a name and an ID", pszWhat);
+		return false;
+	}
+	if ((pNames == &_names) && (strlen(szName) >= R5_PLANIMAGE_NAME))
+	{
+		_error(nLine, "element name %s is longer than %d characters", szName, R5_PLANIMAGE_NAME - 1);
+		return false;
+	}
+	if (pNames->count(nID) && ((*pNames)[nID] != szName))
+		_warning(nLine, "%s %d renamed from %s to %s", pszWhat, nID, (*pNames)[nID].c_str(), szName);
+	(*pNames)[nID] = szName;
+	return true;
+}
+
+// children run, so must be an AP, a C or an A. Parents must be an AP for an APE, a C for a CE
+void R5PlanCompiler::_checkReference(const R5PlanNodeType *pNode, const int nArg, const unsigned char bParent)
+{
+	int nID = pNode->args[nArg];
+	const R5PlanNodeType *pTarget = getNode(nID);
+	const char *pszWhat = bParent ? "parent" : "child";
+
+	if (!pTarget)
+	{
+		_error(pNode->nLine, "%s %s of %s is not in the plan", pszWhat, getNodeName(nID).c_str(), getNodeName(pNode->args[0]).c_str());
+		return;
+	}
+	int nType = pTarget->nNodeType;
+	if (bParent && (nType != ((pNode->nNodeType == R5_PLAN_APE) ? R5_PLAN_AP : R5_PLAN_C)))
+		_error(pNode->nLine, "parent %s of %s is a %s", getNodeName(nID).c_str(), getNodeName(pNode->args[0]).c_str(), nodeTypeName(nType));
+	else if (!bParent && (nType != R5_PLAN_AP) && (nType != R5_PLAN_C) && (nType != R5_PLAN_A))
+		_error(pNode->nLine, "child %s of %s is a %s", getNodeName(nID).c_str(), getNodeName(pNode->args[0]).c_str(), nodeTypeName(nType));
+}
+
+void R5PlanCompiler::_checkSense(const R5PlanNodeType *pNode, const int nSenseArg, const int nCompareArg)
+{
+	if (!_senses.empty() && !_senses.count(pNode->args[nSenseArg]))
+		_error(pNode->nLine, "sense %d of %s is not named by RSENSE", pNode->args[nSenseArg], getNodeName(pNode->args[0]).c_str());
+	if ((pNode->args[nCompareArg] < 0) || (pNode->args[nCompareArg] >= R5_PLAN_COMPARATORS))
+		_error(pNode->nLine, "comparator %d of %s is not one of EQ NE GT LT TR FL", pNode->args[nCompareArg], getNodeName(pNode->args[0]).c_str());
+}
+
+unsigned char R5PlanCompiler::check(void)
+{
+	std::map<int, int> elements; // elements of each AP and C
+
+	for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+	{
+		if (getCount(i) != _nDeclared[i])
+			_error(0, "PLAN R I gives %d %s nodes, the plan has %d", _nDeclared[i], szNodeTypeNames[i], getCount(i));
+	}
+	for (std::map<int, R5PlanNodeType>::const_iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+	{
+		const R5PlanNodeType *pNode = &it->second;
+		switch (pNode->nNodeType)
+		{
+		case R5_PLAN_APE:
+			_checkReference(pNode, R5_PLAN_APE_PARENT, true);
+			_checkReference(pNode, R5_PLAN_APE_CHILD, false);
+			elements[pNode->args[R5_PLAN_APE_PARENT]]++;
+			break;
+		case R5_PLAN_CE:
+			_checkReference(pNode, R5_PLAN_CE_PARENT, true);
+			_checkReference(pNode, R5_PLAN_CE_CHILD, false);
+			_checkSense(pNode, R5_PLAN_CE_SENSE, R5_PLAN_CE_COMPARE);
+			elements[pNode->args[R5_PLAN_CE_PARENT]]++;
+			break;
+		case R5_PLAN_D:
+			_checkReference(pNode, R5_PLAN_D_CHILD, false);
+			_checkSense(pNode, R5_PLAN_D_SENSE, R5_PLAN_D_COMPARE);
+			break;
+		case R5_PLAN_A:
+			if (!_actions.empty() && !_actions.count(pNode->args[R5_PLAN_A_ACTION]))
+				_error(pNode->nLine, "action %d of %s is not named by RACTION", pNode->args[R5_PLAN_A_ACTION], getNodeName(it->first).c_str());
+			break;
+		}
+	}
+	for (std::map<int, R5PlanNodeType>::const_iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+	{
+		if (((it->second.nNodeType == R5_PLAN_AP) || (it->second.nNodeType == R5_PLAN_C)) && !elements.count(it->first))
+			_error(it->second.nLine, "%s %s has no elements", nodeTypeName(it->second.nNodeType), getNodeName(it->first).c_str());
+	}
+	for (std::map<int, std::string>::const_iterator it = _names.begin(); it != _names.end(); ++it)
+	{
+		if (!_nodes.count(it->first))
+			_warning(0, "PELEM %s=%d names no element", it->second.c_str(), it->first);
+	}
+	return _errors.empty();
+}
+
+static void _putWord(std::vector<unsigned char> *pData, const int nValue)
+{
+	pData->push_back((unsigned char)(nValue & 0xFF));
+	pData->push_back((unsigned char)((nValue >> 8) & 0xFF));
+}
+
+// nodes in ID order, as R5EEPROM::writeData() stores them, then the names of the nodes
+void R5PlanCompiler::getImage(std::vector<unsigned char> *pImage)
+{
+	std::vector<unsigned char> body;
+	int nNames = 0;
+
+	for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+		_putWord(&body, _nDeclared[i]);
+	_putWord(&body, _nPlanID);
+	for (std::map<int, R5PlanNodeType>::const_iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+	{
+		body.push_back((unsigned char)it->second.nNodeType);
+		for (size_t i = 0; i < it->second.args.size(); i++)
+			_putWord(&body, it->second.args[i]);
+	}
+	for (std::map<int, std::string>::const_iterator it = _names.begin(); it != _names.end(); ++it)
+		nNames += _nodes.count(it->first);
+	_putWord(&body, nNames);
+	for (std::map<int, std::string>::const_iterator it = _names.begin(); it != _names.end(); ++it)
+	{
+		if (!_nodes.count(it->first))
+			continue;
+		_putWord(&body, it->first);
+		body.push_back((unsigned char)it->second.size());
+		body.insert(body.end(), it->second.begin(), it->second.end());
+	}
+
+	unsigned int uiCRC = R5_CRC16_INIT;
+	for (size_t i = 0; i < body.size(); i++)
+		uiCRC = crc16Update(uiCRC, body[i]);
+	pImage->clear();
+	pImage->push_back('R');
+	pImage->push_back('5');
+	pImage->push_back('P');
+	pImage->push_back(R5_PLANIMAGE_VERSION);
+	_putWord(pImage, (int)body.size());
+	_putWord(pImage, (int)uiCRC);
+	pImage->insert(pImage->end(), body.begin(), body.end());
+}
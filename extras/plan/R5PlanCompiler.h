@@ -0,0 +1,116 @@
+// 	Library for Rover 5 Platform Plan Compiler
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Compiles an Instinct plan from its .inst file, as written by dia/instinctgen.py, into the binary
+// image that R5PlanImage loads on the robot, see src/R5PlanImage.h. The plan is checked first:
+//
+// - PLAN R I comes before the nodes, and the node counts it gives are the counts in the file
+// - every node has the right number of arguments, each fits in 16 bits, and each ID is used once
+// - parents and children are nodes of the right type, and every AP and C has elements
+// - comparators are known, and senses and actions are named by RSENSE and RACTION, when the file
+//   names any
+// - PELEM names a node, with a name short enough for the robot
+//
+// PLAN commands other than R C, R I and A are run time commands and are left out of the image.
+//
+#ifndef _R5PLANCOMPILER_H_
+#define _R5PLANCOMPILER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define R5_PLAN_NODE_TYPES	6	// AP APE C CE D A, as Instinct numbers them
+#define R5_PLAN_AP			0
+#define R5_PLAN_APE			1
+#define R5_PLAN_C			2
+#define R5_PLAN_CE			3
+#define R5_PLAN_D			4
+#define R5_PLAN_A			5
+#define R5_PLAN_COMPARATORS	6	// EQ NE GT LT TR FL
+
+// where the arguments of each PLAN A command are, after the element ID in argument 0
+#define R5_PLAN_APE_PARENT	1
+#define R5_PLAN_APE_CHILD	2
+#define R5_PLAN_APE_ORDER	3
+#define R5_PLAN_CE_PARENT	1
+#define R5_PLAN_CE_CHILD	2
+#define R5_PLAN_CE_PRIORITY	3
+#define R5_PLAN_CE_SENSE	5
+#define R5_PLAN_CE_COMPARE	6
+#define R5_PLAN_CE_VALUE	7
+#define R5_PLAN_CE_HYST		8
+#define R5_PLAN_D_CHILD		1
+#define R5_PLAN_D_PRIORITY	2
+#define R5_PLAN_D_SENSE		4
+#define R5_PLAN_D_COMPARE	5
+#define R5_PLAN_D_VALUE		6
+#define R5_PLAN_D_HYST		7
+#define R5_PLAN_A_ACTION	1
+#define R5_PLAN_A_VALUE		2
+
+typedef struct {
+	int nNodeType;
+	std::vector<int> args;	// the PLAN A arguments, ID first
+	int nLine;
+} R5PlanNodeType;
+
+class R5PlanCompiler {
+public:
+	R5PlanCompiler();
+	void clear(void);
+	unsigned char parseFile(const char *pszFile); // false if the file cannot be read or has errors
+	unsigned char parseLine(const char *pszLine, const int nLine);
+	unsigned char check(void);	// false if the plan has errors, call once the whole plan is parsed
+	void setPlanID(const int nPlanID);
+	void getImage(std::vector<unsigned char> *pImage); // only meaningful once check() passes
+
+	const std::vector<std::string> &getErrors(void) {return _errors;};
+	const std::vector<std::string> &getWarnings(void) {return _warnings;};
+	const std::map<int, R5PlanNodeType> &getNodes(void) {return _nodes;};
+	const std::map<int, std::string> &getNames(void) {return _names;};
+	const std::map<int, std::string> &getSenses(void) {return _senses;};
+	const std::map<int, std::string> &getActions(void) {return _actions;};
+	const R5PlanNodeType *getNode(const int nID);
+	std::string getNodeName(const int nID); // the PELEM name, or the node type and ID
+	int getDeclared(const int nNodeType);	// the count from PLAN R I
+	int getCount(const int nNodeType);		// the nodes in the file
+
+	static int argCount(const int nNodeType);
+	static const char *nodeTypeName(const int nNodeType);
+
+private:
+	void _error(const int nLine, const char *pszFormat, ...);
+	void _warning(const int nLine, const char *pszFormat, ...);
+	unsigned char _parseName(const char *pszArgs, const int nLine, std::map<int, std::string> *pNames, const char *pszWhat);
+	void _checkReference(const R5PlanNodeType *pNode, const int nArg, const unsigned char bParent);
+	void _checkSense(const R5PlanNodeType *pNode, const int nSenseArg, const int nCompareArg);
+
+	std::string _strSource;
+	std::vector<std::string> _errors;
+	std::vector<std::string> _warnings;
+	std::map<int, R5PlanNodeType> _nodes;
+	std::map<int, std::string> _names;
+	std::map<int, std::string> _senses;
+	std::map<int, std::string> _actions;
+	int _nDeclared[R5_PLAN_NODE_TYPES];
+	unsigned char _bInitialised;
+	int _nPlanID;
+};
+
+#endif // _R5PLANCOMPILER_H_
@@ -0,0 +1,172 @@
+// 	Library for Rover 5 Platform Plan Compiler
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Checks an Instinct .inst plan and compiles it into a binary image, see R5PlanCompiler.h, so
+// that it is sent to the robot in one transfer rather than one command and reply per line.
+//
+// r5plan [-i plan ID] [-o image] [-s] [-a] [-k costs] [-d depth] [-m bytes] [-N bytes] [-t uS] plan.inst
+//
+// -o writes the image, and -s puts the PIMAGE command before it so the file can be sent to the
+// robot as it is. Errors and warnings go to stderr, and with errors nothing is written.
+//
+// The plan is also checked against the robot's budgets, see R5PlanAnalyser.h: -d the execution
+// stack depth, -m the RAM for the plan nodes, -N the names buffer and -t the uS a plan cycle may
+// take. A plan over any of them is rejected. -k loads a cost file and -a shows the analysis.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "R5PlanCompiler.h"
+#include "R5PlanAnalyser.h"
+
+static void _printPath(R5PlanCompiler *pCompiler, const std::vector<int> &path)
+{
+	for (size_t i = 0; i < path.size(); i++)
+		printf("%s%s", i ? " > " : "  ", pCompiler->getNodeName(path[i]).c_str());
+	printf("\n");
+}
+
+static void _usage(void)
+{
+	fprintf(stderr, "usage: r5plan [-i plan ID] [-o image] [-s] [-a] [-k costs] [-d depth] [-m bytes] [-N bytes] [-t uS] plan.inst\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *pszOut = 0;
+	unsigned char bSend = false;
+	unsigned char bAnalysis = false;
+	const char *pszCosts = 0;
+	int nMaxDepth = R5_PLAN_MAX_DEPTH;
+	unsigned long ulMaxRAM = R5_PLAN_MAX_RAM;
+	unsigned long ulNamesBuffer = R5_PLAN_NAMES_BUFFER;
+	unsigned long ulMaxCycle = R5_PLAN_MAX_CYCLE;
+	int nPlanID = 0;
+	int nOpt;
+
+	while ((nOpt = getopt(argc, argv, "i:o:sak:d:m:N:t:")) != -1)
+	{
+		switch (nOpt)
+		{
+			case 'i': nPlanID = atoi(optarg); break;
+			case 'o': pszOut = optarg; break;
+			case 's': bSend = true; break;
+			case 'a': bAnalysis = true; break;
+			case 'k': pszCosts = optarg; break;
+			case 'd': nMaxDepth = atoi(optarg); break;
+			case 'm': ulMaxRAM = strtoul(optarg, 0, 10); break;
+			case 'N': ulNamesBuffer = strtoul(optarg, 0, 10); break;
+			case 't': ulMaxCycle = strtoul(optarg, 0, 10); break;
+			default: _usage(); return 2;
+		}
+	}
+	if (optind != argc - 1)
+	{
+		_usage();
+		return 2;
+	}
+
+	R5PlanCompiler compiler;
+	compiler.setPlanID(nPlanID);
+	if (!compiler.parseFile(argv[optind]) && compiler.getErrors().empty())
+	{
+		fprintf(stderr, "r5plan: cannot read %s\n", argv[optind]);
+		return 1;
+	}
+	compiler.check();
+	for (size_t i = 0; i < compiler.getWarnings().size(); i++)
+		fprintf(stderr, "%s\n", compiler.getWarnings()[i].c_str());
+	for (size_t i = 0; i < compiler.getErrors().size(); i++)
+		fprintf(stderr, "%s\n", compiler.getErrors()[i].c_str());
+	if (!compiler.getErrors().empty())
+		return 1;
+
+	R5PlanAnalyser analyser(&compiler);
+	if (pszCosts && !analyser.loadCosts(pszCosts))
+	{
+		fprintf(stderr, "r5plan: cannot read costs %s\n", pszCosts);
+		return 1;
+	}
+	if (!analyser.analyse())
+	{
+		fprintf(stderr, "%s: error: %s contains itself, so the plan has no worst case\n", argv[optind],
+				compiler.getNodeName(analyser.getRecursiveID()).c_str());
+		return 1;
+	}
+	if (bAnalysis)
+	{
+		printf("deepest path, %d nodes:\n", analyser.getDepth());
+		_printPath(&compiler, analyser.getDeepestPath());
+		printf("costliest cycle, %lu uS: %lu uS of Drive senses, then\n", analyser.getCycleMicros(), analyser.getDriveSenseMicros());
+		_printPath(&compiler, analyser.getCostliestPath());
+		printf("plan RAM:");
+		for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+			printf(" %s %d x %d,", R5PlanCompiler::nodeTypeName(i), compiler.getDeclared(i), analyser.getNodeBytes(i));
+		printf(" %lu bytes\n", analyser.getPlanBytes());
+	}
+	printf("depth %d of %d, plan RAM %lu of %lu bytes, names %lu of %lu bytes, cycle %lu of %lu uS\n",
+			analyser.getDepth(), nMaxDepth, analyser.getPlanBytes(), ulMaxRAM, analyser.getNameBytes(), ulNamesBuffer,
+			analyser.getCycleMicros(), ulMaxCycle);
+	int nOver = 0;
+	if (analyser.getDepth() > nMaxDepth)
+		nOver += fprintf(stderr, "%s: error: the execution stack is %d deep, more than %d\n", argv[optind], analyser.getDepth(), nMaxDepth) > 0;
+	if (analyser.getPlanBytes() > ulMaxRAM)
+		nOver += fprintf(stderr, "%s: error: the plan needs %lu bytes of RAM, more than %lu\n", argv[optind], analyser.getPlanBytes(), ulMaxRAM) > 0;
+	if (analyser.getNameBytes() > ulNamesBuffer)
+		nOver += fprintf(stderr, "%s: error: the names need %lu bytes, more than the %lu byte buffer\n", argv[optind], analyser.getNameBytes(), ulNamesBuffer) > 0;
+	if (analyser.getCycleMicros() > ulMaxCycle)
+		nOver += fprintf(stderr, "%s: error: a plan cycle can take %lu uS, more than %lu\n", argv[optind], analyser.getCycleMicros(), ulMaxCycle) > 0;
+	if (nOver)
+		return 1;
+
+	std::vector<unsigned char> image;
+	compiler.getImage(&image);
+	if (image.size() > 0xFFFF)
+	{
+		fprintf(stderr, "r5plan: the image is %d bytes, more than the robot can take\n", (int)image.size());
+		return 1;
+	}
+
+	printf("%s: %d nodes (", argv[optind], (int)compiler.getNodes().size());
+	for (int i = 0; i < R5_PLAN_NODE_TYPES; i++)
+		printf("%s%s %d", i ? ", " : "", R5PlanCompiler::nodeTypeName(i), compiler.getCount(i));
+	printf("), %d names\n", (int)compiler.getNames().size());
+	printf("image %d bytes, CRC16 0x%02X%02X, send with PIMAGE %d\n", (int)image.size(), image[7], image[6], (int)image.size());
+
+	if (pszOut)
+	{
+		FILE *pFile = fopen(pszOut, "wb");
+		if (!pFile)
+		{
+			fprintf(stderr, "r5plan: cannot write %s\n", pszOut);
+			return 1;
+		}
+		if (bSend)
+			fprintf(pFile, "PIMAGE %d\n", (int)image.size());
+		size_t nWritten = fwrite(&image[0], 1, image.size(), pFile);
+		if ((fclose(pFile) != 0) || (nWritten != image.size()))
+		{
+			fprintf(stderr, "r5plan: cannot write %s\n", pszOut);
+			return 1;
+		}
+	}
+	return 0;
+}
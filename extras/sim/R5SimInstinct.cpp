@@ -0,0 +1,152 @@
+// 	Library for Rover 5 Platform Simulator Instinct Planner
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanInterface.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+#include "Instinct.h"
+#include "R5SimInstinct.h"
+
+#define R5_SIM_PLAN_LINE 256
+#define R5_SIM_PLAN_TOKENS 16
+
+// the zero based token that holds the overridable value in PLAN A E, PLAN A D and PLAN A A lines
+static int _valueToken(const char cType)
+{
+	switch (cType)
+	{
+		case 'E': return 10;	// PLAN A E id parent child priority retry sense comparator value ...
+		case 'D': return 9;		// PLAN A D id child priority frequency sense comparator value ...
+		case 'A': return 5;		// PLAN A A id action value
+	}
+	return 0;
+}
+
+// replace the value in a PLAN line if its element is overridden
+static void _applyOverride(char *pszLine, const size_t uiSize, const std::vector<std::pair<int, int> > &ids)
+{
+	char szCopy[R5_SIM_PLAN_LINE];
+	char *pszTokens[R5_SIM_PLAN_TOKENS];
+	int nTokens = 0;
+	int nValueToken;
+	char *pszSave;
+
+	strncpy(szCopy, pszLine, sizeof(szCopy) - 1);
+	szCopy[sizeof(szCopy) - 1] = 0;
+	for (char *psz = strtok_r(szCopy, " \t", &pszSave); psz && (nTokens < R5_SIM_PLAN_TOKENS); psz = strtok_r(0, " \t", &pszSave))
+		pszTokens[nTokens++] = psz;
+	if ((nTokens < 4) || strcmp(pszTokens[1], "A") || (strlen(pszTokens[2]) != 1))
+		return;
+	nValueToken = _valueToken(pszTokens[2][0]);
+	if (!nValueToken || (nValueToken >= nTokens))
+		return;
+
+	int nId = atoi(pszTokens[3]);
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		if (ids[i].first != nId)
+			continue;
+		size_t uiLen = 0;
+		pszLine[0] = 0;
+		for (int j = 0; j < nTokens; j++)
+		{
+			char szValue[16];
+			const char *pszToken = pszTokens[j];
+
+			if (j == nValueToken)
+			{
+				snprintf(szValue, sizeof(szValue), "%d", ids[i].second);
+				pszToken = szValue;
+			}
+			uiLen += snprintf(pszLine + uiLen, (uiLen < uiSize) ? uiSize - uiLen : 0, j ? " %s" : "%s", pszToken);
+		}
+		return;
+	}
+}
+
+R5SimPlanner::R5SimPlanner(R5SimRobot *pRobot) :
+	_senses(pRobot),
+	_actions(pRobot),
+	_planSize(),	// all zero, the plan sets its own size
+	_plan(_planSize, &_senses, &_actions, &_monitor)
+{
+	_plan.setGlobalMonitorFlags(1, 1, 1, 1, 1, 1);
+}
+
+// the PELEM lines, which name the elements, may come after the PLAN lines so read the file twice
+unsigned char R5SimPlanner::load(const char *pszFile, const std::vector<R5SimOverrideType> *pOverrides)
+{
+	char szLine[R5_SIM_PLAN_LINE];
+	char szMsgBuff[R5_SIM_PLAN_LINE];
+	std::vector<std::pair<int, int> > ids; // element id and its new value
+	FILE *pFile = fopen(pszFile, "r");
+
+	if (!pFile)
+		return false;
+	while (pOverrides && fgets(szLine, sizeof(szLine), pFile))
+	{
+		char *pszEquals = strchr(szLine, '=');
+
+		if (strncmp(szLine, "PELEM ", 6) || !pszEquals)
+			continue;
+		*pszEquals = 0;
+		for (size_t i = 0; i < pOverrides->size(); i++)
+		{
+			if ((*pOverrides)[i].strName == szLine + 6)
+				ids.push_back(std::make_pair(atoi(pszEquals + 1), (*pOverrides)[i].nValue));
+		}
+	}
+	rewind(pFile);
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		szLine[strcspn(szLine, "\r\n")] = 0;
+		if (strncmp(szLine, "PLAN ", 5))
+			continue;
+		if (!ids.empty())
+			_applyOverride(szLine, sizeof(szLine), ids);
+		_plan.executeCommand(szLine + 5, szMsgBuff, sizeof(szMsgBuff));
+	}
+	fclose(pFile);
+	return true;
+}
+
+void R5SimPlanner::runPlan(void *pContext)
+{
+	((R5SimPlanner *)pContext)->_plan.runPlan();
+}
+
+void R5SimPlanner::processTimers(void *pContext)
+{
+	((R5SimPlanner *)pContext)->_plan.processTimers(1);
+}
@@ -0,0 +1,86 @@
+// 	Library for Rover 5 Platform Simulator Instinct Planner
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Runs an Instinct plan on an R5SimRobot. Only built when the host build is given R5_INSTINCT_DIR.
+//
+// A plan is loaded from its .inst file as the Instinct Server sends it, one PLAN line at a time.
+// Overrides change the value of a named plan element as it is loaded: the SenseValue of a Drive
+// or CompetenceElement, or the ActionValue of an Action. The names are those of the PELEM lines,
+// so a sweep can try different thresholds without editing the file.
+//
+#ifndef _R5SIMINSTINCT_H_
+#define _R5SIMINSTINCT_H_
+
+#include <string>
+#include <vector>
+
+typedef struct {
+	std::string strName;
+	int nValue;
+} R5SimOverrideType;
+
+// the Instinct callbacks forward to the simulated robot
+class R5SimSenses : public Instinct::Senses {
+public:
+	R5SimSenses(R5SimRobot *pRobot) {_pRobot = pRobot;};
+	int readSense(const Instinct::instinctID nSense) {return _pRobot->readSense(nSense);};
+private:
+	R5SimRobot *_pRobot;
+};
+
+class R5SimActions : public Instinct::Actions {
+public:
+	R5SimActions(R5SimRobot *pRobot) {_pRobot = pRobot;};
+	unsigned char executeAction(const Instinct::actionID nAction, const int nActionValue, const unsigned char bCheckForComplete)
+		{return INSTINCT_RTN_COMBINE(_pRobot->executeAction(nAction, nActionValue, bCheckForComplete), nAction);};
+private:
+	R5SimRobot *_pRobot;
+};
+
+// counts the plan nodes that report an error
+class R5SimMonitor : public Instinct::Monitor {
+public:
+	R5SimMonitor() {_ulErrors = 0;};
+	unsigned char nodeExecuted(const Instinct::PlanNode * pPlanNode) {return true;};
+	unsigned char nodeSuccess(const Instinct::PlanNode * pPlanNode) {return true;};
+	unsigned char nodeInProgress(const Instinct::PlanNode * pPlanNode) {return true;};
+	unsigned char nodeFail(const Instinct::PlanNode * pPlanNode) {return true;};
+	unsigned char nodeError(const Instinct::PlanNode * pPlanNode) {_ulErrors++; return true;};
+	unsigned char nodeSense(const Instinct::ReleaserType *pReleaser, const int nSenseValue) {return true;};
+	unsigned long getErrors(void) {return _ulErrors;};
+private:
+	unsigned long _ulErrors;
+};
+
+class R5SimPlanner {
+public:
+	R5SimPlanner(R5SimRobot *pRobot);
+	unsigned char load(const char *pszFile, const std::vector<R5SimOverrideType> *pOverrides = 0); // false if the file cannot be read
+	unsigned long getErrors(void) {return _monitor.getErrors();};
+	Instinct::CmdPlanner *getPlanner(void) {return &_plan;};
+	static void runPlan(void *pContext);		// R5SimPlanCallbacks, with pContext the R5SimPlanner
+	static void processTimers(void *pContext);
+
+private:
+	R5SimSenses _senses;
+	R5SimActions _actions;
+	R5SimMonitor _monitor;
+	Instinct::instinctID _planSize[INSTINCT_NODE_TYPES];
+	Instinct::CmdPlanner _plan;
+};
+
+#endif // _R5SIMINSTINCT_H_
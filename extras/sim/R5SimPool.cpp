@@ -0,0 +1,88 @@
+// 	Library for Rover 5 Platform Simulator Thread Pool
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5SimPool.h"
+
+R5SimPool::R5SimPool(const int nThreads)
+{
+	_nThreads = (nThreads > 0) ? nThreads : (int)std::thread::hardware_concurrency();
+	if (_nThreads < 1)
+		_nThreads = 1;
+	_pQueues = new R5SimQueueType[_nThreads];
+	_pfnTask = 0;
+	_pContext = 0;
+}
+
+R5SimPool::~R5SimPool()
+{
+	delete[] _pQueues;
+}
+
+int R5SimPool::getThreads(void)
+{
+	return _nThreads;
+}
+
+// deal the tasks out round robin, then let the workers balance the load between themselves.
+// No tasks are added once the workers start, so an empty pass over every queue means all are taken
+void R5SimPool::run(const int nTasks, R5SimTaskCallback pfnTask, void *pContext)
+{
+	std::vector<std::thread> workers;
+
+	_pfnTask = pfnTask;
+	_pContext = pContext;
+	for (int i = 0; i < nTasks; i++)
+		_pQueues[i % _nThreads].tasks.push_back(i);
+
+	for (int i = 0; i < _nThreads; i++)
+		workers.push_back(std::thread(&R5SimPool::_worker, this, i));
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void R5SimPool::_worker(const int nWorker)
+{
+	int nTask;
+
+	while (_nextTask(nWorker, &nTask))
+		(*_pfnTask)(_pContext, nTask);
+}
+
+// our own newest task first, otherwise the oldest task of the next busy worker
+unsigned char R5SimPool::_nextTask(const int nWorker, int *pnTask)
+{
+	for (int i = 0; i < _nThreads; i++)
+	{
+		R5SimQueueType &queue = _pQueues[(nWorker + i) % _nThreads];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tasks.empty())
+			continue;
+		if (i == 0)
+		{
+			*pnTask = queue.tasks.back();
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			*pnTask = queue.tasks.front();
+			queue.tasks.pop_front();
+		}
+		return true;
+	}
+	return false;
+}
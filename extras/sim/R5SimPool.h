@@ -0,0 +1,58 @@
+// 	Library for Rover 5 Platform Simulator Thread Pool
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Runs independent simulator tasks on all the cores. Each worker has its own queue of tasks and
+// takes from the back of it. When its queue is empty it steals from the front of another worker's
+// queue, so workers that get short runs help out those that got long ones.
+//
+// Tasks must not share anything mutable. Each builds its own R5SimWorld and R5SimRobot, and
+// the R5HalHost context is per thread, so robots on different threads never meet.
+//
+#ifndef _R5SIMPOOL_H_
+#define _R5SIMPOOL_H_
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// runs task nTask. Called on a worker thread
+typedef void (*R5SimTaskCallback)(void *pContext, const int nTask);
+
+class R5SimPool {
+public:
+	R5SimPool(const int nThreads = 0); // 0 uses every core
+	~R5SimPool();
+	int getThreads(void);
+	void run(const int nTasks, R5SimTaskCallback pfnTask, void *pContext); // returns when all the tasks are done
+
+private:
+	typedef struct {
+		std::mutex mutex;
+		std::deque<int> tasks;
+	} R5SimQueueType;
+
+	void _worker(const int nWorker);
+	unsigned char _nextTask(const int nWorker, int *pnTask);
+
+	int _nThreads;
+	R5SimQueueType *_pQueues;
+	R5SimTaskCallback _pfnTask;
+	void *_pContext;
+};
+
+#endif // _R5SIMPOOL_H_
@@ -0,0 +1,196 @@
+// 	Library for Rover 5 Platform Simulator Trace Replay
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanInterface.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+#include "R5SimReplay.h"
+
+// the replay has no world, the trace stands in for it
+R5SimReplay::R5SimReplay(const unsigned char bSmoothing) : R5SimRobot(0, bSmoothing)
+{
+	_nBleed = _nCorner = _nMotor = _nEcho = _nPIR = 0;
+	_ulRecords = 0;
+	_ulFirstMillis = _ulLastMillis = 0;
+	_ulOffset = 0;
+}
+
+unsigned char R5SimReplay::load(const char *pszFile)
+{
+	FILE *pFile = fopen(pszFile, "r");
+	char szLine[256];
+
+	if (!pFile)
+		return false;
+
+	_bleed.clear();
+	_corners.clear();
+	_motors.clear();
+	_echoes.clear();
+	_pir.clear();
+	_nBleed = _nCorner = _nMotor = _nEcho = _nPIR = 0;
+	_ulRecords = 0;
+
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		R5SimTraceRecordType record;
+		char cType;
+		int nPos = 0;
+
+		if ((sscanf(szLine, "%lu T %c%n", &record.ulMillis, &cType, &nPos) != 2) || !nPos)
+			continue; // not a trace record
+
+		std::vector<R5SimTraceRecordType> *pRecords;
+		int nValues;
+		switch (cType)
+		{
+			case 'B': pRecords = &_bleed; nValues = 4; break;
+			case 'C': pRecords = &_corners; nValues = 8; break;
+			case 'M': pRecords = &_motors; nValues = 4; break;
+			case 'U': pRecords = &_echoes; nValues = 1; break;
+			case 'P': pRecords = &_pir; nValues = 1; break;
+			default: continue;
+		}
+
+		// a record cut short, by a dropped character on the serial line say, is skipped
+		char *pValue = szLine + nPos;
+		int i;
+		for (i = 0; i < nValues; i++)
+		{
+			char *pEnd;
+			record.lValue[i] = strtol(pValue, &pEnd, 10);
+			if (pEnd == pValue)
+				break;
+			pValue = pEnd;
+		}
+		if (i < nValues)
+			continue;
+
+		if (!_ulRecords)
+			_ulFirstMillis = record.ulMillis;
+		_ulLastMillis = record.ulMillis;
+		_ulRecords++;
+		pRecords->push_back(record);
+	}
+	fclose(pFile);
+	// a trace recorded from boot keeps the robot's clock, so the replay's startup lines up with the robot's
+	_ulOffset = (_ulFirstMillis < R5_REPLAY_BOOT_MILLIS) ? 0 : _ulFirstMillis - getMillis();
+	return (_ulRecords > 0);
+}
+
+unsigned long R5SimReplay::getRobotMillis(void)
+{
+	return getMillis() + _ulOffset;
+}
+
+unsigned char R5SimReplay::finished(void)
+{
+	return (getRobotMillis() > _ulLastMillis);
+}
+
+// set the inputs from the trace, instead of moving the robot in a world
+void R5SimReplay::_physics(const double dSeconds)
+{
+	unsigned long ulTrace = getRobotMillis();
+	// no later than the next pass of loop()
+	unsigned long ulNext = (_host.getMicros() + _ulLoopMicros) / 1000UL + _ulOffset;
+
+	// the recorded bleed levels replace the ones from the startup calibration
+	for (; _started() && (_nBleed < _bleed.size()) && (_bleed[_nBleed].ulMillis <= ulTrace); _nBleed++)
+	{
+		for (int i = 0; i < 4; i++)
+			_sensors.bleedLevel[i] = (int)_bleed[_nBleed].lValue[i];
+	}
+
+	// the encoders, currents and PIR were read by the loop() that wrote the record, so they must be
+	// in place, and the ADC scheduler must have sampled the currents, before that loop() runs here
+	for (; (_nMotor < _motors.size()) && (_motors[_nMotor].ulMillis <= ulNext); _nMotor++)
+	{
+		_dClicks[0] = (double)_motors[_nMotor].lValue[0];
+		_dClicks[1] = (double)_motors[_nMotor].lValue[1];
+		_setMotorCurrents((int)_motors[_nMotor].lValue[2], (int)_motors[_nMotor].lValue[3]);
+	}
+
+	for (; (_nPIR < _pir.size()) && (_pir[_nPIR].ulMillis <= ulNext); _nPIR++)
+		_setPIR((unsigned char)_pir[_nPIR].lValue[0]);
+
+	// a corner record is written when its sense cycle completes, so the cycle in progress
+	// reads the levels from the next record
+	while (((_nCorner + 1) < _corners.size()) && (_corners[_nCorner].ulMillis < ulTrace))
+		_nCorner++;
+	if (_nCorner < _corners.size())
+	{
+		int nPassive[4];
+		int nActive[4];
+		for (int i = 0; i < 4; i++)
+		{
+			nPassive[i] = (int)_corners[_nCorner].lValue[i];
+			nActive[i] = (int)_corners[_nCorner].lValue[i + 4];
+		}
+		_setIRLevels(nPassive, nActive);
+	}
+}
+
+// like the corner levels, an echo is recorded once it has been timed, so a ping gets the next one
+unsigned long R5SimReplay::_echoDuration(void)
+{
+	unsigned long ulTrace = getRobotMillis();
+
+	if (_echoes.empty())
+		return 0;
+	while (((_nEcho + 1) < _echoes.size()) && (_echoes[_nEcho].ulMillis < ulTrace))
+		_nEcho++;
+	return (unsigned long)_echoes[_nEcho].lValue[0];
+}
+
+// MyOutput::outputData() from R5Robot.ino, writing to a file
+R5SimLog::R5SimLog(FILE *pFile, R5SimRobot *pRobot)
+{
+	_pFile = pFile;
+	_pRobot = pRobot;
+}
+
+void R5SimLog::outputData(const char *pszData)
+{
+	fprintf(_pFile, "%010lu %s\n", _pRobot->getRobotMillis(), pszData);
+}
+
+void R5SimLog::outputVocaliseData(const char *pszData)
+{
+}
+
+void R5SimLog::outputFrame(const unsigned char *pFrame, const unsigned int uiLength)
+{
+	fwrite(pFrame, 1, uiLength, _pFile);
+}
@@ -0,0 +1,91 @@
+// 	Library for Rover 5 Platform Simulator Trace Replay
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Plays a trace recorded by R5Trace back through the library classes. The replay is the simulated
+// robot with its inputs taken from the trace rather than from a world: the corner sensors read the
+// recorded passive and active levels as their LEDs switch, the encoders and motor currents follow
+// the M records, the ultrasonic ranger gets the recorded echoes and the PIR the recorded edges.
+// Everything else runs as it does on the robot, so R5CornerSensors, R5SensingHead, R5SensorFrame
+// and whatever plan is attached see the run again, and on the virtual clock the result is the same
+// every time.
+//
+// A trace that starts during the robot's startup was recorded from boot, and is replayed on the robot's
+// own clock. Any other trace starts at the time of its first record, as if the robot had booted then,
+// so its first second or so is used by the startup calibration, after which the recorded bleed
+// levels replace the calibrated ones.
+//
+#ifndef _R5SIMREPLAY_H_
+#define _R5SIMREPLAY_H_
+
+#define R5_REPLAY_VALUES 8
+#define R5_REPLAY_BOOT_MILLIS 2000	// a trace starting before this was recorded from boot
+
+// one T record
+typedef struct {
+	unsigned long ulMillis;
+	long lValue[R5_REPLAY_VALUES];
+} R5SimTraceRecordType;
+
+class R5SimReplay : public R5SimRobot {
+public:
+	R5SimReplay(const unsigned char bSmoothing = 10);
+	// reads the T records from a log, ignoring anything else in it. false if there are none
+	unsigned char load(const char *pszFile);
+	unsigned long getRecords(void) {return _ulRecords;};
+	virtual unsigned long getRobotMillis(void); // the trace time the replay has reached
+	unsigned long getStartMillis(void) {return _ulFirstMillis;};
+	unsigned long getEndMillis(void) {return _ulLastMillis;};
+	unsigned char finished(void); // true once the replay has passed the last record
+
+protected:
+	virtual void _physics(const double dSeconds);
+	virtual unsigned long _echoDuration(void);
+
+private:
+	std::vector<R5SimTraceRecordType> _bleed;
+	std::vector<R5SimTraceRecordType> _corners;
+	std::vector<R5SimTraceRecordType> _motors;
+	std::vector<R5SimTraceRecordType> _echoes;
+	std::vector<R5SimTraceRecordType> _pir;
+
+	// the next record of each type
+	size_t _nBleed;
+	size_t _nCorner;
+	size_t _nMotor;
+	size_t _nEcho;
+	size_t _nPIR;
+
+	unsigned long _ulRecords;
+	unsigned long _ulFirstMillis;
+	unsigned long _ulLastMillis;
+	unsigned long _ulOffset; // trace time less replay time
+};
+
+// writes records as the sketch's R5Output does, each line starting with the robot's millis()
+class R5SimLog : public R5Output {
+public:
+	R5SimLog(FILE *pFile, R5SimRobot *pRobot);
+	virtual void outputData(const char *pszData);
+	virtual void outputVocaliseData(const char *pszData);
+	virtual void outputFrame(const unsigned char *pFrame, const unsigned int uiLength);
+
+private:
+	FILE *_pFile;
+	R5SimRobot *_pRobot;
+};
+
+#endif // _R5SIMREPLAY_H_
@@ -0,0 +1,529 @@
+// 	Library for Rover 5 Platform Simulated Robot
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5PlanInterface.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+
+// pins and settings from R5Robot.ino
+#define ULTRASONIC_PIN 2
+#define ULTRASONIC_MIN_INTERVAL 300
+#define PIR_PIN 9
+static const unsigned char cornerInputs[] = {A0, A1, A2, A3};
+static const unsigned char cornerOutputs[] = {24, 25, 26, 27};
+static const unsigned char motorSpeeds[] = {4, 5};
+static const unsigned char motorDirections[] = {29, 28};
+static const unsigned char motorCurrents[] = {A4, A5};
+
+// where each IR corner sensor is, relative to the centre of the robot, and which way it looks
+static const double dIRSensorX[] = {100, 100, -100, -100};
+static const double dIRSensorY[] = {75, -75, -75, 75};
+static const double dIRSensorAngle[] = {45, -45, -135, 135};
+static const double dIRSideAngle[] = {90, -90, -90, 90};
+
+// the effective track width that R5_CNTPER100DEG gives, see R5MotorControl.h
+static const double dTrackWidth = (2.0 * R5_CNTPER100DEG * 1000.0 / R5_CNTPER1000MM) / (100.0 * M_PI / 180.0);
+
+// the reflected light level for a distance, the inverse of R5CornerSensors::_mapCornerSensor()
+static int _irLevel(const int *pnMap, const double dDist)
+{
+	if (dDist >= pnMap[0])
+		return 0;
+	for (int i = 2; i < R5_IR_MAP_SIZE; i += 2)
+	{
+		if (dDist >= pnMap[i])
+		{
+			double dFrac = (pnMap[i - 2] - dDist) / (double)(pnMap[i - 2] - pnMap[i]);
+			return pnMap[i - 1] + (int)(dFrac * (pnMap[i + 1] - pnMap[i - 1]));
+		}
+	}
+	return pnMap[R5_IR_MAP_SIZE - 1];
+}
+
+R5SimRobot::R5SimRobot(R5SimWorld *pWorld, const unsigned char bSmoothing) :
+	_select(&_host),
+	_sensors(cornerInputs, cornerOutputs, &_adc),
+	_ranger(ULTRASONIC_PIN, ULTRASONIC_MIN_INTERVAL),
+	_pir(PIR_PIN),
+	_motors(motorSpeeds, motorDirections, motorCurrents, &_adc),
+	_head(&_servoHHead, &_servoVHead, 75, 180, &_ranger, 5, 2, bSmoothing),
+	_frame(&_sensors, &_motors, &_head, &_ranger, &_pir, 0, 2),
+	_plan(&_frame, &_motors, &_head, &_sensors, &_pir, &_servoHHead, &_servoVHead)
+{
+	_pWorld = pWorld;
+	_ulLoopMicros = R5_SIM_LOOP_US;
+	_uiPlanRate = 10;
+	_nStartupLoopCounter = 0;
+	_ulOldTimerMilliSecs = _ulOldRateMilliSecs = _ulOldSenseMilliSecs = 0;
+	_pfnPlan = _pfnTimers = 0;
+	_pPlanContext = 0;
+	_pTrace = 0;
+	_pReport = 0;
+	_bReportHeadMatrix = false;
+	_pTelemetry = 0;
+	_dTrackSpeed[0] = _dTrackSpeed[1] = 0;
+	_dClicks[0] = _dClicks[1] = 0;
+	_dDistance = 0;
+	_bStalled = false;
+	_ulCollisions = 0;
+	_bTriggerHigh = false;
+	_ulPIRUntil = 0;
+	_lHumanMillis = -1;
+	_ulActionErrors = 0;
+	_ulNoise = 1;
+	_dX = _dY = _dHeading = 0;
+	if (pWorld)
+		pWorld->getStart(&_dX, &_dY, &_dHeading);
+
+	_host.setPulseHandler(_pulseHandler, this);
+	_host.setWriteHandler(_writeHandler, this);
+
+	// setup()
+	_adc.begin();
+	_servoHHead.attach(6);
+	_servoVHead.attach(7);
+	_head.setHScanParams(30, 15, 135);
+	_head.setVScanParams(45, 135, 180);
+	_head.setHScanInterval(0);
+	_head.setVScanInterval(0);
+	_head.lookAhead();
+	_head.setParalyse(true);
+	_ranger.setAsync(true);
+	_motors.setParalyse(true);
+	_updateIR();
+	_select.restore();
+}
+
+R5SimRobot::~R5SimRobot()
+{
+	R5HalHost *pOldHost = R5HalHost::current();
+
+	R5HalHost::setCurrent(&_host);
+	_adc.end();
+	_ranger.setAsync(false);
+	R5HalHost::setCurrent(pOldHost);
+}
+
+void R5SimRobot::setLoopMicros(const unsigned long ulLoopMicros)
+{
+	_ulLoopMicros = ulLoopMicros ? ulLoopMicros : 1;
+}
+
+void R5SimRobot::setPlanRate(const unsigned int uiPlanRate)
+{
+	_uiPlanRate = uiPlanRate;
+}
+
+void R5SimRobot::setPlanCallback(R5SimPlanCallback pfnPlan, R5SimPlanCallback pfnTimers, void *pContext)
+{
+	_pfnPlan = pfnPlan;
+	_pfnTimers = pfnTimers;
+	_pPlanContext = pContext;
+}
+
+void R5SimRobot::setSeed(const unsigned long ulSeed)
+{
+	_ulNoise = ulSeed ? ulSeed : 1;
+	_host.seedRandom(_ulNoise);
+}
+
+void R5SimRobot::setPose(const double dX, const double dY, const double dHeading)
+{
+	_dX = dX;
+	_dY = dY;
+	_dHeading = dHeading;
+}
+
+void R5SimRobot::setTrace(R5Trace *pTrace)
+{
+	_pTrace = pTrace;
+}
+
+void R5SimRobot::setReport(R5Output *pOut, const unsigned char bHeadMatrix)
+{
+	_pReport = pOut;
+	_bReportHeadMatrix = bHeadMatrix;
+}
+
+void R5SimRobot::setTelemetry(R5Telemetry *pTelemetry)
+{
+	_pTelemetry = pTelemetry;
+}
+
+unsigned long R5SimRobot::getMillis(void)
+{
+	return _host.getMicros() / 1000UL;
+}
+
+// run loop() and then let the world catch up with the time it took
+void R5SimRobot::step(void)
+{
+	R5HalHost *pOldHost = R5HalHost::current();
+	unsigned long ulRemaining = _ulLoopMicros;
+
+	R5HalHost::setCurrent(&_host);
+	_loop();
+	while (ulRemaining)
+	{
+		unsigned long ulStep = min(ulRemaining, (unsigned long)R5_SIM_STEP_US);
+		_physics(ulStep / 1000000.0);
+		_host.advanceMicros(ulStep);
+		ulRemaining -= ulStep;
+	}
+	R5HalHost::setCurrent(pOldHost);
+}
+
+void R5SimRobot::run(const unsigned long ulMilliSecs)
+{
+	unsigned long ulEnd = _host.getMicros() + ulMilliSecs * 1000UL;
+
+	while ((long)(ulEnd - _host.getMicros()) > 0)
+		step();
+}
+
+// the same as loop() in R5Robot.ino, without the serial, WiFi and display handling
+void R5SimRobot::_loop(void)
+{
+	unsigned long ulMilliSecs = millis();
+
+	if (_nStartupLoopCounter < 100)
+		_nStartupLoopCounter++;
+
+	if (_nStartupLoopCounter < 50)
+	{
+		_sensors.sense();
+		delay(25);
+	}
+	else if (_nStartupLoopCounter == 50)
+	{
+		_sensors.calibrateBleed();
+		_motors.setParalyse(false);
+		_head.setParalyse(false);
+	}
+	else
+	{
+		if ((ulMilliSecs - _ulOldTimerMilliSecs) >= 1000)
+		{
+			_ulOldTimerMilliSecs = ulMilliSecs;
+			if (_pfnTimers)
+				(*_pfnTimers)(_pPlanContext);
+		}
+
+		unsigned int uiSensorRate = _uiPlanRate ? _uiPlanRate : 1;
+		if ((ulMilliSecs - _ulOldSenseMilliSecs) >= (125 / uiSensorRate))
+		{
+			_ulOldSenseMilliSecs = ulMilliSecs;
+			_sensors.sense();
+		}
+
+		if (_uiPlanRate && ((ulMilliSecs - _ulOldRateMilliSecs) >= (1000 / _uiPlanRate)))
+		{
+			_ulOldRateMilliSecs = ulMilliSecs;
+			_frame.capture();
+			if (_pReport)
+				_reportSensorValues();
+			if (_pReport && _bReportHeadMatrix)
+				_reportHeadMatrix();
+			if (_pfnPlan)
+				(*_pfnPlan)(_pPlanContext);
+		}
+	}
+
+	if (_pTrace)
+		_pTrace->record(getClicks(0), getClicks(1));
+	_motors.driveMotors(getClicks(0), getClicks(1));
+	_head.driveHead();
+}
+
+// reportSensorValues() from R5Robot.ino, the same X record from the frame
+void R5SimRobot::_reportSensorValues(void)
+{
+	char szDisplayBuff[100];
+
+	if (_pTelemetry)
+	{
+		_pTelemetry->begin(R5_TELEMETRY_SENSORS, getRobotMillis(), 18);
+		for (int i = 0; i < 4; i++)
+			_pTelemetry->add(_frame.getCornerDistance(i));
+		for (int i = 0; i < 4; i++)
+			_pTelemetry->add(_frame.getEdgeDistance(i));
+		for (int i = 0; i < 4; i++)
+			_pTelemetry->add(_frame.getEdgeAngle(i));
+		_pTelemetry->add(_frame.getRudder());
+		_pTelemetry->add(_frame.getDistanceTravelled());
+		_pTelemetry->add(_frame.getMotorCurrent(0));
+		_pTelemetry->add(_frame.getPIRActivated());
+		_pTelemetry->add(_frame.getUltrasonicRange());
+		_pTelemetry->add(_frame.getHMinRange());
+		_pTelemetry->send();
+		return;
+	}
+	snprintf(szDisplayBuff, sizeof(szDisplayBuff), "X %i %i %i %i %i %i %i %i %i %i %i %i %i %li %i %i %i %i",
+			_frame.getCornerDistance(0), _frame.getCornerDistance(1), _frame.getCornerDistance(2), _frame.getCornerDistance(3),
+			_frame.getEdgeDistance(0), _frame.getEdgeDistance(1), _frame.getEdgeDistance(2), _frame.getEdgeDistance(3),
+			_frame.getEdgeAngle(0), _frame.getEdgeAngle(1), _frame.getEdgeAngle(2), _frame.getEdgeAngle(3),
+			_frame.getRudder(), _frame.getDistanceTravelled(), _frame.getMotorCurrent(0), _frame.getPIRActivated(),
+			_frame.getUltrasonicRange(), _frame.getHMinRange());
+	_pReport->outputData(szDisplayBuff);
+}
+
+// reportHeadMatrix() from R5Robot.ino
+void R5SimRobot::_reportHeadMatrix(void)
+{
+	char szDisplayBuff[100];
+	char szElemBuff[12];
+
+	if (_pTelemetry)
+	{
+		_pTelemetry->begin(R5_TELEMETRY_HEADMATRIX, getRobotMillis(), _head.getVCells() * _head.getHCells());
+		for (unsigned char v = _head.getVCells(); v > 0; v--)
+		{
+			for (unsigned char h = _head.getHCells(); h > 0; h--)
+				_pTelemetry->add(_head.getRangeAtCell(h-1, v-1));
+		}
+		_pTelemetry->send();
+		return;
+	}
+	strcpy(szDisplayBuff, "Y");
+	for (unsigned char v = _head.getVCells(); v > 0; v--)
+	{
+		for (unsigned char h = _head.getHCells(); h > 0; h--)
+		{
+			snprintf(szElemBuff, sizeof(szElemBuff), " %u", _head.getRangeAtCell(h-1, v-1));
+			if (sizeof(szDisplayBuff) - strlen(szDisplayBuff) > strlen(szElemBuff))
+				strcat(szDisplayBuff, szElemBuff);
+		}
+	}
+	_pReport->outputData(szDisplayBuff);
+}
+
+// move the robot by the track speeds the motor outputs give, then update the inputs
+void R5SimRobot::_physics(const double dSeconds)
+{
+	double dAlpha = dSeconds / (R5_SIM_MOTOR_TAU + dSeconds);
+	double dMM[2];
+
+	for (int i = 0; i < 2; i++)
+	{
+		double dTarget = (_host.getAnalogOutput(motorSpeeds[i]) * (double)R5_CNTPERSEC_MAX) / 255.0;
+		if (_host.getDigitalOutput(motorDirections[i]))
+			dTarget = -dTarget;
+		_dTrackSpeed[i] += (dTarget - _dTrackSpeed[i]) * dAlpha;
+		dMM[i] = (_dTrackSpeed[i] * dSeconds * 1000.0) / R5_CNTPER1000MM;
+	}
+
+	double dForward = (dMM[0] + dMM[1]) / 2.0;
+	double dTurn = ((dMM[0] - dMM[1]) / dTrackWidth) * 180.0 / M_PI; // clockwise
+	double dMidHeading = (_dHeading + dTurn / 2.0) * M_PI / 180.0;
+	double dNewX = _dX + dForward * cos(dMidHeading);
+	double dNewY = _dY + dForward * sin(dMidHeading);
+
+	// pushing into a wall stalls the tracks, but moving away from it is allowed
+	double dClearance = _pWorld->clearance(dNewX, dNewY);
+	_bStalled = (dClearance < R5_SIM_RADIUS) && (dClearance < _pWorld->clearance(_dX, _dY));
+
+	if (_bStalled)
+	{
+		_ulCollisions++;
+		_dTrackSpeed[0] = _dTrackSpeed[1] = 0;
+	}
+	else
+	{
+		_dX = dNewX;
+		_dY = dNewY;
+		_dHeading = fmod(_dHeading + dTurn + 360.0, 360.0);
+		_dDistance += fabs(dForward);
+		_dClicks[0] += (dMM[0] * R5_CNTPER1000MM) / 1000.0;
+		_dClicks[1] += (dMM[1] * R5_CNTPER1000MM) / 1000.0;
+	}
+
+	// motor current, 5mA per unit. More when stalled
+	for (int i = 0; i < 2; i++)
+	{
+		int nDrive = _host.getAnalogOutput(motorSpeeds[i]);
+		_host.setAnalogInput(motorCurrents[i], _bStalled ? (nDrive * 300) / 255 : (nDrive * 120) / 255 + _noise(4));
+	}
+
+	_updateIR();
+
+	unsigned long ulMillis = _host.getMicros() / 1000UL;
+	if (_seesHuman(R5_SIM_PIR_RANGE))
+		_ulPIRUntil = ulMillis + R5_SIM_PIR_HOLD;
+	if ((_lHumanMillis < 0) && _seesHuman(MAX_DIST_FOR_HUMAN))
+		_lHumanMillis = (long)ulMillis;
+	_host.setDigitalInput(PIR_PIN, ((long)(_ulPIRUntil - ulMillis) > 0) ? HIGH : LOW);
+}
+
+// each sensor sees the ambient light, plus the reflection of its LED when it is on.
+// The diagonal uses the corner curve and the view straight out to the side uses the side curve
+void R5SimRobot::_updateIR(void)
+{
+	double dCos = cos(_dHeading * M_PI / 180.0);
+	double dSin = sin(_dHeading * M_PI / 180.0);
+
+	for (int i = 0; i < 4; i++)
+	{
+		int nLevel = R5_SIM_IR_AMBIENT + _noise(4);
+
+		if (_host.getDigitalOutput(cornerOutputs[i]))
+		{
+			double dX = _dX + dIRSensorX[i] * dCos - dIRSensorY[i] * dSin;
+			double dY = _dY + dIRSensorX[i] * dSin + dIRSensorY[i] * dCos;
+			double dCorner = _pWorld->castRay(dX, dY, _dHeading + dIRSensorAngle[i], 1000, 50);
+			double dSide = _pWorld->castRay(dX, dY, _dHeading + dIRSideAngle[i], 1000, 50);
+			nLevel += R5_SIM_IR_BLEED + max(_irLevel(nIRCornerSensorMap, dCorner), _irLevel(nIRSideCornerSensorMap, dSide));
+		}
+		_host.setAnalogInput(cornerInputs[i], nLevel);
+	}
+}
+
+void R5SimRobot::_setIRLevels(const int *pnPassive, const int *pnActive)
+{
+	for (int i = 0; i < 4; i++)
+		_host.setAnalogInput(cornerInputs[i], _host.getDigitalOutput(cornerOutputs[i]) ? pnActive[i] : pnPassive[i]);
+}
+
+void R5SimRobot::_setMotorCurrents(const int nLeft, const int nRight)
+{
+	_host.setAnalogInput(motorCurrents[0], nLeft);
+	_host.setAnalogInput(motorCurrents[1], nRight);
+}
+
+void R5SimRobot::_setPIR(const unsigned char bLevel)
+{
+	_host.setDigitalInput(PIR_PIN, bLevel ? HIGH : LOW);
+}
+
+// which way the head is pointing. Above the centre angle looks left
+double R5SimRobot::_headDirection(void)
+{
+	return _dHeading - (_servoHHead.read() - 75);
+}
+
+unsigned long R5SimRobot::_echoDuration(void)
+{
+	return (_ultrasonicRange() * 29UL) / 5UL;
+}
+
+// the nearest echo across the width of the beam. The head looks up as the vertical servo moves down from 180
+unsigned int R5SimRobot::_ultrasonicRange(void)
+{
+	double dSlope = tan((180 - _servoVHead.read()) * M_PI / 180.0);
+	double dDirection = _headDirection();
+	double dX = _dX + 100.0 * cos(_dHeading * M_PI / 180.0);
+	double dY = _dY + 100.0 * sin(_dHeading * M_PI / 180.0);
+	double dRange = R5_SIM_US_MAXRANGE;
+
+	for (int i = -1; i <= 1; i++)
+		dRange = min(dRange, _pWorld->castRay(dX, dY, dDirection + i * 7.5, R5_SIM_US_MAXRANGE, R5_SIM_HEAD_HEIGHT, dSlope));
+	return (unsigned int)dRange;
+}
+
+// a human within dRange in the PIR's field of view that nothing is in front of
+unsigned char R5SimRobot::_seesHuman(const double dRange)
+{
+	double dDirection = _headDirection();
+
+	for (int i = 0; i < _pWorld->getHumans(); i++)
+	{
+		const R5SimHumanType *pHuman = _pWorld->getHuman(i);
+		double dDX = pHuman->dX - _dX;
+		double dDY = pHuman->dY - _dY;
+		double dDist = sqrt(dDX * dDX + dDY * dDY);
+		double dAngle = fmod(atan2(dDY, dDX) * 180.0 / M_PI - dDirection + 540.0, 360.0) - 180.0;
+
+		if ((dDist < dRange) && (fabs(dAngle) < R5_SIM_PIR_ANGLE) &&
+			(_pWorld->castRay(_dX, _dY, dDirection + dAngle, dDist, 1000) >= dDist))
+			return true;
+	}
+	return false;
+}
+
+// -nRange to +nRange
+int R5SimRobot::_noise(const int nRange)
+{
+	_ulNoise = _ulNoise * 1103515245UL + 12345UL;
+	return (int)((_ulNoise >> 16) % (2 * nRange + 1)) - nRange;
+}
+
+// pulseIn() on the ultrasonic pin returns the echo for the current head position
+unsigned long R5SimRobot::_pulseHandler(void *pContext, const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout)
+{
+	R5SimRobot *pRobot = (R5SimRobot *)pContext;
+
+	if (bPin != ULTRASONIC_PIN)
+		return 0;
+	return pRobot->_echoDuration();
+}
+
+// the end of the trigger pulse starts an echo on the same pin, for the asynchronous ranger
+void R5SimRobot::_writeHandler(void *pContext, const uint8_t bPin, const uint8_t bValue)
+{
+	R5SimRobot *pRobot = (R5SimRobot *)pContext;
+
+	if (bPin != ULTRASONIC_PIN)
+		return;
+	if (bValue)
+		pRobot->_bTriggerHigh = true;
+	else if (pRobot->_bTriggerHigh)
+	{
+		unsigned long ulStart = pRobot->_host.getMicros() + R5_SIM_US_ECHO_DELAY;
+		unsigned long ulDuration = pRobot->_echoDuration();
+		pRobot->_bTriggerHigh = false;
+		if (!ulDuration)
+			return; // no echo, the ranger times out
+		pRobot->_host.scheduleDigitalInput(ULTRASONIC_PIN, HIGH, ulStart);
+		pRobot->_host.scheduleDigitalInput(ULTRASONIC_PIN, LOW, ulStart + ulDuration);
+	}
+}
+
+int R5SimRobot::readSense(const int nSense)
+{
+	R5HalHost *pOldHost = R5HalHost::current();
+
+	R5HalHost::setCurrent(&_host);
+	int nRtn = _plan.readSense(nSense);
+	R5HalHost::setCurrent(pOldHost);
+	return nRtn;
+}
+
+// returns R5_SUCCESS etc. without the action ID
+unsigned char R5SimRobot::executeAction(const int nAction, const int nActionValue, const unsigned char bCheckForComplete)
+{
+	R5HalHost *pOldHost = R5HalHost::current();
+
+	R5HalHost::setCurrent(&_host);
+	unsigned char bRtn = _plan.executeAction(nAction, nActionValue, bCheckForComplete);
+	if (bRtn == R5_ERROR)
+		_ulActionErrors++;
+	R5HalHost::setCurrent(pOldHost);
+	return bRtn;
+}
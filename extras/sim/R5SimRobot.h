@@ -0,0 +1,164 @@
+// 	Library for Rover 5 Platform Simulated Robot
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Runs the R5 library classes against an R5SimWorld on the virtual clock of its own R5HalHost.
+// The classes are wired up and driven as R5Robot.ino does, and readSense() / executeAction()
+// go through the same R5PlanInterface as Robot_Instinct.ino, so a plan sees the same robot.
+//
+// The simulator models the tracks and encoders, the four IR corner sensors using the
+// R5CornerSensors response curves, the motor current, the ultrasonic sensor on the servo head
+// and the PIR. Things the sketch does for people (the display, voice, WiFi) are left out.
+//
+#ifndef _R5SIMROBOT_H_
+#define _R5SIMROBOT_H_
+
+#define R5_SIM_LOOP_US		2000	// default time taken by one pass of loop()
+#define R5_SIM_STEP_US		1000	// longest physics step
+#define R5_SIM_RADIUS		170.0	// the robot's footprint
+#define R5_SIM_MOTOR_TAU	0.08	// track speed time constant in S
+#define R5_SIM_IR_AMBIENT	30		// IR level with no reflection
+#define R5_SIM_IR_BLEED		5		// IR level from the robot's own LEDs
+#define R5_SIM_US_MAXRANGE	3000.0	// beyond this there is no echo
+#define R5_SIM_US_ECHO_DELAY	750		// uS from the trigger to the start of the echo
+#define R5_SIM_PIR_RANGE	4000.0
+#define R5_SIM_PIR_ANGLE	50.0	// half angle of the PIR field of view
+#define R5_SIM_PIR_HOLD		2000	// mS the PIR output stays high
+
+// makes a host current while the robot's members are constructed
+class R5SimHostSelect {
+public:
+	R5SimHostSelect(R5HalHost *pHost) {_pOldHost = R5HalHost::current(); R5HalHost::setCurrent(pHost);};
+	void restore(void) {R5HalHost::setCurrent(_pOldHost);};
+private:
+	R5HalHost *_pOldHost;
+};
+
+// called at the plan rate, after the sensor frame is captured, and once a second for the plan timers
+typedef void (*R5SimPlanCallback)(void *pContext);
+
+class R5SimRobot {
+public:
+	R5SimRobot(R5SimWorld *pWorld, const unsigned char bSmoothing = 10); // bSmoothing is passed to R5SensingHead
+	virtual ~R5SimRobot();
+
+	void setLoopMicros(const unsigned long ulLoopMicros);
+	void setPlanRate(const unsigned int uiPlanRate); // plan cycles per second, 0 = don't run the plan
+	void setPlanCallback(R5SimPlanCallback pfnPlan, R5SimPlanCallback pfnTimers, void *pContext);
+	void setSeed(const unsigned long ulSeed); // noise on the sensors
+	void setPose(const double dX, const double dY, const double dHeading);
+	void setTrace(R5Trace *pTrace); // recorded each loop, as R5Robot.ino does with REPORT trace on
+	// X records at the plan rate, and Y records if bHeadMatrix, as R5Robot.ino does with REPORT sensors and head matrix on
+	void setReport(R5Output *pOut, const unsigned char bHeadMatrix = false);
+	void setTelemetry(R5Telemetry *pTelemetry); // send the reports as binary frames, as REPORT binary does
+
+	void step(void); // one pass of loop()
+	void run(const unsigned long ulMilliSecs);
+
+	// the plan interface
+	int readSense(const int nSense);
+	unsigned char executeAction(const int nAction, const int nActionValue, const unsigned char bCheckForComplete);
+
+	// the true state of the simulated robot
+	double getX(void) {return _dX;};
+	double getY(void) {return _dY;};
+	double getHeading(void) {return _dHeading;};
+	double getDistance(void) {return _dDistance;}; // mm driven, not counting time stuck
+	unsigned long getCollisions(void) {return _ulCollisions;}; // physics steps spent pushing against something
+	long getHumanMillis(void) {return _lHumanMillis;}; // when it first faced a human within MAX_DIST_FOR_HUMAN, -1 if it hasn't
+	unsigned long getActionErrors(void) {return _ulActionErrors;}; // executeAction() calls that returned R5_ERROR
+	unsigned long getMillis(void);
+	virtual unsigned long getRobotMillis(void) {return getMillis();}; // what millis() reads on the robot being modelled
+
+	R5HalHost *getHost(void) {return &_host;};
+	R5MotorControl *getMotors(void) {return &_motors;};
+	R5SensingHead *getHead(void) {return &_head;};
+	R5CornerSensors *getSensors(void) {return &_sensors;};
+	R5SensorFrame *getFrame(void) {return &_frame;};
+	R5Ultrasonic *getRanger(void) {return &_ranger;};
+	R5PIR *getPIR(void) {return &_pir;};
+	long getClicks(const unsigned char bMotor) {return (long)floor(_dClicks[bMotor % 2]);}; // what the encoders read
+
+protected:
+	// the model of the robot's inputs, run between passes of loop(). A replay overrides these to feed a trace instead
+	virtual void _physics(const double dSeconds);
+	virtual unsigned long _echoDuration(void); // uS width of the echo for the current head position
+	unsigned char _started(void) {return (_nStartupLoopCounter > 50);}; // false during the startup calibration
+	void _setIRLevels(const int *pnPassive, const int *pnActive); // each sensor reads its active level while its LED is on
+	void _setMotorCurrents(const int nLeft, const int nRight); // raw samples, 5mA per unit
+	void _setPIR(const unsigned char bLevel);
+
+private:
+	void _loop(void);
+	void _reportSensorValues(void);
+	void _reportHeadMatrix(void);
+	void _updateIR(void);
+	unsigned int _ultrasonicRange(void);
+	unsigned char _seesHuman(const double dRange);
+	double _headDirection(void);
+	int _noise(const int nRange);
+	static unsigned long _pulseHandler(void *pContext, const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout);
+	static void _writeHandler(void *pContext, const uint8_t bPin, const uint8_t bValue);
+
+protected:
+	R5SimWorld *_pWorld;
+	R5HalHost _host;
+	R5SimHostSelect _select; // the members below are constructed on _host
+
+	// the robot, as declared in R5Robot.ino
+	Servo _servoHHead;
+	Servo _servoVHead;
+	R5AdcScheduler _adc;
+	R5CornerSensors _sensors;
+	R5Ultrasonic _ranger;
+	R5PIR _pir;
+	R5MotorControl _motors;
+	R5SensingHead _head;
+	R5SensorFrame _frame;
+	R5PlanInterface _plan;
+
+	// loop() state
+	unsigned long _ulLoopMicros;
+	unsigned int _uiPlanRate;
+	int _nStartupLoopCounter;
+	unsigned long _ulOldTimerMilliSecs;
+	unsigned long _ulOldRateMilliSecs;
+	unsigned long _ulOldSenseMilliSecs;
+	R5SimPlanCallback _pfnPlan;
+	R5SimPlanCallback _pfnTimers;
+	void *_pPlanContext;
+	R5Trace *_pTrace;
+	R5Output *_pReport;
+	unsigned char _bReportHeadMatrix;
+	R5Telemetry *_pTelemetry;
+
+	// the world as the robot is in it
+	double _dX;
+	double _dY;
+	double _dHeading;
+	double _dTrackSpeed[2];		// clicks per second
+	double _dClicks[2];
+	double _dDistance;
+	unsigned char _bStalled;
+	unsigned long _ulCollisions;
+	unsigned char _bTriggerHigh;
+	unsigned long _ulPIRUntil;
+	long _lHumanMillis;
+	unsigned long _ulActionErrors;
+	unsigned long _ulNoise;
+};
+
+#endif // _R5SIMROBOT_H_
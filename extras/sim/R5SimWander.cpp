@@ -0,0 +1,110 @@
+// 	Library for Rover 5 Platform Simulator Wander Behaviour
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanInterface.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+#include "R5SimWander.h"
+
+R5SimWander::R5SimWander(R5SimRobot *pRobot)
+{
+	_pRobot = pRobot;
+	_uiScanInterval = R5_WANDER_SCAN_INTERVAL;
+	_nNearRange = R5_WANDER_NEAR_RANGE;
+	_nFastRange = R5_WANDER_FAST_RANGE;
+	_nStallCurrent = R5_WANDER_STALL_CURRENT;
+	_bStarted = false;
+	_bBacking = false;
+	_bTurning = false;
+	_nTurn = 0;
+}
+
+void R5SimWander::setScanInterval(const unsigned int uiScanInterval)
+{
+	_uiScanInterval = uiScanInterval;
+}
+
+void R5SimWander::setRanges(const int nNearRange, const int nFastRange)
+{
+	_nNearRange = nNearRange;
+	_nFastRange = nFastRange;
+}
+
+void R5SimWander::setStallCurrent(const int nStallCurrent)
+{
+	_nStallCurrent = nStallCurrent;
+}
+
+void R5SimWander::runPlan(void *pContext)
+{
+	((R5SimWander *)pContext)->_plan();
+}
+
+void R5SimWander::_plan(void)
+{
+	int nAhead = _pRobot->readSense(SENSE_FRONT_RANGE);
+	unsigned char bStalled = (_pRobot->readSense(SENSE_MOTOR_CURRENT) > _nStallCurrent);
+
+	if (!_bStarted)
+	{
+		_pRobot->executeAction(ACTION_HSCAN, _uiScanInterval, false);
+		_bStarted = true;
+	}
+
+	if (_bBacking)
+	{
+		_bBacking = !bStalled && (_pRobot->executeAction(ACTION_MOVEBY, -150, true) == R5_IN_PROGRESS);
+		if (_bBacking)
+			return;
+		_pRobot->executeAction(ACTION_STOP, 0, false);
+		nAhead = 0; // turn away now we have backed off
+	}
+	else if (bStalled)
+	{
+		_pRobot->executeAction(ACTION_STOP, 0, false);
+		_bBacking = (_pRobot->executeAction(ACTION_MOVEBY, -150, false) == R5_IN_PROGRESS);
+		return;
+	}
+
+	if (_bTurning)
+		_bTurning = (_pRobot->executeAction(ACTION_TURN, _nTurn, true) == R5_IN_PROGRESS);
+	else if (nAhead < _nNearRange)
+	{
+		if (!_nTurn)
+			_nTurn = (_pRobot->readSense(SENSE_NEAREST_CORNER) == R5_FRONT_LEFT) ? 45 : -45;
+		_bTurning = (_pRobot->executeAction(ACTION_TURN, _nTurn, false) == R5_IN_PROGRESS);
+	}
+	else
+	{
+		_nTurn = 0;
+		_pRobot->executeAction(ACTION_SETSPEED, (nAhead > _nFastRange) ? 60 : 40, false);
+	}
+}
@@ -0,0 +1,53 @@
+// 	Library for Rover 5 Platform Simulator Wander Behaviour
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// The built in behaviour for the simulator, used when there is no Instinct plan. It uses the same
+// senses and actions as a plan would: scan ahead, drive towards open space and turn away from
+// anything close. It keeps turning the same way until the way ahead is clear, so corners don't
+// trap it. If the motors stall on something the sensors missed, it backs off first.
+//
+#ifndef _R5SIMWANDER_H_
+#define _R5SIMWANDER_H_
+
+#define R5_WANDER_SCAN_INTERVAL	1000	// mS per head cell, the HSCAN action value
+#define R5_WANDER_NEAR_RANGE	250		// mm ahead at which it turns away
+#define R5_WANDER_FAST_RANGE	800		// mm ahead beyond which it drives fast
+#define R5_WANDER_STALL_CURRENT	500		// mA
+
+class R5SimWander {
+public:
+	R5SimWander(R5SimRobot *pRobot);
+	void setScanInterval(const unsigned int uiScanInterval);
+	void setRanges(const int nNearRange, const int nFastRange);
+	void setStallCurrent(const int nStallCurrent);
+	static void runPlan(void *pContext); // an R5SimPlanCallback, with pContext the R5SimWander
+
+private:
+	void _plan(void);
+
+	R5SimRobot *_pRobot;
+	unsigned int _uiScanInterval;
+	int _nNearRange;
+	int _nFastRange;
+	int _nStallCurrent;
+	unsigned char _bStarted;
+	unsigned char _bBacking;
+	unsigned char _bTurning;
+	int _nTurn;	// 0 when not avoiding anything
+};
+
+#endif // _R5SIMWANDER_H_
@@ -0,0 +1,267 @@
+// 	Library for Rover 5 Platform Simulator World
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "R5SimWorld.h"
+
+#define R5_SIM_LINE_SIZE 256
+#define R5_SIM_RANDOM_BOXES 4
+#define R5_SIM_RANDOM_TRIES 100
+
+// each world has its own generator, so worlds built on different threads don't interfere
+static double _randomUniform(unsigned long *pulState, const double dMin, const double dMax)
+{
+	*pulState = (*pulState * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+	return dMin + (dMax - dMin) * (*pulState / (double)0x80000000UL);
+}
+
+// true if the point is within dMargin of the rectangle
+static unsigned char _nearRect(const double *pdRect, const double dX, const double dY, const double dMargin)
+{
+	return (dX > pdRect[0] - dMargin) && (dX < pdRect[0] + pdRect[2] + dMargin) &&
+			(dY > pdRect[1] - dMargin) && (dY < pdRect[1] + pdRect[3] + dMargin);
+}
+
+R5SimWorld::R5SimWorld()
+{
+	clear();
+}
+
+void R5SimWorld::clear(void)
+{
+	_walls.clear();
+	_humans.clear();
+	_dStartX = 0;
+	_dStartY = 0;
+	_dStartHeading = 0;
+}
+
+void R5SimWorld::loadDefault(void)
+{
+	clear();
+	addBox(0, 0, 4000, 3000);
+	addBox(1500, 600, 400, 400);
+	addBox(2600, 1800, 600, 300, 150); // low enough to see over when the head looks up
+	addHuman(3600, 400);
+	setStart(500, 1500, 0);
+}
+
+// the robot starts at the left end facing into the room. Boxes keep clear of the start and of each other
+// so there is always a way round, and one in four is low enough to see over
+void R5SimWorld::loadRandom(const unsigned long ulSeed)
+{
+	unsigned long ulState = ulSeed;
+	double dBoxes[R5_SIM_RANDOM_BOXES][4];
+	int nBoxes = 0;
+
+	clear();
+	addBox(0, 0, 4000, 3000);
+	setStart(_randomUniform(&ulState, 400, 1000), _randomUniform(&ulState, 400, 2600), _randomUniform(&ulState, -90, 90));
+
+	for (int nTry = 0; (nTry < R5_SIM_RANDOM_TRIES) && (nBoxes < R5_SIM_RANDOM_BOXES); nTry++)
+	{
+		double *pdBox = dBoxes[nBoxes];
+		unsigned char bClear;
+
+		pdBox[2] = _randomUniform(&ulState, 200, 700);
+		pdBox[3] = _randomUniform(&ulState, 200, 700);
+		pdBox[0] = _randomUniform(&ulState, 400, 3600 - pdBox[2]);
+		pdBox[1] = _randomUniform(&ulState, 400, 2600 - pdBox[3]);
+		bClear = !_nearRect(pdBox, _dStartX, _dStartY, 500);
+		for (int i = 0; bClear && (i < nBoxes); i++)
+		{
+		{
+			// grow the other box by this one's size, then the corner test covers any overlap
+			double dGrown[4] = {dBoxes[i][0] - pdBox[2], dBoxes[i][1] - pdBox[3], dBoxes[i][2] + pdBox[2], dBoxes[i][3] + pdBox[3]};
+			bClear = !_nearRect(dGrown, pdBox[0], pdBox[1], 500);
+		}
+		}
+		if (bClear)
+		{
+			addBox(pdBox[0], pdBox[1], pdBox[2], pdBox[3], (nBoxes % 4 == 3) ? 150 : 0);
+			nBoxes++;
+		}
+	}
+
+	for (int nTry = 0; nTry < R5_SIM_RANDOM_TRIES; nTry++)
+	{
+		double dX = _randomUniform(&ulState, 2000, 3800);
+		double dY = _randomUniform(&ulState, 200, 2800);
+		unsigned char bClear = true;
+
+		for (int i = 0; bClear && (i < nBoxes); i++)
+			bClear = !_nearRect(dBoxes[i], dX, dY, 200);
+		if (bClear)
+		{
+			addHuman(dX, dY);
+			break;
+		}
+	}
+}
+
+unsigned char R5SimWorld::load(const char *pszFile)
+{
+	char szLine[R5_SIM_LINE_SIZE];
+	char szItem[16];
+	double d[5];
+	FILE *pFile = fopen(pszFile, "r");
+
+	if (!pFile)
+		return false;
+
+	clear();
+	while (fgets(szLine, sizeof(szLine), pFile))
+	{
+		char *pComment = strchr(szLine, '#');
+		if (pComment)
+			*pComment = 0;
+		d[4] = 0;
+		int nItems = sscanf(szLine, "%15s %lf %lf %lf %lf %lf", szItem, &d[0], &d[1], &d[2], &d[3], &d[4]);
+		if (nItems <= 0)
+			continue;
+
+		if (!strcmp(szItem, "ARENA") && (nItems == 3))
+			addBox(0, 0, d[0], d[1]);
+		else if (!strcmp(szItem, "WALL") && (nItems >= 5))
+			addWall(d[0], d[1], d[2], d[3], d[4]);
+		else if (!strcmp(szItem, "BOX") && (nItems >= 5))
+			addBox(d[0], d[1], d[2], d[3], d[4]);
+		else if (!strcmp(szItem, "HUMAN") && (nItems == 3))
+			addHuman(d[0], d[1]);
+		else if (!strcmp(szItem, "ROBOT") && (nItems == 4))
+			setStart(d[0], d[1], d[2]);
+		else
+		{
+			fclose(pFile);
+			return false;
+		}
+	}
+	fclose(pFile);
+	return true;
+}
+
+void R5SimWorld::addWall(const double dX1, const double dY1, const double dX2, const double dY2, const double dHeight)
+{
+	R5SimWallType wall = {dX1, dY1, dX2, dY2, dHeight};
+
+	_walls.push_back(wall);
+}
+
+void R5SimWorld::addBox(const double dX, const double dY, const double dLength, const double dWidth, const double dHeight)
+{
+	addWall(dX, dY, dX + dLength, dY, dHeight);
+	addWall(dX + dLength, dY, dX + dLength, dY + dWidth, dHeight);
+	addWall(dX + dLength, dY + dWidth, dX, dY + dWidth, dHeight);
+	addWall(dX, dY + dWidth, dX, dY, dHeight);
+}
+
+void R5SimWorld::addHuman(const double dX, const double dY)
+{
+	R5SimHumanType human = {dX, dY};
+
+	_humans.push_back(human);
+}
+
+void R5SimWorld::setStart(const double dX, const double dY, const double dHeading)
+{
+	_dStartX = dX;
+	_dStartY = dY;
+	_dStartHeading = dHeading;
+}
+
+void R5SimWorld::getStart(double *pdX, double *pdY, double *pdHeading)
+{
+	*pdX = _dStartX;
+	*pdY = _dStartY;
+	*pdHeading = _dStartHeading;
+}
+
+double R5SimWorld::castRay(const double dX, const double dY, const double dHeading, const double dMaxRange,
+							const double dHeight, const double dSlope)
+{
+	double dDirX = cos(dHeading * M_PI / 180.0);
+	double dDirY = sin(dHeading * M_PI / 180.0);
+	double dRange = dMaxRange;
+
+	// looking down, the floor is the furthest we can see
+	if ((dSlope < 0) && (dHeight / -dSlope < dRange))
+		dRange = dHeight / -dSlope;
+
+	for (size_t i = 0; i < _walls.size(); i++)
+	{
+		const R5SimWallType &wall = _walls[i];
+		double dWallX = wall.dX2 - wall.dX1;
+		double dWallY = wall.dY2 - wall.dY1;
+		double dDenom = dDirX * dWallY - dDirY * dWallX;
+
+		if (fabs(dDenom) < 1e-9)
+			continue; // parallel
+		double dOffX = wall.dX1 - dX;
+		double dOffY = wall.dY1 - dY;
+		double t = (dOffX * dWallY - dOffY * dWallX) / dDenom; // along the ray
+		double u = (dOffX * dDirY - dOffY * dDirX) / dDenom; // along the wall
+		if ((t <= 0) || (t >= dRange) || (u < 0) || (u > 1))
+			continue;
+		if ((wall.dHeight > 0) && ((dHeight + t * dSlope) > wall.dHeight))
+			continue; // passes over the top
+		dRange = t;
+	}
+	return dRange;
+}
+
+double R5SimWorld::clearance(const double dX, const double dY)
+{
+	double dMin2 = 1e18;
+
+	for (size_t i = 0; i < _walls.size(); i++)
+	{
+		const R5SimWallType &wall = _walls[i];
+		double dWallX = wall.dX2 - wall.dX1;
+		double dWallY = wall.dY2 - wall.dY1;
+		double dLen2 = dWallX * dWallX + dWallY * dWallY;
+		double u = (dLen2 > 0) ? ((dX - wall.dX1) * dWallX + (dY - wall.dY1) * dWallY) / dLen2 : 0;
+
+		u = (u < 0) ? 0 : ((u > 1) ? 1 : u);
+		double dNearX = wall.dX1 + u * dWallX - dX;
+		double dNearY = wall.dY1 + u * dWallY - dY;
+		if ((dNearX * dNearX + dNearY * dNearY) < dMin2)
+			dMin2 = dNearX * dNearX + dNearY * dNearY;
+	}
+	return sqrt(dMin2);
+}
+
+int R5SimWorld::getHumans(void)
+{
+	return (int)_humans.size();
+}
+
+const R5SimHumanType *R5SimWorld::getHuman(const int nHuman)
+{
+	return &_humans[nHuman];
+}
+
+int R5SimWorld::getWalls(void)
+{
+	return (int)_walls.size();
+}
+
+const R5SimWallType *R5SimWorld::getWall(const int nWall)
+{
+	return &_walls[nWall];
+}
@@ -0,0 +1,78 @@
+// 	Library for Rover 5 Platform Simulator World
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// The 2D arena for the host simulator. Walls and boxes block the robot and reflect IR and
+// ultrasound, and humans trigger the PIR.
+//
+// Distances are in mm. The coordinates follow R5PoseType: x ahead, y to the right and
+// headings in degrees clockwise from the x axis.
+//
+// An arena file has one item per line, # starts a comment:
+// ARENA length width				walls round the outside, from (0, 0) to (length, width)
+// WALL x1 y1 x2 y2 [height]		height 0 or missing is floor to ceiling
+// BOX x y length width [height]	box with corner (x, y)
+// HUMAN x y
+// ROBOT x y heading				where the robot starts
+//
+#ifndef _R5SIMWORLD_H_
+#define _R5SIMWORLD_H_
+
+#include <vector>
+
+#define R5_SIM_HEAD_HEIGHT	250.0	// height of the ultrasonic sensor above the floor
+
+typedef struct {
+	double dX1, dY1, dX2, dY2;
+	double dHeight;
+} R5SimWallType;
+
+typedef struct {
+	double dX, dY;
+} R5SimHumanType;
+
+class R5SimWorld {
+public:
+	R5SimWorld();
+	void clear(void);
+	void loadDefault(void); // a 4m x 3m room with two boxes and a human
+	void loadRandom(const unsigned long ulSeed); // the same room with boxes, a human and a start chosen by the seed
+	unsigned char load(const char *pszFile); // false if the file cannot be read or has an error
+	void addWall(const double dX1, const double dY1, const double dX2, const double dY2, const double dHeight = 0);
+	void addBox(const double dX, const double dY, const double dLength, const double dWidth, const double dHeight = 0);
+	void addHuman(const double dX, const double dY);
+	void setStart(const double dX, const double dY, const double dHeading);
+	void getStart(double *pdX, double *pdY, double *pdHeading);
+
+	// distance to the first thing the ray hits, or dMaxRange if nothing is hit. dHeight is the height of the
+	// start of the ray and dSlope its rise per mm, so rays can pass over low boxes or hit the floor
+	double castRay(const double dX, const double dY, const double dHeading, const double dMaxRange,
+					const double dHeight = R5_SIM_HEAD_HEIGHT, const double dSlope = 0);
+	double clearance(const double dX, const double dY); // distance to the nearest wall
+	int getHumans(void);
+	const R5SimHumanType *getHuman(const int nHuman);
+	int getWalls(void);
+	const R5SimWallType *getWall(const int nWall);
+
+private:
+	std::vector<R5SimWallType> _walls;
+	std::vector<R5SimHumanType> _humans;
+	double _dStartX;
+	double _dStartY;
+	double _dStartHeading;
+};
+
+#endif // _R5SIMWORLD_H_
@@ -0,0 +1,342 @@
+// 	Library for Rover 5 Platform Simulator Batch Runner
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Monte Carlo evaluation of a plan. Runs many simulated robots on all the cores, sweeping the
+// plan rate, the head scan interval, the head smoothing and the behaviour thresholds, and writes
+// the metrics for each combination as CSV.
+//
+// r5batch [-a arena] [-p plan.inst] [-n runs] [-t seconds] [-j threads] [-s seed] [-R]
+//         [-r rates] [-i scan intervals] [-m smoothings] [-d near ranges] [-o Element=values]...
+//
+// Each list is comma separated, e.g. -r 5,10,20, and every combination is run -n times with seeds
+// seed, seed+1 ... so the combinations see the same arenas and noise. Without -a each run gets a
+// random arena from its seed. -i and -d set the built in wander behaviour. With -p the plan runs
+// instead, and -o Element=values overrides the SenseValue or ActionValue of a named plan element,
+// e.g. -o AheadPossibleObstacle=300,400,500. -o may be repeated.
+//
+// The output is one row per combination, or one row per run with -R. The metrics are the time spent
+// pushing against obstacles, the distance driven, how many runs found a human and how long it took,
+// and the plan errors, which are actions returning R5_ERROR plus plan nodes reporting an error.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanInterface.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+#include "R5SimWander.h"
+#include "R5SimPool.h"
+#if defined(R5_SIM_INSTINCT)
+#include "Instinct.h"
+#include "R5SimInstinct.h"
+#endif
+
+// the swept parameters. Plan element overrides follow these
+#define R5_BATCH_RATE		0
+#define R5_BATCH_SCAN		1
+#define R5_BATCH_SMOOTHING	2
+#define R5_BATCH_NEAR		3
+#define R5_BATCH_OVERRIDES	4
+
+typedef struct {
+	std::string strName;
+	std::vector<int> values;
+} R5BatchDimType;
+
+typedef struct {
+	unsigned long ulSeed;
+	unsigned long ulCollisionMs;
+	double dDistance;
+	long lHumanMillis;
+	unsigned long ulPlanErrors;
+} R5BatchResultType;
+
+// shared by the tasks, but only read once the pool is running. Each task writes its own result
+typedef struct {
+	const R5SimWorld *pArena;	// 0 for a random arena per run
+	const char *pszPlan;
+	unsigned long ulSeconds;
+	unsigned long ulSeed;
+	int nRuns;
+	std::vector<R5BatchDimType> dims;
+	std::vector<R5BatchResultType> results;
+} R5BatchType;
+
+// fills pnValues with the parameters of combination nSet, the first dimension varying slowest
+static void batchParams(const R5BatchType *pBatch, int nSet, std::vector<int> *pnValues)
+{
+	pnValues->resize(pBatch->dims.size());
+	for (int i = (int)pBatch->dims.size() - 1; i >= 0; i--)
+	{
+		int nSize = (int)pBatch->dims[i].values.size();
+
+		(*pnValues)[i] = pBatch->dims[i].values[nSet % nSize];
+		nSet /= nSize;
+	}
+}
+
+static int batchSets(const R5BatchType *pBatch)
+{
+	int nSets = 1;
+
+	for (size_t i = 0; i < pBatch->dims.size(); i++)
+		nSets *= (int)pBatch->dims[i].values.size();
+	return nSets;
+}
+
+static void batchTask(void *pContext, const int nTask)
+{
+	R5BatchType *pBatch = (R5BatchType *)pContext;
+	R5BatchResultType *pResult = &pBatch->results[nTask];
+	std::vector<int> nValues;
+	R5SimWorld world;
+
+	batchParams(pBatch, nTask / pBatch->nRuns, &nValues);
+	pResult->ulSeed = pBatch->ulSeed + nTask % pBatch->nRuns;
+	if (pBatch->pArena)
+		world = *pBatch->pArena;
+	else
+		world.loadRandom(pResult->ulSeed);
+
+	R5SimRobot robot(&world, (unsigned char)nValues[R5_BATCH_SMOOTHING]);
+	robot.setPlanRate(nValues[R5_BATCH_RATE]);
+	robot.setSeed(pResult->ulSeed);
+
+	R5SimWander wander(&robot);
+	wander.setScanInterval(nValues[R5_BATCH_SCAN]);
+	wander.setRanges(nValues[R5_BATCH_NEAR], R5_WANDER_FAST_RANGE);
+#if defined(R5_SIM_INSTINCT)
+	R5SimPlanner plan(&robot);
+	if (pBatch->pszPlan)
+	{
+		std::vector<R5SimOverrideType> overrides;
+		for (size_t i = R5_BATCH_OVERRIDES; i < pBatch->dims.size(); i++)
+		{
+			R5SimOverrideType elementOverride = {pBatch->dims[i].strName, nValues[i]};
+			overrides.push_back(elementOverride);
+		}
+		plan.load(pBatch->pszPlan, &overrides);
+		robot.setPlanCallback(R5SimPlanner::runPlan, R5SimPlanner::processTimers, &plan);
+	}
+	else
+#endif
+		robot.setPlanCallback(R5SimWander::runPlan, 0, &wander);
+
+	robot.run(pBatch->ulSeconds * 1000UL);
+
+	pResult->ulCollisionMs = robot.getCollisions() * R5_SIM_STEP_US / 1000UL;
+	pResult->dDistance = robot.getDistance();
+	pResult->lHumanMillis = robot.getHumanMillis();
+	pResult->ulPlanErrors = robot.getActionErrors();
+#if defined(R5_SIM_INSTINCT)
+	pResult->ulPlanErrors += plan.getErrors();
+#endif
+}
+
+// parse a comma separated list of integers. false if it is empty or not a number
+static unsigned char parseList(const char *psz, std::vector<int> *pnValues)
+{
+	char *pszEnd;
+
+	pnValues->clear();
+	do
+	{
+		pnValues->push_back((int)strtol(psz, &pszEnd, 0));
+		if (pszEnd == psz)
+			return false;
+		psz = pszEnd + 1;
+	} while (*pszEnd == ',');
+	return !*pszEnd;
+}
+
+static void printHeader(const R5BatchType *pBatch, const unsigned char bRuns)
+{
+	for (size_t i = 0; i < pBatch->dims.size(); i++)
+		printf("%s,", pBatch->dims[i].strName.c_str());
+	if (bRuns)
+		printf("seed,collision_ms,distance_mm,human_ms,plan_errors\n");
+	else
+		printf("runs,collision_ms,distance_mm,humans_found,human_ms,plan_errors\n");
+}
+
+static void printParams(const R5BatchType *pBatch, const int nSet)
+{
+	std::vector<int> nValues;
+
+	batchParams(pBatch, nSet, &nValues);
+	for (size_t i = 0; i < nValues.size(); i++)
+		printf("%d,", nValues[i]);
+}
+
+// means over the runs. The time to find a human is averaged over the runs that found one
+static void printSet(const R5BatchType *pBatch, const int nSet)
+{
+	double dCollisions = 0, dDistance = 0, dHuman = 0, dErrors = 0;
+	int nFound = 0;
+
+	for (int i = 0; i < pBatch->nRuns; i++)
+	{
+		const R5BatchResultType *pResult = &pBatch->results[nSet * pBatch->nRuns + i];
+
+		dCollisions += pResult->ulCollisionMs;
+		dDistance += pResult->dDistance;
+		dErrors += pResult->ulPlanErrors;
+		if (pResult->lHumanMillis >= 0)
+		{
+			dHuman += pResult->lHumanMillis;
+			nFound++;
+		}
+	}
+	printParams(pBatch, nSet);
+	printf("%d,%.1f,%.0f,%d,%.0f,%.2f\n", pBatch->nRuns, dCollisions / pBatch->nRuns, dDistance / pBatch->nRuns,
+			nFound, nFound ? dHuman / nFound : -1.0, dErrors / pBatch->nRuns);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: r5batch [-a arena] [-p plan.inst] [-n runs] [-t seconds] [-j threads] [-s seed] [-R]\n"
+					"               [-r rates] [-i scan intervals] [-m smoothings] [-d near ranges] [-o Element=values]...\n");
+}
+
+int main(int argc, char *argv[])
+{
+	const char *pszArena = 0;
+	int nThreads = 0;
+	unsigned char bRuns = false;
+	R5SimWorld arena;
+	R5BatchType batch;
+	int nOpt;
+
+	batch.pArena = 0;
+	batch.pszPlan = 0;
+	batch.ulSeconds = 300;
+	batch.ulSeed = 1;
+	batch.nRuns = 10;
+	batch.dims.resize(R5_BATCH_OVERRIDES);
+	batch.dims[R5_BATCH_RATE].strName = "plan_rate";
+	batch.dims[R5_BATCH_RATE].values.push_back(10);
+	batch.dims[R5_BATCH_SCAN].strName = "scan_interval";
+	batch.dims[R5_BATCH_SCAN].values.push_back(R5_WANDER_SCAN_INTERVAL);
+	batch.dims[R5_BATCH_SMOOTHING].strName = "smoothing";
+	batch.dims[R5_BATCH_SMOOTHING].values.push_back(10);
+	batch.dims[R5_BATCH_NEAR].strName = "near_range";
+	batch.dims[R5_BATCH_NEAR].values.push_back(R5_WANDER_NEAR_RANGE);
+
+	while ((nOpt = getopt(argc, argv, "a:p:n:t:j:s:Rr:i:m:d:o:")) != -1)
+	{
+		unsigned char bOk = true;
+		const char *pszEquals;
+		R5BatchDimType dim;
+
+		switch (nOpt)
+		{
+			case 'a': pszArena = optarg; break;
+			case 'p': batch.pszPlan = optarg; break;
+			case 'n': batch.nRuns = atoi(optarg); bOk = (batch.nRuns > 0); break;
+			case 't': batch.ulSeconds = strtoul(optarg, 0, 0); break;
+			case 'j': nThreads = atoi(optarg); break;
+			case 's': batch.ulSeed = strtoul(optarg, 0, 0); break;
+			case 'R': bRuns = true; break;
+			case 'r': bOk = parseList(optarg, &batch.dims[R5_BATCH_RATE].values); break;
+			case 'i': bOk = parseList(optarg, &batch.dims[R5_BATCH_SCAN].values); break;
+			case 'm': bOk = parseList(optarg, &batch.dims[R5_BATCH_SMOOTHING].values); break;
+			case 'd': bOk = parseList(optarg, &batch.dims[R5_BATCH_NEAR].values); break;
+			case 'o':
+				pszEquals = strchr(optarg, '=');
+				bOk = pszEquals && (pszEquals != optarg) && parseList(pszEquals + 1, &dim.values);
+				dim.strName.assign(optarg, bOk ? pszEquals - optarg : 0);
+				batch.dims.push_back(dim);
+				break;
+			default: bOk = false; break;
+		}
+		if (!bOk)
+		{
+			usage();
+			return 2;
+		}
+	}
+
+#if !defined(R5_SIM_INSTINCT)
+	if (batch.pszPlan || (batch.dims.size() > R5_BATCH_OVERRIDES))
+	{
+		fprintf(stderr, "r5batch: built without the Instinct Planner, set R5_INSTINCT_DIR to run plans\n");
+		return 1;
+	}
+#endif
+	if (pszArena)
+	{
+		if (!arena.load(pszArena))
+		{
+			fprintf(stderr, "r5batch: cannot load arena %s\n", pszArena);
+			return 1;
+		}
+		batch.pArena = &arena;
+	}
+	if (batch.pszPlan && (access(batch.pszPlan, R_OK) != 0))
+	{
+		fprintf(stderr, "r5batch: cannot load plan %s\n", batch.pszPlan);
+		return 1;
+	}
+
+	int nSets = batchSets(&batch);
+	int nTasks = nSets * batch.nRuns;
+	R5SimPool pool(nThreads);
+	batch.results.resize(nTasks);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.run(nTasks, batchTask, &batch);
+	double dWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printHeader(&batch, bRuns);
+	for (int i = 0; i < nSets; i++)
+	{
+		if (!bRuns)
+		{
+			printSet(&batch, i);
+			continue;
+		}
+		for (int j = 0; j < batch.nRuns; j++)
+		{
+			const R5BatchResultType *pResult = &batch.results[i * batch.nRuns + j];
+
+			printParams(&batch, i);
+			printf("%lu,%lu,%.0f,%ld,%lu\n", pResult->ulSeed, pResult->ulCollisionMs, pResult->dDistance,
+					pResult->lHumanMillis, pResult->ulPlanErrors);
+		}
+	}
+	fprintf(stderr, "r5batch: %d runs of %lu s on %d threads in %.2f s (%.0fx real time)\n", nTasks, batch.ulSeconds,
+			pool.getThreads(), dWall, (dWall > 0) ? nTasks * batch.ulSeconds / dWall : 0.0);
+	return 0;
+}
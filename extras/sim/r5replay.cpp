@@ -0,0 +1,135 @@
+// 	Library for Rover 5 Platform Simulator
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Replays a sensor trace recorded with REPORT trace on (see R5Trace.h) and writes the X records,
+// and with -y the Y records, the robot would have reported. The output can be compared with the
+// X and Y records in the original log, or with a replay through a different plan or library.
+//
+// r5replay [-p plan.inst] [-r plan rate] [-l loop uS] [-m smoothing] [-y] [-b] trace.log
+//
+// The plan rate and loop time should be those of the run that made the trace. With -p the plan is
+// loaded into the Instinct Planner, which needs the host build to have been given R5_INSTINCT_DIR.
+// Otherwise the simulator's wander behaviour is used. -b writes the records as binary telemetry
+// frames, see R5Telemetry.h, as the robot does with REPORT binary on.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanInterface.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+#include "R5SimWander.h"
+#include "R5SimReplay.h"
+#if defined(R5_SIM_INSTINCT)
+#include "Instinct.h"
+#include "R5SimInstinct.h"
+#endif
+
+int main(int argc, char *argv[])
+{
+	const char *pszPlan = 0;
+	unsigned int uiPlanRate = 10;
+	unsigned long ulLoopMicros = R5_SIM_LOOP_US;
+	unsigned int uiSmoothing = 10;
+	unsigned char bHeadMatrix = false;
+	unsigned char bBinary = false;
+	int nOpt;
+
+	while ((nOpt = getopt(argc, argv, "p:r:l:m:yb")) != -1)
+	{
+		switch (nOpt)
+		{
+			case 'p': pszPlan = optarg; break;
+			case 'r': uiPlanRate = (unsigned int)strtoul(optarg, 0, 0); break;
+			case 'l': ulLoopMicros = strtoul(optarg, 0, 0); break;
+			case 'm': uiSmoothing = (unsigned int)strtoul(optarg, 0, 0); break;
+			case 'y': bHeadMatrix = true; break;
+			case 'b': bBinary = true; break;
+			default:
+				fprintf(stderr, "usage: r5replay [-p plan.inst] [-r plan rate] [-l loop uS] [-m smoothing] [-y] [-b] trace.log\n");
+				return 2;
+		}
+	}
+	if (optind != (argc - 1))
+	{
+		fprintf(stderr, "usage: r5replay [-p plan.inst] [-r plan rate] [-l loop uS] [-m smoothing] [-y] [-b] trace.log\n");
+		return 2;
+	}
+
+	R5SimReplay robot((unsigned char)uiSmoothing);
+	if (!robot.load(argv[optind]))
+	{
+		fprintf(stderr, "r5replay: no trace records in %s\n", argv[optind]);
+		return 1;
+	}
+	R5SimLog log(stdout, &robot);
+	robot.setLoopMicros(ulLoopMicros);
+	robot.setPlanRate(uiPlanRate);
+	robot.setReport(&log, bHeadMatrix);
+	R5Telemetry telemetry(&log);
+	if (bBinary)
+		robot.setTelemetry(&telemetry);
+
+	R5SimWander wander(&robot);
+#if defined(R5_SIM_INSTINCT)
+	R5SimPlanner plan(&robot);
+#endif
+
+	if (pszPlan)
+	{
+#if defined(R5_SIM_INSTINCT)
+		if (!plan.load(pszPlan))
+		{
+			fprintf(stderr, "r5replay: cannot load plan %s\n", pszPlan);
+			return 1;
+		}
+		robot.setPlanCallback(R5SimPlanner::runPlan, R5SimPlanner::processTimers, &plan);
+#else
+		fprintf(stderr, "r5replay: built without the Instinct Planner, set R5_INSTINCT_DIR to run plans\n");
+		return 1;
+#endif
+	}
+	else
+		robot.setPlanCallback(R5SimWander::runPlan, 0, &wander);
+
+	clock_t start = clock();
+	while (!robot.finished())
+		robot.step();
+	double dCpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+	double dSeconds = (robot.getEndMillis() - robot.getStartMillis()) / 1000.0;
+
+	fprintf(stderr, "replayed %lu records, %.1f s of trace in %.2f s (%.0fx real time)\n", robot.getRecords(), dSeconds, dCpu,
+			(dCpu > 0) ? dSeconds / dCpu : 0.0);
+	return 0;
+}
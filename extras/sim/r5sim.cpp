@@ -0,0 +1,161 @@
+// 	Library for Rover 5 Platform Simulator
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Runs the simulated robot faster than real time and reports what it did.
+//
+// r5sim [-a arena] [-p plan.inst] [-t seconds] [-r plan rate] [-l loop uS] [-s seed] [-v trace mS] [-T log]
+//
+// With -p the plan is loaded into the Instinct Planner, which needs the host build to have been
+// given R5_INSTINCT_DIR. Otherwise the robot wanders, avoiding obstacles using the same senses and actions.
+//
+// -T writes the log the robot would with REPORT sensors and trace on, the X and T records, which r5replay can play back.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanInterface.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+#include "R5SimWander.h"
+#include "R5SimReplay.h"
+#if defined(R5_SIM_INSTINCT)
+#include "Instinct.h"
+#include "R5SimInstinct.h"
+#endif
+
+int main(int argc, char *argv[])
+{
+	const char *pszArena = 0;
+	const char *pszPlan = 0;
+	unsigned long ulSeconds = 600;
+	unsigned int uiPlanRate = 10;
+	unsigned long ulLoopMicros = R5_SIM_LOOP_US;
+	unsigned long ulSeed = 1;
+	unsigned long ulTrace = 0;
+	const char *pszLog = 0;
+	int nOpt;
+
+	while ((nOpt = getopt(argc, argv, "a:p:t:r:l:s:v:T:")) != -1)
+	{
+		switch (nOpt)
+		{
+			case 'a': pszArena = optarg; break;
+			case 'p': pszPlan = optarg; break;
+			case 't': ulSeconds = strtoul(optarg, 0, 0); break;
+			case 'r': uiPlanRate = (unsigned int)strtoul(optarg, 0, 0); break;
+			case 'l': ulLoopMicros = strtoul(optarg, 0, 0); break;
+			case 's': ulSeed = strtoul(optarg, 0, 0); break;
+			case 'v': ulTrace = strtoul(optarg, 0, 0); break;
+			case 'T': pszLog = optarg; break;
+			default:
+				fprintf(stderr, "usage: r5sim [-a arena] [-p plan.inst] [-t seconds] [-r plan rate] [-l loop uS] [-s seed] [-v trace mS] [-T log]\n");
+				return 2;
+		}
+	}
+
+	R5SimWorld world;
+	if (!pszArena)
+		world.loadDefault();
+	else if (!world.load(pszArena))
+	{
+		fprintf(stderr, "r5sim: cannot load arena %s\n", pszArena);
+		return 1;
+	}
+
+	R5SimRobot robot(&world);
+	robot.setLoopMicros(ulLoopMicros);
+	robot.setPlanRate(uiPlanRate);
+	robot.setSeed(ulSeed);
+
+	FILE *pLog = 0;
+	if (pszLog && !(pLog = fopen(pszLog, "w")))
+	{
+		fprintf(stderr, "r5sim: cannot write log %s\n", pszLog);
+		return 1;
+	}
+	R5SimLog log(pLog, &robot);
+	R5Trace trace(&log, robot.getSensors(), robot.getMotors(), robot.getRanger(), robot.getPIR());
+	if (pLog)
+	{
+		trace.setMotorInterval(0);
+		trace.setEnable(true);
+		robot.setTrace(&trace);
+		robot.setReport(&log);
+	}
+
+	R5SimWander wander(&robot);
+#if defined(R5_SIM_INSTINCT)
+	R5SimPlanner plan(&robot);
+#endif
+
+	if (pszPlan)
+	{
+#if defined(R5_SIM_INSTINCT)
+		if (!plan.load(pszPlan))
+		{
+			fprintf(stderr, "r5sim: cannot load plan %s\n", pszPlan);
+			return 1;
+		}
+		robot.setPlanCallback(R5SimPlanner::runPlan, R5SimPlanner::processTimers, &plan);
+#else
+		fprintf(stderr, "r5sim: built without the Instinct Planner, set R5_INSTINCT_DIR to run plans\n");
+		return 1;
+#endif
+	}
+	else
+		robot.setPlanCallback(R5SimWander::runPlan, 0, &wander);
+
+	clock_t start = clock();
+	unsigned long ulNextTrace = 0;
+	while (robot.getMillis() < ulSeconds * 1000UL)
+	{
+		robot.step();
+		if (ulTrace && (robot.getMillis() >= ulNextTrace))
+		{
+			printf("%lu %.0f %.0f %.1f\n", robot.getMillis(), robot.getX(), robot.getY(), robot.getHeading());
+			ulNextTrace += ulTrace;
+		}
+	}
+	double dCpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	R5PoseType pose;
+	robot.getMotors()->getPose(&pose);
+	printf("simulated %lu s in %.2f s (%.0fx real time)\n", ulSeconds, dCpu, (dCpu > 0) ? ulSeconds / dCpu : 0.0);
+	printf("driven %.0f mm, %lu mS against obstacles\n", robot.getDistance(), robot.getCollisions() * R5_SIM_STEP_US / 1000UL);
+	printf("true pose %.0f %.0f %.1f, odometry %ld %ld %.2f\n", robot.getX(), robot.getY(), robot.getHeading(),
+			pose.lX, pose.lY, pose.nHeading / 100.0);
+	if (pLog)
+		fclose(pLog);
+	return 0;
+}
@@ -0,0 +1,209 @@
+// 	Library for Rover 5 Platform Telemetry Decoder
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include <stdio.h>
+#include "R5Crc.h"
+#include "R5Output.h"
+#include "R5Telemetry.h"
+#include "R5TelemetryDecoder.h"
+
+R5TelemetryDecoder::R5TelemetryDecoder()
+{
+	R5TelemetryStateType state;
+
+	state.bSynced = false;
+	state.bSequence = 0;
+	state.ulMillis = 0;
+	_states.assign(R5_TELEMETRY_TYPES, state);
+	_bInFrame = false;
+	_message.bType = 0;
+	_message.bKey = false;
+	_message.ulMillis = 0;
+	_ulFrames = _ulBadFrames = _ulUnsynced = _ulGaps = _ulFrameBytes = _ulTextBytes = 0;
+}
+
+// a zero starts a frame, and the next zero after some bytes ends it. Between frames bytes are text
+int R5TelemetryDecoder::addByte(const unsigned char bByte)
+{
+	if (!bByte)
+	{
+		_ulFrameBytes++;
+		if (!_bInFrame)
+		{
+			_bInFrame = true;
+			_frame.clear();
+			return R5_DECODE_NONE;
+		}
+		if (_frame.empty()) // two zeros together, the second starts the frame
+			return R5_DECODE_NONE;
+		_ulFrameBytes += _frame.size();
+		unsigned char bGood = _decode();
+		_frame.clear();
+		if (!bGood)
+		{
+			// the frame might have been a delta, so no delta can be trusted until the next key
+			for (size_t i = 0; i < _states.size(); i++)
+				_states[i].bSynced = false;
+			_ulBadFrames++;
+			return R5_DECODE_NONE; // stay in a frame, in case this zero starts the next one
+		}
+		_bInFrame = false;
+		_ulFrames++;
+		return (_message.bType ? R5_DECODE_MESSAGE : R5_DECODE_NONE);
+	}
+	if (_bInFrame)
+	{
+		_frame.push_back(bByte);
+		return R5_DECODE_NONE;
+	}
+
+	_ulTextBytes++;
+	if (bByte == '\n')
+	{
+		_strText = _strLine;
+		if (!_strText.empty() && (_strText[_strText.size() - 1] == '\r'))
+			_strText.erase(_strText.size() - 1);
+		_strLine.clear();
+		return R5_DECODE_TEXT;
+	}
+	_strLine += (char)bByte;
+	return R5_DECODE_NONE;
+}
+
+unsigned char R5TelemetryDecoder::_getVarint(size_t *pnPos, unsigned long *pulValue)
+{
+	unsigned long ulValue = 0;
+	int nShift = 0;
+
+	while (*pnPos < _decoded.size())
+	{
+		unsigned char bByte = _decoded[(*pnPos)++];
+		ulValue |= (unsigned long)(bByte & 0x7F) << nShift;
+		if (!(bByte & 0x80))
+		{
+			*pulValue = ulValue;
+			return true;
+		}
+		nShift += 7;
+		if (nShift > 56)
+			break;
+	}
+	return false;
+}
+
+// undo COBS, check the CRC and apply the message to the state of its type. Returns false for a
+// bad frame. A good frame that can't be used, a delta without its key or after a gap in the
+// sequence, leaves _message.bType 0
+unsigned char R5TelemetryDecoder::_decode(void)
+{
+	size_t nPos = 0;
+
+	_decoded.clear();
+	while (nPos < _frame.size())
+	{
+		unsigned char bCode = _frame[nPos++];
+		if (nPos + bCode - 1 > _frame.size())
+			return false;
+		_decoded.insert(_decoded.end(), _frame.begin() + nPos, _frame.begin() + nPos + bCode - 1);
+		nPos += bCode - 1;
+		if (nPos < _frame.size())
+			_decoded.push_back(0);
+	}
+	if (_decoded.size() < 4)
+		return false;
+
+	unsigned int uiCRC = R5_CRC16_INIT;
+	size_t nLength = _decoded.size() - 2;
+	for (size_t i = 0; i < nLength; i++)
+		uiCRC = crc16Update(uiCRC, _decoded[i]);
+	if (uiCRC != (_decoded[nLength] | ((unsigned int)_decoded[nLength + 1] << 8)))
+		return false;
+	_decoded.resize(nLength);
+
+	unsigned char bType = _decoded[0] & ~R5_TELEMETRY_KEY;
+	unsigned char bKey = (_decoded[0] & R5_TELEMETRY_KEY) ? true : false;
+	unsigned char bSequence = _decoded[1];
+	unsigned long ulMillis, ulFields, ulField;
+	nPos = 2;
+	if (!bType || (bType > R5_TELEMETRY_TYPES) || !_getVarint(&nPos, &ulMillis))
+		return false;
+
+	R5TelemetryStateType *pState = &_states[bType - 1];
+	size_t nMask = nPos;
+	_message.bType = 0;
+	if (bKey)
+	{
+		if (!_getVarint(&nPos, &ulFields) || (ulFields > R5_TELEMETRY_FIELDS))
+			return false;
+		_message.fields.assign(ulFields, 0);
+	}
+	else
+	{
+		// a message of this type went missing, so this delta is from values we don't have
+		if (pState->bSynced && (bSequence != (unsigned char)(pState->bSequence + 1)))
+		{
+			pState->bSynced = false;
+			_ulGaps++;
+		}
+		if (!pState->bSynced)
+		{
+			_ulUnsynced++;
+			return true;
+		}
+		ulFields = pState->fields.size();
+		nPos += (ulFields + 7) / 8;
+		if (nPos > _decoded.size())
+			return false;
+		_message.fields = pState->fields;
+	}
+	for (size_t i = 0; i < ulFields; i++)
+	{
+		if (!bKey && !(_decoded[nMask + (i / 8)] & (1 << (i % 8))))
+			continue;
+		if (!_getVarint(&nPos, &ulField))
+			return false;
+		long lField = (ulField & 1) ? ~(long)(ulField >> 1) : (long)(ulField >> 1);
+		_message.fields[i] += lField;
+	}
+	if (nPos != _decoded.size())
+		return false;
+
+	_message.bType = bType;
+	_message.bKey = bKey;
+	_message.ulMillis = bKey ? ulMillis : pState->ulMillis + ulMillis;
+	pState->bSynced = true;
+	pState->bSequence = bSequence;
+	pState->ulMillis = _message.ulMillis;
+	pState->fields = _message.fields;
+	return true;
+}
+
+std::string R5TelemetryDecoder::formatRecord(const R5TelemetryMessageType *pMessage)
+{
+	char szField[24];
+	std::string strRecord;
+
+	snprintf(szField, sizeof(szField), "%010lu %c", pMessage->ulMillis, R5_TELEMETRY_LETTERS[pMessage->bType - 1]);
+	strRecord = szField;
+	for (size_t i = 0; i < pMessage->fields.size(); i++)
+	{
+		snprintf(szField, sizeof(szField), " %ld", pMessage->fields[i]);
+		strRecord += szField;
+	}
+	return strRecord;
+}
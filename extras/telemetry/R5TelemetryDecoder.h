@@ -0,0 +1,87 @@
+// 	Library for Rover 5 Platform Telemetry Decoder
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Separates the binary telemetry frames of src/R5Telemetry.h from the text lines around them, and
+// turns the frames back into the X and Y records the robot sends in text mode, so tools that read
+// robot logs see the same thing either way.
+//
+// A frame that fails its CRC is dropped, and so are delta messages until the next key message of
+// their type. A gap in the sequence numbers of a type, a frame that never arrived, is treated the
+// same way for that type. Joining a stream part way through costs at most one frame, as the zero that ends a bad
+// frame is taken to start the next one.
+//
+#ifndef _R5TELEMETRYDECODER_H_
+#define _R5TELEMETRYDECODER_H_
+
+#include <string>
+#include <vector>
+
+// what addByte() returns
+#define R5_DECODE_NONE		0
+#define R5_DECODE_TEXT		1	// a line of text, see getText()
+#define R5_DECODE_MESSAGE	2	// a telemetry message, see getMessage()
+
+typedef struct {
+	unsigned char bType;	// R5_TELEMETRY_SENSORS to R5_TELEMETRY_PIR
+	unsigned char bKey;
+	unsigned long ulMillis;
+	std::vector<long> fields;
+} R5TelemetryMessageType;
+
+typedef struct {
+	unsigned char bSynced;
+	unsigned char bSequence;	// of the last message
+	unsigned long ulMillis;
+	std::vector<long> fields;
+} R5TelemetryStateType;
+
+class R5TelemetryDecoder {
+public:
+	R5TelemetryDecoder();
+	int addByte(const unsigned char bByte);
+	const std::string &getText(void) {return _strText;};	// without the newline
+	const R5TelemetryMessageType *getMessage(void) {return &_message;};
+	static std::string formatRecord(const R5TelemetryMessageType *pMessage); // "0000012345 X ..." as the robot writes it
+
+	unsigned long getFrames(void) {return _ulFrames;};
+	unsigned long getBadFrames(void) {return _ulBadFrames;};
+	unsigned long getUnsynced(void) {return _ulUnsynced;};		// deltas dropped waiting for a key message
+	unsigned long getGaps(void) {return _ulGaps;};				// times the sequence skipped, frames lost
+	unsigned long getFrameBytes(void) {return _ulFrameBytes;};	// including the zeros
+	unsigned long getTextBytes(void) {return _ulTextBytes;};
+
+private:
+	unsigned char _decode(void);
+	unsigned char _getVarint(size_t *pnPos, unsigned long *pulValue);
+
+	unsigned char _bInFrame;
+	std::vector<unsigned char> _frame;
+	std::vector<unsigned char> _decoded;
+	std::string _strLine;
+	std::string _strText;
+	R5TelemetryMessageType _message;
+	std::vector<R5TelemetryStateType> _states;
+	unsigned long _ulFrames;
+	unsigned long _ulBadFrames;
+	unsigned long _ulUnsynced;
+	unsigned long _ulGaps;
+	unsigned long _ulFrameBytes;
+	unsigned long _ulTextBytes;
+};
+
+#endif // _R5TELEMETRYDECODER_H_
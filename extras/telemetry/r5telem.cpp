@@ -0,0 +1,102 @@
+// 	Library for Rover 5 Platform Telemetry Decoder
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Reads a capture of the robot's output, with REPORT binary telemetry on, and writes it out as
+// text: text lines as they are and telemetry frames as the X and Y records they replace. The
+// output is the log the robot would have written in text mode, for r5log and the other tools.
+//
+// r5telem [-s] [capture]
+//
+// With no capture, or -, stdin is read. -s writes to stderr how many frames there were and how
+// many bytes they took against the text records they stand for.
+//
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "R5TelemetryDecoder.h"
+
+int main(int argc, char *argv[])
+{
+	unsigned char bStats = false;
+	int nOpt;
+
+	while ((nOpt = getopt(argc, argv, "s")) != -1)
+	{
+		switch (nOpt)
+		{
+			case 's': bStats = true; break;
+			default:
+				fprintf(stderr, "usage: r5telem [-s] [capture]\n");
+				return 2;
+		}
+	}
+	if (argc - optind > 1)
+	{
+		fprintf(stderr, "usage: r5telem [-s] [capture]\n");
+		return 2;
+	}
+
+	FILE *pFile = stdin;
+	if ((optind < argc) && strcmp(argv[optind], "-") && !(pFile = fopen(argv[optind], "rb")))
+	{
+		fprintf(stderr, "r5telem: cannot read %s\n", argv[optind]);
+		return 1;
+	}
+
+	R5TelemetryDecoder decoder;
+	unsigned char bBuffer[65536];
+	unsigned long ulRecordBytes = 0;
+	unsigned long ulMessages = 0;
+	unsigned long ulKeys = 0;
+	size_t nRead;
+	while ((nRead = fread(bBuffer, 1, sizeof(bBuffer), pFile)) > 0)
+	{
+		for (size_t i = 0; i < nRead; i++)
+		{
+			switch (decoder.addByte(bBuffer[i]))
+			{
+			case R5_DECODE_TEXT:
+				printf("%s\n", decoder.getText().c_str());
+				break;
+			case R5_DECODE_MESSAGE:
+				{
+					std::string strRecord = R5TelemetryDecoder::formatRecord(decoder.getMessage());
+					printf("%s\n", strRecord.c_str());
+					ulRecordBytes += strRecord.size() + 1;
+					ulMessages++;
+					ulKeys += decoder.getMessage()->bKey;
+				}
+				break;
+			}
+		}
+	}
+	if (pFile != stdin)
+		fclose(pFile);
+
+	if (bStats)
+	{
+		fprintf(stderr, "%lu frames, %lu key, %lu bad, %lu lost, %lu deltas without a key\n", decoder.getFrames(), ulKeys,
+				decoder.getBadFrames(), decoder.getGaps(), decoder.getUnsynced());
+		fprintf(stderr, "%lu bytes of frames for %lu bytes of records, %.1f bytes a frame, %.2fx smaller, %lu bytes of text\n",
+				decoder.getFrameBytes(), ulRecordBytes, ulMessages ? (double)decoder.getFrameBytes() / ulMessages : 0.0,
+				decoder.getFrameBytes() ? (double)ulRecordBytes / decoder.getFrameBytes() : 0.0, decoder.getTextBytes());
+	}
+	return 0;
+}
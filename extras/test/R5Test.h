@@ -0,0 +1,72 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// The checks used by the host tests in extras/test. Each test is a program, r5test_<name>.cpp,
+// that runs its checks against the host build and returns r5TestResult() from main(), which is
+// how ctest tells a pass from a fail. A failed check prints where it was and carries on, so one
+// run shows every failure.
+//
+#ifndef _R5TEST_H_
+#define _R5TEST_H_
+
+#include <stdio.h>
+#include <math.h>
+
+static unsigned long _ulR5TestChecks = 0;
+static unsigned long _ulR5TestFailures = 0;
+
+static inline unsigned char r5Check(const bool bPassed, const char *pszCheck, const char *pszFile, const int nLine)
+{
+	_ulR5TestChecks++;
+	if (!bPassed)
+	{
+		_ulR5TestFailures++;
+		printf("%s:%d: FAILED %s\n", pszFile, nLine, pszCheck);
+	}
+	return bPassed;
+}
+
+static inline unsigned char r5CheckEqual(const long lActual, const long lExpected, const char *pszActual, const char *pszFile, const int nLine)
+{
+	if (r5Check(lActual == lExpected, pszActual, pszFile, nLine))
+		return true;
+	printf("\tgot %ld, expected %ld\n", lActual, lExpected);
+	return false;
+}
+
+static inline unsigned char r5CheckNear(const double dActual, const double dExpected, const double dTolerance,
+			const char *pszActual, const char *pszFile, const int nLine)
+{
+	if (r5Check(fabs(dActual - dExpected) <= dTolerance, pszActual, pszFile, nLine))
+		return true;
+	printf("\tgot %g, expected %g +/- %g\n", dActual, dExpected, dTolerance);
+	return false;
+}
+
+#define R5_CHECK(x)					r5Check((x), #x, __FILE__, __LINE__)
+#define R5_CHECK_EQUAL(a, b)		r5CheckEqual((long)(a), (long)(b), #a " == " #b, __FILE__, __LINE__)
+#define R5_CHECK_NEAR(a, b, tol)	r5CheckNear((double)(a), (double)(b), (double)(tol), #a " ~ " #b, __FILE__, __LINE__)
+
+// the exit status for main()
+static inline int r5TestResult(void)
+{
+	printf("%lu checks, %lu failed\n", _ulR5TestChecks, _ulR5TestFailures);
+	return _ulR5TestFailures ? 1 : 0;
+}
+
+#endif // _R5TEST_H_
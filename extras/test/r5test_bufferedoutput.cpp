@@ -0,0 +1,336 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5BufferedOutput: what each policy does when the buffer is full. Whatever the policy, every
+// record that reaches the sink must arrive whole and in order, including one that was part way
+// out when the buffer filled, and frames that hold a '\n'. Then when batches are sent.
+//
+#include <string>
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5BufferedOutput.h"
+#include "R5Test.h"
+
+#define TEST_BUFFER 128
+
+// a link with nRoom bytes free. With nRefill it frees that many more once full, as a UART sends on
+class TestSink : public Print {
+public:
+	virtual size_t write(uint8_t b) {bytes.push_back(b); nRoom--; return 1;};
+	using Print::write;
+	virtual int availableForWrite(void)
+	{
+		if (nRoom <= 0)
+			nRoom = nRefill;
+		return nRoom;
+	};
+
+	std::string bytes;
+	int nRoom = 0;
+	int nRefill = 0;
+};
+
+// the records in what the sink received. A frame is given as its bytes between the zeros
+static std::vector<std::string> records(const std::string &str, int *pnBroken)
+{
+	std::vector<std::string> recs;
+	size_t i = 0;
+
+	*pnBroken = 0;
+	while (i < str.size())
+	{
+		size_t nEnd;
+		if (!str[i])
+		{
+			nEnd = str.find('\0', i + 1);
+			if ((nEnd == std::string::npos) || (nEnd == i + 1))
+			{
+				(*pnBroken)++;
+				break;
+			}
+			recs.push_back("F" + str.substr(i + 1, nEnd - i - 1));
+		}
+		else
+		{
+			nEnd = str.find('\n', i);
+			if ((nEnd == std::string::npos) || (str.find('\0', i) < nEnd))
+			{
+				(*pnBroken)++;
+				break;
+			}
+			recs.push_back(str.substr(i + 11, nEnd - i - 11)); // without the timestamp
+		}
+		i = nEnd + 1;
+	}
+	return recs;
+}
+
+// a frame of nLength bytes between the zeros, with a '\n' in it
+static std::string frame(const char cTag, const int nLength)
+{
+	std::string str(nLength, cTag);
+	str[nLength / 2] = '\n';
+	return str;
+}
+
+static void outputFrame(R5BufferedOutput *pOut, const std::string &str)
+{
+	std::string strFrame = std::string(1, '\0') + str + std::string(1, '\0');
+	pOut->outputFrame((const unsigned char *)strFrame.data(), strFrame.size());
+}
+
+static void drainAll(R5BufferedOutput *pOut, TestSink *pSink)
+{
+	pSink->nRoom = 100000;
+	while (pOut->getUsed())
+		pOut->drain();
+}
+
+static void testUnbuffered(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestSink sink;
+	R5BufferedOutput out(&sink, 0, R5_OUTPUT_DROP_OLDEST, false);
+	int nBroken;
+
+	out.outputData("text");
+	outputFrame(&out, frame('a', 10));
+	std::vector<std::string> recs = records(sink.bytes, &nBroken);
+	R5_CHECK_EQUAL(out.getSize(), 0);
+	R5_CHECK_EQUAL(nBroken, 0);
+	R5_CHECK_EQUAL(recs.size(), 2);
+	R5_CHECK(sink.bytes.substr(0, 11) == "0000000000 ");
+	R5HalHost::setCurrent(0);
+}
+
+static void testDropNewest(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestSink sink;
+	R5BufferedOutput out(&sink, TEST_BUFFER, R5_OUTPUT_DROP_NEWEST, true);
+	int nBroken;
+
+	// 11 + 19 + 2 bytes each, so four fit
+	for (int i = 0; i < 6; i++)
+		out.outputData(i % 2 ? "odd record 12345678" : "even record 1234567");
+	R5_CHECK_EQUAL(out.getUsed(), 4 * 32);
+	R5_CHECK_EQUAL(out.getDropped(), 2);
+	R5_CHECK_EQUAL(out.getDroppedBytes(), 2 * 32);
+	R5_CHECK_EQUAL(out.getHighWater(), TEST_BUFFER);
+
+	// nothing larger than the buffer is ever kept
+	drainAll(&out, &sink);
+	outputFrame(&out, frame('x', TEST_BUFFER));
+	R5_CHECK_EQUAL(out.getUsed(), 0);
+	R5_CHECK_EQUAL(out.getDropped(), 3);
+
+	std::vector<std::string> recs = records(sink.bytes, &nBroken);
+	R5_CHECK_EQUAL(nBroken, 0);
+	if (R5_CHECK_EQUAL(recs.size(), 4))
+	{
+		R5_CHECK(recs[0] == "even record 1234567\r");
+		R5_CHECK(recs[3] == "odd record 12345678\r");
+	}
+	R5HalHost::setCurrent(0);
+}
+
+static void testDropOldest(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestSink sink;
+	R5BufferedOutput out(&sink, TEST_BUFFER, R5_OUTPUT_DROP_OLDEST, false);
+	int nBroken;
+
+	// 40 bytes each. The fourth drops the first
+	outputFrame(&out, frame('a', 38));
+	outputFrame(&out, frame('b', 38));
+	outputFrame(&out, frame('c', 38));
+	outputFrame(&out, frame('d', 38));
+	R5_CHECK_EQUAL(out.getDropped(), 1);
+	R5_CHECK_EQUAL(out.getUsed(), 3 * 40);
+
+	// only the leading zero of b goes out, then e needs the room of two records. c and d give way, b stays
+	sink.nRoom = 1;
+	out.drain();
+	outputFrame(&out, frame('e', 78));
+	R5_CHECK_EQUAL(out.getDropped(), 3);
+	R5_CHECK_EQUAL(out.getUsed(), 39 + 80);
+
+	// the rest of b goes out, then half of e, past its '\n'. f takes the room they leave
+	sink.nRoom = 39 + 40;
+	out.drain();
+	out.drain();
+	R5_CHECK_EQUAL(out.getUsed(), 40);
+	outputFrame(&out, frame('f', 78));
+	R5_CHECK_EQUAL(out.getDropped(), 3);
+
+	// g needs the room of f. The rest of e stays
+	outputFrame(&out, frame('g', 70));
+	R5_CHECK_EQUAL(out.getDropped(), 4);
+	R5_CHECK_EQUAL(out.getUsed(), 40 + 72);
+
+	// text and frames together
+	drainAll(&out, &sink);
+	for (int i = 0; i < 10; i++)
+	{
+		out.outputData("a text record");
+		outputFrame(&out, frame('h', 20));
+		sink.nRoom = 7;
+		out.drain();
+	}
+	drainAll(&out, &sink);
+
+	std::vector<std::string> recs = records(sink.bytes, &nBroken);
+	R5_CHECK_EQUAL(nBroken, 0);
+	if (R5_CHECK(recs.size() >= 4))
+	{
+		R5_CHECK(recs[0] == "F" + frame('b', 38));
+		R5_CHECK(recs[1] == "F" + frame('e', 78));
+		R5_CHECK(recs[2] == "F" + frame('g', 70));
+		R5_CHECK(recs.back() == "F" + frame('h', 20));
+	}
+	for (size_t i = 3; i < recs.size(); i++)
+		R5_CHECK((recs[i] == "a text record") || (recs[i] == "F" + frame('h', 20)));
+	R5_CHECK_EQUAL(recs.size() + out.getDropped(), 7 + 20);
+	R5HalHost::setCurrent(0);
+}
+
+static void testBlock(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestSink sink;
+	R5BufferedOutput out(&sink, TEST_BUFFER, R5_OUTPUT_BLOCK, false);
+	int nBroken;
+
+	// the sink takes a few bytes at a time, as a UART would while writing waits on it
+	sink.nRefill = 5;
+	for (int i = 0; i < 50; i++)
+	{
+		out.outputData("a record that the buffer must not lose");
+		outputFrame(&out, frame('z', 30));
+	}
+	R5_CHECK_EQUAL(out.getDropped(), 0);
+	R5_CHECK(out.getUsed() <= TEST_BUFFER);
+	drainAll(&out, &sink);
+	std::vector<std::string> recs = records(sink.bytes, &nBroken);
+	R5_CHECK_EQUAL(nBroken, 0);
+	R5_CHECK_EQUAL(recs.size(), 100);
+	R5HalHost::setCurrent(0);
+}
+
+// 11 + 13 + 1 bytes
+#define TEST_RECORD "a text record"
+#define TEST_RECORD_BYTES 25
+
+static void testBatch(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestSink sink;
+	R5BufferedOutput out(&sink, 256, R5_OUTPUT_DROP_OLDEST, false);
+	int nBroken;
+
+	out.setBatch(64, 20);
+	sink.nRefill = 1000;
+
+	// held back until there are enough bytes for a batch, then all of them go
+	out.outputData(TEST_RECORD);
+	out.outputData(TEST_RECORD);
+	out.drain();
+	R5_CHECK_EQUAL(sink.bytes.size(), 0);
+	out.outputData(TEST_RECORD);
+	out.drain();
+	R5_CHECK_EQUAL(sink.bytes.size(), 3 * TEST_RECORD_BYTES);
+	R5_CHECK_EQUAL(out.getBatches(), 1);
+	R5_CHECK_EQUAL(out.getBatchedBytes(), 3 * TEST_RECORD_BYTES);
+	R5_CHECK_EQUAL(out.getLateBatches(), 0);
+
+	// or until the oldest has waited long enough
+	out.outputData(TEST_RECORD);
+	host.advanceMicros(19000);
+	out.drain();
+	R5_CHECK_EQUAL(out.getUsed(), TEST_RECORD_BYTES);
+	host.advanceMicros(1000);
+	out.drain();
+	R5_CHECK_EQUAL(out.getUsed(), 0);
+	R5_CHECK_EQUAL(out.getBatches(), 2);
+	R5_CHECK_EQUAL(out.getLateBatches(), 1);
+
+	// or flush() is called
+	out.outputData(TEST_RECORD);
+	out.flush();
+	R5_CHECK_EQUAL(out.getUsed(), 0);
+	R5_CHECK_EQUAL(out.getBatches(), 3);
+	R5_CHECK_EQUAL(out.getLateBatches(), 1);
+
+	// a batch the sink can't take at once goes ahead of what is written after it, which waits for its own batch
+	sink.nRefill = 0;
+	for (int i = 0; i < 3; i++)
+		out.outputData(TEST_RECORD);
+	sink.nRoom = 30;
+	out.drain();
+	out.outputData(TEST_RECORD);
+	sink.nRoom = 30;
+	out.drain();
+	sink.nRoom = 30;
+	out.drain();
+	R5_CHECK_EQUAL(sink.bytes.size(), 8 * TEST_RECORD_BYTES);
+	R5_CHECK_EQUAL(out.getUsed(), TEST_RECORD_BYTES);
+	R5_CHECK_EQUAL(out.getBatches(), 4);
+
+	std::vector<std::string> recs = records(sink.bytes, &nBroken);
+	R5_CHECK_EQUAL(nBroken, 0);
+	R5_CHECK_EQUAL(recs.size(), 8);
+	R5HalHost::setCurrent(0);
+}
+
+// without batching, a drain() that finishes sending one lot goes on to send what was written since
+static void testNoBatch(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestSink sink;
+	R5BufferedOutput out(&sink, 256, R5_OUTPUT_DROP_OLDEST, false);
+
+	out.outputData(TEST_RECORD);
+	sink.nRoom = 10;
+	out.drain();
+	out.outputData(TEST_RECORD);
+	out.outputData(TEST_RECORD);
+	sink.nRoom = 100;
+	out.drain();
+	R5_CHECK_EQUAL(out.getUsed(), 0);
+	R5_CHECK_EQUAL(sink.bytes.size(), 3 * TEST_RECORD_BYTES);
+	R5HalHost::setCurrent(0);
+}
+
+int main(int argc, char *argv[])
+{
+	testUnbuffered();
+	testDropNewest();
+	testDropOldest();
+	testBlock();
+	testBatch();
+	testNoBatch();
+	return r5TestResult();
+}
@@ -0,0 +1,145 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5FixedMath against libm, holding it to the error bounds given in R5FixedMath.h: sines and
+// cosines every hundredth of a degree round the circle, and atan2 of vectors at every hundredth
+// of a degree for a range of lengths.
+//
+#include <math.h>
+#include "R5Hal.h"
+#include "R5FixedMath.h"
+#include "R5Test.h"
+
+#define TEST_RAD(c)	((c) * M_PI / 18000.0)	// hundredths of a degree to radians
+
+// the largest error seen, and where
+typedef struct {
+	double dMax;
+	long lAt;
+} TestErrorType;
+
+static void worst(TestErrorType *pError, const double dError, const long lAt)
+{
+	if (fabs(dError) > pError->dMax)
+	{
+		pError->dMax = fabs(dError);
+		pError->lAt = lAt;
+	}
+}
+
+static void report(const char *pszName, const TestErrorType *pError, const double dBound)
+{
+	printf("%-12s max error %.3f at %ld, bound %.2f\n", pszName, pError->dMax, pError->lAt, dBound);
+	R5_CHECK(pError->dMax <= dBound);
+}
+
+static void testSinCos(void)
+{
+	TestErrorType sin1 = {0, 0}, cos1 = {0, 0}, sin100 = {0, 0}, cos100 = {0, 0};
+
+	for (int nDegrees = 0; nDegrees < 360; nDegrees++)
+	{
+		worst(&sin1, R5FixedMath::sinDeg(nDegrees) - sin(TEST_RAD(nDegrees * 100.0)) * R5_FM_ONE, nDegrees);
+		worst(&cos1, R5FixedMath::cosDeg(nDegrees) - cos(TEST_RAD(nDegrees * 100.0)) * R5_FM_ONE, nDegrees);
+	}
+	for (long lCentiDegrees = 0; lCentiDegrees < 36000L; lCentiDegrees++)
+	{
+		worst(&sin100, R5FixedMath::sinDeg100(lCentiDegrees) - sin(TEST_RAD(lCentiDegrees)) * R5_FM_ONE, lCentiDegrees);
+		worst(&cos100, R5FixedMath::cosDeg100(lCentiDegrees) - cos(TEST_RAD(lCentiDegrees)) * R5_FM_ONE, lCentiDegrees);
+	}
+	// in LSBs of Q14
+	report("sinDeg", &sin1, 0.5);
+	report("cosDeg", &cos1, 0.5);
+	report("sinDeg100", &sin100, 1.4);
+	report("cosDeg100", &cos100, 1.4);
+
+	// angles outside 0 - 359.99 wrap, either way
+	for (int nDegrees = -720; nDegrees <= 720; nDegrees += 45)
+	{
+		R5_CHECK_EQUAL(R5FixedMath::sinDeg(nDegrees), R5FixedMath::sinDeg((nDegrees + 720) % 360));
+		R5_CHECK_EQUAL(R5FixedMath::cosDeg(nDegrees), R5FixedMath::cosDeg((nDegrees + 720) % 360));
+		R5_CHECK_EQUAL(R5FixedMath::sinDeg100(nDegrees * 100L + 37), R5FixedMath::sinDeg100(((nDegrees + 720) % 360) * 100L + 37));
+		R5_CHECK_EQUAL(R5FixedMath::cosDeg100(nDegrees * 100L + 37), R5FixedMath::cosDeg100(((nDegrees + 720) % 360) * 100L + 37));
+	}
+}
+
+// the error in hundredths of a degree, taking the short way round at +-180
+static double angleError(const int nAngle, const double dExpected)
+{
+	double dError = nAngle - dExpected;
+
+	if (dError > 18000.0)
+		dError -= 36000.0;
+	else if (dError < -18000.0)
+		dError += 36000.0;
+	return dError;
+}
+
+static void testAtan2(void)
+{
+	static const int nLengths[] = {100, 1000, 4000, 16384, 32767};
+	TestErrorType atan100 = {0, 0}, atan1 = {0, 0};
+
+	for (unsigned int i = 0; i < sizeof(nLengths) / sizeof(nLengths[0]); i++)
+	{
+		for (long lCentiDegrees = 0; lCentiDegrees < 36000L; lCentiDegrees++)
+		{
+			// the vector as integers, and what libm makes of those integers
+			int nX = (int)lround(nLengths[i] * cos(TEST_RAD(lCentiDegrees)));
+			int nY = (int)lround(nLengths[i] * sin(TEST_RAD(lCentiDegrees)));
+			double dExpected = atan2((double)nY, (double)nX) * 18000.0 / M_PI;
+			int nAngle = R5FixedMath::atan2Deg100(nY, nX);
+
+			R5_CHECK((nAngle >= -18000) && (nAngle <= 18000));
+			worst(&atan100, angleError(nAngle, dExpected), lCentiDegrees);
+			worst(&atan1, angleError(R5FixedMath::atan2Deg(nY, nX) * 100, dExpected) / 100.0, lCentiDegrees);
+		}
+	}
+	report("atan2Deg100", &atan100, 1.4);	// hundredths of a degree
+	report("atan2Deg", &atan1, 0.52);		// degrees
+
+	// the axes exactly, and nothing at all
+	R5_CHECK_EQUAL(R5FixedMath::atan2Deg100(0, 1000), 0);
+	R5_CHECK_EQUAL(R5FixedMath::atan2Deg100(1000, 0), 9000);
+	R5_CHECK_EQUAL(R5FixedMath::atan2Deg100(0, -1000), 18000);
+	R5_CHECK_EQUAL(R5FixedMath::atan2Deg100(-1000, 0), -9000);
+	R5_CHECK_EQUAL(R5FixedMath::atan2Deg100(0, 0), 0);
+	R5_CHECK_EQUAL(R5FixedMath::atan2Deg100(-32768, -32768), -13500);
+}
+
+static void testSqrt(void)
+{
+	static const unsigned long ulValues[] = {0, 1, 2, 3, 4, 15, 16, 17, 65535, 65536, 1000000, 4294836225UL, 4294967295UL};
+
+	for (unsigned int i = 0; i < sizeof(ulValues) / sizeof(ulValues[0]); i++)
+	{
+		unsigned long ulRoot = R5FixedMath::sqrtL(ulValues[i]);
+		R5_CHECK(ulRoot * ulRoot <= ulValues[i]);
+		R5_CHECK((ulRoot + 1) * (ulRoot + 1) > ulValues[i]);
+	}
+	for (unsigned long ul = 0; ul < 100000UL; ul++)
+		R5_CHECK_EQUAL(R5FixedMath::sqrtL(ul), (unsigned long)floor(sqrt((double)ul)));
+}
+
+int main(int argc, char *argv[])
+{
+	testSinCos();
+	testAtan2();
+	testSqrt();
+	return r5TestResult();
+}
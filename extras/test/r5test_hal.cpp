@@ -0,0 +1,93 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// The host backend: the virtual clock, scheduled inputs, pin change callbacks and interrupts
+// held back while disabled, which the other tests depend on.
+//
+#include "R5Hal.h"
+#include "R5Test.h"
+
+typedef struct {
+	int nCalls;
+	unsigned long ulMicros;
+} PinCountType;
+
+static void countPinChange(void *pContext)
+{
+	PinCountType *pCount = (PinCountType *)pContext;
+
+	pCount->nCalls++;
+	pCount->ulMicros = micros();
+}
+
+static void testClock(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+
+	R5_CHECK_EQUAL(micros(), 0);
+	host.advanceMicros(1500);
+	R5_CHECK_EQUAL(micros(), 1500);
+	R5_CHECK_EQUAL(millis(), 1);
+	delay(10);
+	R5_CHECK_EQUAL(millis(), 11);
+	R5_CHECK_EQUAL(micros(), 11500);
+	R5HalHost::setCurrent(0);
+}
+
+static void testPinChange(void)
+{
+	R5HalHost host;
+	PinCountType count = {0, 0};
+	R5HalHost::setCurrent(&host);
+
+	// only the pins with an external interrupt can be attached
+	R5_CHECK(!R5Hal::attachPinChange(8, countPinChange, &count));
+	R5_CHECK(R5Hal::attachPinChange(18, countPinChange, &count));
+
+	// a scheduled change fires at its own time, not when the clock is next read
+	R5_CHECK(host.scheduleDigitalInput(18, HIGH, 250));
+	R5_CHECK(host.scheduleDigitalInput(18, LOW, 400));
+	host.advanceMicros(1000);
+	R5_CHECK_EQUAL(count.nCalls, 2);
+	R5_CHECK_EQUAL(count.ulMicros, 400);
+	R5_CHECK_EQUAL(micros(), 1000);
+
+	// the same level again is not a change
+	host.setDigitalInput(18, LOW);
+	R5_CHECK_EQUAL(count.nCalls, 2);
+
+	// held back while interrupts are off, then run when they come back on
+	noInterrupts();
+	host.setDigitalInput(18, HIGH);
+	R5_CHECK_EQUAL(count.nCalls, 2);
+	interrupts();
+	R5_CHECK_EQUAL(count.nCalls, 3);
+
+	R5Hal::detachPinChange(18);
+	host.setDigitalInput(18, LOW);
+	R5_CHECK_EQUAL(count.nCalls, 3);
+	R5HalHost::setCurrent(0);
+}
+
+int main(int argc, char *argv[])
+{
+	testClock();
+	testPinChange();
+	return r5TestResult();
+}
@@ -0,0 +1,221 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5PlanImage: extras/Plan6.inst compiled by R5PlanCompiler and loaded as an image must give the
+// planner the same nodes, plan ID and names as the PLAN and PELEM lines would. A damaged, short
+// or stalled image must fail with the right error and leave no part of a plan behind.
+//
+// Only built when the host build is given R5_INSTINCT_DIR.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanInterface.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5PlanIds.h"
+#include "R5SimWorld.h"
+#include "R5SimRobot.h"
+#include "Instinct.h"
+#include "R5SimInstinct.h"
+#include "R5PlanImage.h"
+#include "R5PlanCompiler.h"
+#include "R5Test.h"
+
+#define TEST_PLAN		"extras/Plan6.inst"
+#define TEST_PLAN_ID	6
+#define TEST_NAMES		1500	// as Robot_Instinct.ino
+
+static unsigned char compilePlan(std::vector<unsigned char> *pImage, R5PlanCompiler *pCompiler)
+{
+	if (!R5_CHECK(pCompiler->parseFile(TEST_PLAN)) || !R5_CHECK(pCompiler->check()))
+		return false;
+	pCompiler->setPlanID(TEST_PLAN_ID);
+	pCompiler->getImage(pImage);
+	return true;
+}
+
+// give the image to addByte() until it is done with it
+static unsigned char loadImage(R5PlanImage *pImage, const std::vector<unsigned char> &image, const unsigned int uiLength)
+{
+	unsigned char bResult = R5_PLANIMAGE_MORE;
+
+	pImage->begin(uiLength);
+	for (size_t i = 0; (i < image.size()) && (bResult == R5_PLANIMAGE_MORE); i++)
+		bResult = pImage->addByte(image[i]);
+	return bResult;
+}
+
+static unsigned int planNodes(Instinct::CmdPlanner *pPlan)
+{
+	return pPlan->planSize();
+}
+
+// the planner holds what loading the plan a PLAN line at a time gives
+static void checkSamePlan(Instinct::CmdPlanner *pPlan, Instinct::CmdPlanner *pExpected)
+{
+	Instinct::instinctID nSize[INSTINCT_NODE_TYPES];
+	Instinct::instinctID nExpected[INSTINCT_NODE_TYPES];
+
+	pPlan->planSize(nSize);
+	pExpected->planSize(nExpected);
+	for (int i = 0; i < INSTINCT_NODE_TYPES; i++)
+		R5_CHECK_EQUAL(nSize[i], nExpected[i]);
+	R5_CHECK_EQUAL(pPlan->maxElementID(), pExpected->maxElementID());
+
+	for (Instinct::instinctID nID = 1; nID <= pExpected->maxElementID(); nID++)
+	{
+		Instinct::PlanNode node;
+		Instinct::PlanNode expected;
+
+		memset(&node, 0, sizeof(node));
+		memset(&expected, 0, sizeof(expected));
+		unsigned char bFound = pPlan->getNode(&node, nID);
+		if (!R5_CHECK_EQUAL(bFound, pExpected->getNode(&expected, nID)) || !bFound)
+			continue;
+		// the node as R5EEPROM stores it
+		int nBytes = pPlan->sizeFromNodeType(node.bNodeType) + sizeof(node.bNodeType);
+		if (!R5_CHECK(!memcmp(&node, &expected, nBytes)))
+			printf("\tnode %u differs\n", (unsigned int)nID);
+	}
+}
+
+static void testLoad(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	R5PlanCompiler compiler;
+	std::vector<unsigned char> image;
+	R5SimPlanner lines(0);	// no robot, the plans are only loaded
+	R5SimPlanner loaded(0);
+	Instinct::Names names(TEST_NAMES);
+	R5PlanImage planImage(loaded.getPlanner(), &names);
+
+	if (!compilePlan(&image, &compiler) || !R5_CHECK(lines.load(TEST_PLAN)))
+		return;
+	R5_CHECK(!planImage.isLoading());
+	R5_CHECK_EQUAL(loadImage(&planImage, image, image.size()), R5_PLANIMAGE_DONE);
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_OK);
+	R5_CHECK(!planImage.isLoading());
+	R5_CHECK_EQUAL(planImage.getNodes(), compiler.getNodes().size());
+
+	checkSamePlan(loaded.getPlanner(), lines.getPlanner());
+	R5_CHECK_EQUAL(loaded.getPlanner()->getPlanID(), TEST_PLAN_ID);
+
+	const std::map<int, std::string> &expectedNames = compiler.getNames();
+	R5_CHECK(!expectedNames.empty());
+	for (std::map<int, std::string>::const_iterator it = expectedNames.begin(); it != expectedNames.end(); ++it)
+	{
+		const char *pszName = names.getElementName((Instinct::instinctID)it->first);
+		if (R5_CHECK(pszName != 0))
+			R5_CHECK(it->second == pszName);
+	}
+
+	// loading it again replaces the plan rather than adding to it
+	R5_CHECK_EQUAL(loadImage(&planImage, image, image.size()), R5_PLANIMAGE_DONE);
+	checkSamePlan(loaded.getPlanner(), lines.getPlanner());
+	R5HalHost::setCurrent(0);
+}
+
+// each way an image can be bad, found part way through the plan, and the plan then cleared
+static void testErrors(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	R5PlanCompiler compiler;
+	std::vector<unsigned char> image;
+	std::vector<unsigned char> bad;
+	R5SimPlanner loaded(0);
+	Instinct::Names names(TEST_NAMES);
+	R5PlanImage planImage(loaded.getPlanner(), &names);
+
+	if (!compilePlan(&image, &compiler))
+		return;
+
+	// a flipped bit in a node argument is only found by the CRC at the end
+	bad = image;
+	bad[R5_PLANIMAGE_HEADER + (2 * (INSTINCT_NODE_TYPES + 1)) + 3] ^= 0x01;
+	R5_CHECK_EQUAL(loadImage(&planImage, bad, bad.size()), R5_PLANIMAGE_ERROR);
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_ECRC);
+	R5_CHECK_EQUAL(planNodes(loaded.getPlanner()), 0);
+	R5_CHECK_EQUAL(planImage.getNodes(), 0);
+	R5_CHECK(!planImage.isLoading());
+
+	// not an image, or a later version
+	bad = image;
+	bad[0] = 'X';
+	R5_CHECK_EQUAL(loadImage(&planImage, bad, bad.size()), R5_PLANIMAGE_ERROR);
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_EHEADER);
+	bad = image;
+	bad[3] = R5_PLANIMAGE_VERSION + 1;
+	R5_CHECK_EQUAL(loadImage(&planImage, bad, bad.size()), R5_PLANIMAGE_ERROR);
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_EHEADER);
+
+	// PIMAGE given the wrong length
+	R5_CHECK_EQUAL(loadImage(&planImage, image, image.size() + 1), R5_PLANIMAGE_ERROR);
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_ELENGTH);
+	planImage.begin(R5_PLANIMAGE_HEADER - 1);
+	R5_CHECK(!planImage.isLoading());
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_ELENGTH);
+
+	// an unknown node type
+	bad = image;
+	bad[R5_PLANIMAGE_HEADER + (2 * (INSTINCT_NODE_TYPES + 1))] = INSTINCT_NODE_TYPES;
+	R5_CHECK_EQUAL(loadImage(&planImage, bad, bad.size()), R5_PLANIMAGE_ERROR);
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_ENODE);
+	R5_CHECK_EQUAL(planNodes(loaded.getPlanner()), 0);
+
+	// the rest of the image never comes
+	std::vector<unsigned char> half(image.begin(), image.begin() + (image.size() / 2));
+	R5_CHECK_EQUAL(loadImage(&planImage, half, image.size()), R5_PLANIMAGE_MORE);
+	R5_CHECK(planImage.isLoading());
+	delay(R5_PLANIMAGE_TIMEOUT);
+	R5_CHECK_EQUAL(planImage.checkTimeout(), R5_PLANIMAGE_MORE);
+	delay(1);
+	R5_CHECK_EQUAL(planImage.checkTimeout(), R5_PLANIMAGE_ERROR);
+	R5_CHECK_EQUAL(planImage.getError(), R5_PLANIMAGE_ETIMEOUT);
+	R5_CHECK(!planImage.isLoading());
+	R5_CHECK_EQUAL(planNodes(loaded.getPlanner()), 0);
+	R5_CHECK_EQUAL(planImage.addByte(image[0]), R5_PLANIMAGE_ERROR);
+
+	// and a good image still loads after all that
+	R5_CHECK_EQUAL(loadImage(&planImage, image, image.size()), R5_PLANIMAGE_DONE);
+	R5_CHECK_EQUAL(planNodes(loaded.getPlanner()), compiler.getNodes().size());
+	R5HalHost::setCurrent(0);
+}
+
+int main(int argc, char *argv[])
+{
+	testLoad();
+	testErrors();
+	return r5TestResult();
+}
@@ -0,0 +1,135 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5MotorControl's dead reckoning, fed encoder counts through driveMotors() as the sketch does,
+// against the analytic pose for a straight line, arcs of constant radius and a spin on the spot.
+// The heading is clockwise positive from the x axis, so y is to the right of the start.
+//
+#include <math.h>
+#include "R5Hal.h"
+#include "R5AdcScheduler.h"
+#include "R5MotorControl.h"
+#include "R5Test.h"
+
+#define TEST_MM(c)		((c) * 1000.0 / R5_CNTPER1000MM)	// clicks to mm
+#define TEST_DEG(d)		((d) * 100.0 / (2.0 * R5_CNTPER100DEG))	// click difference to degrees
+
+static const unsigned char motorSpeeds[] = {4, 5};
+static const unsigned char motorDirections[] = {29, 28};
+static const unsigned char motorCurrents[] = {A4, A5};
+
+class TestPose {
+public:
+	TestPose() :
+		motors(motorSpeeds, motorDirections, motorCurrents)
+	{
+		R5HalHost::setCurrent(&host);
+		lLeft = lRight = 0L;
+		motors.driveMotors(lLeft, lRight);
+		motors.resetPose();
+	};
+	~TestPose()
+	{
+		R5HalHost::setCurrent(0);
+	};
+
+	// nSteps calls to driveMotors(), each moving the tracks by these clicks
+	void move(const int nSteps, const int nLeftStep, const int nRightStep)
+	{
+		for (int i = 0; i < nSteps; i++)
+		{
+			host.advanceMicros(2000);
+			lLeft += nLeftStep;
+			lRight += nRightStep;
+			motors.driveMotors(lLeft, lRight);
+		}
+	};
+
+	// the pose is within lTolerance mm and nTolerance 1/100 degree of (dX, dY, dHeading)
+	void check(const double dX, const double dY, const double dHeading, const long lTolerance, const int nTolerance)
+	{
+		R5PoseType pose;
+		double dError;
+
+		motors.getPose(&pose);
+		printf("pose %ld %ld %d, expected %.1f %.1f %.0f\n", pose.lX, pose.lY, pose.nHeading, dX, dY, dHeading);
+		R5_CHECK_NEAR(pose.lX, lround(dX), lTolerance);
+		R5_CHECK_NEAR(pose.lY, lround(dY), lTolerance);
+		dError = fmod(pose.nHeading - dHeading + 54000.0, 36000.0) - 18000.0; // the short way round
+		R5_CHECK(fabs(dError) <= nTolerance);
+	};
+
+	R5HalHost host;
+	R5MotorControl motors;
+	long lLeft;
+	long lRight;
+};
+
+static void testStraight(void)
+{
+	TestPose rig;
+
+	rig.move(500, 3, 3);
+	rig.check(TEST_MM(1500), 0, 0, 1, 0);
+	rig.move(500, -3, -3);
+	rig.check(0, 0, 0, 1, 0);
+}
+
+// nLeftStep and nRightStep clicks a step, turning dDegrees in all
+static void arc(const int nLeftStep, const int nRightStep, const double dDegrees, const long lTolerance)
+{
+	TestPose rig;
+	int nSteps = (int)lround((dDegrees * 2.0 * R5_CNTPER100DEG) / (100.0 * (nLeftStep - nRightStep)));
+	double dTheta = TEST_DEG((double)nSteps * (nLeftStep - nRightStep)) * M_PI / 180.0;
+	double dDist = TEST_MM(nSteps * (nLeftStep + nRightStep) / 2.0);
+	double dRadius = dDist / dTheta;
+
+	rig.move(nSteps, nLeftStep, nRightStep);
+	rig.check(dRadius * sin(dTheta), dRadius * (1.0 - cos(dTheta)), fmod(dTheta * 18000.0 / M_PI + 36000.0, 36000.0), lTolerance, 1);
+}
+
+static void testArcs(void)
+{
+	arc(3, 1, 90, 2);		// a quarter circle to the right
+	arc(1, 3, -90, 2);		// and to the left
+	arc(4, 1, 180, 2);
+	arc(3, 2, 360, 2);		// a whole circle, back where it started
+	arc(2, -1, 270, 2);		// the inside track going backwards
+	arc(-3, -1, -90, 2);	// reversing
+}
+
+// turning on the spot moves nowhere, however many times round
+static void testSpin(void)
+{
+	TestPose rig;
+
+	rig.move(189, 3, -3); // 1134 clicks each way is 90 degrees
+	rig.check(0, 0, 9000, 1, 0);
+	rig.move(4536 / 2, 5, -5); // five more turns
+	rig.check(0, 0, 9000, 1, 0);
+	rig.move(378, -3, 3);
+	rig.check(0, 0, 27000, 1, 0);
+}
+
+int main(int argc, char *argv[])
+{
+	testStraight();
+	testArcs();
+	testSpin();
+	return r5TestResult();
+}
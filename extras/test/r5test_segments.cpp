@@ -0,0 +1,193 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5MotorControl's segment queue against a model of the tracks with a deadband, so a track
+// driven too slowly does not move at all. Arcs must still finish, and a stalled track must
+// abort the queue rather than hold it up.
+//
+#include "R5Hal.h"
+#include "R5AdcScheduler.h"
+#include "R5MotorControl.h"
+#include "R5Test.h"
+
+#define TEST_DEADBAND 15	// % of full drive below which a track does not move
+#define TEST_STEP 2000		// uS between calls to driveMotors()
+
+static const unsigned char motorSpeeds[] = {4, 5};
+static const unsigned char motorDirections[] = {29, 28};
+static const unsigned char motorCurrents[] = {A4, A5};
+
+class TestTracks {
+public:
+	TestTracks() :
+		motors(motorSpeeds, motorDirections, motorCurrents)
+	{
+		R5HalHost::setCurrent(&host);
+		lClicks[0] = lClicks[1] = 0L;
+		lPart[0] = lPart[1] = 0L;
+		bStalled[0] = bStalled[1] = false;
+	};
+	~TestTracks()
+	{
+		R5HalHost::setCurrent(0);
+	};
+
+	// run the motors until the queue is done or ulMillis has passed, returning the mS taken
+	unsigned long run(const unsigned long ulMillis)
+	{
+		unsigned long ulStart = millis();
+
+		motors.driveMotors(lClicks[0], lClicks[1]);
+		while ((motors.getSegmentStatus() == R5_IN_PROGRESS) && ((millis() - ulStart) < ulMillis))
+		{
+			host.advanceMicros(TEST_STEP);
+			for (int i = 0; i < 2; i++)
+				_move(i);
+			motors.driveMotors(lClicks[0], lClicks[1]);
+		}
+		return millis() - ulStart;
+	};
+
+	R5HalHost host;
+	R5MotorControl motors;
+	long lClicks[2];
+	unsigned char bStalled[2];
+
+private:
+	// clicks in TEST_STEP at the drive on the track's pins, in millionths to keep the remainder
+	void _move(const int i)
+	{
+		int nOutput = host.getAnalogOutput(motorSpeeds[i]);
+
+		if (bStalled[i] || (nOutput * 100 < TEST_DEADBAND * 255))
+			return;
+		lPart[i] += (long)nOutput * R5_CNTPERSEC_MAX * TEST_STEP / 255;
+		if (host.getDigitalOutput(motorDirections[i]) == HIGH)
+		{
+			lClicks[i] -= lPart[i] / 1000000L;
+		}
+		else
+		{
+			lClicks[i] += lPart[i] / 1000000L;
+		}
+		lPart[i] %= 1000000L;
+	};
+
+	long lPart[2];
+};
+
+static void testArc(const int nDistance, const int nAngle)
+{
+	TestTracks tracks;
+	long lLeft = (long)nDistance * R5_CNTPER1000MM / 1000 + (long)nAngle * R5_CNTPER100DEG / 100;
+	long lRight = (long)nDistance * R5_CNTPER1000MM / 1000 - (long)nAngle * R5_CNTPER100DEG / 100;
+
+	R5_CHECK_EQUAL(tracks.motors.queueArc(nDistance, nAngle), R5_SUCCESS);
+	R5_CHECK(tracks.run(10000) < 10000);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentStatus(), R5_SUCCESS);
+	// a few clicks over at most, from stopping a step late
+	R5_CHECK_NEAR(tracks.lClicks[0], lLeft, 10);
+	R5_CHECK_NEAR(tracks.lClicks[1], lRight, 10);
+}
+
+static void testDrive(void)
+{
+	TestTracks tracks;
+
+	R5_CHECK_EQUAL(tracks.motors.queueDrive(300), R5_SUCCESS);
+	R5_CHECK_EQUAL(tracks.motors.queueDrive(-100), R5_SUCCESS);
+	R5_CHECK(tracks.run(10000) < 10000);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentStatus(), R5_SUCCESS);
+	R5_CHECK_NEAR(tracks.lClicks[0], 200L * R5_CNTPER1000MM / 1000, 10);
+	R5_CHECK_NEAR(tracks.lClicks[1], 200L * R5_CNTPER1000MM / 1000, 10);
+}
+
+static void testPause(void)
+{
+	TestTracks tracks;
+
+	R5_CHECK_EQUAL(tracks.motors.queuePause(1500), R5_SUCCESS);
+	R5_CHECK(tracks.run(10000) >= 1500);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentStatus(), R5_SUCCESS);
+	R5_CHECK_EQUAL(tracks.lClicks[0], 0);
+	R5_CHECK_EQUAL(tracks.lClicks[1], 0);
+}
+
+// a jammed track aborts the queue once neither track has moved for R5_SEGMENT_STALL
+static void testStall(void)
+{
+	TestTracks tracks;
+	unsigned long ulTaken;
+
+	tracks.bStalled[0] = tracks.bStalled[1] = true;
+	R5_CHECK_EQUAL(tracks.motors.queueDrive(300), R5_SUCCESS);
+	R5_CHECK_EQUAL(tracks.motors.queuePause(100), R5_SUCCESS);
+	ulTaken = tracks.run(10000);
+	R5_CHECK(ulTaken > R5_SEGMENT_STALL);
+	R5_CHECK(ulTaken <= R5_SEGMENT_STALL + 10);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentStatus(), R5_FAIL);
+	R5_CHECK_EQUAL(tracks.host.getAnalogOutput(motorSpeeds[0]), 0);
+	R5_CHECK_EQUAL(tracks.host.getAnalogOutput(motorSpeeds[1]), 0);
+
+	// and the queue is empty, so the next segment starts afresh
+	tracks.bStalled[0] = tracks.bStalled[1] = false;
+	R5_CHECK_EQUAL(tracks.motors.queueDrive(100), R5_SUCCESS);
+	R5_CHECK(tracks.run(10000) < 10000);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentStatus(), R5_SUCCESS);
+
+	// one track jammed, so the other finishes and then the segment waits on the jammed one
+	tracks.bStalled[0] = true;
+	R5_CHECK_EQUAL(tracks.motors.queueArc(200, 45), R5_SUCCESS);
+	R5_CHECK(tracks.run(10000) < 10000);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentStatus(), R5_FAIL);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentsQueued(), 0);
+}
+
+// acceleration is capped so the profile arithmetic cannot wrap
+static void testLimits(void)
+{
+	TestTracks tracks;
+	int nMaxSpeed, nAccel;
+
+	R5_CHECK_EQUAL(tracks.motors.setMotionLimits(80, R5_PROFILE_MAXACCEL), R5_SUCCESS);
+	R5_CHECK_EQUAL(tracks.motors.setMotionLimits(80, R5_PROFILE_MAXACCEL + 1), R5_FAIL);
+	R5_CHECK_EQUAL(tracks.motors.setMotionLimits(80, 30000), R5_FAIL);
+	R5_CHECK_EQUAL(tracks.motors.setMotionLimits(80, -1), R5_FAIL);
+	tracks.motors.getMotionLimits(&nMaxSpeed, &nAccel);
+	R5_CHECK_EQUAL(nMaxSpeed, 80);
+	R5_CHECK_EQUAL(nAccel, R5_PROFILE_MAXACCEL);
+
+	// at the cap a long drive still finishes where it should
+	R5_CHECK_EQUAL(tracks.motors.queueDrive(2000), R5_SUCCESS);
+	R5_CHECK(tracks.run(20000) < 20000);
+	R5_CHECK_EQUAL(tracks.motors.getSegmentStatus(), R5_SUCCESS);
+	R5_CHECK_NEAR(tracks.lClicks[0], 2000L * R5_CNTPER1000MM / 1000, 10);
+}
+
+int main(int argc, char *argv[])
+{
+	testArc(200, 45);
+	testArc(200, 60);
+	testArc(200, -60);
+	testArc(-200, 45);
+	testDrive();
+	testPause();
+	testStall();
+	testLimits();
+	return r5TestResult();
+}
@@ -0,0 +1,268 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5SensingHead's dirty cells: exactly the cells whose range has changed since they were last
+// taken, each taken once. A head that isn't scanning still keeps the range ahead fresh, and the
+// cached minimum range ahead follows a change to the servo range.
+//
+#include <set>
+#include <vector>
+#include <stdlib.h>
+#include "R5Hal.h"
+#include "R5FixedMath.h"
+#include "R5Ultrasonic.h"
+#include "R5HeadControl.h"
+#include "R5SensingHead.h"
+#include "R5Test.h"
+
+#define TEST_HCELLS 5
+#define TEST_VCELLS 3	// 15 cells, so the last byte of the bitmap is part used
+
+// every ping comes back after *pContext uS
+static unsigned long echoHandler(void *pContext, const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout)
+{
+	return *(unsigned long *)pContext;
+}
+
+// asynchronous mode: the end of the trigger pulse on pin 2 starts an echo of *pContext uS
+static void echoWriteHandler(void *pContext, const uint8_t bPin, const uint8_t bValue)
+{
+	unsigned long ulStart = R5HalHost::current()->getMicros() + 500;
+
+	if ((bPin != 2) || bValue)
+		return;
+	R5HalHost::current()->scheduleDigitalInput(bPin, HIGH, ulStart);
+	R5HalHost::current()->scheduleDigitalInput(bPin, LOW, ulStart + *(unsigned long *)pContext);
+}
+
+class TestHead {
+public:
+	TestHead(const unsigned char bPin = 8) :
+		ranger(bPin, 0),
+		head(&servoHHead, &servoVHead, 75, 180, &ranger, TEST_HCELLS, TEST_VCELLS, 10)
+	{
+		ulEcho = 1740;
+		R5HalHost::current()->setPulseHandler(echoHandler, &ulEcho);
+		R5HalHost::current()->setWriteHandler(echoWriteHandler, &ulEcho);
+		servoHHead.attach(6);
+		servoVHead.attach(7);
+		head.setHScanParams(30, 15, 135);
+		head.setVScanParams(45, 135, 180);
+		head.setHScanInterval(1000);
+		head.lookAhead();
+	};
+
+	// one step of the head, so one cell is updated
+	void step(void)
+	{
+		R5HalHost::current()->advanceMicros(250000UL);
+		head.driveHead();
+	};
+
+	std::vector<unsigned int> ranges(void)
+	{
+		std::vector<unsigned int> cells;
+		for (unsigned char v = 0; v < TEST_VCELLS; v++)
+			for (unsigned char h = 0; h < TEST_HCELLS; h++)
+				cells.push_back(head.getRangeAtCell(h, v));
+		return cells;
+	};
+
+	// the dirty cells as indexes into ranges(), checking none is given twice
+	std::set<unsigned int> takeAll(void)
+	{
+		std::set<unsigned int> cells;
+		unsigned int uiDirty = head.getDirtyCells();
+		unsigned char bHCoord, bVCoord;
+
+		while (head.takeDirtyCell(&bHCoord, &bVCoord))
+		{
+			R5_CHECK(bHCoord < TEST_HCELLS);
+			R5_CHECK(bVCoord < TEST_VCELLS);
+			R5_CHECK(cells.insert(bHCoord + (bVCoord * TEST_HCELLS)).second);
+		}
+		R5_CHECK_EQUAL(cells.size(), uiDirty);
+		R5_CHECK_EQUAL(head.getDirtyCells(), 0);
+		return cells;
+	};
+
+	Servo servoHHead;
+	Servo servoVHead;
+	R5Ultrasonic ranger;
+	R5SensingHead head;
+	unsigned long ulEcho;
+};
+
+// a new or cleared matrix is all dirty, so its zeros get reported
+static void testClear(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestHead rig;
+
+	R5_CHECK_EQUAL(rig.head.getDirtyCells(), TEST_HCELLS * TEST_VCELLS);
+	R5_CHECK_EQUAL(rig.takeAll().size(), TEST_HCELLS * TEST_VCELLS);
+	unsigned char bHCoord, bVCoord;
+	R5_CHECK(!rig.head.takeDirtyCell(&bHCoord, &bVCoord));
+
+	rig.head.clearSenseMatrix();
+	R5_CHECK_EQUAL(rig.head.getDirtyCells(), TEST_HCELLS * TEST_VCELLS);
+	rig.head.clearDirtyCells();
+	R5_CHECK_EQUAL(rig.head.getDirtyCells(), 0);
+	R5_CHECK(!rig.head.takeDirtyCell(&bHCoord, &bVCoord));
+	R5HalHost::setCurrent(0);
+}
+
+// after each few steps, the dirty cells are the ones whose range is not what it was
+static void testChanges(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestHead rig;
+	std::vector<unsigned int> before;
+	unsigned long ulSeed = 1;
+	int nChanged = 0;
+
+	rig.head.clearDirtyCells();
+	before = rig.ranges();
+	for (int n = 0; n < 200; n++)
+	{
+		// mostly the same range, sometimes a new one
+		ulSeed = ulSeed * 1103515245UL + 12345UL;
+		if (!((ulSeed >> 16) % 4))
+			rig.ulEcho = 600 + ((ulSeed >> 8) % 8) * 300;
+		for (int i = (ulSeed >> 12) % 4; i >= 0; i--)
+			rig.step();
+
+		std::vector<unsigned int> after = rig.ranges();
+		std::set<unsigned int> dirty = rig.takeAll();
+		for (unsigned int c = 0; c < after.size(); c++)
+		{
+			if (!R5_CHECK_EQUAL(dirty.count(c), after[c] != before[c] ? 1 : 0))
+				printf("\tcell %u, range %u was %u\n", c, after[c], before[c]);
+		}
+		nChanged += dirty.size();
+		before = after;
+	}
+	// and the head did scan, with both changes and repeats
+	R5_CHECK(nChanged > 50);
+	R5_CHECK(rig.head.getSweeps() > 5);
+
+	// a steady range leaves nothing to report once the smoothing has settled
+	rig.ulEcho = 1740;
+	for (int i = 0; i < 400; i++)
+		rig.step();
+	rig.head.clearDirtyCells();
+	for (int i = 0; i < 40; i++)
+		rig.step();
+	R5_CHECK_EQUAL(rig.head.getDirtyCells(), 0);
+	R5HalHost::setCurrent(0);
+}
+
+// nothing else pings when the head is still, so driveHead() does, leaving the matrix alone.
+// Only asynchronously though, as a blocking ping would stall the loop
+static void testStillHead(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestHead rig(2);
+	unsigned int uiSequence;
+
+	R5_CHECK(rig.ranger.setAsync(true));
+	rig.head.setParalyse(true);
+	rig.head.clearDirtyCells();
+	rig.step(); // the first ping, collected on the next step as that starts another
+	uiSequence = rig.ranger.getSequence();
+	for (int i = 1; i <= 10; i++)
+	{
+		unsigned long ulEcho = rig.ulEcho;
+		rig.ulEcho = 600 + i * 100;
+		rig.step();
+		R5_CHECK_EQUAL(rig.ranger.getSequence(), uiSequence + i);
+		R5_CHECK_EQUAL(rig.ranger.getEchoDuration(), ulEcho);
+	}
+	R5_CHECK_EQUAL(rig.head.getDirtyCells(), 0);
+
+	// and the same once it is moving again but not scanning
+	rig.head.setParalyse(false);
+	rig.head.setHScanInterval(0);
+	rig.head.setVScanInterval(0);
+	rig.step();
+	R5_CHECK_EQUAL(rig.ranger.getSequence(), uiSequence + 11);
+
+	// in blocking mode the still head leaves the ranger alone, and takes no time over it
+	rig.step();
+	rig.ranger.setAsync(false);
+	uiSequence = rig.ranger.getSequence();
+	for (int i = 0; i < 10; i++)
+	{
+		unsigned long ulStart = micros();
+		rig.step();
+		R5_CHECK_EQUAL(micros() - ulStart, 250000UL);
+	}
+	R5_CHECK_EQUAL(rig.ranger.getSequence(), uiSequence);
+	R5HalHost::setCurrent(0);
+}
+
+// getHMinRange() as the head works it out, from the cells of row 0 and the servo range given
+static unsigned int expectedHMinRange(TestHead *pRig, const int nMin, const int nMax)
+{
+	unsigned int uiMinRange = R5_HEAD_MAXRANGE;
+
+	for (unsigned char h = 0; h < TEST_HCELLS; h++)
+	{
+		unsigned int uiRange = pRig->head.getRangeAtCell(h, 0);
+		int nAngle = abs(nMin + ((h * (nMax - nMin)) / (TEST_HCELLS - 1)) - 75);
+		long lSine = R5FixedMath::sinDeg(nAngle);
+
+		if (uiRange && (uiRange < uiMinRange) && (uiRange < ((long)(R5_ROBOT_WIDTH / 2) << R5_FM_SHIFT) / (lSine ? lSine : 1L)))
+			uiMinRange = (unsigned int)(((long)uiRange * R5FixedMath::cosDeg(nAngle)) >> R5_FM_SHIFT);
+	}
+	return uiMinRange;
+}
+
+// the cached minimum range ahead is worked out again when the servo range changes
+static void testScanParams(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	TestHead rig;
+	unsigned int uiWide, uiNarrow;
+
+	rig.ulEcho = 1450; // 250mm, close enough that cells 30 degrees off centre count
+	for (int i = 0; i < 400; i++)
+		rig.step();
+	rig.head.setParalyse(true);
+	uiWide = rig.head.getHMinRange(0);
+	R5_CHECK_EQUAL(uiWide, expectedHMinRange(&rig, 15, 135));
+
+	rig.head.setHScanParams(10, 65, 85);
+	uiNarrow = rig.head.getHMinRange(0);
+	R5_CHECK_EQUAL(uiNarrow, expectedHMinRange(&rig, 65, 85));
+	R5_CHECK(uiNarrow > uiWide);
+	R5HalHost::setCurrent(0);
+}
+
+int main(int argc, char *argv[])
+{
+	testClear();
+	testChanges();
+	testStillHead();
+	testScanParams();
+	return r5TestResult();
+}
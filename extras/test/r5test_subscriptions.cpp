@@ -0,0 +1,182 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5Subscriptions: when due() says each trigger fires, decimation, and send() only writing changed
+// values once the period is up.
+//
+#include <string>
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5Telemetry.h"
+#include "R5Subscriptions.h"
+#include "R5Test.h"
+
+class RecordOutput : public R5Output {
+public:
+	virtual void outputData(const char *pszData) {records.push_back(pszData);};
+	virtual void outputVocaliseData(const char *pszData) {};
+	virtual void outputFrame(const unsigned char *pFrame, const unsigned int uiLength) {frames++;};
+
+	std::vector<std::string> records;
+	int frames = 0;
+};
+
+static void testSubscribe(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	R5Subscriptions subs(0, 0);
+
+	for (unsigned char i = 0; i < R5_CHANNELS; i++)
+		R5_CHECK(!subs.isActive(i));
+	R5_CHECK(!subs.subscribe(R5_CHANNELS, R5_TRIGGER_PLAN, 0, 1));
+	R5_CHECK(!subs.subscribe(R5_CHANNEL_CORNERS, R5_TRIGGER_SWEEP + 1, 0, 1));
+	R5_CHECK(subs.subscribe(R5_CHANNEL_CORNERS, R5_TRIGGER_PLAN, 0, 0));
+	R5_CHECK(subs.isActive(R5_CHANNEL_CORNERS));
+
+	R5SubscriptionType sub;
+	subs.getSubscription(R5_CHANNEL_CORNERS, &sub);
+	R5_CHECK_EQUAL(sub.bDecimation, 1); // 0 is taken as every time
+
+	R5_CHECK_EQUAL(subs.getChannel('X'), R5_CHANNEL_SENSORS);
+	R5_CHECK_EQUAL(subs.getChannel('H'), R5_CHANNEL_PIR);
+	R5_CHECK_EQUAL(subs.getChannel('P'), R5_CHANNEL_MONITOR);
+	R5_CHECK_EQUAL(subs.getChannel('Z'), R5_CHANNELS);
+
+	subs.unsubscribe(R5_CHANNEL_CORNERS);
+	R5_CHECK(!subs.isActive(R5_CHANNEL_CORNERS));
+	R5_CHECK(!subs.due(R5_CHANNEL_CORNERS, 0, R5_EVENT_PLAN | R5_EVENT_SWEEP | R5_EVENT_CHANGE));
+	R5_CHECK(!subs.due(R5_CHANNELS, 0, R5_EVENT_PLAN));
+	R5HalHost::setCurrent(0);
+}
+
+static void testTriggers(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	R5Subscriptions subs(0, 0);
+
+	// plan and sweep follow their events, and nothing else
+	subs.subscribe(R5_CHANNEL_SENSORS, R5_TRIGGER_PLAN, 1000, 1);
+	subs.subscribe(R5_CHANNEL_HEADMATRIX, R5_TRIGGER_SWEEP, 0, 1);
+	R5_CHECK(!subs.due(R5_CHANNEL_SENSORS, 10, R5_EVENT_SWEEP | R5_EVENT_CHANGE));
+	R5_CHECK(subs.due(R5_CHANNEL_SENSORS, 20, R5_EVENT_PLAN));
+	R5_CHECK(subs.due(R5_CHANNEL_SENSORS, 21, R5_EVENT_PLAN)); // the period is not used
+	R5_CHECK(!subs.due(R5_CHANNEL_HEADMATRIX, 30, R5_EVENT_PLAN | R5_EVENT_CHANGE));
+	R5_CHECK(subs.due(R5_CHANNEL_HEADMATRIX, 40, R5_EVENT_SWEEP));
+
+	// periodic, due straight away and then once each period measured from when it fired
+	subs.subscribe(R5_CHANNEL_CORNERS, R5_TRIGGER_PERIOD, 100, 1);
+	R5_CHECK(subs.due(R5_CHANNEL_CORNERS, 0, 0));
+	R5_CHECK(!subs.due(R5_CHANNEL_CORNERS, 50, R5_EVENT_PLAN));
+	R5_CHECK(!subs.due(R5_CHANNEL_CORNERS, 99, 0));
+	R5_CHECK(subs.due(R5_CHANNEL_CORNERS, 100, 0));
+	R5_CHECK(!subs.due(R5_CHANNEL_CORNERS, 150, 0));
+	R5_CHECK(subs.due(R5_CHANNEL_CORNERS, 230, 0));
+	R5_CHECK(!subs.due(R5_CHANNEL_CORNERS, 300, 0));
+	R5_CHECK(subs.due(R5_CHANNEL_CORNERS, 330, 0));
+
+	// a period of 0 is every loop()
+	subs.subscribe(R5_CHANNEL_EDGES, R5_TRIGGER_PERIOD, 0, 1);
+	for (unsigned long ul = 0; ul < 5; ul++)
+		R5_CHECK(subs.due(R5_CHANNEL_EDGES, 400, 0));
+
+	// change, no more often than the period
+	subs.subscribe(R5_CHANNEL_MONITOR, R5_TRIGGER_CHANGE, 50, 1);
+	R5_CHECK(!subs.due(R5_CHANNEL_MONITOR, 0, R5_EVENT_PLAN));
+	R5_CHECK(subs.due(R5_CHANNEL_MONITOR, 0, R5_EVENT_CHANGE));
+	R5_CHECK(!subs.due(R5_CHANNEL_MONITOR, 49, R5_EVENT_CHANGE));
+	R5_CHECK(subs.due(R5_CHANNEL_MONITOR, 50, R5_EVENT_CHANGE));
+	R5_CHECK(!subs.due(R5_CHANNEL_MONITOR, 500, 0));
+	R5HalHost::setCurrent(0);
+}
+
+static void testDecimation(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	R5Subscriptions subs(0, 0);
+	int nDue = 0;
+
+	subs.subscribe(R5_CHANNEL_ODOMETRY, R5_TRIGGER_PLAN, 0, 3);
+	for (int i = 0; i < 30; i++)
+	{
+		// events that don't fire the trigger don't count towards the decimation
+		R5_CHECK(!subs.due(R5_CHANNEL_ODOMETRY, i, R5_EVENT_SWEEP));
+		if (subs.due(R5_CHANNEL_ODOMETRY, i, R5_EVENT_PLAN))
+		{
+			R5_CHECK_EQUAL(i % 3, 2);
+			nDue++;
+		}
+	}
+	R5_CHECK_EQUAL(nDue, 10);
+	R5HalHost::setCurrent(0);
+}
+
+static void testSendOnChange(void)
+{
+	R5HalHost host;
+	R5HalHost::setCurrent(&host);
+	RecordOutput out;
+	R5Telemetry telemetry(&out);
+	R5Subscriptions subs(&out, &telemetry);
+	long lValues[4] = {120, 96, 300, 280};
+
+	subs.subscribe(R5_CHANNEL_CORNERS, R5_TRIGGER_CHANGE, 100, 1);
+	R5_CHECK(subs.send(R5_CHANNEL_CORNERS, 0, 0, lValues, 4));
+	R5_CHECK_EQUAL(out.records.size(), 1);
+	R5_CHECK(out.records[0] == "C 120 96 300 280");
+
+	// the same values are not sent again, however long it has been
+	R5_CHECK(!subs.send(R5_CHANNEL_CORNERS, 1000, R5_EVENT_PLAN, lValues, 4));
+
+	// a change long after the last is sent at once
+	lValues[1] = 97;
+	R5_CHECK(subs.send(R5_CHANNEL_CORNERS, 1050, 0, lValues, 4));
+	R5_CHECK(out.records.back() == "C 120 97 300 280");
+
+	// a change inside the period waits for the period, and is still sent then
+	lValues[2] = -5;
+	R5_CHECK(!subs.send(R5_CHANNEL_CORNERS, 1100, 0, lValues, 4));
+	R5_CHECK(subs.send(R5_CHANNEL_CORNERS, 1150, 0, lValues, 4));
+	R5_CHECK(out.records.back() == "C 120 97 -5 280");
+	R5_CHECK(!subs.send(R5_CHANNEL_CORNERS, 1300, 0, lValues, 4));
+
+	// binary is a telemetry frame rather than a record
+	subs.setBinary(true);
+	R5_CHECK(subs.getBinary());
+	lValues[0] = 0;
+	R5_CHECK(subs.send(R5_CHANNEL_CORNERS, 1400, 0, lValues, 4));
+	R5_CHECK_EQUAL(out.records.size(), 3);
+	R5_CHECK_EQUAL(out.frames, 1);
+
+	// the monitor has no values of its own to send
+	subs.subscribe(R5_CHANNEL_MONITOR, R5_TRIGGER_PERIOD, 0, 1);
+	R5_CHECK(!subs.send(R5_CHANNEL_MONITOR, 1500, 0, lValues, 4));
+	R5HalHost::setCurrent(0);
+}
+
+int main(int argc, char *argv[])
+{
+	testSubscribe();
+	testTriggers();
+	testDecimation();
+	testSendOnChange();
+	return r5TestResult();
+}
@@ -0,0 +1,237 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Binary telemetry: the CRC16, and frames from R5Telemetry coming back out of R5TelemetryDecoder
+// as the messages that went in, through COBS, key and delta messages, text in between, a
+// corrupted frame and one lost altogether.
+//
+#include <vector>
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5Crc.h"
+#include "R5Telemetry.h"
+#include "R5TelemetryDecoder.h"
+#include "R5Test.h"
+
+#define TEST_FIELDS 12
+#define TEST_MESSAGES 200
+
+// keeps everything written, as the link would carry it
+class CaptureOutput : public R5Output {
+public:
+	virtual void outputData(const char *pszData)
+	{
+		while (*pszData)
+			bytes.push_back(*pszData++);
+		bytes.push_back('\n');
+	};
+	virtual void outputVocaliseData(const char *pszData) {outputData(pszData);};
+	virtual void outputFrame(const unsigned char *pFrame, const unsigned int uiLength)
+	{
+		frames++;
+		// a zero at each end and none inside
+		R5_CHECK(uiLength > 2);
+		R5_CHECK_EQUAL(pFrame[0], 0);
+		R5_CHECK_EQUAL(pFrame[uiLength - 1], 0);
+		for (unsigned int i = 1; i < (uiLength - 1); i++)
+		{
+			if (!R5_CHECK(pFrame[i] != 0))
+				break;
+		}
+		bytes.insert(bytes.end(), pFrame, pFrame + uiLength);
+	};
+
+	std::vector<unsigned char> bytes;
+	int frames = 0;
+};
+
+// the fields of message n: some constant, some that change every time, small and large, both signs
+static long testField(const int n, const int nField)
+{
+	switch (nField % 4)
+	{
+	case 0:
+		return 42;
+	case 1:
+		return (long)n * 1000 - 50000;
+	case 2:
+		return (n / 7) % 2 ? -nField : nField;
+	default:
+		return (long)((n * 2654435761UL) % 2000000000UL) - 1000000000L;
+	}
+}
+
+static void testCRC(void)
+{
+	const char *pszCheck = "123456789";
+	unsigned int uiCRC = R5_CRC16_INIT;
+
+	while (*pszCheck)
+		uiCRC = crc16Update(uiCRC, *pszCheck++);
+	R5_CHECK_EQUAL(uiCRC, 0x29B1); // the CRC-16/CCITT-FALSE check value
+}
+
+static void testRoundTrip(void)
+{
+	CaptureOutput out;
+	R5Telemetry telemetry(&out);
+	R5TelemetryDecoder decoder;
+	int nMessages = 0;
+	int nKeys = 0;
+	int nTexts = 0;
+
+	for (int n = 0; n < TEST_MESSAGES; n++)
+	{
+		// a shorter message part way through forces a key message
+		unsigned char bFields = (n == 100) ? TEST_FIELDS - 2 : TEST_FIELDS;
+
+		telemetry.begin(R5_TELEMETRY_SENSORS, 1000UL + n * 55UL, bFields);
+		for (unsigned char i = 0; i < bFields; i++)
+			telemetry.add(testField(n, i));
+		telemetry.send();
+		if (!(n % 10))
+			out.outputData("0000001234 text between frames");
+	}
+	R5_CHECK_EQUAL(out.frames, TEST_MESSAGES);
+
+	for (size_t i = 0; i < out.bytes.size(); i++)
+	{
+		switch (decoder.addByte(out.bytes[i]))
+		{
+		case R5_DECODE_TEXT:
+			R5_CHECK(decoder.getText() == "0000001234 text between frames");
+			nTexts++;
+			break;
+		case R5_DECODE_MESSAGE:
+		{
+			const R5TelemetryMessageType *pMessage = decoder.getMessage();
+			size_t nFields = (nMessages == 100) ? TEST_FIELDS - 2 : TEST_FIELDS;
+
+			R5_CHECK_EQUAL(pMessage->bType, R5_TELEMETRY_SENSORS);
+			R5_CHECK_EQUAL(pMessage->ulMillis, 1000UL + nMessages * 55UL);
+			if (R5_CHECK_EQUAL(pMessage->fields.size(), nFields))
+			{
+				for (size_t f = 0; f < nFields; f++)
+					R5_CHECK_EQUAL(pMessage->fields[f], testField(nMessages, f));
+			}
+			if (pMessage->bKey)
+				nKeys++;
+			nMessages++;
+			break;
+		}
+		}
+	}
+	R5_CHECK_EQUAL(nMessages, TEST_MESSAGES);
+	R5_CHECK_EQUAL(nTexts, TEST_MESSAGES / 10);
+	R5_CHECK_EQUAL(decoder.getBadFrames(), 0);
+	// the first, one every R5_TELEMETRY_KEY_INTERVAL, and the two around the change of field count
+	R5_CHECK(nKeys >= (TEST_MESSAGES / R5_TELEMETRY_KEY_INTERVAL));
+	R5_CHECK(nKeys <= (TEST_MESSAGES / R5_TELEMETRY_KEY_INTERVAL) + 3);
+	// and most messages are much shorter than the text record would be
+	R5_CHECK(decoder.getFrameBytes() < (unsigned long)(TEST_MESSAGES * TEST_FIELDS * 4));
+}
+
+// a flipped byte fails the CRC, and the deltas after it are dropped until the next key
+static void testCorruptFrame(void)
+{
+	CaptureOutput out;
+	R5Telemetry telemetry(&out);
+	R5TelemetryDecoder decoder;
+	std::vector<size_t> starts;
+	int nMessages = 0;
+	long lLastMillis = -1;
+
+	for (int n = 0; n < 3 * R5_TELEMETRY_KEY_INTERVAL; n++)
+	{
+		starts.push_back(out.bytes.size());
+		telemetry.begin(R5_TELEMETRY_SENSORS, n * 10UL, TEST_FIELDS);
+		for (unsigned char i = 0; i < TEST_FIELDS; i++)
+			telemetry.add(testField(n, i));
+		telemetry.send();
+	}
+	out.bytes[starts[5] + 4] ^= 0x10; // in the fifth delta after the first key
+
+	for (size_t i = 0; i < out.bytes.size(); i++)
+	{
+		if (decoder.addByte(out.bytes[i]) != R5_DECODE_MESSAGE)
+			continue;
+		const R5TelemetryMessageType *pMessage = decoder.getMessage();
+		int n = pMessage->ulMillis / 10;
+
+		// whatever gets through is right
+		for (size_t f = 0; f < pMessage->fields.size(); f++)
+			R5_CHECK_EQUAL(pMessage->fields[f], testField(n, f));
+		R5_CHECK((long)pMessage->ulMillis > lLastMillis);
+		lLastMillis = pMessage->ulMillis;
+		nMessages++;
+	}
+	R5_CHECK_EQUAL(decoder.getBadFrames(), 1);
+	R5_CHECK_EQUAL(decoder.getUnsynced(), R5_TELEMETRY_KEY_INTERVAL - 6);
+	R5_CHECK_EQUAL(nMessages, 3 * R5_TELEMETRY_KEY_INTERVAL - (R5_TELEMETRY_KEY_INTERVAL - 5));
+}
+
+// a frame that never arrives, as when R5BufferedOutput drops one, passes every CRC check, so the
+// sequence numbers have to catch it, and the deltas after it wait for the next key
+static void testLostFrame(void)
+{
+	CaptureOutput out;
+	R5Telemetry telemetry(&out);
+	R5TelemetryDecoder decoder;
+	std::vector<size_t> starts;
+	int nMessages = 0;
+	long lLastMillis = -1;
+
+	for (int n = 0; n < 3 * R5_TELEMETRY_KEY_INTERVAL; n++)
+	{
+		starts.push_back(out.bytes.size());
+		telemetry.begin(R5_TELEMETRY_SENSORS, n * 10UL, TEST_FIELDS);
+		for (unsigned char i = 0; i < TEST_FIELDS; i++)
+			telemetry.add(testField(n, i));
+		telemetry.send();
+	}
+	// the fifth delta after the first key, from its leading zero to the next frame's
+	out.bytes.erase(out.bytes.begin() + starts[5], out.bytes.begin() + starts[6]);
+
+	for (size_t i = 0; i < out.bytes.size(); i++)
+	{
+		if (decoder.addByte(out.bytes[i]) != R5_DECODE_MESSAGE)
+			continue;
+		const R5TelemetryMessageType *pMessage = decoder.getMessage();
+		int n = pMessage->ulMillis / 10;
+
+		for (size_t f = 0; f < pMessage->fields.size(); f++)
+			R5_CHECK_EQUAL(pMessage->fields[f], testField(n, f));
+		R5_CHECK((long)pMessage->ulMillis > lLastMillis);
+		R5_CHECK((n < 5) || (n >= R5_TELEMETRY_KEY_INTERVAL));
+		lLastMillis = pMessage->ulMillis;
+		nMessages++;
+	}
+	R5_CHECK_EQUAL(decoder.getBadFrames(), 0);
+	R5_CHECK_EQUAL(decoder.getGaps(), 1);
+	R5_CHECK_EQUAL(decoder.getUnsynced(), R5_TELEMETRY_KEY_INTERVAL - 6);
+	R5_CHECK_EQUAL(nMessages, 3 * R5_TELEMETRY_KEY_INTERVAL - (R5_TELEMETRY_KEY_INTERVAL - 5));
+}
+
+int main(int argc, char *argv[])
+{
+	testCRC();
+	testRoundTrip();
+	testCorruptFrame();
+	testLostFrame();
+	return r5TestResult();
+}
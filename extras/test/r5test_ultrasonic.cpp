@@ -0,0 +1,173 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5Ultrasonic in blocking and asynchronous modes, driven as R5Robot.ino drives it: a loop that
+// does its own work and then calls driveHead() on a scanning head. Both modes must measure the same
+// ranges, and asynchronous mode must not hold up the loop while it waits for the echo.
+//
+#include "R5Hal.h"
+#include "R5Ultrasonic.h"
+#include "R5HeadControl.h"
+#include "R5SensingHead.h"
+#include "R5Test.h"
+
+#define TEST_PIN 2				// the interrupt pin the sketch uses
+#define TEST_INTERVAL 300		// mS between pings, as the sketch
+#define TEST_LOOP_WORK 2000		// uS the rest of the loop takes
+#define TEST_ECHO_DELAY 750		// uS from the trigger to the start of the echo
+
+class TestRanger {
+public:
+	TestRanger(const unsigned char bPin, const unsigned char bAsync) :
+		ranger(bPin, TEST_INTERVAL),
+		head(&servoHHead, &servoVHead, 75, 180, &ranger, 5, 2, 10)
+	{
+		R5HalHost::setCurrent(&host);
+		bSensorPin = bPin;
+		ulEcho = 5800; // 1m
+		bTriggerHigh = false;
+		host.setPulseHandler(_pulseHandler, this);
+		host.setWriteHandler(_writeHandler, this);
+		servoHHead.attach(6);
+		servoVHead.attach(7);
+		head.setHScanParams(30, 15, 135);
+		head.setVScanParams(45, 135, 180);
+		head.setHScanInterval(1000);
+		head.setVScanInterval(0);
+		head.lookAhead();
+		bAsyncSet = ranger.setAsync(bAsync);
+	};
+	~TestRanger()
+	{
+		R5HalHost::setCurrent(&host);
+		ranger.setAsync(false);
+		R5HalHost::setCurrent(0);
+	};
+
+	// run the loop for ulMillis, returning the longest pass through it in uS
+	unsigned long run(const unsigned long ulMillis)
+	{
+		unsigned long ulStart, ulWorst = 0;
+
+		R5HalHost::setCurrent(&host); // each rig has its own clock
+		ulStart = millis();
+		while ((millis() - ulStart) < ulMillis)
+		{
+			unsigned long ulPass = micros();
+			host.advanceMicros(TEST_LOOP_WORK);
+			head.driveHead();
+			ulWorst = max(ulWorst, micros() - ulPass);
+		}
+		return ulWorst;
+	};
+
+	R5HalHost host;
+	Servo servoHHead;
+	Servo servoVHead;
+	R5Ultrasonic ranger;
+	R5SensingHead head;
+	unsigned char bSensorPin;
+	unsigned char bAsyncSet;
+	unsigned long ulEcho;	// 0 for no echo at all
+
+private:
+	// blocking mode, pulseIn() on the sensor pin
+	static unsigned long _pulseHandler(void *pContext, const uint8_t bPin, const uint8_t bState, const unsigned long ulTimeout)
+	{
+		TestRanger *pRig = (TestRanger *)pContext;
+
+		if (!pRig->ulEcho)
+			return 0;
+		pRig->host.advanceMicros(TEST_ECHO_DELAY); // pulseIn() waits for the echo to start
+		return pRig->ulEcho;
+	};
+
+	// asynchronous mode, the end of the trigger starts the echo on the same pin
+	static void _writeHandler(void *pContext, const uint8_t bPin, const uint8_t bValue)
+	{
+		TestRanger *pRig = (TestRanger *)pContext;
+		unsigned long ulStart;
+
+		if (bPin != pRig->bSensorPin)
+			return;
+		if (bValue)
+			pRig->bTriggerHigh = true;
+		else if (pRig->bTriggerHigh)
+		{
+			pRig->bTriggerHigh = false;
+			if (!pRig->ulEcho)
+				return;
+			ulStart = pRig->host.getMicros() + TEST_ECHO_DELAY;
+			pRig->host.scheduleDigitalInput(bPin, HIGH, ulStart);
+			pRig->host.scheduleDigitalInput(bPin, LOW, ulStart + pRig->ulEcho);
+		}
+	};
+
+	unsigned char bTriggerHigh;
+};
+
+// the pin has to have an interrupt, and setAsync() says when it hasn't
+static void testPins(void)
+{
+	{
+		TestRanger rig(TEST_PIN, true);
+		R5_CHECK(rig.bAsyncSet);
+		R5_CHECK(rig.ranger.getAsync());
+	}
+	{
+		TestRanger rig(8, true);
+		R5_CHECK(!rig.bAsyncSet);
+		R5_CHECK(!rig.ranger.getAsync());
+	}
+}
+
+// the same readings either way, but only the blocking loop waits for them
+static void testLatency(void)
+{
+	TestRanger blocking(TEST_PIN, false);
+	TestRanger async(TEST_PIN, true);
+	unsigned long ulBlocking, ulAsync;
+
+	ulBlocking = blocking.run(3000);
+	ulAsync = async.run(3000);
+	printf("worst loop, blocking %lu uS, asynchronous %lu uS\n", ulBlocking, ulAsync);
+	R5_CHECK(ulBlocking >= TEST_LOOP_WORK + TEST_ECHO_DELAY + blocking.ulEcho);
+	R5_CHECK(ulAsync < TEST_LOOP_WORK + 100);
+	R5_CHECK_EQUAL(async.ranger.range(), blocking.ranger.range());
+	R5_CHECK(blocking.ranger.range() > 900);
+	R5_CHECK(blocking.ranger.range() < 1100);
+	R5_CHECK_NEAR(async.ranger.getSequence(), blocking.ranger.getSequence(), 1);
+	// the head steps every 250mS, and TEST_INTERVAL lets a ping through on every other step
+	R5_CHECK(blocking.ranger.getSequence() >= 3000 / 500 - 1);
+
+	// with nothing in range the blocking loop waits out the whole timeout
+	blocking.ulEcho = async.ulEcho = 0;
+	ulBlocking = blocking.run(3000);
+	ulAsync = async.run(3000);
+	printf("no echo, blocking %lu uS, asynchronous %lu uS\n", ulBlocking, ulAsync);
+	R5_CHECK(ulBlocking >= TEST_LOOP_WORK + 30000);
+	R5_CHECK(ulAsync < TEST_LOOP_WORK + 100);
+	R5_CHECK_EQUAL(async.ranger.range(), blocking.ranger.range());
+}
+
+int main(int argc, char *argv[])
+{
+	testPins();
+	testLatency();
+	return r5TestResult();
+}
@@ -0,0 +1,167 @@
+// 	Library for Rover 5 Platform Host Tests
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// R5MotorControl's wheel velocity estimate from synthetic encoder streams: clicks at known times
+// fed through driveMotors() from a loop, as the sketch does. Covers steady speeds above and below
+// the window, slowing to a stop, R5_VEL_TIMEOUT, and micros() wrapping round.
+//
+#include <limits.h>
+#include "R5Hal.h"
+#include "R5AdcScheduler.h"
+#include "R5MotorControl.h"
+#include "R5Test.h"
+
+#define TEST_LOOP 1000	// uS between calls to driveMotors()
+#define TEST_MMPS(c)	((long)(c) * 1000L / R5_CNTPER1000MM)	// clicks/s to mm/s
+
+static const unsigned char motorSpeeds[] = {4, 5};
+static const unsigned char motorDirections[] = {29, 28};
+static const unsigned char motorCurrents[] = {A4, A5};
+
+class TestEncoders {
+public:
+	TestEncoders(const unsigned long ulStart) :
+		motors(motorSpeeds, motorDirections, motorCurrents)
+	{
+		R5HalHost::setCurrent(&host);
+		host.setMicros(ulStart);
+		lClicks[0] = lClicks[1] = 0L;
+		ulNext[0] = ulNext[1] = 0;
+		motors.driveMotors(0L, 0L);
+	};
+	~TestEncoders()
+	{
+		R5HalHost::setCurrent(0);
+	};
+
+	// run the loop for ulMicros with each wheel clicking every ulInterval uS, forwards or backwards,
+	// or not at all if the interval is 0
+	void run(const unsigned long ulMicros, const unsigned long ulLeftInterval, const unsigned long ulRightInterval, const int nDirection)
+	{
+		unsigned long ulInterval[2] = {ulLeftInterval, ulRightInterval};
+
+		for (unsigned long ulRun = 0; ulRun < ulMicros; ulRun += TEST_LOOP)
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				if (!ulInterval[i])
+					continue;
+				// clicks due during this pass of the loop
+				for (ulNext[i] += TEST_LOOP; ulNext[i] >= ulInterval[i]; ulNext[i] -= ulInterval[i])
+					lClicks[i] += nDirection;
+			}
+			host.advanceMicros(TEST_LOOP);
+			motors.driveMotors(lClicks[0], lClicks[1]);
+		}
+	};
+
+	R5HalHost host;
+	R5MotorControl motors;
+	long lClicks[2];
+	unsigned long ulNext[2];	// uS since each wheel's last click
+};
+
+// clicks often enough that the window holds several, at the full speed and less. The clicks are
+// timed by the loop, so the window can be out by one pass of it, 2%
+static void testSteady(void)
+{
+	TestEncoders rig(0);
+
+	rig.run(500000UL, 1000000UL / 430, 1000000UL / 430, 1);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(1), TEST_MMPS(430), 6);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(2), TEST_MMPS(430), 6);
+
+	rig.run(500000UL, 5000UL, 10000UL, 1);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(1), TEST_MMPS(200), 2);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(2), TEST_MMPS(100), 2);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(0), TEST_MMPS(150), 2);
+
+	rig.run(500000UL, 5000UL, 10000UL, -1);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(1), -TEST_MMPS(200), 2);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(2), -TEST_MMPS(100), 2);
+}
+
+// clicks further apart than R5_VEL_WINDOW, so the speed is from the single interval between the last two
+static void testSlow(void)
+{
+	TestEncoders rig(0);
+
+	rig.run(1000000UL, 80000UL, 200000UL, 1); // 12.5 and 5 clicks/s
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(1), TEST_MMPS(12), 1);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(2), TEST_MMPS(5), 1);
+	R5_CHECK(rig.motors.getWheelVelocity(1) > 0);
+	R5_CHECK(rig.motors.getWheelVelocity(2) > 0);
+}
+
+// once the clicks stop the speed can be no more than one click in the time since, and then it is zero
+static void testStopping(void)
+{
+	TestEncoders rig(0);
+	int nLast;
+
+	rig.run(500000UL, 5000UL, 5000UL, 1);
+	rig.run(20000UL, 0, 0, 1);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(1), TEST_MMPS(200), 2); // still within the window
+	rig.run(80000UL, 0, 0, 1);
+	R5_CHECK_NEAR(rig.motors.getWheelVelocity(1), TEST_MMPS(10), 1); // 1 click in 100mS
+
+	nLast = rig.motors.getWheelVelocity(1);
+	while ((micros() - (5000UL * rig.lClicks[0])) < R5_VEL_TIMEOUT - TEST_LOOP)
+	{
+		rig.run(TEST_LOOP, 0, 0, 1);
+		R5_CHECK(rig.motors.getWheelVelocity(1) <= nLast);
+		nLast = rig.motors.getWheelVelocity(1);
+	}
+	R5_CHECK_EQUAL(rig.motors.getWheelVelocity(1), TEST_MMPS(2)); // 1 click in 0.5S
+	rig.run(2 * TEST_LOOP, 0, 0, 1);
+	R5_CHECK_EQUAL(rig.motors.getWheelVelocity(1), 0);
+	R5_CHECK_EQUAL(rig.motors.getWheelVelocity(2), 0);
+	R5_CHECK_EQUAL(rig.motors.getWheelVelocity(0), 0);
+}
+
+// micros() wraps to 0 (every 71 minutes on the robot, where unsigned long is 32 bits)
+static void testWrap(void)
+{
+	TestEncoders rig(ULONG_MAX - 250000UL);
+
+	rig.run(200000UL, 5000UL, 80000UL, 1);
+	for (int i = 0; i < 100; i++) // either side of the wrap
+	{
+		rig.run(1000UL, 5000UL, 80000UL, 1);
+		R5_CHECK_NEAR(rig.motors.getWheelVelocity(1), TEST_MMPS(200), 2);
+		R5_CHECK_NEAR(rig.motors.getWheelVelocity(2), TEST_MMPS(12), 1);
+	}
+	R5_CHECK(micros() < 100000UL);
+
+	// and the timeout still works across it
+	rig.host.setMicros(ULONG_MAX - 100000UL);
+	rig.run(200000UL, 5000UL, 5000UL, 1);
+	rig.run(R5_VEL_TIMEOUT / 2, 0, 0, 1);
+	R5_CHECK(rig.motors.getWheelVelocity(1) > 0);
+	rig.run(R5_VEL_TIMEOUT / 2 + TEST_LOOP, 0, 0, 1);
+	R5_CHECK_EQUAL(rig.motors.getWheelVelocity(1), 0);
+}
+
+int main(int argc, char *argv[])
+{
+	testSteady();
+	testSlow();
+	testStopping();
+	testWrap();
+	return r5TestResult();
+}
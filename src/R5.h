@@ -18,16 +18,31 @@
 #ifndef _R5_H_
 #define __R5_H_
 
+#include "R5Hal.h"
 #include "R5Output.h"
+#include "R5BufferedOutput.h"
+#include "R5Crc.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
+#include "R5Progmem.h"
+#include "R5Command.h"
+#include "R5RobotCommands.h"
 #include "R5CornerSensors.h"
 #include "R5MotorControl.h"
 #include "R5HeadControl.h"
 #include "R5Ultrasonic.h"
 #include "R5SensingHead.h"
 #include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5Trace.h"
+#include "R5Telemetry.h"
+#include "R5Subscriptions.h"
 #include "R5Voice.h"
 #include "R5Vocalise.h"
 #include "R5EEPROM.h"
+#include "R5PlanImage.h"
+#include "R5PlanIds.h"
+#include "R5PlanInterface.h"
 
 // implementation of MyMonitor is in Robot_Instinct but definitions are here
 // because Arduino sketches have no concept of include files
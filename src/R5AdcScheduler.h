@@ -0,0 +1,52 @@
+// 	Library for Rover 5 Platform ADC Scheduler
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// The scheduler owns the ADC. Once begin() is called it converts each registered channel in turn from
+// the ADC complete interrupt, so nothing waits for analogRead(). When a pass over all the channels is
+// complete the results are published together and the sequence number is incremented.
+// Nothing else may call analogRead() once the scheduler is running.
+//
+#ifndef _R5ADCSCHEDULER_H_
+#define _R5ADCSCHEDULER_H_
+
+#define R5_ADC_MAX_CHANNELS 8
+
+class R5AdcScheduler {
+public:
+	R5AdcScheduler(void);
+	unsigned char addChannel(const unsigned char bPin); // register an analog pin. Must be done before begin()
+	void begin(void);	// start converting the registered channels
+	void end(void);		// stop converting after the current conversion
+	int getSample(const unsigned char bPin); // the latest published value for this pin, 0 if not registered
+	unsigned int getSequence(void); // incremented each time a complete pass is published
+	unsigned char getChannels(void);
+	static void handleInterrupt(void *pContext, const int nValue); // called by the ADC complete interrupt only
+
+private:
+	unsigned char _bPins[R5_ADC_MAX_CHANNELS];
+	unsigned char _bChannels;
+	volatile unsigned char _bRunning;
+	volatile unsigned char _bCurrent;		// index of the channel being converted
+	volatile unsigned char _bFront;			// which buffer holds the published results
+	volatile unsigned int _uiSequence;
+	volatile int _nSamples[2][R5_ADC_MAX_CHANNELS]; // double buffered results, the ISR writes to !_bFront
+
+	void _startConversion(void);
+	void _conversionComplete(const int nValue);
+};
+
+#endif // _R5ADCSCHEDULER_H_
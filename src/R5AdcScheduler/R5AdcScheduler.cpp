@@ -0,0 +1,129 @@
+// 	Library for Rover 5 Platform ADC Scheduler
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5AdcScheduler.h"
+
+R5AdcScheduler::R5AdcScheduler(void)
+{
+	_bChannels = 0;
+	_bRunning = false;
+	_bCurrent = 0;
+	_bFront = 0;
+	_uiSequence = 0;
+	memset((void *)_nSamples, 0, sizeof(_nSamples));
+}
+
+// register an analog pin to be converted on every pass. Registering the same pin twice is harmless
+unsigned char R5AdcScheduler::addChannel(const unsigned char bPin)
+{
+	for (unsigned char i = 0; i < _bChannels; i++)
+	{
+		if (_bPins[i] == bPin)
+			return true;
+	}
+
+	if (_bRunning || (_bChannels >= R5_ADC_MAX_CHANNELS))
+		return false;
+
+	_bPins[_bChannels] = bPin;
+	_bChannels++;
+	return true;
+}
+
+// take ownership of the ADC and start the first conversion. The interrupt keeps it going from then on
+void R5AdcScheduler::begin(void)
+{
+	if (_bRunning || !_bChannels)
+		return;
+
+	_bCurrent = 0;
+	_bRunning = true;
+	_startConversion();
+}
+
+// the conversion in progress completes but no more are started
+void R5AdcScheduler::end(void)
+{
+	_bRunning = false;
+}
+
+unsigned char R5AdcScheduler::getChannels(void)
+{
+	return _bChannels;
+}
+
+unsigned int R5AdcScheduler::getSequence(void)
+{
+	unsigned int uiSequence;
+
+	noInterrupts(); // 2 bytes so read it atomically
+	uiSequence = _uiSequence;
+	interrupts();
+	return uiSequence;
+}
+
+// return the value from the last complete pass. Costs a few cycles rather than an ~110uS conversion
+int R5AdcScheduler::getSample(const unsigned char bPin)
+{
+	int nSample = 0;
+
+	for (unsigned char i = 0; i < _bChannels; i++)
+	{
+		if (_bPins[i] == bPin)
+		{
+			noInterrupts(); // stop the buffers swapping while we read
+			nSample = _nSamples[_bFront][i];
+			interrupts();
+			break;
+		}
+	}
+	return nSample;
+}
+
+// start converting the current channel. The result comes back through handleInterrupt()
+void R5AdcScheduler::_startConversion(void)
+{
+	R5Hal::adcStart(_bPins[_bCurrent], handleInterrupt, this);
+}
+
+// store the result in the back buffer. Swap buffers at the end of each pass
+void R5AdcScheduler::_conversionComplete(const int nValue)
+{
+	unsigned char bBack = !_bFront;
+
+	_nSamples[bBack][_bCurrent] = nValue;
+	_bCurrent++;
+	if (_bCurrent >= _bChannels)
+	{
+		// publish this pass and start filling the other buffer
+		_bCurrent = 0;
+		_bFront = bBack;
+		_uiSequence++;
+	}
+
+	if (_bRunning)
+		_startConversion();
+	else
+		R5Hal::adcStop(); // leave the ADC for analogRead()
+}
+
+// the context is the scheduler that started the conversion
+void R5AdcScheduler::handleInterrupt(void *pContext, const int nValue)
+{
+	((R5AdcScheduler *)pContext)->_conversionComplete(nValue);
+}
@@ -0,0 +1,99 @@
+// 	Library for Rover 5 Platform Buffered Output
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// An R5Output that never waits for the link. Records are copied into a ring buffer and drain()
+// passes on as much as the sink will take without blocking, which for a HardwareSerial is the
+// room left in its transmit buffer. The UART data register empty interrupt in the Arduino core
+// sends that on, so calling drain() once per loop() keeps the link busy.
+//
+// A text record is the millis() timestamp, the data and an end of line, as the sketch has always
+// written them. A telemetry frame is written as it is. Records go into the buffer whole or not at
+// all, and when there is no room the policy decides what gives way:
+//
+//	R5_OUTPUT_DROP_OLDEST	records already buffered, oldest first, but never one partly sent
+//	R5_OUTPUT_DROP_NEWEST	the record being written
+//	R5_OUTPUT_BLOCK			nothing, wait for the sink as writing to it directly would
+//
+// A text record ends with a '\n'. A frame starts and ends with a zero and has none in between, but
+// can hold a '\n'. Dropping the oldest finds the records that way, and counts down what is left of
+// the record going out, so it knows where that one ends.
+//
+// setBatch() holds records back until there are enough bytes for a batch, the oldest has waited long
+// enough, or flush() is called, and then sends the batch without a break, ahead of anything newer.
+// A sink that makes packets of what arrives together, like the WiFly, then sends fewer and fuller ones.
+//
+#ifndef _R5BUFFEREDOUTPUT_H_
+#define _R5BUFFEREDOUTPUT_H_
+
+#define R5_OUTPUT_DROP_OLDEST	0
+#define R5_OUTPUT_DROP_NEWEST	1
+#define R5_OUTPUT_BLOCK			2
+
+class R5BufferedOutput : public R5Output {
+public:
+	// uiSize bytes of buffer are allocated from the heap. bCRLF ends text records with "\r\n" rather than "\n"
+	R5BufferedOutput(Print *pSink, const unsigned int uiSize, const unsigned char bPolicy, const unsigned char bCRLF);
+	virtual void outputData(const char *pszData);
+	virtual void outputVocaliseData(const char *pszData);
+	virtual void outputFrame(const unsigned char *pFrame, const unsigned int uiLength);
+	void drain(void);	// call once per loop()
+	void setBatch(const unsigned int uiBytes, const unsigned int uiMillis);	// 0 bytes sends as soon as it can
+	void flush(void);	// send what is waiting now rather than waiting for a batch
+	void setPolicy(const unsigned char bPolicy);
+	unsigned char getPolicy(void);
+	unsigned int getSize(void);
+	unsigned int getUsed(void);
+	unsigned int getHighWater(void);	// most bytes ever waiting
+	unsigned long getDropped(void);		// records lost to a full buffer
+	unsigned long getDroppedBytes(void);
+	unsigned long getBatches(void);
+	unsigned long getBatchedBytes(void);
+	unsigned long getLateBatches(void);		// sent short because the oldest record had waited uiMillis
+	void clearCounters(void);
+
+private:
+	void _write(const unsigned char *pData, const unsigned int uiLength, const unsigned char bEnd);
+	unsigned char _makeRoom(const unsigned int uiLength);
+	unsigned char _dropOldest(void);
+	unsigned int _recordLength(const unsigned int uiOffset);
+	unsigned int _index(const unsigned int uiOffset);
+
+	Print *_pSink;
+	unsigned char *_pBuffer;
+	unsigned int _uiSize;
+	unsigned int _uiHead;	// where the next byte is written
+	unsigned int _uiTail;	// the next byte to send
+	unsigned int _uiUsed;
+	unsigned char _bPolicy;
+	unsigned char _bCRLF;
+	unsigned int _uiRecordLeft;	// bytes of the record at _uiTail still to send, 0 between records
+	unsigned int _uiHighWater;
+	unsigned long _ulDropped;
+	unsigned long _ulDroppedBytes;
+
+	unsigned int _uiBatch;
+	unsigned int _uiBatchMillis;
+	unsigned int _uiSending;		// bytes of the batch going out still to send
+	unsigned char _bFlush;
+	unsigned long _ulWaiting;		// millis() when the oldest record not yet in a batch was written
+	unsigned long _ulBatches;
+	unsigned long _ulBatchedBytes;
+	unsigned long _ulLateBatches;
+};
+
+#endif // _R5BUFFEREDOUTPUT_H_
@@ -0,0 +1,295 @@
+// 	Library for Rover 5 Platform Buffered Output
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5BufferedOutput.h"
+
+R5BufferedOutput::R5BufferedOutput(Print *pSink, const unsigned int uiSize, const unsigned char bPolicy, const unsigned char bCRLF)
+{
+	_pSink = pSink;
+	_bPolicy = bPolicy;
+	_bCRLF = bCRLF;
+	_uiHead = _uiTail = _uiUsed = 0;
+	_uiRecordLeft = 0;
+	_uiBatch = _uiBatchMillis = _uiSending = 0;
+	_bFlush = false;
+	_ulWaiting = 0;
+	_pBuffer = (unsigned char *)malloc(uiSize);
+	_uiSize = _pBuffer ? uiSize : 0; // without a buffer everything is written straight to the sink
+	clearCounters();
+}
+
+void R5BufferedOutput::setPolicy(const unsigned char bPolicy)
+{
+	_bPolicy = bPolicy;
+}
+
+unsigned char R5BufferedOutput::getPolicy(void)
+{
+	return _bPolicy;
+}
+
+void R5BufferedOutput::setBatch(const unsigned int uiBytes, const unsigned int uiMillis)
+{
+	_uiBatch = min(uiBytes, _uiSize);
+	_uiBatchMillis = uiMillis;
+}
+
+void R5BufferedOutput::flush(void)
+{
+	_bFlush = true;
+	drain();
+}
+
+unsigned int R5BufferedOutput::getSize(void)
+{
+	return _uiSize;
+}
+
+unsigned int R5BufferedOutput::getUsed(void)
+{
+	return _uiUsed;
+}
+
+unsigned int R5BufferedOutput::getHighWater(void)
+{
+	return _uiHighWater;
+}
+
+unsigned long R5BufferedOutput::getDropped(void)
+{
+	return _ulDropped;
+}
+
+unsigned long R5BufferedOutput::getDroppedBytes(void)
+{
+	return _ulDroppedBytes;
+}
+
+unsigned long R5BufferedOutput::getBatches(void)
+{
+	return _ulBatches;
+}
+
+unsigned long R5BufferedOutput::getBatchedBytes(void)
+{
+	return _ulBatchedBytes;
+}
+
+unsigned long R5BufferedOutput::getLateBatches(void)
+{
+	return _ulLateBatches;
+}
+
+void R5BufferedOutput::clearCounters(void)
+{
+	_uiHighWater = _uiUsed;
+	_ulDropped = 0;
+	_ulDroppedBytes = 0;
+	_ulBatches = 0;
+	_ulBatchedBytes = 0;
+	_ulLateBatches = 0;
+}
+
+// the buffer position uiOffset bytes on from the next byte to send
+unsigned int R5BufferedOutput::_index(const unsigned int uiOffset)
+{
+	unsigned int uiIndex = _uiTail + uiOffset;
+	return (uiIndex >= _uiSize) ? uiIndex - _uiSize : uiIndex;
+}
+
+// timestamp the data as the sketch always has, e.g. "0000123456 X 10 20 ..."
+void R5BufferedOutput::outputData(const char *pszData)
+{
+	char szMillisBuff[12];
+	static const char PROGMEM szFmt[] = {"%010lu "};
+	snprintf_P(szMillisBuff, sizeof(szMillisBuff), szFmt, millis());
+
+	unsigned int uiMillis = strlen(szMillisBuff);
+	unsigned int uiData = strlen(pszData);
+	unsigned int uiEnd = _bCRLF ? 2 : 1;
+	const unsigned char *pEnd = (const unsigned char *)"\r\n" + (2 - uiEnd);
+
+	if (!_uiSize)
+	{
+		_pSink->write((const unsigned char *)szMillisBuff, uiMillis);
+		_pSink->write((const unsigned char *)pszData, uiData);
+		_pSink->write(pEnd, uiEnd);
+		return;
+	}
+	if (!_makeRoom(uiMillis + uiData + uiEnd))
+		return;
+	_write((const unsigned char *)szMillisBuff, uiMillis, false);
+	_write((const unsigned char *)pszData, uiData, false);
+	_write(pEnd, uiEnd, true);
+}
+
+void R5BufferedOutput::outputVocaliseData(const char *pszData)
+{
+	outputData(pszData);
+}
+
+void R5BufferedOutput::outputFrame(const unsigned char *pFrame, const unsigned int uiLength)
+{
+	if (!_uiSize)
+	{
+		_pSink->write(pFrame, uiLength);
+		return;
+	}
+	if (_makeRoom(uiLength))
+		_write(pFrame, uiLength, true);
+}
+
+// copy into the buffer, which _makeRoom() has made sure has space
+void R5BufferedOutput::_write(const unsigned char *pData, const unsigned int uiLength, const unsigned char bEnd)
+{
+	if (_uiUsed == _uiSending) // the first record of the next batch
+		_ulWaiting = millis();
+	for (unsigned int i = 0; i < uiLength; i++)
+	{
+		_pBuffer[_uiHead++] = pData[i];
+		if (_uiHead >= _uiSize)
+			_uiHead = 0;
+	}
+	_uiUsed += uiLength;
+	if (bEnd && (_uiUsed > _uiHighWater))
+		_uiHighWater = _uiUsed;
+}
+
+// false if the record of uiLength bytes is to be dropped
+unsigned char R5BufferedOutput::_makeRoom(const unsigned int uiLength)
+{
+	if (uiLength <= (_uiSize - _uiUsed))
+		return true;
+
+	if (uiLength <= _uiSize)
+	{
+		if (_bPolicy == R5_OUTPUT_BLOCK)
+		{
+			while (uiLength > (_uiSize - _uiUsed))
+				flush();
+			return true;
+		}
+		if (_bPolicy == R5_OUTPUT_DROP_OLDEST)
+		{
+			while ((uiLength > (_uiSize - _uiUsed)) && _dropOldest())
+				;
+			if (uiLength <= (_uiSize - _uiUsed))
+				return true;
+		}
+	}
+	// too big for the buffer, or dropping the newest
+	_ulDropped++;
+	_ulDroppedBytes += uiLength;
+	return false;
+}
+
+// the length of the record that starts uiOffset bytes on from the next byte to send. A frame
+// starts with a zero and ends at the next one, as COBS leaves none inside it, and may hold any
+// other byte including '\n'. Anything else is text, which ends with a '\n'
+unsigned int R5BufferedOutput::_recordLength(const unsigned int uiOffset)
+{
+	unsigned int i = uiOffset;
+	unsigned char bEnd = '\n';
+
+	if (!_pBuffer[_index(i)])
+	{
+		bEnd = 0;
+		i++;
+	}
+	while ((i < _uiUsed) && (_pBuffer[_index(i++)] != bEnd))
+		;
+	return i - uiOffset;
+}
+
+// remove the oldest record that has not started to go out. If one has, it is kept, and the
+// rest of it moved up against the record after the one dropped
+unsigned char R5BufferedOutput::_dropOldest(void)
+{
+	unsigned int uiKeep = _uiRecordLeft;
+
+	if (uiKeep >= _uiUsed)
+		return false;
+
+	unsigned int uiDrop = _recordLength(uiKeep);
+
+	if (uiKeep < _uiSending) // a batch always ends with a whole record, so this one was all in it
+		_uiSending -= uiDrop;
+	for (unsigned int j = uiKeep; j > 0; j--)
+		_pBuffer[_index(j - 1 + uiDrop)] = _pBuffer[_index(j - 1)];
+	_uiTail = _index(uiDrop);
+	_uiUsed -= uiDrop;
+	_ulDropped++;
+	_ulDroppedBytes += uiDrop;
+	return true;
+}
+
+// pass on what the sink will take without waiting. With batching, what is waiting only starts to
+// go once there is a batch of it, and then all of that batch goes before anything written since.
+// When a batch has gone and there is still room, the next one starts straight away
+void R5BufferedOutput::drain(void)
+{
+	for (;;)
+	{
+		if (!_uiSending)
+		{
+			if (!_uiUsed)
+				return;
+			if (_uiBatch && !_bFlush && (_uiUsed < _uiBatch))
+			{
+				if ((millis() - _ulWaiting) < _uiBatchMillis)
+					return;
+				_ulLateBatches++;
+			}
+			_uiSending = _uiUsed;
+			_bFlush = false;
+			_ulBatches++;
+			_ulBatchedBytes += _uiSending;
+		}
+
+		while (_uiSending)
+		{
+			int nRoom = _pSink->availableForWrite();
+			if (nRoom <= 0)
+				return;
+
+			// as far as the end of the buffer, the rest next time round
+			unsigned int uiCount = _uiSize - _uiTail;
+			if (uiCount > _uiSending)
+				uiCount = _uiSending;
+			if (uiCount > (unsigned int)nRoom)
+				uiCount = nRoom;
+
+			_pSink->write(_pBuffer + _uiTail, uiCount);
+			_uiSending -= uiCount;
+
+			// move on a record at a time, so that where the one going out ends is known
+			while (uiCount)
+			{
+				if (!_uiRecordLeft)
+					_uiRecordLeft = _recordLength(0);
+				unsigned int uiStep = min(uiCount, _uiRecordLeft);
+				_uiRecordLeft -= uiStep;
+				_uiTail = _index(uiStep);
+				_uiUsed -= uiStep;
+				uiCount -= uiStep;
+			}
+		}
+	}
+}
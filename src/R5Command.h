@@ -0,0 +1,72 @@
+// 	Library for Rover 5 Platform Command Registry
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Commands are kept in a table in flash, one R5CommandType for each, sorted by name so that a
+// command is found by binary search rather than by scanning every name. Each entry holds the name,
+// the function that runs it, whether it takes arguments and its help line, so adding a command is
+// adding one entry. The names and help lines are PROGMEM strings of their own, e.g.
+//
+//	const char PROGMEM szCmdRate[] = "RATE";
+//	const char PROGMEM szHelpRate[] = "RATE N - set plan rate";
+//	const R5CommandType PROGMEM myCommands[] = { ..., {szCmdRate, cmdRate, R5_COMMAND_REQUIRED, szHelpRate}, ... };
+//
+// Declare the names and the table constexpr and static_assert(commandsSorted(myCommands, n)) makes
+// a table out of order fail to compile.
+//
+#ifndef _R5COMMAND_H_
+#define _R5COMMAND_H_
+
+// whether a command takes arguments
+#define R5_COMMAND_NONE		0	// any given are ignored
+#define R5_COMMAND_OPTIONAL	1
+#define R5_COMMAND_REQUIRED	2	// the command fails without running if there are none
+
+// what a handler returns, the flags or'd together
+#define R5_COMMAND_FAIL		0x00
+#define R5_COMMAND_DONE		0x01	// the command worked
+#define R5_COMMAND_SAY		0x02	// reply OK or Fail, otherwise the handler has replied itself
+#define R5_COMMAND_OK		(R5_COMMAND_DONE | R5_COMMAND_SAY)
+
+// pArgs is what follows the command name and a space, and may be empty.
+// pMsgBuff is uiBuffLen bytes the handler may use to build its reply
+typedef unsigned char (*R5CommandHandler)(const char *pArgs, char *pMsgBuff, const unsigned int uiBuffLen);
+
+typedef struct {
+	const char *pszName;		// PROGMEM, upper case
+	R5CommandHandler pfnHandler;
+	unsigned char bArgs;		// R5_COMMAND_NONE, R5_COMMAND_OPTIONAL or R5_COMMAND_REQUIRED
+	const char *pszHelp;		// PROGMEM
+} R5CommandType;
+
+// returns the index of the command in the PROGMEM table, or -1 if it is not there
+int findCommand(const char *pszName, const R5CommandType *pTable, const unsigned char bCount);
+// copy entry bIndex out of the PROGMEM table
+void getCommand(R5CommandType *pCommand, const R5CommandType *pTable, const unsigned char bIndex);
+
+// compare names as strcmp() does, but at compile time
+constexpr int compareCommandNames(const char *pszA, const char *pszB)
+{
+	return ((*pszA != *pszB) || !*pszA) ? (*pszA - *pszB) : compareCommandNames(pszA + 1, pszB + 1);
+}
+
+constexpr bool commandsSorted(const R5CommandType *pTable, const unsigned char bCount)
+{
+	return (bCount < 2) || ((compareCommandNames(pTable[0].pszName, pTable[1].pszName) < 0) && commandsSorted(pTable + 1, bCount - 1));
+}
+
+#endif // _R5COMMAND_H_
@@ -0,0 +1,48 @@
+// 	Library for Rover 5 Platform Command Registry
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include "R5Hal.h"
+#include "R5Command.h"
+
+int findCommand(const char *pszName, const R5CommandType *pTable, const unsigned char bCount)
+{
+	int nLow = 0;
+	int nHigh = (int)bCount - 1;
+
+	if (!pszName || !pTable)
+		return -1;
+
+	while (nLow <= nHigh)
+	{
+		int nMid = (nLow + nHigh) / 2;
+		int nCompare = strcmp_P(pszName, (const char *)pgm_read_ptr(&pTable[nMid].pszName));
+		if (!nCompare)
+			return nMid;
+		else if (nCompare < 0)
+			nHigh = nMid - 1;
+		else
+			nLow = nMid + 1;
+	}
+
+	return -1;
+}
+
+void getCommand(R5CommandType *pCommand, const R5CommandType *pTable, const unsigned char bIndex)
+{
+	memcpy_P(pCommand, &pTable[bIndex], sizeof(R5CommandType));
+}
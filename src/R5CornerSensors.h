@@ -29,11 +29,18 @@
 #define R5_RIGHT 3
 #define R5_NONE 4
 
+// the sensor response curves, pairs of distance in mm and reflected light level, furthest first.
+// They are in R5CornerSensors.cpp and also used by the host simulator
+#define R5_IR_MAP_SIZE 18
+extern const int nIRCornerSensorMap[R5_IR_MAP_SIZE];
+extern const int nIRSideCornerSensorMap[R5_IR_MAP_SIZE];
 
+class R5AdcScheduler;
 
 class R5CornerSensors {
 public:
-	R5CornerSensors(const unsigned char *pbSensePins, const unsigned char *pbIRPins);
+	// if pAdc is given the sensor pins are sampled by the scheduler rather than with analogRead()
+	R5CornerSensors(const unsigned char *pbSensePins, const unsigned char *pbIRPins, R5AdcScheduler *pAdc = 0);
 	// the 4 corner sensors and corresponding assumed edge distances & angles are accessed via these arrays
 	// 0 = sensor 1 FR, 1 = sensor 2 FL, 2 = sensor 3 RL, 4 = sensor 4 RR  -- distances are in mm
 	// edges: 0 = front, 1 = left, 2 = rear, 3 = right
@@ -56,6 +63,7 @@ public:
 	int getEdgeAngle(const unsigned int nEdge);
 	unsigned int nearestCorner(void); // returns the index of the nearest corner, or 4 if none
 	unsigned int nearestEdge(void); // returns the index of the nearest edge, or 4 if none
+	unsigned int getSequence(void); // incremented each time a full sense cycle updates the distances
 
 
 private:
@@ -76,6 +84,11 @@ private:
 
 	int _sensorRange;
 	int _edgeRange;
+	R5AdcScheduler *_pAdc;
+	unsigned int _uiLEDSequence; // the ADC sequence number when the IR LEDs last changed
+	unsigned int _uiSequence;
+	int _readSensor(const unsigned int nSensor);
+	void _LEDsChanged(void);
 	void _calculateDistances(void);
 	int _mapCornerSensor(int nSensorValue );
 	int _mapSideCornerSensor(int nSensorValue );
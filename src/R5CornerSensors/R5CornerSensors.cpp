@@ -15,12 +15,14 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
-#include "Arduino.h"
+#include "R5Hal.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
 #include "R5CornerSensors.h"
 
 // this maps distance (600-50) to reflected light level (0-690)
 // it was measured using white cardboard at 45' to each sensor corner
-const int nIRCornerSensorMap[] =
+extern const int nIRCornerSensorMap[R5_IR_MAP_SIZE] =
 		{600,  0,
 		 500, 10,
 		 400, 17,
@@ -33,7 +35,7 @@ const int nIRCornerSensorMap[] =
 
 // this maps distance (600-50) to reflected light level (0-186)
 // it was measured using white cardboard parallel each side
-const int nIRSideCornerSensorMap[] =
+extern const int nIRSideCornerSensorMap[R5_IR_MAP_SIZE] =
 		{600,  0,
 		 500,  1,
 		 400,  3,
@@ -93,11 +95,14 @@ int R5CornerSensors::_mapSideCornerSensor( int nSensorValue )
 }
 
 // constructor requires identification of input and output pins
-R5CornerSensors::R5CornerSensors(const unsigned char *pbSensePins, const unsigned char *pbIRPins)
+R5CornerSensors::R5CornerSensors(const unsigned char *pbSensePins, const unsigned char *pbIRPins, R5AdcScheduler *pAdc)
 {
 	memcpy(_sensePins, pbSensePins, sizeof(_sensePins));
 	memcpy(_IRPins, pbIRPins, sizeof(_IRPins));
 	_state = 0;
+	_pAdc = pAdc;
+	_uiLEDSequence = 0;
+	_uiSequence = 0;
 	// set all the array variables to zero
 	for ( int i = 0; i < 4; i++)
 	{
@@ -118,9 +123,24 @@ R5CornerSensors::R5CornerSensors(const unsigned char *pbSensePins, const unsigne
 	{
 		pinMode(_IRPins[i], OUTPUT);
 		digitalWrite(_IRPins[i], LOW);
+		if (_pAdc)
+			_pAdc->addChannel(_sensePins[i]);
 	}
 }
 
+// read a sensor either from the ADC scheduler or directly
+int R5CornerSensors::_readSensor(const unsigned int nSensor)
+{
+	return _pAdc ? _pAdc->getSample(_sensePins[nSensor]) : analogRead(_sensePins[nSensor]);
+}
+
+// samples taken by the scheduler before this point may have been taken with the old LED state
+void R5CornerSensors::_LEDsChanged(void)
+{
+	if (_pAdc)
+		_uiLEDSequence = _pAdc->getSequence();
+}
+
 // puts the sensors into pasue mode to save power
 unsigned char R5CornerSensors::setPause(const unsigned char bPause)
 {
@@ -130,6 +150,7 @@ unsigned char R5CornerSensors::setPause(const unsigned char bPause)
 		{
 			digitalWrite(_IRPins[i], LOW);
 		}
+		_LEDsChanged();
 		_state = 3;
 		return true;
 	}
@@ -150,36 +171,45 @@ unsigned char R5CornerSensors::getPause(void)
 
 unsigned char R5CornerSensors::sense()
 {
+	// the scheduler samples all the time, so wait until a complete pass has been published
+	// that started after the LEDs last changed. That is two increments of the sequence number
+	if (_pAdc && (_state != 3) && ((unsigned int)(_pAdc->getSequence() - _uiLEDSequence) < 2))
+		return _state;
+
 	switch(_state)
 	{
 		case 0: // measure ambient IR and store {all IR LEDS off}, pulse on 1 & 3
 			for (unsigned int i = 0; i < 4; i++)
 			{
-				passiveLevel[i] = analogRead(_sensePins[i]);
+				passiveLevel[i] = _readSensor(i);
 			}
 			digitalWrite(_IRPins[0], HIGH);
 			digitalWrite(_IRPins[2], HIGH);
+			_LEDsChanged();
 			_state++;
 			break;
 
 		case 1: // measure 1 & 3, pulse off 1&3, pulse on 2 & 4
-			activeLevel[0] = analogRead(_sensePins[0]);
-			activeLevel[2] = analogRead(_sensePins[2]);
+			activeLevel[0] = _readSensor(0);
+			activeLevel[2] = _readSensor(2);
 			digitalWrite(_IRPins[0], LOW);
 			digitalWrite(_IRPins[2], LOW);
 			digitalWrite(_IRPins[1], HIGH);
 			digitalWrite(_IRPins[3], HIGH);
+			_LEDsChanged();
 			_state++;
 			break;
 
 		case 2: // measure 2 & 4, pulse off 2 & 4
-			activeLevel[1] = analogRead(_sensePins[1]);
-			activeLevel[3] = analogRead(_sensePins[3]);
+			activeLevel[1] = _readSensor(1);
+			activeLevel[3] = _readSensor(3);
 			digitalWrite(_IRPins[1], LOW);
 			digitalWrite(_IRPins[3], LOW);
+			_LEDsChanged();
 
 			// we've been round all states, so calculate distance values
 			_calculateDistances();
+			_uiSequence++;
 			_state = 0;
 			break;
 
@@ -292,6 +322,11 @@ int R5CornerSensors::getEdgeAngle(const unsigned int nEdge)
 	return _edgeAngle[nEdge % 4];
 }
 
+unsigned int R5CornerSensors::getSequence(void)
+{
+	return _uiSequence;
+}
+
 
 // calculates the measured distances based on measurements, bleed level and estimated range.
 // currently assumes linear sensor feedback, and equal range for all sensors
@@ -342,9 +377,8 @@ void R5CornerSensors::_calculateDistances(void)
 
 		// R5 sensors are ~ 200mm apart on sides, 150mm front/back
 		// and we need 200 / cos 45 = 282.84, 150 / cos 45 = 212.13
-		// 1 radian ~ 57.3 degrees
-		_edgeAngle[i] = (int)(57.3 * atan( (double)(corner1 - corner2) /
-								(double)(corner1 + corner2 + ((i % 2) ? 212 : 283) ) ) );
+		// the denominator is always positive so the angle is within +-45 degrees
+		_edgeAngle[i] = R5FixedMath::atan2Deg(corner1 - corner2, corner1 + corner2 + ((i % 2) ? 212 : 283));
 	}
 }
 
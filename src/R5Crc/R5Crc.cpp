@@ -0,0 +1,29 @@
+// 	Library for Rover 5 Platform CRC
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include "R5Crc.h"
+
+// bitwise rather than a table, to keep the 512 byte table out of flash
+unsigned int crc16Update(const unsigned int uiCRC, const unsigned char bByte)
+{
+	unsigned int uiRtn = uiCRC ^ ((unsigned int)bByte << 8);
+
+	for (unsigned char i = 0; i < 8; i++)
+		uiRtn = (uiRtn & 0x8000) ? (uiRtn << 1) ^ 0x1021 : (uiRtn << 1);
+	return uiRtn & 0xFFFF;
+}
@@ -0,0 +1,45 @@
+// 	Library for Rover 5 Platform Fixed Point Maths
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Table driven trigonometry in integer maths, to avoid the soft float library on the AVR.
+// The tables are in PROGMEM. Sines and cosines are returned in Q14 format, i.e. 16384 = 1.0
+//
+// Error bounds, measured against libm over the full range of inputs:
+// sinDeg(), cosDeg()			- whole degrees, read directly from the table. Max error 0.5 LSB (3.1e-5)
+// sinDeg100(), cosDeg100()		- hundredths of a degree, interpolated. Max error 1.4 LSB (8.1e-5)
+// atan2Deg100()				- hundredths of a degree, interpolated. Max error 1.4 (i.e. 0.014 degrees)
+// atan2Deg()					- whole degrees, rounded to nearest. Max error 0.52 degrees
+// sqrtL()						- integer square root, rounded down. Exact
+//
+#ifndef _R5FIXEDMATH_H_
+#define _R5FIXEDMATH_H_
+
+#define R5_FM_ONE	16384	// 1.0 in Q14 format
+#define R5_FM_SHIFT	14
+
+class R5FixedMath {
+public:
+	static int sinDeg(const int nDegrees);
+	static int cosDeg(const int nDegrees);
+	static int sinDeg100(const long lCentiDegrees);
+	static int cosDeg100(const long lCentiDegrees);
+	static int atan2Deg100(const int nY, const int nX); // -18000 to 18000
+	static int atan2Deg(const int nY, const int nX); // -180 to 180
+	static unsigned int sqrtL(const unsigned long ulValue);
+};
+
+#endif // _R5FIXEDMATH_H_
@@ -0,0 +1,174 @@
+// 	Library for Rover 5 Platform Fixed Point Maths
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5FixedMath.h"
+
+// sin(0..90 degrees) in Q14
+const int nSinTable[] PROGMEM =
+		{
+		    0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+		 2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+		 5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+		 8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+		10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+		12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+		14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+		15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+		16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+		16384};
+
+// atan(i/64) for i = 0..64 in hundredths of a degree
+const int nAtanTable[] PROGMEM =
+		{
+		    0,    90,   179,   268,   358,   447,   536,   624,   713,   800,
+		  888,   975,  1062,  1148,  1234,  1319,  1404,  1488,  1571,  1653,
+		 1735,  1817,  1897,  1977,  2056,  2134,  2211,  2287,  2363,  2438,
+		 2511,  2584,  2657,  2728,  2798,  2867,  2936,  3003,  3070,  3136,
+		 3201,  3264,  3327,  3390,  3451,  3511,  3571,  3629,  3687,  3744,
+		 3800,  3855,  3909,  3963,  4016,  4067,  4119,  4169,  4218,  4267,
+		 4315,  4363,  4409,  4455,  4500};
+
+// whole degrees, any value
+int R5FixedMath::sinDeg(const int nDegrees)
+{
+	int nAngle = nDegrees % 360;
+	int nSign = 1;
+
+	if (nAngle < 0)
+		nAngle += 360;
+	if (nAngle >= 180) // sin(x) = -sin(x - 180)
+	{
+		nAngle -= 180;
+		nSign = -1;
+	}
+	if (nAngle > 90) // sin(x) = sin(180 - x)
+		nAngle = 180 - nAngle;
+
+	return nSign * (int)pgm_read_word(&nSinTable[nAngle]);
+}
+
+int R5FixedMath::cosDeg(const int nDegrees)
+{
+	return sinDeg(90 - (nDegrees % 360));
+}
+
+// hundredths of a degree, interpolating between whole degrees in the table
+int R5FixedMath::sinDeg100(const long lCentiDegrees)
+{
+	int nAngle = (int)(lCentiDegrees % 36000L);
+	int nSign = 1;
+	int nIndex;
+	int nSine;
+
+	if (nAngle < 0)
+		nAngle += 36000;
+	if (nAngle >= 18000)
+	{
+		nAngle -= 18000;
+		nSign = -1;
+	}
+	if (nAngle > 9000)
+		nAngle = 18000 - nAngle;
+
+	nIndex = nAngle / 100;
+	nSine = (int)pgm_read_word(&nSinTable[nIndex]);
+	if (nIndex < 90)
+	{
+		// the table steps are at most 286, so this fits in an int
+		int nStep = (int)pgm_read_word(&nSinTable[nIndex + 1]) - nSine;
+		nSine += ((nStep * (nAngle - (nIndex * 100))) + 50) / 100; // rounded
+	}
+
+	return nSign * nSine;
+}
+
+int R5FixedMath::cosDeg100(const long lCentiDegrees)
+{
+	return sinDeg100(9000L - (lCentiDegrees % 36000L));
+}
+
+// the angle of the vector (nX, nY) from the x axis, in hundredths of a degree
+// works in the first octant by taking the ratio of the smaller to the larger component
+int R5FixedMath::atan2Deg100(const int nY, const int nX)
+{
+	unsigned int uiY = (nY < 0) ? -(long)nY : nY;
+	unsigned int uiX = (nX < 0) ? -(long)nX : nX;
+	unsigned char bSwap = (uiY > uiX);
+	unsigned int uiRatio;
+	unsigned char bIndex;
+	int nAngle;
+
+	if (!uiX && !uiY)
+		return 0;
+
+	// ratio of smaller to larger in Q14, so 0..16384
+	if (bSwap)
+		uiRatio = ((unsigned long)uiX << R5_FM_SHIFT) / uiY;
+	else
+		uiRatio = ((unsigned long)uiY << R5_FM_SHIFT) / uiX;
+
+	// 64 table steps, and 256 interpolation steps between them
+	bIndex = uiRatio >> 8;
+	nAngle = (int)pgm_read_word(&nAtanTable[bIndex]);
+	if (bIndex < 64)
+	{
+		int nStep = (int)pgm_read_word(&nAtanTable[bIndex + 1]) - nAngle;
+		nAngle += (int)((((long)nStep * (uiRatio & 0xFF)) + 128) >> 8); // rounded
+	}
+
+	if (bSwap)
+		nAngle = 9000 - nAngle;
+	if (nX < 0)
+		nAngle = 18000 - nAngle;
+	if (nY < 0)
+		nAngle = -nAngle;
+
+	return nAngle;
+}
+
+// whole degrees, rounded to nearest
+int R5FixedMath::atan2Deg(const int nY, const int nX)
+{
+	int nAngle = atan2Deg100(nY, nX);
+
+	return (nAngle < 0) ? -((50 - nAngle) / 100) : ((nAngle + 50) / 100);
+}
+
+// integer square root, one result bit per iteration
+unsigned int R5FixedMath::sqrtL(const unsigned long ulValue)
+{
+	unsigned long ulRem = ulValue;
+	unsigned long ulRoot = 0;
+	unsigned long ulBit = 1UL << 30;
+
+	while (ulBit > ulRem)
+		ulBit >>= 2;
+
+	while (ulBit)
+	{
+		if (ulRem >= ulRoot + ulBit)
+		{
+			ulRem -= ulRoot + ulBit;
+			ulRoot = (ulRoot >> 1) + ulBit;
+		}
+		else
+			ulRoot >>= 1;
+		ulBit >>= 2;
+	}
+	return (unsigned int)ulRoot;
+}
@@ -0,0 +1,60 @@
+// 	Library for Rover 5 Platform Hardware Abstraction
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// All of the R5 library reaches the hardware through this header.
+// On the robot it is the Arduino core, plus the Servo and EEPROM libraries. Define R5_HAL_HOST and
+// the same interface is provided by R5HalHost.h (in extras/host) so the library builds and runs on Linux.
+//
+// The interface the library may use is:
+// GPIO		pinMode, digitalWrite, digitalRead, analogWrite
+// ADC		analogRead, or R5Hal::adcStart() to convert in the background
+// Time		millis, micros, delay, delayMicroseconds
+// Pulses	pulseIn, R5Hal::attachPinChange, R5Hal::detachPinChange, noInterrupts, interrupts
+// Servo	Servo::attach, write, read
+// EEPROM	EEPROM.read, update, length
+// Stream	Stream, Serial, and Print::availableForWrite() to write without blocking
+// and the PROGMEM helpers PROGMEM, pgm_read_byte, pgm_read_word, pgm_read_ptr, snprintf_P
+//
+#ifndef _R5HAL_H_
+#define _R5HAL_H_
+
+#if defined(R5_HAL_HOST)
+#include "R5HalHost.h"
+#else
+#include "Arduino.h"
+#include "Servo.h" // adding this include uses 139 bytes of RAM somehow
+#include "EEPROM.h"
+#endif
+
+// Interrupt callbacks are given back the context pointer they were registered with, so the library
+// keeps no static pointers to its objects and any number of robots can run side by side on the host.
+
+// called with the result when a background conversion completes. On the robot this is from the interrupt
+typedef void (*R5AdcCallback)(void *pContext, const int nValue);
+// called from the external interrupt when a pin changes state
+typedef void (*R5PinCallback)(void *pContext);
+
+class R5Hal {
+public:
+	static void adcStart(const unsigned char bPin, R5AdcCallback pfnCallback, void *pContext); // start one conversion
+	static void adcStop(void); // no more callbacks, leave the ADC for analogRead()
+	// on the Mega pins 2, 3, 18, 19, 20, 21 can interrupt. Returns false for any other pin
+	static unsigned char attachPinChange(const unsigned char bPin, R5PinCallback pfnCallback, void *pContext);
+	static void detachPinChange(const unsigned char bPin);
+};
+
+#endif // _R5HAL_H_
@@ -0,0 +1,115 @@
+// 	Library for Rover 5 Platform Hardware Abstraction
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// The AVR backend for R5Hal. The host backend is in extras/host/R5HalHost.cpp
+//
+#if !defined(R5_HAL_HOST)
+
+#include "R5Hal.h"
+
+#define R5_HAL_PIN_INTERRUPTS 6
+
+static volatile R5AdcCallback _pfnAdcCallback = 0;
+static void * volatile _pAdcContext = 0;
+
+// the Arduino core calls a plain function for each external interrupt, so there is one
+// small function per interrupt that passes on the registered context
+static const unsigned char _bPinInterruptPins[R5_HAL_PIN_INTERRUPTS] = {2, 3, 21, 20, 19, 18};
+static volatile R5PinCallback _pfnPinCallback[R5_HAL_PIN_INTERRUPTS];
+static void * volatile _pPinContext[R5_HAL_PIN_INTERRUPTS];
+
+template <int N> static void _pinChangeISR(void)
+{
+	if (_pfnPinCallback[N])
+		(*_pfnPinCallback[N])(_pPinContext[N]);
+}
+
+static void (* const _pfnPinISR[R5_HAL_PIN_INTERRUPTS])(void) =
+	{_pinChangeISR<0>, _pinChangeISR<1>, _pinChangeISR<2>, _pinChangeISR<3>, _pinChangeISR<4>, _pinChangeISR<5>};
+
+// index of the pin in the tables above, or R5_HAL_PIN_INTERRUPTS if it can't interrupt
+static unsigned char _pinInterruptIndex(const unsigned char bPin)
+{
+	unsigned char i;
+
+	for (i = 0; i < R5_HAL_PIN_INTERRUPTS; i++)
+	{
+		if (_bPinInterruptPins[i] == bPin)
+			break;
+	}
+	return i;
+}
+
+// select the channel and start a single conversion with the interrupt enabled
+// this is what analogRead() does, except that we don't wait for the result
+void R5Hal::adcStart(const unsigned char bPin, R5AdcCallback pfnCallback, void *pContext)
+{
+	unsigned char bChannel = bPin;
+
+	if (bChannel >= A0)
+		bChannel -= A0; // allow for pins given as A0.. or as channel numbers
+
+	_pfnAdcCallback = pfnCallback;
+	_pAdcContext = pContext;
+#if defined(MUX5)
+	ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((bChannel >> 3) & 0x01) << MUX5);
+#endif
+	ADMUX = (DEFAULT << 6) | (bChannel & 0x07); // same reference as analogRead()
+	ADCSRA |= (1 << ADSC) | (1 << ADIE);
+}
+
+void R5Hal::adcStop(void)
+{
+	ADCSRA &= ~(1 << ADIE);
+	_pfnAdcCallback = 0;
+}
+
+ISR(ADC_vect)
+{
+	int nValue = ADC; // reads ADCL then ADCH
+
+	if (_pfnAdcCallback)
+		(*_pfnAdcCallback)(_pAdcContext, nValue);
+}
+
+unsigned char R5Hal::attachPinChange(const unsigned char bPin, R5PinCallback pfnCallback, void *pContext)
+{
+	unsigned char i = _pinInterruptIndex(bPin);
+
+	if (i >= R5_HAL_PIN_INTERRUPTS)
+		return false;
+
+	noInterrupts();
+	_pfnPinCallback[i] = pfnCallback;
+	_pPinContext[i] = pContext;
+	interrupts();
+	attachInterrupt(digitalPinToInterrupt(bPin), _pfnPinISR[i], CHANGE);
+	return true;
+}
+
+void R5Hal::detachPinChange(const unsigned char bPin)
+{
+	unsigned char i = _pinInterruptIndex(bPin);
+
+	if (i >= R5_HAL_PIN_INTERRUPTS)
+		return;
+
+	detachInterrupt(digitalPinToInterrupt(bPin));
+	_pfnPinCallback[i] = 0;
+}
+
+#endif // !R5_HAL_HOST
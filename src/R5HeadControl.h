@@ -34,13 +34,14 @@ public:
 	unsigned char getParalyse(void);
 	void lookAhead(void);
 	void lookNearestSide(void);
-	void driveHead(void);	// called my the main loop to give cpu to the head
+	virtual void driveHead(void);	// called my the main loop to give cpu to the head
 
 protected:
 	virtual void notifyHEndstop(const unsigned char bScanDirection, const unsigned char bServoPosition);
 	virtual void notifyHMovement(const unsigned char bScanDirection, const unsigned char bServoPosition);
 	virtual void notifyVEndstop(const unsigned char bScanDirection, const unsigned char bServoPosition);
 	virtual void notifyVMovement(const unsigned char bScanDirection, const unsigned char bServoPosition);
+	virtual void notifyHScanParams(void); // the horizontal servo range has changed
 
 	// these params are protected so they can be accessed by the R5SensingHead class
 	Servo *_pServoHHead;				// the servo itself
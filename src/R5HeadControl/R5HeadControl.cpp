@@ -17,8 +17,7 @@
 //
 // This class supports the basic head with 2 degrees of freedom, but no attached sensors
 //
-#include "Arduino.h"
-#include "Servo.h" // adding this include uses 139 bytes of RAM somehow
+#include "R5Hal.h"
 #include "R5HeadControl.h"
 
 // constructor requires identification of servos
@@ -72,6 +71,7 @@ void R5HeadControl::setHScanParams(const unsigned char bMinServoMovement, const
 	_bHMinServoMovement = bMinServoMovement;
 	_bHMinServoPosition = bMinServoPosition;
 	_bHMaxServoPosition = bMaxServoPosition;
+	notifyHScanParams();
 }
 
 // Sets the scan interval for one complete horizontal sweep in mS. Set to zero to stop scanning
@@ -222,3 +222,7 @@ void R5HeadControl::notifyVMovement(const unsigned char bScanDirection, const un
 {
 }
 
+void R5HeadControl::notifyHScanParams(void)
+{
+}
+
@@ -32,13 +32,69 @@
 #define R5_ROTATE	2	// busy turning on the spot
 #define R5_DRIVE	3	// busy moving forwards in a straight line
 #define R5_REVERSE	4	// busy moving backwards in a straight line
+#define R5_SEGMENT	5	// busy working through the segment queue
 
 #define R5_CNTPER1000MM	1538L // this is the number of quadrature detector clicks per 1000mm travelled.
 #define R5_CNTPER100DEG	630L // how many quad clicks to turn 100'
 
+// odometry. Heading comes from the difference in track clicks, calibrated by R5_CNTPER100DEG, which
+// gives an effective track width of 2 * (630 / 1538) * 1000mm / (100 * PI / 180) = ~470mm.
+// Position is kept in 1/64 half clicks (the average of the two tracks) and converted to mm when read
+#define R5_POSE_SHIFT	6
+
+// the position and heading of the robot since resetPose()
+// x is in the direction the robot faced at the reset, y is to its right. Heading is in 1/100 degree, 0 to 35999, clockwise
+typedef struct {
+	long lX;		// mm
+	long lY;		// mm
+	int nHeading;	// 1/100 degree
+} R5PoseType;
+
+// motion segments are queued and then run back to back by driveMotors(), without waiting for the planner.
+// Drive, rotate and arc segments are all arcs, given by the clicks each track must move
+#define R5_SEGMENT_QUEUE_SIZE	6
+#define R5_SEG_ARC		0
+#define R5_SEG_PAUSE	1
+#define R5_SEGMENT_STALL	1000 // mS an arc can go without a click from either track before the queue is aborted
+
+typedef struct {
+	unsigned char bType;
+	long lLeftTicks;	// R5_SEG_PAUSE uses lLeftTicks as mS
+	long lRightTicks;
+} R5MotionSegmentType;
+
+// wheel velocity is estimated from the times at which the encoder counts changed.
+// At speed it is the clicks over the last R5_VEL_WINDOW uS, and when the clicks are further apart
+// than that it is 1 / the time between the last two clicks. With no clicks for R5_VEL_TIMEOUT uS it is zero
+#define R5_VEL_SAMPLES	8 // per wheel
+#define R5_VEL_WINDOW	50000UL
+#define R5_VEL_TIMEOUT	500000UL
+
+// closed loop speed control. The drive % is taken as a % of R5_CNTPERSEC_MAX, and each track is
+// corrected every R5_SPEED_PERIOD mS using PID gains that are in units of 1/R5_GAIN_SCALE
+#define R5_CNTPERSEC_MAX	430L // approx quad clicks per second at 100% drive on a charged battery
+#define R5_SPEED_PERIOD		20 // mS between speed corrections
+#define R5_GAIN_SCALE		16
+#define R5_DEFAULT_KP		8
+#define R5_DEFAULT_KI		2
+#define R5_DEFAULT_KD		0
+
+// move() and stopAndRotate() follow a trapezoidal profile, accelerating away from the start and
+// decelerating into the target. Acceleration is in % per second. An acceleration of 0 drives at the
+// fixed 60% speed / 70% rudder instead
+#define R5_DEFAULT_MAXSPEED	80
+#define R5_DEFAULT_ACCEL	200
+#define R5_PROFILE_MINSPEED	25 // the slowest the tracks will reliably turn
+#define R5_PROFILE_MAXACCEL	1000 // keeps 2 * a * d in _profileSpeed() within an unsigned long
+#define R5_PROFILE_SYNC		4 // % correction per click one track is ahead of the other
+
+class R5AdcScheduler;
+
 class R5MotorControl {
 public:
-	R5MotorControl(const unsigned char *pbDrivePins, const unsigned char *pbDirectionPins, const unsigned char *pbCurrentSensePins);
+	// if pAdc is given the current sense pins are sampled by the scheduler rather than with analogRead()
+	R5MotorControl(const unsigned char *pbDrivePins, const unsigned char *pbDirectionPins, const unsigned char *pbCurrentSensePins,
+					R5AdcScheduler *pAdc = 0);
 
 	// these commands return R5_PENDING if a high level command is underway
 	// if the command is completed then they return R5_SUCCESS
@@ -54,11 +110,20 @@ public:
 	unsigned char getParalyse(void);
 	unsigned char getReverse(void);
 	unsigned char resetDistanceTravelled(void); // reset the distance counter
+	unsigned char resetPose(void); // the current position becomes (0, 0) with heading 0
+	void getPose(R5PoseType *pPose);
+	unsigned char setSpeedControl(const unsigned char bEnable); // enable closed loop track speed control
+	unsigned char getSpeedControl(void);
+	unsigned char setSpeedGains(const int nKp, const int nKi, const int nKd); // gains are in 1/R5_GAIN_SCALE units
+	void getSpeedGains(int *pnKp, int *pnKi, int *pnKd);
+	unsigned char setMotionLimits(const int nMaxSpeed, const int nAccel); // speed in %, acceleration in % per second
+	void getMotionLimits(int *pnMaxSpeed, int *pnAccel);
 
 	int getSpeed(void);
 	int getRudder(void);
 	int getMotorCurrent(const unsigned char bMotor);
 	long getDistanceTravelled(void); // returns distance travelled in mm (approximately!)
+	int getWheelVelocity(const unsigned char bMotor); // mm/s. 0 = average of two tracks, 1 = left, 2 = right
 	unsigned char getBehaviourState(void); 	// returns the internal state of the behaviour
     										// T5_NORMAL - not doing any specific movement just moving according
     										//			to speed and rudder
@@ -79,6 +144,16 @@ public:
 	unsigned char driveForward(const int nDistance, const unsigned char bCheckForComplete); // drive forward mm
 	unsigned char driveBackward(const int nDistance, const unsigned char bCheckForComplete); // drive backward mm
 
+	// the segment queue. Segments start when the robot is not busy with another movement command, and
+	// then follow each other as soon as the previous one is complete. The queue commands return R5_FAIL when it is full
+	unsigned char queueDrive(const int nDistance); // mm forward or backward
+	unsigned char queueRotate(const int nAngle); // degrees, positive is right
+	unsigned char queueArc(const int nDistance, const int nAngle); // move nDistance mm while turning nAngle degrees
+	unsigned char queuePause(const unsigned int uiMillis);
+	unsigned char abortSegments(void); // empty the queue and stop
+	unsigned char getSegmentsQueued(void); // including the one running
+	unsigned char getSegmentStatus(void); // R5_IN_PROGRESS while running, R5_FAIL if aborted, otherwise R5_SUCCESS
+
 	void driveMotors(const long lLeftRead, const long lRightRead); // need to call this in main loop to affect outputs
 
 private:
@@ -98,9 +173,57 @@ private:
 	long _rightQuadRead;
 	long _leftQuadDesired;
 	long _rightQuadDesired;
+	long _leftQuadStart;	// quad reads at the start of a manoeuvre
+	long _rightQuadStart;
+	int _nMaxSpeed;
+	int _nAccel;
+
+	// segment queue
+	R5MotionSegmentType _segments[R5_SEGMENT_QUEUE_SIZE];
+	unsigned char _bSegmentHead;	// the segment running or next to run
+	unsigned char _bSegmentCount;
+	unsigned char _bSegmentAborted;
+	unsigned long _ulSegmentStart;	// millis() when a pause started
+	unsigned long _ulSegmentMoved;	// millis() when a track last moved, or the segment started
+
+	// encoder samples for velocity estimation, a ring buffer per wheel
+	unsigned long _ulSampleMicros[2][R5_VEL_SAMPLES];
+	long _lSampleCount[2][R5_VEL_SAMPLES];
+	unsigned char _bSampleHead[2];	// the newest sample
+	unsigned char _bSamples[2];		// how many of the samples are valid
+
+	// odometry
+	long _lPoseX;			// 1/(1 << R5_POSE_SHIFT) half clicks
+	long _lPoseY;
+	long _lHeadingClicks;	// total left clicks - right clicks since resetPose()
+	int _nHeading;			// 1/100 degree, 0 to 35999
 	unsigned char _behaviourState;
+	R5AdcScheduler *_pAdc;
+
+	// closed loop speed control
+	unsigned char _speedControl;
+	int _nKp;
+	int _nKi;
+	int _nKd;
+	unsigned long _ulControlMillis;	// when the last correction was made
+	long _lControlQuadRead[2];		// quad reads at the last correction
+	long _lIntegral[2];
+	int _nMeasured[2];				// measured track speed as a % of R5_CNTPERSEC_MAX
+	int _nDrive[2];					// corrected drive % for each track
 
+	int _readCurrent(const unsigned char bMotor);
 	void _calculateOutputs(void);
+	void _controlSpeed(void);
+	int _controlTrack(const unsigned char bMotor, const int nTarget, const long lTicks, const unsigned long ulElapsed);
+	void _resetSpeedControl(void);
+	void _profileOutputs(void);
+	void _updatePose(const long lLeftDist, const long lRightDist);
+	void _sampleEncoder(const unsigned char bWheel, const long lCount, const unsigned long ulMicros);
+	long _estimateVelocity(const unsigned char bWheel, const unsigned long ulMicros);
+	unsigned char _queueSegment(const unsigned char bType, const long lLeftTicks, const long lRightTicks);
+	void _startSegment(void);
+	unsigned char _driveSegment(void);
+	int _profileSpeed(const long lTicks);
 };
 
 
@@ -15,24 +15,43 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
-#include "Arduino.h"
+#include "R5Hal.h"
+#include "R5AdcScheduler.h"
+#include "R5FixedMath.h"
 #include "R5MotorControl.h"
 
 
 // constructor requires identification of output pins for speed and direction control
-R5MotorControl::R5MotorControl(const unsigned char *pbDrivePins, const unsigned char *pbDirectionPins, const unsigned char *pbCurrentSensePins)
+R5MotorControl::R5MotorControl(const unsigned char *pbDrivePins, const unsigned char *pbDirectionPins, const unsigned char *pbCurrentSensePins,
+								R5AdcScheduler *pAdc)
 {
 	memcpy(_drivePins, pbDrivePins, sizeof(_drivePins));
 	memcpy(_directionPins, pbDirectionPins, sizeof(_directionPins));
 	memcpy(_currentSensePins, pbCurrentSensePins, sizeof(_currentSensePins));
 	_speed = 0;
 	_rudder = 0;
+	_reverse = false;
 	_m1 = _m2 = 0;
 	_paralyse = false;
 	_distanceTravelled = 0L;
 	_leftQuadRead = _rightQuadRead = 0L;
 	_leftQuadDesired = _rightQuadDesired = 0L;
+	_leftQuadStart = _rightQuadStart = 0L;
+	_nMaxSpeed = R5_DEFAULT_MAXSPEED;
+	_nAccel = R5_DEFAULT_ACCEL;
+	resetPose();
+	_bSampleHead[0] = _bSampleHead[1] = 0;
+	_bSamples[0] = _bSamples[1] = 0;
+	_bSegmentHead = _bSegmentCount = 0;
+	_bSegmentAborted = false;
+	_ulSegmentStart = _ulSegmentMoved = 0L;
 	_behaviourState = R5_NORMAL;
+	_pAdc = pAdc;
+	_speedControl = false;
+	_nKp = R5_DEFAULT_KP;
+	_nKi = R5_DEFAULT_KI;
+	_nKd = R5_DEFAULT_KD;
+	_resetSpeedControl();
 
 
 	// set the output pins to output, direction to forward and speed to zero
@@ -44,9 +63,17 @@ R5MotorControl::R5MotorControl(const unsigned char *pbDrivePins, const unsigned
 		pinMode(_directionPins[i], OUTPUT);
 		digitalWrite(_directionPins[i], LOW);
 		pinMode(_currentSensePins[i], INPUT);
+		if (_pAdc)
+			_pAdc->addChannel(_currentSensePins[i]);
 	}
 }
 
+// read a current sense pin either from the ADC scheduler or directly
+int R5MotorControl::_readCurrent(const unsigned char bMotor)
+{
+	return _pAdc ? _pAdc->getSample(_currentSensePins[bMotor]) : analogRead(_currentSensePins[bMotor]);
+}
+
 // read the motor current in mA. 0 = sum of two motors, 1 = left, 2 = right
 // analogRead() returns 1023 for 5A -> 5mA per unit
 int R5MotorControl::getMotorCurrent(const unsigned char bMotor)
@@ -57,16 +84,16 @@ int R5MotorControl::getMotorCurrent(const unsigned char bMotor)
 	switch (bMotor)
 	{
 		case 0:
-			nLeftMotor = analogRead(_currentSensePins[0]);
-			nRightMotor = analogRead(_currentSensePins[1]);
+			nLeftMotor = _readCurrent(0);
+			nRightMotor = _readCurrent(1);
 			nCurrent = 5 * ( nLeftMotor + nRightMotor );
 			break;
 		case 1:
-			nLeftMotor = analogRead(_currentSensePins[0]);
+			nLeftMotor = _readCurrent(0);
 			nCurrent = 5 * nLeftMotor;
 			break;
 		case 2:
-			nRightMotor = analogRead(_currentSensePins[1]);
+			nRightMotor = _readCurrent(1);
 			nCurrent = 5 * nRightMotor;
 			break;
 	}
@@ -77,6 +104,11 @@ int R5MotorControl::getMotorCurrent(const unsigned char bMotor)
 // whatever we are doing, abort and stop now
 unsigned char R5MotorControl::stop(void)
 {
+	if (_bSegmentCount)
+	{
+		_bSegmentCount = 0;
+		_bSegmentAborted = true;
+	}
 	_behaviourState = R5_STOPPED;
 	_speed = 0;
 	_rudder = 0;
@@ -137,6 +169,8 @@ unsigned char R5MotorControl::stopAndRotate(const int nAngle, const unsigned cha
 		long lTicks = ((long)nAngle * R5_CNTPER100DEG) / 100L;
 		_leftQuadDesired = _leftQuadRead + lTicks;
 		_rightQuadDesired = _rightQuadRead - lTicks;
+		_leftQuadStart = _leftQuadRead;
+		_rightQuadStart = _rightQuadRead;
 
 		// then set speed and rudder
 		_speed = 0; // rotating on the spot
@@ -171,6 +205,8 @@ unsigned char R5MotorControl::move(const int nDistance, const unsigned char bChe
 		lTicks = (lTicks * R5_CNTPER1000MM) / 1000;
 		_leftQuadDesired = _leftQuadRead + lTicks;
 		_rightQuadDesired = _rightQuadRead + lTicks;
+		_leftQuadStart = _leftQuadRead;
+		_rightQuadStart = _rightQuadRead;
 
 		// then set speed and rudder
 		_speed = 60; // set speed to 60% for now - maybe make dependent on distance
@@ -262,11 +298,458 @@ long R5MotorControl::getDistanceTravelled(void)
 	return _distanceTravelled;
 }
 
+// returns the velocity in mm/s. 0 = average of two tracks, 1 = left, 2 = right
+int R5MotorControl::getWheelVelocity(const unsigned char bMotor)
+{
+	unsigned long ulMicros = micros();
+	long lVelocity = 0L;
+
+	switch (bMotor)
+	{
+		case 0:
+			lVelocity = (_estimateVelocity(0, ulMicros) + _estimateVelocity(1, ulMicros)) / 2;
+			break;
+		case 1:
+			lVelocity = _estimateVelocity(0, ulMicros);
+			break;
+		case 2:
+			lVelocity = _estimateVelocity(1, ulMicros);
+			break;
+	}
+
+	return (int)((lVelocity * 1000L) / R5_CNTPER1000MM);
+}
+
+// record the time of an encoder count change
+void R5MotorControl::_sampleEncoder(const unsigned char bWheel, const long lCount, const unsigned long ulMicros)
+{
+	_bSampleHead[bWheel] = (_bSampleHead[bWheel] + 1) % R5_VEL_SAMPLES;
+	_ulSampleMicros[bWheel][_bSampleHead[bWheel]] = ulMicros;
+	_lSampleCount[bWheel][_bSampleHead[bWheel]] = lCount;
+	if (_bSamples[bWheel] < R5_VEL_SAMPLES)
+		_bSamples[bWheel]++;
+}
+
+// clicks per second for one wheel
+long R5MotorControl::_estimateVelocity(const unsigned char bWheel, const unsigned long ulMicros)
+{
+	unsigned char bNewest = _bSampleHead[bWheel];
+	unsigned char bOldest = bNewest;
+	unsigned char bIndex;
+	unsigned long ulSince;
+	unsigned long ulInterval;
+	long lClicks;
+
+	if (_bSamples[bWheel] < 2)
+		return 0L;
+
+	ulSince = ulMicros - _ulSampleMicros[bWheel][bNewest];
+	if (ulSince >= R5_VEL_TIMEOUT) // stopped
+		return 0L;
+
+	// find the oldest sample within the window. If there is none, use the one before the newest
+	for (unsigned char i = 1; i < _bSamples[bWheel]; i++)
+	{
+		bIndex = (bNewest + R5_VEL_SAMPLES - i) % R5_VEL_SAMPLES;
+		if ((i > 1) && ((_ulSampleMicros[bWheel][bNewest] - _ulSampleMicros[bWheel][bIndex]) > R5_VEL_WINDOW))
+			break;
+		bOldest = bIndex;
+	}
+
+	lClicks = _lSampleCount[bWheel][bNewest] - _lSampleCount[bWheel][bOldest];
+	ulInterval = _ulSampleMicros[bWheel][bNewest] - _ulSampleMicros[bWheel][bOldest];
+
+	// if it is longer since the last click than the interval we measured over, then we are slowing down,
+	// and can't be going faster than one click in the time since
+	if (ulSince > ulInterval)
+	{
+		lClicks = (lClicks < 0) ? -1L : 1L;
+		ulInterval = ulSince;
+	}
+	if (!ulInterval)
+		return 0L;
+
+	return (lClicks * 1000000L) / (long)ulInterval;
+}
+
+unsigned char R5MotorControl::resetPose(void)
+{
+	_lPoseX = _lPoseY = 0L;
+	_lHeadingClicks = 0L;
+	_nHeading = 0;
+	return R5_SUCCESS;
+}
+
+// returns the pose with the position converted to mm
+void R5MotorControl::getPose(R5PoseType *pPose)
+{
+	pPose->lX = ((_lPoseX >> R5_POSE_SHIFT) * 500L) / R5_CNTPER1000MM;
+	pPose->lY = ((_lPoseY >> R5_POSE_SHIFT) * 500L) / R5_CNTPER1000MM;
+	pPose->nHeading = _nHeading;
+}
+
+// dead reckoning from the clicks moved since the last call.
+// The heading is recalculated from the total click difference so it does not drift from rounding,
+// and the position is moved along the average of the old and new headings
+void R5MotorControl::_updatePose(const long lLeftDist, const long lRightDist)
+{
+	int nOldHeading = _nHeading;
+	long lHeading;
+	long lMidHeading;
+	long lDist;
+
+	if (!lLeftDist && !lRightDist)
+		return;
+
+	// 2 * R5_CNTPER100DEG clicks difference is 10000 1/100 degrees
+	// 4536 clicks difference is exactly one turn, so wrap there to keep the total small
+	_lHeadingClicks = (_lHeadingClicks + lLeftDist - lRightDist) % ((36000L * 2L * R5_CNTPER100DEG) / 10000L);
+	lHeading = ((_lHeadingClicks * 5000L) / R5_CNTPER100DEG) % 36000L;
+	if (lHeading < 0)
+		lHeading += 36000L;
+	_nHeading = (int)lHeading;
+
+	// the shortest way round from the old heading to the new one
+	lMidHeading = lHeading - nOldHeading;
+	if (lMidHeading > 18000L)
+		lMidHeading -= 36000L;
+	else if (lMidHeading < -18000L)
+		lMidHeading += 36000L;
+	lMidHeading = nOldHeading + (lMidHeading / 2);
+
+	// sum of the tracks is twice the distance, so this is in half clicks
+	lDist = lLeftDist + lRightDist;
+	_lPoseX += ((lDist * R5FixedMath::cosDeg100(lMidHeading)) + (1L << (R5_FM_SHIFT - R5_POSE_SHIFT - 1))) >> (R5_FM_SHIFT - R5_POSE_SHIFT);
+	_lPoseY += ((lDist * R5FixedMath::sinDeg100(lMidHeading)) + (1L << (R5_FM_SHIFT - R5_POSE_SHIFT - 1))) >> (R5_FM_SHIFT - R5_POSE_SHIFT);
+}
+
 unsigned char R5MotorControl::getBehaviourState(void)
 {
 	return _behaviourState;
 }
 
+// when enabled the encoders are used to hold each track at the speed requested, rather than
+// just setting the PWM duty. This keeps the tracks together and makes speed independent of battery voltage
+unsigned char R5MotorControl::setSpeedControl(const unsigned char bEnable)
+{
+	if (bEnable && !_speedControl)
+		_resetSpeedControl();
+	_speedControl = bEnable;
+	return R5_SUCCESS;
+}
+
+unsigned char R5MotorControl::getSpeedControl(void)
+{
+	return _speedControl;
+}
+
+unsigned char R5MotorControl::setSpeedGains(const int nKp, const int nKi, const int nKd)
+{
+	if ((nKp < 0) || (nKi < 0) || (nKd < 0))
+		return R5_FAIL;
+
+	_nKp = nKp;
+	_nKi = nKi;
+	_nKd = nKd;
+	_resetSpeedControl();
+	return R5_SUCCESS;
+}
+
+void R5MotorControl::getSpeedGains(int *pnKp, int *pnKi, int *pnKd)
+{
+	*pnKp = _nKp;
+	*pnKi = _nKi;
+	*pnKd = _nKd;
+}
+
+// limits for the move() and stopAndRotate() profiles. nAccel of 0 turns the profile off
+unsigned char R5MotorControl::setMotionLimits(const int nMaxSpeed, const int nAccel)
+{
+	if ((nMaxSpeed < R5_PROFILE_MINSPEED) || (nMaxSpeed > 100) || (nAccel < 0) || (nAccel > R5_PROFILE_MAXACCEL))
+		return R5_FAIL;
+
+	_nMaxSpeed = nMaxSpeed;
+	_nAccel = nAccel;
+	return R5_SUCCESS;
+}
+
+void R5MotorControl::getMotionLimits(int *pnMaxSpeed, int *pnAccel)
+{
+	*pnMaxSpeed = _nMaxSpeed;
+	*pnAccel = _nAccel;
+}
+
+// the fastest we can go lTicks from the start or the end of a manoeuvre and still keep within the acceleration limit
+// v = sqrt(2 * a * d), worked in quad clicks and then converted to %
+int R5MotorControl::_profileSpeed(const long lTicks)
+{
+	long lAccel = ((long)_nAccel * R5_CNTPERSEC_MAX) / 100L; // clicks per second per second
+	long lSpeed = R5FixedMath::sqrtL(2UL * (unsigned long)lAccel * (unsigned long)lTicks); // clicks per second
+
+	lSpeed = R5_PROFILE_MINSPEED + ((lSpeed * 100L) / R5_CNTPERSEC_MAX);
+	return (int)min(lSpeed, (long)_nMaxSpeed);
+}
+
+// set both tracks from the profile, based on how far they have come and how far they have to go.
+// The average progress of the tracks sets the speed, and the track that is ahead is slowed so they stay together
+void R5MotorControl::_profileOutputs(void)
+{
+	long lLeftTravel = abs(_leftQuadRead - _leftQuadStart);
+	long lRightTravel = abs(_rightQuadRead - _rightQuadStart);
+	long lLeftRemain = max(0L, abs(_leftQuadDesired - _leftQuadStart) - lLeftTravel);
+	long lRightRemain = max(0L, abs(_rightQuadDesired - _rightQuadStart) - lRightTravel);
+	int nSpeed, nTrim;
+
+	nSpeed = _profileSpeed(min(lLeftTravel + lRightTravel, lLeftRemain + lRightRemain) / 2);
+	nTrim = (int)constrain((lLeftTravel - lRightTravel) * R5_PROFILE_SYNC, (long)(R5_PROFILE_MINSPEED - nSpeed), (long)(nSpeed - R5_PROFILE_MINSPEED));
+
+	switch ( _behaviourState )
+	{
+		case R5_ROTATE:
+			_m1 = (_rudder > 0) ? nSpeed - nTrim : -(nSpeed - nTrim);
+			_m2 = (_rudder > 0) ? -(nSpeed + nTrim) : nSpeed + nTrim;
+			break;
+		case R5_DRIVE:
+			_m1 = nSpeed - nTrim;
+			_m2 = nSpeed + nTrim;
+			break;
+		case R5_REVERSE:
+			_m1 = -(nSpeed - nTrim);
+			_m2 = -(nSpeed + nTrim);
+			break;
+	}
+}
+
+// add a segment to the back of the queue, converted to track clicks
+unsigned char R5MotorControl::_queueSegment(const unsigned char bType, const long lLeftTicks, const long lRightTicks)
+{
+	R5MotionSegmentType *pSegment;
+
+	if (_bSegmentCount >= R5_SEGMENT_QUEUE_SIZE)
+		return R5_FAIL;
+
+	if (!_bSegmentCount)
+		_bSegmentAborted = false; // a new run of segments
+	pSegment = &_segments[(_bSegmentHead + _bSegmentCount) % R5_SEGMENT_QUEUE_SIZE];
+	pSegment->bType = bType;
+	pSegment->lLeftTicks = lLeftTicks;
+	pSegment->lRightTicks = lRightTicks;
+	_bSegmentCount++;
+	return R5_SUCCESS;
+}
+
+unsigned char R5MotorControl::queueDrive(const int nDistance)
+{
+	return queueArc(nDistance, 0);
+}
+
+unsigned char R5MotorControl::queueRotate(const int nAngle)
+{
+	return queueArc(0, nAngle);
+}
+
+// the tracks move the same distance plus or minus the clicks that would rotate nAngle on the spot
+unsigned char R5MotorControl::queueArc(const int nDistance, const int nAngle)
+{
+	long lTicks = ((long)nDistance * R5_CNTPER1000MM) / 1000L;
+	long lTurnTicks = ((long)nAngle * R5_CNTPER100DEG) / 100L;
+
+	if (!lTicks && !lTurnTicks)
+		return R5_SUCCESS; // nothing to do
+	return _queueSegment(R5_SEG_ARC, lTicks + lTurnTicks, lTicks - lTurnTicks);
+}
+
+unsigned char R5MotorControl::queuePause(const unsigned int uiMillis)
+{
+	return _queueSegment(R5_SEG_PAUSE, (long)uiMillis, 0L);
+}
+
+unsigned char R5MotorControl::abortSegments(void)
+{
+	if (_bSegmentCount || (_behaviourState == R5_SEGMENT))
+		stop();
+	return R5_SUCCESS;
+}
+
+unsigned char R5MotorControl::getSegmentsQueued(void)
+{
+	return _bSegmentCount;
+}
+
+unsigned char R5MotorControl::getSegmentStatus(void)
+{
+	if (_bSegmentCount)
+		return R5_IN_PROGRESS;
+	return _bSegmentAborted ? R5_FAIL : R5_SUCCESS;
+}
+
+// set the targets for the segment at the head of the queue
+void R5MotorControl::_startSegment(void)
+{
+	R5MotionSegmentType *pSegment = &_segments[_bSegmentHead];
+
+	_behaviourState = R5_SEGMENT;
+	_leftQuadStart = _leftQuadRead;
+	_rightQuadStart = _rightQuadRead;
+	_ulSegmentStart = _ulSegmentMoved = millis();
+	if (pSegment->bType == R5_SEG_ARC)
+	{
+		_leftQuadDesired = _leftQuadRead + pSegment->lLeftTicks;
+		_rightQuadDesired = _rightQuadRead + pSegment->lRightTicks;
+	}
+	else
+	{
+		_leftQuadDesired = _leftQuadRead;
+		_rightQuadDesired = _rightQuadRead;
+	}
+	_reverse = false;
+}
+
+// set the track outputs for the running segment. Returns true once it is complete.
+// The track with further to go follows the speed profile, and the other is scaled to arrive at the same time,
+// but never below R5_PROFILE_MINSPEED or it would stop short on a tight arc. The skew correction then
+// holds the longer track back to match. If the tracks stop moving anyway the queue is aborted
+unsigned char R5MotorControl::_driveSegment(void)
+{
+	R5MotionSegmentType *pSegment = &_segments[_bSegmentHead];
+	long lLeftTotal, lRightTotal, lLong;
+	long lLeftTravel, lRightTravel, lLongTravel;
+	long lSkew;
+	int nSpeed, nTrim;
+	int nLeft, nRight;
+
+	if (pSegment->bType == R5_SEG_PAUSE)
+	{
+		_m1 = _m2 = 0;
+		return ((millis() - _ulSegmentStart) >= (unsigned long)pSegment->lLeftTicks);
+	}
+
+	lLeftTotal = abs(pSegment->lLeftTicks);
+	lRightTotal = abs(pSegment->lRightTicks);
+	lLong = max(lLeftTotal, lRightTotal);
+	lLeftTravel = (pSegment->lLeftTicks < 0) ? _leftQuadStart - _leftQuadRead : _leftQuadRead - _leftQuadStart;
+	lRightTravel = (pSegment->lRightTicks < 0) ? _rightQuadStart - _rightQuadRead : _rightQuadRead - _rightQuadStart;
+
+	if ((lLeftTravel >= lLeftTotal) && (lRightTravel >= lRightTotal)) // we are there
+	{
+		_m1 = _m2 = 0;
+		return true;
+	}
+	if ((millis() - _ulSegmentMoved) > R5_SEGMENT_STALL)
+	{
+		abortSegments(); // a stalled track would otherwise hold up the queue for ever
+		return false;
+	}
+
+	// progress of each track scaled to the longer track, so the skew is in its clicks
+	lLongTravel = (lLeftTotal == lLong) ? lLeftTravel : lRightTravel;
+	lSkew = 0L;
+	if (lLeftTotal && lRightTotal)
+		lSkew = ((lLeftTravel * lLong) / lLeftTotal) - ((lRightTravel * lLong) / lRightTotal);
+
+	if (_nAccel)
+		nSpeed = _profileSpeed(max(0L, min(lLongTravel, lLong - lLongTravel)));
+	else
+		nSpeed = 60;
+	nTrim = (int)constrain(lSkew * R5_PROFILE_SYNC, (long)(R5_PROFILE_MINSPEED - nSpeed), (long)(nSpeed - R5_PROFILE_MINSPEED));
+
+	nLeft = max((int)(((long)(nSpeed - nTrim) * lLeftTotal) / lLong), R5_PROFILE_MINSPEED);
+	nRight = max((int)(((long)(nSpeed + nTrim) * lRightTotal) / lLong), R5_PROFILE_MINSPEED);
+	if (lLeftTravel >= lLeftTotal)
+		nLeft = 0;
+	if (lRightTravel >= lRightTotal)
+		nRight = 0;
+	_m1 = (pSegment->lLeftTicks < 0) ? -nLeft : nLeft;
+	_m2 = (pSegment->lRightTicks < 0) ? -nRight : nRight;
+	return false;
+}
+
+// start the speed loop again from the current position with no history
+void R5MotorControl::_resetSpeedControl(void)
+{
+	_ulControlMillis = millis();
+	_lControlQuadRead[0] = _leftQuadRead;
+	_lControlQuadRead[1] = _rightQuadRead;
+	for (int i = 0; i < 2; i++)
+	{
+		_lIntegral[i] = 0L;
+		_nMeasured[i] = 0;
+		_nDrive[i] = 0;
+	}
+}
+
+// called from driveMotors(). Once every R5_SPEED_PERIOD measure each track speed and correct the drive
+void R5MotorControl::_controlSpeed(void)
+{
+	unsigned long ulMillis = millis();
+	unsigned long ulElapsed = ulMillis - _ulControlMillis;
+
+	if (_paralyse) // the tracks are not being driven so there is nothing to correct
+	{
+		_resetSpeedControl();
+		return;
+	}
+	if (ulElapsed < R5_SPEED_PERIOD)
+		return;
+
+	_nDrive[0] = _controlTrack(0, _m1, _leftQuadRead - _lControlQuadRead[0], ulElapsed);
+	_nDrive[1] = _controlTrack(1, _m2, _rightQuadRead - _lControlQuadRead[1], ulElapsed);
+
+	_ulControlMillis = ulMillis;
+	_lControlQuadRead[0] = _leftQuadRead;
+	_lControlQuadRead[1] = _rightQuadRead;
+}
+
+// PID on track speed. The requested % is fed forward and the PID terms correct it.
+// The drive is not allowed to reverse, and the integral stops growing while the drive is at its limit
+int R5MotorControl::_controlTrack(const unsigned char bMotor, const int nTarget, const long lTicks, const unsigned long ulElapsed)
+{
+	int nMeasured;
+	int nError;
+	long lIntegral;
+	long lDrive;
+
+	// convert clicks in this period to a % of full speed
+	nMeasured = (int)((lTicks * 100000L) / ((long)ulElapsed * R5_CNTPERSEC_MAX));
+
+	if (nTarget == 0) // stop now, and don't carry anything over to the next manoeuvre
+	{
+		_lIntegral[bMotor] = 0L;
+		_nMeasured[bMotor] = nMeasured;
+		return 0;
+	}
+
+	nError = nTarget - nMeasured;
+	lIntegral = _lIntegral[bMotor] + ((long)_nKi * nError);
+	lIntegral = constrain(lIntegral, -100L * R5_GAIN_SCALE, 100L * R5_GAIN_SCALE);
+
+	// derivative on measurement, so a change of target doesn't kick the output
+	lDrive = ((long)_nKp * nError) + lIntegral - ((long)_nKd * (nMeasured - _nMeasured[bMotor]));
+	lDrive = nTarget + (lDrive / R5_GAIN_SCALE);
+	_nMeasured[bMotor] = nMeasured;
+
+	if (nTarget > 0)
+	{
+		if (lDrive > 100L)
+			lDrive = 100L;
+		else if (lDrive < 0L)
+			lDrive = 0L;
+		else
+			_lIntegral[bMotor] = lIntegral; // only integrate when not saturated
+	}
+	else
+	{
+		if (lDrive < -100L)
+			lDrive = -100L;
+		else if (lDrive > 0L)
+			lDrive = 0L;
+		else
+			_lIntegral[bMotor] = lIntegral;
+	}
+
+	return (int)lDrive;
+}
+
 void R5MotorControl::_calculateOutputs(void)
 {
 	int speed;
@@ -298,6 +781,7 @@ void R5MotorControl::_calculateOutputs(void)
 void R5MotorControl::driveMotors(long lLeftRead, long lRightRead)
 {
 	unsigned int speedM1, speedM2;
+	int nDriveM1, nDriveM2;
 	// long lLeftRead, lRightRead;
 	long lLeftDist, lRightDist;
 
@@ -305,19 +789,55 @@ void R5MotorControl::driveMotors(long lLeftRead, long lRightRead)
 	// lRightRead = _pRightEncoder->read();
 	lLeftDist = lLeftRead - _leftQuadRead;
 	lRightDist = lRightRead - _rightQuadRead;
+	if (lLeftDist || lRightDist)
+	{
+		unsigned long ulMicros = micros();
+		_ulSegmentMoved = millis();
+		if (lLeftDist)
+			_sampleEncoder(0, lLeftRead, ulMicros);
+		if (lRightDist)
+			_sampleEncoder(1, lRightRead, ulMicros);
+	}
 	_leftQuadRead = lLeftRead; // store values for next iteration
 	_rightQuadRead = lRightRead;
 	// take the average 1000/2 = 500
     _distanceTravelled += (500L*(lLeftDist + lRightDist))/ R5_CNTPER1000MM;
+	_updatePose(lLeftDist, lRightDist);
 
 	// now switch based on state i.e. what this behaviour is busy with
 	switch ( _behaviourState )
 	{
-		case R5_NORMAL:	// nothing to do here
+		case R5_NORMAL:	// nothing to do here unless there are segments waiting
 		case R5_STOPPED:
+			if (_bSegmentCount)
+			{
+				_startSegment();
+				_driveSegment();
+			}
+			break;
+
+		case R5_SEGMENT:
+			// move straight on to the next segment once this one is complete
+			while (_bSegmentCount && _driveSegment())
+			{
+				_bSegmentHead = (_bSegmentHead + 1) % R5_SEGMENT_QUEUE_SIZE;
+				_bSegmentCount--;
+				if (_bSegmentCount)
+					_startSegment();
+			}
+			if (!_bSegmentCount) // all done
+			{
+				_behaviourState = R5_STOPPED;
+				_m1 = _m2 = 0;
+			}
+			// report what we are doing through speed and rudder
+			_speed = (_m1 + _m2) / 2;
+			_rudder = (_m1 - _m2) / 2;
 			break;
 
 		case R5_ROTATE:	// have we turned enough yet ?
+			if ( _nAccel )
+				_profileOutputs();
 			if ( _rudder > 0 ) // turning right so left quad increasing
 			{
 				if ( _leftQuadRead >= _leftQuadDesired )
@@ -342,6 +862,8 @@ void R5MotorControl::driveMotors(long lLeftRead, long lRightRead)
 			break;
 
 		case R5_DRIVE:	// have we gone far enough yet ?
+			if ( _nAccel )
+				_profileOutputs();
 			if ( _leftQuadRead >= _leftQuadDesired )
 				_m1 = 0;
 			if ( _rightQuadRead >= _rightQuadDesired )
@@ -356,6 +878,8 @@ void R5MotorControl::driveMotors(long lLeftRead, long lRightRead)
 
 
 		case R5_REVERSE:	// have we reversed far enough yet ?
+			if ( _nAccel )
+				_profileOutputs();
 			if ( _leftQuadRead <= _leftQuadDesired )
 				_m1 = 0;
 			if ( _rightQuadRead <= _rightQuadDesired )
@@ -369,11 +893,20 @@ void R5MotorControl::driveMotors(long lLeftRead, long lRightRead)
 			}
 			break;
 	}
-	speedM1 = abs(_m1);
-	speedM2 = abs(_m2);
+	nDriveM1 = _m1;
+	nDriveM2 = _m2;
+	if (_speedControl)
+	{
+		_controlSpeed();
+		// a track that has just been stopped stops now, not at the next correction
+		nDriveM1 = _m1 ? _nDrive[0] : 0;
+		nDriveM2 = _m2 ? _nDrive[1] : 0;
+	}
+	speedM1 = abs(nDriveM1);
+	speedM2 = abs(nDriveM2);
 
     analogWrite(_drivePins[0], _paralyse ? 0 : (speedM1*255)/100);
     analogWrite(_drivePins[1], _paralyse ? 0 : (speedM2*255)/100);
-    digitalWrite(_directionPins[0], (_m1 < 0) ? HIGH : LOW);
-    digitalWrite(_directionPins[1], (_m2 < 0) ? HIGH : LOW);
+    digitalWrite(_directionPins[0], (nDriveM1 < 0) ? HIGH : LOW);
+    digitalWrite(_directionPins[1], (nDriveM2 < 0) ? HIGH : LOW);
 }
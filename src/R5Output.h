@@ -24,6 +24,8 @@ class R5Output {
 public:
 	virtual void outputData(const char *pszData) = 0;
 	virtual void outputVocaliseData(const char *pszData) = 0;
+	// binary telemetry frames, see R5Telemetry.h. Outputs that only carry text need not implement this
+	virtual void outputFrame(const unsigned char *pFrame, const unsigned int uiLength) {};
 };
 
 
@@ -15,7 +15,7 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
-#include "Arduino.h"
+#include "R5Hal.h"
 #include "R5PIR.h"
 
 // constructor requires identification of sensor pin
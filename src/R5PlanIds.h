@@ -0,0 +1,93 @@
+// 	Library for Rover 5 Platform Plan Sense and Action IDs
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// These are the IDs the robot gives to the Instinct Planner. The RSENSE and RACTION lines of a plan
+// name them, and R5PlanInterface implements them.
+//
+#ifndef _R5PLANIDS_H_
+#define _R5PLANIDS_H_
+
+// define the available robot actions
+#define ACTION_SETSPEED 1
+#define ACTION_MOVEBY 2
+#define ACTION_TURN 3
+#define ACTION_STOP 4
+#define ACTION_SLEEP 5
+#define ACTION_WAKE 6
+#define ACTION_HMOVEHEAD 7
+#define ACTION_VMOVEHEAD 8
+#define ACTION_FAIL 9 // a test action that always fails
+#define ACTION_HSCAN 10
+#define ACTION_VSCAN 11
+#define ACTION_WAIT 12
+#define ACTION_TURNTOMOSTOPEN 13
+#define ACTION_TURNMOSTOPENDIR 14
+#define ACTION_WAIT_HSCANREADY 15
+#define ACTION_WAIT_VSCANREADY 16
+#define ACTION_RESET_HUMAN_DETECTOR 17
+#define ACTION_WAIT_SCANREADY 18
+#define ACTION_SCAN 19
+#define ACTION_CONF_HUMAN 20
+#define ACTION_FLASH_COLOUR 21
+#define ACTION_RESET_POSE 22
+#define ACTION_QUEUE_DRIVE 23 // queue a drive segment of nActionValue mm
+#define ACTION_QUEUE_ROTATE 24 // queue a rotate segment of nActionValue degrees
+#define ACTION_QUEUE_ARC 25 // upper byte is distance in 20mm units, lower byte is angle in degrees, both signed
+#define ACTION_QUEUE_PAUSE 26 // queue a pause of nActionValue mS
+#define ACTION_RUN_SEGMENTS 27 // in progress until the segment queue is complete, fails if it was aborted
+#define ACTION_ABORT_SEGMENTS 28
+
+// define the available robot senses
+// these return distances to obstacles in units 0-3
+#define SENSE_FRONT_RIGHT 1
+#define SENSE_FRONT_LEFT 2
+#define SENSE_REAR_LEFT 3
+#define SENSE_REAR_RIGHT 4
+#define SENSE_FRONT 5
+#define SENSE_REAR 6
+#define SENSE_RANDOM 7
+#define SENSE_SLEEPING 8
+#define SENSE_FIFTY 9
+#define SENSE_RANGE 10
+#define SENSE_FRONT_RANGE 11
+#define SENSE_PIR 12
+#define SENSE_LEFT 13
+#define SENSE_RIGHT 14
+#define SENSE_NEAREST_CORNER 15
+#define SENSE_NEAREST_EDGE 16
+#define SENSE_MOTOR_CURRENT 17
+#define SENSE_MOVING_HSCANINTERVAL 18
+#define SENSE_STOPPED_VSCANINTERVAL 19
+#define SENSE_MIN_RANGE_AHEAD 20
+#define SENSE_HSCANREADY 21
+#define SENSE_VSCANREADY 22
+#define SENSE_HUMAN_AHEAD 23
+#define SENSE_SCANREADY 24
+#define SENSE_CONFIRMED_HUMAN 25
+#define SENSE_MOVING 26
+#define EMERGENCY_AVOID_DISTANCE 27
+#define SENSE_HEADING 28 // degrees turned since ACTION_RESET_POSE, -180 to 180, clockwise positive
+#define SENSE_DISPLACEMENT 29 // straight line distance in mm from where ACTION_RESET_POSE was done
+#define SENSE_SEGMENTS_QUEUED 30 // number of motion segments waiting or running
+#define SENSE_SEGMENT_STATUS 31 // 0 = aborted, 1 = complete, 2 = in progress
+#define SENSE_VELOCITY 32 // measured forward speed in mm/s, the average of the two tracks
+
+// used by SENSE_HUMAN_AHEAD and EMERGENCY_AVOID_DISTANCE
+#define MAX_DIST_FOR_HUMAN 800
+#define MIN_TRAVEL_BETWEEN_HUMANS 300
+
+#endif // _R5PLANIDS_H_
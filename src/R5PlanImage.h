@@ -0,0 +1,99 @@
+// 	Library for Rover 5 Platform Binary Plan Image
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Loads an Instinct plan sent as one binary image, made from a .inst file by extras/plan/r5plan,
+// instead of one PLAN command and OK per plan element. The image holds what R5EEPROM::writeData()
+// stores - the node counts, the plan ID, the nodes in ID order and the element names - with each
+// node as the arguments of its PLAN A command, so it does not depend on how Instinct lays out its
+// nodes in memory. All values are little endian.
+//
+//	header	'R' '5' 'P' version, body length (2), CRC16 of the body (2)
+//	body	node counts AP APE C CE D A (2 each), plan ID (2)
+//			for each node - node type (1), PLAN A arguments (2 each, the first is the element ID)
+//			name count (2), for each name - element ID (2), length (1), characters
+//
+// Bytes are given to addByte() as they arrive. Nodes are added to the plan as they complete, so a
+// corrupt image is only found at the end, and then the plan is cleared rather than left half loaded.
+//
+#ifndef _R5PLANIMAGE_H_
+#define _R5PLANIMAGE_H_
+
+#define R5_PLANIMAGE_VERSION	1
+#define R5_PLANIMAGE_HEADER		8	// bytes before the body
+#define R5_PLANIMAGE_FIELDS		12	// most PLAN A arguments of any node type
+#define R5_PLANIMAGE_NAME		30	// longest element name, with its terminator, as for PELEM
+#define R5_PLANIMAGE_TIMEOUT	2000 // mS without a byte before a load is abandoned
+
+// what addByte() returns
+#define R5_PLANIMAGE_MORE		0	// waiting for more of the image
+#define R5_PLANIMAGE_DONE		1	// the plan is loaded
+#define R5_PLANIMAGE_ERROR		2	// the load failed, see getError()
+
+// getError() values
+#define R5_PLANIMAGE_OK			0
+#define R5_PLANIMAGE_EHEADER	1	// not an image, or the wrong version
+#define R5_PLANIMAGE_ELENGTH	2	// the body length does not match the length given to begin()
+#define R5_PLANIMAGE_ENODE		3	// an unknown node type, or the planner rejected a node
+#define R5_PLANIMAGE_ENAME		4	// a name too long, or rejected
+#define R5_PLANIMAGE_ECRC		5	// the checksum does not match
+#define R5_PLANIMAGE_ETIMEOUT	6	// the image stopped arriving
+
+class R5PlanImage {
+public:
+	R5PlanImage(Instinct::CmdPlanner *pPlan, Instinct::Names *pNames);
+	void begin(const unsigned int uiLength);	// expect an image of uiLength bytes
+	unsigned char isLoading(void);
+	unsigned char addByte(const unsigned char bByte);
+	unsigned char checkTimeout(void);			// R5_PLANIMAGE_ERROR if a load has stalled
+	unsigned char getError(void);
+	unsigned int getNodes(void);				// nodes added by the last load
+
+	static unsigned char fieldCount(const unsigned char bNodeType);
+	static char nodeCommand(const unsigned char bNodeType); // the PLAN A letter for a node type
+
+private:
+	unsigned char _fail(const unsigned char bError);
+	unsigned char _startPlan(void);
+	unsigned char _addNode(void);
+	unsigned char _addName(void);
+
+	Instinct::CmdPlanner *_pPlan;
+	Instinct::Names *_pNames;
+	unsigned int _uiLength;		// bytes still to come, zero when not loading
+	unsigned int _uiOffset;		// bytes received
+	unsigned int _uiBodyLength;
+	unsigned int _uiCRC;
+	unsigned int _uiExpectedCRC;
+	unsigned long _ulLastByte;
+	unsigned char _bError;
+
+	// the value being assembled, and where it goes
+	unsigned char _bState;
+	unsigned char _bField;
+	unsigned char _bFieldBytes;
+	int _nValue;
+	int _nFields[R5_PLANIMAGE_FIELDS];
+	unsigned char _bNodeType;
+	unsigned int _uiNodesLeft;
+	unsigned int _uiNodes;
+	unsigned int _uiNamesLeft;
+	unsigned char _bNameLength;
+	char _szName[R5_PLANIMAGE_NAME];
+};
+
+#endif // _R5PLANIMAGE_H_
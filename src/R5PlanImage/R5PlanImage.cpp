@@ -0,0 +1,268 @@
+// 	Library for Rover 5 Platform Binary Plan Image
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include "R5Hal.h"
+#include "Instinct.h"
+#include "R5Crc.h"
+#include "R5PlanImage.h"
+
+// where addByte() is in the image
+#define R5_PLANIMAGE_SHEADER	0
+#define R5_PLANIMAGE_SCOUNTS	1
+#define R5_PLANIMAGE_STYPE		2
+#define R5_PLANIMAGE_SFIELDS	3
+#define R5_PLANIMAGE_SNAMES		4
+#define R5_PLANIMAGE_SNAMEID	5
+#define R5_PLANIMAGE_SNAMELEN	6
+#define R5_PLANIMAGE_SNAMECHARS	7
+#define R5_PLANIMAGE_SEND		8
+
+// PLAN A letters and argument counts, by Instinct node type AP APE C CE D A
+static const char PROGMEM szNodeCommands[] = {"PLCEDA"};
+static const unsigned char PROGMEM bNodeFields[INSTINCT_NODE_TYPES] = {1, 4, 2, 10, 12, 3};
+
+R5PlanImage::R5PlanImage(Instinct::CmdPlanner *pPlan, Instinct::Names *pNames)
+{
+	_pPlan = pPlan;
+	_pNames = pNames;
+	_uiLength = 0;
+	_uiNodes = 0;
+	_bError = R5_PLANIMAGE_OK;
+}
+
+void R5PlanImage::begin(const unsigned int uiLength)
+{
+	_uiLength = uiLength;
+	_uiOffset = 0;
+	_uiNodes = 0;
+	_uiCRC = R5_CRC16_INIT;
+	_bError = R5_PLANIMAGE_OK;
+	_bState = R5_PLANIMAGE_SHEADER;
+	_bField = 0;
+	_bFieldBytes = 0;
+	_nValue = 0;
+	_ulLastByte = millis();
+	if (uiLength < R5_PLANIMAGE_HEADER)
+		_fail(R5_PLANIMAGE_ELENGTH);
+}
+
+unsigned char R5PlanImage::isLoading(void)
+{
+	return (_uiLength != 0);
+}
+
+unsigned char R5PlanImage::getError(void)
+{
+	return _bError;
+}
+
+unsigned int R5PlanImage::getNodes(void)
+{
+	return _uiNodes;
+}
+
+unsigned char R5PlanImage::fieldCount(const unsigned char bNodeType)
+{
+	return (bNodeType < INSTINCT_NODE_TYPES) ? pgm_read_byte(&bNodeFields[bNodeType]) : 0;
+}
+
+char R5PlanImage::nodeCommand(const unsigned char bNodeType)
+{
+	return (bNodeType < INSTINCT_NODE_TYPES) ? pgm_read_byte(&szNodeCommands[bNodeType]) : 0;
+}
+
+unsigned char R5PlanImage::checkTimeout(void)
+{
+	if (_uiLength && ((millis() - _ulLastByte) > R5_PLANIMAGE_TIMEOUT))
+		return _fail(R5_PLANIMAGE_ETIMEOUT);
+	return R5_PLANIMAGE_MORE;
+}
+
+// values are 16 bit little endian. Each byte goes into _nValue, and _bFieldBytes counts them
+unsigned char R5PlanImage::addByte(const unsigned char bByte)
+{
+	if (!_uiLength)
+		return R5_PLANIMAGE_ERROR;
+	_ulLastByte = millis();
+	_uiLength--;
+
+	if (_bState == R5_PLANIMAGE_SHEADER)
+	{
+		static const char PROGMEM szMagic[] = {"R5P"};
+		if ((_uiOffset < 3) && (bByte != (unsigned char)pgm_read_byte(&szMagic[_uiOffset])))
+			return _fail(R5_PLANIMAGE_EHEADER);
+		if ((_uiOffset == 3) && (bByte != R5_PLANIMAGE_VERSION))
+			return _fail(R5_PLANIMAGE_EHEADER);
+		if (_uiOffset == 4)
+			_uiBodyLength = bByte;
+		else if (_uiOffset == 5)
+		{
+			_uiBodyLength |= (unsigned int)bByte << 8;
+			if (_uiBodyLength != (_uiLength - 2)) // the CRC is still to come
+				return _fail(R5_PLANIMAGE_ELENGTH);
+		}
+		else if (_uiOffset == 6)
+			_uiExpectedCRC = bByte;
+		else if (_uiOffset == 7)
+		{
+			_uiExpectedCRC |= (unsigned int)bByte << 8;
+			_bState = R5_PLANIMAGE_SCOUNTS;
+		}
+		_uiOffset++;
+		return R5_PLANIMAGE_MORE;
+	}
+
+	_uiOffset++;
+	_uiCRC = crc16Update(_uiCRC, bByte);
+
+	switch (_bState)
+	{
+	case R5_PLANIMAGE_STYPE:
+		_bNodeType = bByte;
+		if (!fieldCount(_bNodeType))
+			return _fail(R5_PLANIMAGE_ENODE);
+		_bState = R5_PLANIMAGE_SFIELDS;
+		break;
+	case R5_PLANIMAGE_SNAMELEN:
+		_bNameLength = bByte;
+		_bField = 0;
+		if (_bNameLength >= R5_PLANIMAGE_NAME)
+			return _fail(R5_PLANIMAGE_ENAME);
+		if (!_bNameLength && !_addName())
+			return _fail(R5_PLANIMAGE_ENAME);
+		if (_bNameLength)
+			_bState = R5_PLANIMAGE_SNAMECHARS;
+		break;
+	case R5_PLANIMAGE_SNAMECHARS:
+		_szName[_bField++] = (char)bByte;
+		if ((_bField == _bNameLength) && !_addName())
+			return _fail(R5_PLANIMAGE_ENAME);
+		break;
+	case R5_PLANIMAGE_SEND:
+		return _fail(R5_PLANIMAGE_ELENGTH);
+	default: // everything else is made of 16 bit values
+		_nValue |= (unsigned int)bByte << (8 * _bFieldBytes);
+		if (++_bFieldBytes < 2)
+			break;
+		_bFieldBytes = 0;
+		_nFields[_bField++] = (int)(short)_nValue;
+		_nValue = 0;
+		switch (_bState)
+		{
+		case R5_PLANIMAGE_SCOUNTS: // the six node counts then the plan ID
+			if ((_bField == INSTINCT_NODE_TYPES + 1) && !_startPlan())
+				return _fail(R5_PLANIMAGE_ENODE);
+			break;
+		case R5_PLANIMAGE_SFIELDS:
+			if ((_bField == fieldCount(_bNodeType)) && !_addNode())
+				return _fail(R5_PLANIMAGE_ENODE);
+			break;
+		case R5_PLANIMAGE_SNAMES:
+			_uiNamesLeft = (unsigned int)_nFields[0];
+			_bField = 0;
+			_bState = _uiNamesLeft ? R5_PLANIMAGE_SNAMEID : R5_PLANIMAGE_SEND;
+			break;
+		case R5_PLANIMAGE_SNAMEID:
+			_bState = R5_PLANIMAGE_SNAMELEN;
+			break;
+		}
+		break;
+	}
+
+	if (_uiLength)
+		return R5_PLANIMAGE_MORE;
+	if ((_bState != R5_PLANIMAGE_SEND) || _bFieldBytes)
+		return _fail(R5_PLANIMAGE_ELENGTH);
+	if (_uiCRC != _uiExpectedCRC)
+		return _fail(R5_PLANIMAGE_ECRC);
+	return R5_PLANIMAGE_DONE;
+}
+
+// stop loading, and clear any part of the plan already loaded
+unsigned char R5PlanImage::_fail(const unsigned char bError)
+{
+	char szResponse[20];
+
+	if (_uiOffset > R5_PLANIMAGE_HEADER)
+	{
+		_pPlan->executeCommand("R C", szResponse, sizeof(szResponse));
+		_pNames->clearElementNames();
+	}
+	_uiLength = 0;
+	_uiNodes = 0;
+	_bError = bError;
+	return R5_PLANIMAGE_ERROR;
+}
+
+// clear the plan and the names, then size the plan from the node counts in _nFields
+unsigned char R5PlanImage::_startPlan(void)
+{
+	char szCmd[48];
+	char szResponse[20];
+	static const char PROGMEM szFmt[] = {"R I %u %u %u %u %u %u"};
+
+	_pPlan->executeCommand("R C", szResponse, sizeof(szResponse));
+	_pNames->clearElementNames();
+	snprintf_P(szCmd, sizeof(szCmd), szFmt, (unsigned int)_nFields[0], (unsigned int)_nFields[1], (unsigned int)_nFields[2],
+			(unsigned int)_nFields[3], (unsigned int)_nFields[4], (unsigned int)_nFields[5]);
+	if (!_pPlan->executeCommand(szCmd, szResponse, sizeof(szResponse)))
+		return false;
+	_pPlan->setPlanID(_nFields[INSTINCT_NODE_TYPES]);
+
+	_uiNodesLeft = 0;
+	for (unsigned char i = 0; i < INSTINCT_NODE_TYPES; i++)
+		_uiNodesLeft += (unsigned int)_nFields[i];
+	_bField = 0;
+	_bState = _uiNodesLeft ? R5_PLANIMAGE_STYPE : R5_PLANIMAGE_SNAMES;
+	return true;
+}
+
+// give the planner the PLAN A command for the node in _bNodeType and _nFields
+unsigned char R5PlanImage::_addNode(void)
+{
+	char szCmd[8 + (R5_PLANIMAGE_FIELDS * 7)];
+	char szResponse[20];
+	static const char PROGMEM szFmt[] = {" %i"};
+	unsigned int uiLen;
+
+	szCmd[0] = 'A';
+	szCmd[1] = ' ';
+	szCmd[2] = nodeCommand(_bNodeType);
+	szCmd[3] = 0;
+	uiLen = 3;
+	for (unsigned char i = 0; i < _bField; i++)
+		uiLen += snprintf_P(szCmd + uiLen, sizeof(szCmd) - uiLen, szFmt, _nFields[i]);
+	if (!_pPlan->executeCommand(szCmd, szResponse, sizeof(szResponse)))
+		return false;
+
+	_uiNodes++;
+	_bField = 0;
+	_bState = (--_uiNodesLeft) ? R5_PLANIMAGE_STYPE : R5_PLANIMAGE_SNAMES;
+	return true;
+}
+
+// the ID is in _nFields[0] and the name in _szName
+unsigned char R5PlanImage::_addName(void)
+{
+	_szName[_bNameLength] = 0;
+	if (!_pNames->addElementName((Instinct::instinctID)_nFields[0], _szName))
+		return false;
+	_bField = 0;
+	_bState = (--_uiNamesLeft) ? R5_PLANIMAGE_SNAMEID : R5_PLANIMAGE_SEND;
+	return true;
+}
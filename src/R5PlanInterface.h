@@ -0,0 +1,62 @@
+// 	Library for Rover 5 Platform Plan Interface
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Maps the senses and actions of R5PlanIds.h onto the robot. MySenses and MyActions in
+// Robot_Instinct.ino pass the planner's calls through to it, and the host simulator calls it
+// directly, so a plan sees the same robot either way.
+//
+// Senses are read from the sensor frame, captured once before each plan cycle. Actions return
+// R5_SUCCESS, R5_FAIL, R5_IN_PROGRESS or R5_ERROR, which have the same values as the planner's.
+// The display is the sketch's, so the actions that use it call the virtual display functions,
+// which do nothing unless overridden.
+//
+#ifndef _R5PLANINTERFACE_H_
+#define _R5PLANINTERFACE_H_
+
+class R5PlanInterface {
+public:
+	R5PlanInterface(R5SensorFrame *pFrame, R5MotorControl *pMotors, R5SensingHead *pHead, R5CornerSensors *pSensors,
+			R5PIR *pPIR, Servo *pServoHHead, Servo *pServoVHead);
+	int readSense(const int nSense);
+	unsigned char executeAction(const int nAction, const int nActionValue, const unsigned char bCheckForComplete);
+	unsigned char confirmedHuman(void) {return _bConfirmedHuman;}; // 0 = not detected, 1 = maybe, 2 = confirmed
+
+protected:
+	virtual void displayClear(void) {};
+	virtual void displayRainbow(void) {}; // enticing a human while ACTION_CONF_HUMAN waits
+	virtual void displayColour(const unsigned char bRGB) {}; // lowest 3 bits are RGB
+
+private:
+	unsigned char _robotSleep(const int nSleepTime, const unsigned char bCheckForComplete);
+	unsigned char _robotWait(const int nWaitTime, const unsigned char bCheckForComplete);
+	unsigned char _robotWake(const unsigned char bCheckForComplete);
+
+	R5SensorFrame *_pFrame;
+	R5MotorControl *_pMotors;
+	R5SensingHead *_pHead;
+	R5CornerSensors *_pSensors;
+	R5PIR *_pPIR;
+	Servo *_pServoHHead;
+	Servo *_pServoVHead;
+
+	unsigned long _ulSleepStart;
+	unsigned long _ulWaitStart;
+	int _nNewHeading;
+	unsigned char _bConfirmedHuman;
+};
+
+#endif // _R5PLANINTERFACE_H_
@@ -0,0 +1,425 @@
+// 	Library for Rover 5 Platform Plan Interface
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5FixedMath.h"
+#include "R5AdcScheduler.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+#include "R5PlanIds.h"
+#include "R5PlanInterface.h"
+
+R5PlanInterface::R5PlanInterface(R5SensorFrame *pFrame, R5MotorControl *pMotors, R5SensingHead *pHead, R5CornerSensors *pSensors,
+			R5PIR *pPIR, Servo *pServoHHead, Servo *pServoVHead)
+{
+	_pFrame = pFrame;
+	_pMotors = pMotors;
+	_pHead = pHead;
+	_pSensors = pSensors;
+	_pPIR = pPIR;
+	_pServoHHead = pServoHHead;
+	_pServoVHead = pServoVHead;
+	_ulSleepStart = 0L;
+	_ulWaitStart = 0L;
+	_nNewHeading = 0;
+	_bConfirmedHuman = 0;
+}
+
+// map the senses requested by the planner with those available from the robot
+int R5PlanInterface::readSense(const int nSense)
+{
+	int nRtn = 0;
+
+	switch (nSense)
+	{
+		case SENSE_FRONT_RIGHT:
+			nRtn = _pFrame->getCornerDistance(R5_FRONT_RIGHT);
+			break;
+		case SENSE_FRONT_LEFT:
+			nRtn = _pFrame->getCornerDistance(R5_FRONT_LEFT);
+			break;
+		case SENSE_REAR_LEFT:
+			nRtn = _pFrame->getCornerDistance(R5_REAR_LEFT);
+			break;
+		case SENSE_REAR_RIGHT:
+			nRtn = _pFrame->getCornerDistance(R5_REAR_RIGHT);
+			break;
+		case SENSE_FRONT:
+			nRtn = _pFrame->getEdgeDistance(R5_FRONT);
+			break;
+		case SENSE_REAR:
+			nRtn = _pFrame->getEdgeDistance(R5_REAR);
+			break;
+		case SENSE_LEFT:
+			nRtn = _pFrame->getEdgeDistance(R5_LEFT);
+			break;
+		case SENSE_RIGHT:
+			nRtn = _pFrame->getEdgeDistance(R5_RIGHT);
+			break;
+		case SENSE_NEAREST_CORNER:
+			nRtn = _pFrame->nearestCorner();
+			break;
+		case SENSE_NEAREST_EDGE:
+			nRtn = _pFrame->nearestEdge();
+			break;
+		case SENSE_RANDOM: // return 1-100
+			nRtn = random(100) + 1;
+			break;
+		case SENSE_SLEEPING:
+			nRtn = _pFrame->getPause();
+			break;
+		case SENSE_FIFTY:
+			nRtn = 50;
+			break;
+		case SENSE_RANGE:
+			nRtn = _pFrame->getUltrasonicRange(); // the last ping before the frame was captured
+			break;
+		case SENSE_FRONT_RANGE: // the instantaneous range ahead from the IR sensors, and the sense matrix if it's ready
+			if (_pFrame->senseHMatrixReady())
+				nRtn = _pFrame->getHMinRange(); // the actual min range ahead as detected by the ultrasonic scanner
+			else
+				nRtn = _pFrame->getRange(); // the max range that the corner sensors can return
+			// try and return the minimum distance to obstacles that are ahead right now
+			nRtn = min(_pFrame->getCornerDistance(R5_FRONT_RIGHT), nRtn);
+			nRtn = min(_pFrame->getCornerDistance(R5_FRONT_LEFT), nRtn);
+			nRtn = min(_pFrame->getEdgeDistance(R5_FRONT), nRtn);
+			break;
+		case SENSE_MIN_RANGE_AHEAD: // the free space ahead. May be out of date depending on speed and scan rate
+			if (_pFrame->senseHMatrixReady()) // if the scan is not ready then we can't see ahead
+				nRtn = _pFrame->getHMinRange();
+			break;
+		case SENSE_PIR:
+			nRtn = _pFrame->getPIRActivated();
+			break;
+		case SENSE_MOTOR_CURRENT:
+			nRtn = _pFrame->getMotorCurrent(0);
+			break;
+		case SENSE_MOVING_HSCANINTERVAL:
+			if (_pFrame->getSpeed() != 0) // moving forwards or backwards. We might still be rotating
+			{
+				nRtn = _pFrame->getHScanInterval();
+				if (!nRtn) // zero means no scanning so this is effectively a large interval
+					nRtn = 32000;
+			}
+			break;
+		case SENSE_STOPPED_VSCANINTERVAL:
+			if ((_pFrame->getSpeed() == 0) && (_pFrame->getRudder() == 0)) // we must not be moving at all
+			{
+				nRtn = _pFrame->getVScanInterval();
+				if (!nRtn)
+					nRtn = 32000;
+			}
+			break;
+		case SENSE_HSCANREADY: // check if we have scan values for looking ahead
+			nRtn = _pFrame->senseHMatrixReady();
+			break;
+		case SENSE_VSCANREADY: // check if we have scan values for looking up and down ahead
+			nRtn = _pFrame->senseVMatrixReady();
+			break;
+		case SENSE_SCANREADY: // check if we have scan values for all cells
+			nRtn = _pFrame->senseMatrixReady();
+			break;
+		case SENSE_HUMAN_AHEAD: // 1 if there 'might' be a human ahead
+			if (_bConfirmedHuman || (_pFrame->getPIRActivated() && _pFrame->senseHMatrixReady() &&
+				(_pFrame->getHMinRange() <= MAX_DIST_FOR_HUMAN) && (_pFrame->getDistanceTravelled() >= MIN_TRAVEL_BETWEEN_HUMANS)))
+				nRtn = 1;
+			break;
+		case SENSE_CONFIRMED_HUMAN: // the result of ACTION_CONF_HUMAN
+			nRtn = _bConfirmedHuman;
+			break;
+		case SENSE_MOVING: // true if the tracks are moving
+			nRtn = ((_pFrame->getSpeed() != 0) || (_pFrame->getRudder() != 0)) ? 1 : 0;
+			break;
+		case EMERGENCY_AVOID_DISTANCE: // normally SENSE_FRONT_RANGE, unless stationary and a human might be sensed
+			nRtn = readSense(SENSE_FRONT_RANGE);
+			if ((_pFrame->getSpeed() == 0) && (_pFrame->getRudder() == 0) &&
+				(_bConfirmedHuman || (_pFrame->getPIRActivated() && (_pFrame->getDistanceTravelled() >= MIN_TRAVEL_BETWEEN_HUMANS))))
+				nRtn = _pFrame->getRange();
+			break;
+		case SENSE_HEADING:
+			nRtn = _pFrame->getHeading();
+			break;
+		case SENSE_DISPLACEMENT:
+			nRtn = min(_pFrame->getDisplacement(), 32767U);
+			break;
+		case SENSE_SEGMENTS_QUEUED:
+			nRtn = _pFrame->getSegmentsQueued();
+			break;
+		case SENSE_SEGMENT_STATUS:
+			nRtn = _pFrame->getSegmentStatus();
+			break;
+		case SENSE_VELOCITY:
+			nRtn = _pFrame->getWheelVelocity(0);
+			break;
+	}
+	return nRtn;
+}
+
+// map the actions available to the planner with those provided by the robot
+unsigned char R5PlanInterface::executeAction(const int nAction, const int nActionValue, const unsigned char bCheckForComplete)
+{
+	unsigned char bRtn = R5_ERROR;
+
+	switch (nAction)
+	{
+		case ACTION_SETSPEED:
+			bRtn = _pMotors->setSpeed(nActionValue);
+			break;
+		case ACTION_MOVEBY:
+			bRtn = _pMotors->move(nActionValue, bCheckForComplete);
+			break;
+		case ACTION_TURN:
+			bRtn = _pMotors->stopAndRotate(nActionValue, bCheckForComplete);
+			break;
+		case ACTION_STOP:
+			bRtn = _pMotors->stop();
+			break;
+		case ACTION_SLEEP:
+			bRtn = _robotSleep(nActionValue, bCheckForComplete);
+			break;
+		case ACTION_WAKE:
+			bRtn = _robotWake(bCheckForComplete);
+			break;
+		case ACTION_WAIT:
+			bRtn = _robotWait(nActionValue, bCheckForComplete);
+			break;
+		case ACTION_HMOVEHEAD:
+			_pServoHHead->write(nActionValue);
+			bRtn = R5_SUCCESS;
+			break;
+		case ACTION_VMOVEHEAD:
+			_pServoVHead->write(nActionValue);
+			bRtn = R5_SUCCESS;
+			break;
+		case ACTION_FAIL:
+			bRtn = R5_FAIL;
+			break;
+		case ACTION_HSCAN:
+			if (!_pHead->getHScanInterval()) // if we've not been scanning horizontally, the old values are invalid
+			{
+				_pHead->lookNearestSide();
+				_pHead->clearSenseMatrix();
+			}
+			if ((unsigned int)nActionValue != _pHead->getHScanInterval()) // only change parameters if they are not already set
+			{
+				_pHead->setVScanInterval(0); // stop vertical scanning
+				_pHead->setHScanInterval(nActionValue); // start nActionValue mS sweeps
+			}
+			bRtn = R5_SUCCESS;
+			break;
+		case ACTION_VSCAN:
+			if (!_pHead->getVScanInterval()) // if we've not been scanning vertically, the old values are invalid
+			{
+				_pHead->lookNearestSide();
+				_pHead->clearSenseMatrix();
+			}
+			if ((unsigned int)nActionValue != _pHead->getVScanInterval())
+			{
+				_pHead->setHScanInterval(0); // stop horizontal scanning
+				_pHead->setVScanInterval(nActionValue);
+			}
+			bRtn = R5_SUCCESS;
+			break;
+		case ACTION_SCAN:
+			if (!_pHead->getHScanInterval() || !_pHead->getVScanInterval()) // if we've not been scanning, the old values are invalid
+			{
+				_pHead->lookNearestSide();
+				_pHead->clearSenseMatrix();
+			}
+			{
+				// intervals for a sawtooth scan pattern
+				unsigned int nVScanInterval = nActionValue * _pHead->getVCells();
+				unsigned int nHScanInterval = nVScanInterval * _pHead->getHCells();
+				if (nHScanInterval != _pHead->getHScanInterval())
+					_pHead->setHScanInterval(nHScanInterval);
+				if (nVScanInterval != _pHead->getVScanInterval())
+					_pHead->setVScanInterval(nVScanInterval);
+			}
+			bRtn = R5_SUCCESS;
+			break;
+		case ACTION_TURNTOMOSTOPEN: // stops and turns towards the most open way forward
+			// nActionValue is the row of sensor cells to look at. Only works if we've been scanning ahead long enough
+			if (!bCheckForComplete) // if this is the first time through
+			{
+				unsigned char bVCoord = min(nActionValue, (int)_pHead->getVCells());
+				_nNewHeading = 0 - (_pHead->getHMostOpenAngle(bVCoord) - 75); // 75' is straight ahead as the head is wonky
+			}
+			bRtn = _pMotors->stopAndRotate(_nNewHeading, bCheckForComplete);
+			break;
+		case ACTION_TURNMOSTOPENDIR: // turns nActionValue degrees towards the more open side, using the IR sensors
+			if (!bCheckForComplete)
+			{
+				switch (_pSensors->nearestCorner())
+				{
+					case R5_FRONT_LEFT:
+						_nNewHeading = nActionValue;
+						break;
+					case R5_FRONT_RIGHT:
+						_nNewHeading = -nActionValue;
+						break;
+					default:
+						_nNewHeading = (random(1) > 0) ? nActionValue : -nActionValue;
+						break;
+				}
+			}
+			bRtn = _pMotors->stopAndRotate(_nNewHeading, bCheckForComplete);
+			break;
+		case ACTION_WAIT_HSCANREADY:
+			bRtn = _robotWait(_pHead->getHScanInterval() * 2, bCheckForComplete);
+			if (_pHead->senseHMatrixReady(nActionValue))
+				bRtn = R5_SUCCESS;
+			else if (bRtn == R5_SUCCESS) // this is success from the wait
+				bRtn = R5_FAIL; // timeout
+			break;
+		case ACTION_WAIT_VSCANREADY:
+			bRtn = _robotWait(_pHead->getVScanInterval() * 2, bCheckForComplete);
+			if (_pHead->senseVMatrixReady(nActionValue))
+				bRtn = R5_SUCCESS;
+			else if (bRtn == R5_SUCCESS)
+				bRtn = R5_FAIL;
+			break;
+		case ACTION_WAIT_SCANREADY: // wait until the scan is ready, or timeout after twice the scan interval
+			bRtn = _robotWait(max(_pHead->getHScanInterval(), _pHead->getVScanInterval()) * 2, bCheckForComplete);
+			if (_pHead->senseMatrixReady())
+				bRtn = R5_SUCCESS;
+			else if (bRtn == R5_SUCCESS)
+				bRtn = R5_FAIL;
+			break;
+		case ACTION_RESET_HUMAN_DETECTOR:
+			_pMotors->resetDistanceTravelled();
+			_bConfirmedHuman = 0;
+			bRtn = R5_SUCCESS;
+			break;
+		case ACTION_CONF_HUMAN:
+			if (!bCheckForComplete) // cycle starts - no human detected yet
+			{
+				_bConfirmedHuman = 0;
+				displayClear(); // don't entice a human just yet as we need the PIR to clear
+			}
+			if (!_pPIR->activated()) // step 1 - PIR now ready to detect a human
+				_bConfirmedHuman = 1;
+			else if (_bConfirmedHuman == 1) // step 2 - human confirmed so no need to wait any longer
+				_bConfirmedHuman = 2;
+
+			if (_bConfirmedHuman == 2)
+				bRtn = R5_SUCCESS;
+			else
+			{
+				bRtn = _robotWait(nActionValue, bCheckForComplete);
+				if (bRtn == R5_SUCCESS) // check the PIR at timeout
+					_bConfirmedHuman = _pPIR->activated() ? 2 : 0;
+				else
+					displayRainbow();
+			}
+			if (bRtn == R5_SUCCESS)
+				displayClear();
+			break;
+		case ACTION_FLASH_COLOUR: // lowest 3 bits are RGB, remainder is delay in mS
+			displayColour(nActionValue & 0x07);
+			bRtn = _robotWait(nActionValue & 0xFFF8, bCheckForComplete);
+			if (bRtn == R5_SUCCESS)
+				displayClear();
+			break;
+		case ACTION_RESET_POSE: // the current position becomes the origin for SENSE_HEADING and SENSE_DISPLACEMENT
+			bRtn = _pMotors->resetPose();
+			break;
+		case ACTION_QUEUE_DRIVE: // the queue actions succeed as soon as the segment is queued, and fail if the queue is full
+			bRtn = _pMotors->queueDrive(nActionValue);
+			break;
+		case ACTION_QUEUE_ROTATE:
+			bRtn = _pMotors->queueRotate(nActionValue);
+			break;
+		case ACTION_QUEUE_ARC:
+			bRtn = _pMotors->queueArc((int)((signed char)(nActionValue >> 8)) * 20, (signed char)(nActionValue & 0xFF));
+			break;
+		case ACTION_QUEUE_PAUSE:
+			bRtn = _pMotors->queuePause(nActionValue);
+			break;
+		case ACTION_RUN_SEGMENTS:
+			bRtn = _pMotors->getSegmentStatus();
+			break;
+		case ACTION_ABORT_SEGMENTS:
+			bRtn = _pMotors->abortSegments();
+			break;
+	}
+	return bRtn;
+}
+
+// puts the robot to sleep for nSleepTime seconds (note wait uses mS, but this is seconds)
+unsigned char R5PlanInterface::_robotSleep(const int nSleepTime, const unsigned char bCheckForComplete)
+{
+	unsigned char bSuccess;
+	unsigned long ulMillis = millis();
+
+	if (_ulSleepStart > ulMillis) // avoid huge sleep on rollover
+		_ulSleepStart = 0L;
+
+	if (!bCheckForComplete && nSleepTime)
+	{
+		_pMotors->stop(); // stop the robot
+		_pSensors->setPause(true); // pause the sensors to save power
+		_pHead->setHScanInterval(0); // stop the head scanning
+		_pHead->setVScanInterval(0);
+		_ulSleepStart = ulMillis;
+		bSuccess = R5_IN_PROGRESS;
+	}
+	else if (!nSleepTime || (ulMillis > (_ulSleepStart + ((unsigned long)nSleepTime * 1000L))))
+	{
+		_pSensors->setPause(false); // enable the sensors
+		_ulSleepStart = 0L;
+		bSuccess = R5_SUCCESS;
+	}
+	else
+		bSuccess = R5_IN_PROGRESS;
+	return bSuccess;
+}
+
+unsigned char R5PlanInterface::_robotWake(const unsigned char bCheckForComplete)
+{
+	_pSensors->setPause(false);
+	_ulSleepStart = 0L;
+	return R5_SUCCESS;
+}
+
+// this just waits for nWaitTime mS, useful for waiting while scanning around
+unsigned char R5PlanInterface::_robotWait(const int nWaitTime, const unsigned char bCheckForComplete)
+{
+	unsigned char bSuccess;
+	unsigned long ulMillis = millis();
+
+	if (_ulWaitStart > ulMillis) // avoid huge wait on rollover
+		_ulWaitStart = 0L;
+
+	if (!bCheckForComplete && nWaitTime)
+	{
+		_ulWaitStart = ulMillis;
+		bSuccess = R5_IN_PROGRESS;
+	}
+	else if (!nWaitTime || (ulMillis > (_ulWaitStart + (unsigned long)nWaitTime)))
+	{
+		_ulWaitStart = 0L;
+		bSuccess = R5_SUCCESS;
+	}
+	else
+		bSuccess = R5_IN_PROGRESS;
+	return bSuccess;
+}
@@ -0,0 +1,33 @@
+// 	Library for Rover 5 Platform PROGMEM Strings
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Lists of strings are kept in flash to save RAM, as one PROGMEM string with each entry ended by '!'
+// e.g. "PLAN!STOP!START!". These copy an entry out by index, or find the index of an entry.
+// Both scan the list from the start. Where the index is known a table is quicker, a PROGMEM array
+// of pointers to PROGMEM strings, from which getProgmemTableStr() copies the entry directly.
+//
+#ifndef _R5PROGMEM_H_
+#define _R5PROGMEM_H_
+
+// copy string nStrOffset into pStrBuff, truncated to nBuffLen. Returns pStrBuff, empty if there is no such string
+char * getProgmemStr(char *pStrBuff, const int nBuffLen, const unsigned char nStrOffset, const char *progBuff);
+// returns the 0 based index of the string, or -1 if it is not in the list
+int findProgmemStr(const char *pStrBuff, const char *progBuff);
+// copy entry nIndex of a table of bCount strings into pStrBuff, truncated to nBuffLen. Returns pStrBuff, empty if there is no such entry
+char * getProgmemTableStr(char *pStrBuff, const int nBuffLen, const unsigned char nIndex, const char * const *ppTable, const unsigned char bCount);
+
+#endif // _R5PROGMEM_H_
@@ -0,0 +1,116 @@
+// 	Library for Rover 5 Platform PROGMEM Strings
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5Progmem.h"
+
+// access a string from progBuff with offset nStrOffset. Strings separated by '!'
+char * getProgmemStr(char *pStrBuff, const int nBuffLen, const unsigned char nStrOffset, const char *progBuff)
+{
+	char *pBuff = pStrBuff;
+	int i = 0;
+	int j = 0;
+	int len = 1;
+	unsigned char ch;
+
+	if (!pStrBuff || (nBuffLen < 1) || !progBuff) // no buffers
+		return pBuff;
+
+	*pBuff = 0; // ensure the return string is always zero terminated
+	while ((ch = pgm_read_byte_far(progBuff + i)))
+	{
+		i++;
+
+		if (len == nBuffLen)
+		{
+			break;
+		}
+		else if (ch == '!')
+		{
+			j++;
+			*pBuff = 0;
+		}
+		else if (j == nStrOffset)
+		{
+			*pBuff = ch;
+			pBuff++;
+			len++;
+			*pBuff = 0; // ensure the return string is always zero terminated
+		}
+		else if (j > nStrOffset)
+			break;
+	}
+
+	return pStrBuff;
+}
+
+// search for a string from progBuff . If found return 0 based index. If not return -1. Strings separated by '!'
+int findProgmemStr(const char *pStrBuff, const char *progBuff)
+{
+	const char *pBuff;
+	int i = 0;
+	int nString = 0;
+	unsigned char bMatch;
+	unsigned char ch;
+
+	if (!pStrBuff || !progBuff) // no buffer
+		return -1;
+
+	pBuff = pStrBuff;
+	bMatch = 1;
+	while ((ch = pgm_read_byte_far(progBuff + i)))
+	{
+		i++;
+
+		if (bMatch && (ch == '!') && (*pBuff == 0))
+		{
+			// strings matched to the end
+			return nString;
+		}
+		else if (ch == '!')
+		{
+			// start on the next string
+			nString++;
+			pBuff = pStrBuff;
+			bMatch = 1;
+		}
+		else if (bMatch && (*pBuff == ch)) // matching so far
+		{
+			pBuff++;
+		}
+		else
+			bMatch = 0;
+	}
+
+	return -1;
+}
+
+// access a string from a table of pointers, all in PROGMEM
+char * getProgmemTableStr(char *pStrBuff, const int nBuffLen, const unsigned char nIndex, const char * const *ppTable, const unsigned char bCount)
+{
+	if (!pStrBuff || (nBuffLen < 1)) // no buffer
+		return pStrBuff;
+
+	*pStrBuff = 0;
+	if (ppTable && (nIndex < bCount))
+	{
+		strncpy_P(pStrBuff, (const char *)pgm_read_ptr(&ppTable[nIndex]), nBuffLen - 1);
+		pStrBuff[nBuffLen - 1] = 0;
+	}
+
+	return pStrBuff;
+}
@@ -0,0 +1,68 @@
+// 	Library for Rover 5 Platform Robot Commands
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// The commands R5Robot.ino answers, one X(Name, "WORD", handler, args, "help") each, in the
+// alphabetical order that robotCommands[] must keep, see R5Command.h. The sketch makes its szCmd
+// and szHelp strings and robotCommands[] from this list, and extras/bench/r5bench.cpp makes its
+// command table from it too, so the benchmarks search the same table the robot does.
+//
+#ifndef _R5ROBOTCOMMANDS_H_
+#define _R5ROBOTCOMMANDS_H_
+
+#define R5_ROBOT_COMMANDS(X) \
+	X(Cal, "CAL", cmdCal, R5_COMMAND_NONE, "CAL - recalibrate sensors") \
+	X(CNames, "CNAMES", cmdCNames, R5_COMMAND_NONE, "CNAMES - clear plan element names") \
+	X(Con, "CON", cmdCon, R5_COMMAND_NONE, "CON - connect to wifi - useful if server started after robot is booted") \
+	X(Conf, "CONF", cmdConf, R5_COMMAND_REQUIRED, "CONF N N N N N - set config flags - ConnectWifi ReadPlan MonitorPlan Vocalise ReadSpeakRules") \
+	X(Dump, "DUMP", cmdDump, R5_COMMAND_NONE, "DUMP - Dump a complete listing of the Instinct Plan") \
+	X(Help, "HELP", cmdHelp, R5_COMMAND_OPTIONAL, "HELP - return command list to the user - HELP [CMD] - command help") \
+	X(HStart, "HSTART", cmdHStart, R5_COMMAND_NONE, "HSTART - allow robot head to scan") \
+	X(HStop, "HSTOP", cmdHStop, R5_COMMAND_NONE, "HSTOP - stop robot head from scanning") \
+	X(MLimits, "MLIMITS", cmdMLimits, R5_COMMAND_OPTIONAL, "MLIMITS N N - max speed % and acceleration %/s (0-1000) for moves and turns, 0 accel for fixed speed") \
+	X(Output, "OUTPUT", cmdOutput, R5_COMMAND_OPTIONAL, "OUTPUT [N] - full buffer policy, 0 drop oldest 1 drop newest 2 wait. Alone shows buffer stats") \
+	X(PElem, "PELEM", cmdPElem, R5_COMMAND_REQUIRED, "PELEM [name]=[ID] - associate a name with a plan element ID") \
+	X(PID, "PID", cmdPID, R5_COMMAND_OPTIONAL, "PID N [N N N] - track speed control on/off, Kp Ki Kd in 1/16ths. PID alone shows settings") \
+	X(PImage, "PIMAGE", cmdPImage, R5_COMMAND_REQUIRED, "PIMAGE N - load a binary plan image of N bytes, sent straight after, made by r5plan") \
+	X(Plan, "PLAN", cmdPlan, R5_COMMAND_OPTIONAL, "PLAN") /* HELP PLAN lists the CmdPlanner help instead */ \
+	X(RAction, "RACTION", cmdRName, R5_COMMAND_NONE, "RACTION [name]=[ID] - associate a name with a robot action ID") \
+	X(Rate, "RATE", cmdRate, R5_COMMAND_REQUIRED, "RATE N - Set plan rate - cycles per second - 0 to stop plan execution") \
+	X(RConf, "RCONF", cmdRConf, R5_COMMAND_NONE, "RCONF - read robot config from EEPROM") \
+	X(Report, "REPORT", cmdReport, R5_COMMAND_REQUIRED, "REPORT N N N N N N N N [mS] - Serial Wifi Sensors HeadMatrix Plan Vocalise Trace Binary TracemA") \
+	X(Reset, "RESET", cmdReset, R5_COMMAND_NONE, "RESET - does not work - needs a bootloader fix") \
+	X(RPlan, "RPLAN", cmdRPlan, R5_COMMAND_NONE, "RPLAN - read robot plan from EEPROM") \
+	X(RRules, "RRULES", cmdRRules, R5_COMMAND_NONE, "RRULES - read speak rules from EEPROM") \
+	X(RSense, "RSENSE", cmdRName, R5_COMMAND_NONE, "RSENSE [name]=[ID] - associate a name with a robot sense ID") \
+	X(SConf, "SCONF", cmdSConf, R5_COMMAND_NONE, "SCONF - save robot config in EEPROM") \
+	X(SetTime, "SETTIME", cmdSetTime, R5_COMMAND_REQUIRED, "SETTIME YYYY MM DD HH MM SS - Set the time") \
+	X(ShoConf, "SHOCONF", cmdShoConf, R5_COMMAND_NONE, "SHOCONF - show startup flags - ConnectWifi ReadPlan MonitorPlan Vocalise ReadSpeakRules") \
+	X(ShoNames, "SHONAMES", cmdShoNames, R5_COMMAND_NONE, "SHONAMES - show plan element names stored in the robot") \
+	X(ShoRate, "SHORATE", cmdShoRate, R5_COMMAND_NONE, "SHORATE - show plan cycle rate. 0 means no plan processing") \
+	X(ShoReport, "SHOREPORT", cmdShoReport, R5_COMMAND_NONE, "SHOREPORT - show report flags - Serial Wifi Sensors HeadMatrix Plan Vocalise Trace Binary TracemA") \
+	X(ShoRules, "SHORULES", cmdShoRules, R5_COMMAND_NONE, "SHORULES - show speak rules") \
+	X(ShoWifi, "SHOWIFI", cmdShoWifi, R5_COMMAND_NONE, "SHOWIFI - show wifi params - SSID PW WifiRetry IP Port ServerRetry") \
+	X(SpeakRule, "SPEAKRULE", cmdSpeakRule, R5_COMMAND_REQUIRED, "SPEAKRULE N N N N N N - set rule - NodeType Status Timeout RepeatMyself RptTimeout AlwaysSpeak") \
+	X(SPlan, "SPLAN", cmdSPlan, R5_COMMAND_NONE, "SPLAN - save robot plan in EEPROM") \
+	X(SRules, "SRULES", cmdSRules, R5_COMMAND_NONE, "SRULES - save speak rules in EEPROM") \
+	X(Start, "START", cmdStart, R5_COMMAND_NONE, "START - Enable the robot motors") \
+	X(Stop, "STOP", cmdStop, R5_COMMAND_NONE, "STOP - Disable the robot motors") \
+	X(Sub, "SUB", cmdSub, R5_COMMAND_OPTIONAL, "SUB L T [mS [N]] - report channel XYCGOMHP - 0 off 1 plan 2 period 3 change 4 sweep") \
+	X(SWifi, "SWIFI", cmdSWifi, R5_COMMAND_REQUIRED, "SWIFI SSID PW WifiRetry IP Port ServerRetry - set wifi params") \
+	X(Time, "TIME", cmdTime, R5_COMMAND_NONE, "TIME - Report the time") \
+	X(Unsub, "UNSUB", cmdUnsub, R5_COMMAND_OPTIONAL, "UNSUB [L] - stop reporting channel L, or all channels") \
+	X(Ver, "VER", cmdVer, R5_COMMAND_NONE, "VER - return date and time of last compilation")
+
+#endif // _R5ROBOTCOMMANDS_H_
@@ -38,32 +38,63 @@ public:
 	unsigned int getRangeAtCell(const unsigned char bHCell, const unsigned char bVCell);
 	unsigned char getHMostOpenAngle(const unsigned char bVCoord);
 	unsigned char senseMatrixReady(void);
+	unsigned int getSweeps(void);	// horizontal sweeps completed, counting each end stop reached
+	// cells whose range has changed since they were last taken, so that only those need reporting
+	unsigned int getDirtyCells(void);
+	unsigned char takeDirtyCell(unsigned char *pbHCoord, unsigned char *pbVCoord);	// false if there are none
+	void clearDirtyCells(void);
 	unsigned int getMinRange(void);
 	unsigned char senseHMatrixReady(const unsigned char bVCoord);
 	unsigned int getHMinRange(const unsigned char bVCoord);
 	unsigned char senseVMatrixReady(const unsigned char bHCoord);
 	unsigned int getVMinRange(const unsigned char bHCoord);
 	void clearSenseMatrix(void);
+	virtual void driveHead(void);	// also collects an asynchronous range, and keeps pinging ahead asynchronously while the head is still
 
 protected:
 	virtual void notifyHEndstop(const unsigned char bScanDirection, const unsigned char bServoPosition);
 	virtual void notifyHMovement(const unsigned char bScanDirection, const unsigned char bServoPosition);
 	virtual void notifyVEndstop(const unsigned char bScanDirection, const unsigned char bServoPosition);
 	virtual void notifyVMovement(const unsigned char bScanDirection, const unsigned char bServoPosition);
+	virtual void notifyHScanParams(void);
 
 private:
 	void updateSenseMatrix(const unsigned char bHServoPosition, const unsigned char bVServoPosition);
-	long taylorFPSin(const int nAngle);
+	void updateCell(const unsigned char bHCoord, const unsigned char bVCoord, unsigned int uiRange);
+	void updateEndStopRange(unsigned int *puiEndStopRange);
+	unsigned int scanRowMinRange(const unsigned char bVCoord);
+	unsigned int scanColMinRange(const unsigned char bHCoord);
+	unsigned int calculateHMinRange(const unsigned char bVCoord);
+	void setDirtyCell(const unsigned int uiCell);
 
 	R5Ultrasonic *_pUltrasonic;
 	unsigned char _bHCells;
 	unsigned char _bVCells;
 	unsigned char _bSmoothing;
 	unsigned int *_pSenseMatrix;
+
+	// summaries of the matrix, updated as each cell is written. They share the _pSenseMatrix buffer
+	unsigned int *_pRowMinRange;	// smallest range in each row
+	unsigned int *_pColMinRange;	// smallest range in each column
+	unsigned int *_pRowHMinRange;	// getHMinRange() for each row
+	unsigned char *_pRowFilled;		// number of non zero cells in each row
+	unsigned char *_pColFilled;		// number of non zero cells in each column
+	unsigned char *_pRowHMinValid;	// false if the row has changed since _pRowHMinRange was calculated
+	unsigned char *_pDirty;			// a bit for each cell, set when its range changes
+	unsigned int _uiFilledCells;
+	unsigned int _uiDirtyCells;
+	unsigned int _uiMinRange;
 	unsigned int _uiLeftEndStopRange;
 	unsigned int _uiRightEndStopRange;
 	unsigned int _uiTopEndStopRange;
 	unsigned int _uiBottomEndStopRange;
+	unsigned int _uiSweeps;
+
+	// in asynchronous mode the range arrives after the head has been notified, so remember where it goes
+	unsigned char _bPendingCell;
+	unsigned char _bPendingHCoord;
+	unsigned char _bPendingVCoord;
+	unsigned int *_puiPendingEndStopRange;
 };
 
 #endif // _R5SENSINGHEAD_H_
@@ -15,10 +15,10 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
-#include "Arduino.h"
-#include "Servo.h" // adding this include uses 139 bytes of RAM somehow
+#include "R5Hal.h"
 #include "R5HeadControl.h"
 #include "R5Ultrasonic.h"
+#include "R5FixedMath.h"
 #include "R5SensingHead.h"
 
 // constructor requires identification of servos and sensor and the size of our sensing matrix
@@ -26,44 +26,111 @@ R5SensingHead::R5SensingHead(Servo *pServoHHead, Servo *pServoVHead, const unsig
 		R5Ultrasonic *pUltrasonic, const unsigned char bHCells, const unsigned char bVCells, const unsigned char bSmoothing)
 	: R5HeadControl(pServoHHead, pServoVHead, bHCentreAngle, bVForwardAngle)
 {
-	int nBuffSize;
+	int nCells;
 
 	_pUltrasonic = pUltrasonic;
 	_bHCells = bHCells;
 	_bVCells = bVCells;
 	_bSmoothing = bSmoothing;
 	_pSenseMatrix = 0;
-
-	nBuffSize = _bHCells * _bVCells * sizeof(unsigned int);
-	_pSenseMatrix = (unsigned int *)malloc(nBuffSize);
+	_bPendingCell = false;
+	_bPendingHCoord = 0;
+	_bPendingVCoord = 0;
+	_puiPendingEndStopRange = 0;
+	_uiSweeps = 0;
+
+	// one buffer holds the matrix and the row and column summaries that are kept up to date as it fills
+	nCells = _bHCells * _bVCells;
+	_pSenseMatrix = (unsigned int *)malloc(((nCells + (2 * _bVCells) + _bHCells) * sizeof(unsigned int)) +
+											(2 * _bVCells) + _bHCells + ((nCells + 7) / 8));
 	if (_pSenseMatrix)
+	{
+		_pRowMinRange = _pSenseMatrix + nCells;
+		_pColMinRange = _pRowMinRange + _bVCells;
+		_pRowHMinRange = _pColMinRange + _bHCells;
+		_pRowFilled = (unsigned char *)(_pRowHMinRange + _bVCells);
+		_pColFilled = _pRowFilled + _bVCells;
+		_pRowHMinValid = _pColFilled + _bHCells;
+		_pDirty = _pRowHMinValid + _bVCells;
 		clearSenseMatrix();
+	}
 	else
 	{
 		// if we can't alloc the buffer then we have no matrix to write into
 		_bHCells = 0;
 		_bVCells = 0;
+		_uiFilledCells = 0;
+		_uiDirtyCells = 0;
+		_uiMinRange = R5_HEAD_MAXRANGE;
 	}
 }
 
 // clear the sensor array and reset to initial values
+// this is the only time the row and column summaries are rebuilt from scratch
+// every cell is marked dirty, so that whoever is reporting the matrix sends the zeros
 void R5SensingHead::clearSenseMatrix(void)
 {
 	int nArraySize = _bHCells * _bVCells;
 	for (int i = 0; i < nArraySize; i++)
 		*(_pSenseMatrix+i) = 0; // set to zero
+	for (int i = 0; i < (nArraySize + 7) / 8; i++)
+		_pDirty[i] = 0xFF;
+	if (nArraySize % 8)
+		_pDirty[nArraySize / 8] = (1 << (nArraySize % 8)) - 1; // no bits for cells past the end
+	_uiDirtyCells = nArraySize;
+	for (unsigned char v = 0; v < _bVCells; v++)
+	{
+		_pRowMinRange[v] = R5_HEAD_MAXRANGE;
+		_pRowFilled[v] = 0;
+		_pRowHMinValid[v] = false;
+	}
+	for (unsigned char h = 0; h < _bHCells; h++)
+	{
+		_pColMinRange[h] = R5_HEAD_MAXRANGE;
+		_pColFilled[h] = 0;
+	}
+	_uiFilledCells = 0;
+	_uiMinRange = R5_HEAD_MAXRANGE;
+	_bPendingCell = false; // a range still in flight belongs to the old matrix
+}
+
+// in asynchronous mode collect any range that has arrived since the last call, then move the head
+void R5SensingHead::driveHead(void)
+{
+	if (_pUltrasonic->pollRange())
+	{
+		unsigned int uiRange = _pUltrasonic->range();
+		if (_bPendingCell)
+		{
+			updateCell(_bPendingHCoord, _bPendingVCoord, uiRange);
+			_bPendingCell = false;
+		}
+		if (_puiPendingEndStopRange)
+		{
+			*_puiPendingEndStopRange = uiRange;
+			_puiPendingEndStopRange = 0;
+		}
+	}
+
+	// a head that isn't scanning takes no readings, so keep ranging ahead for the sensor frame.
+	// Only asynchronously: a blocking ping here would stall the loop whenever the head is idle.
+	// startPing() holds off until the sensor's minimum interval has passed
+	if (_pUltrasonic->getAsync() && (getParalyse() || (!getHScanInterval() && !getVScanInterval())))
+		_pUltrasonic->startPing();
+
+	R5HeadControl::driveHead();
 }
 
 void R5SensingHead::notifyHEndstop(const unsigned char bScanDirection, const unsigned char bServoPosition)
 {
-	unsigned int uiRange = _pUltrasonic->measureRange();
+	_uiSweeps++;
 	if (bScanDirection)
 	{
-		_uiLeftEndStopRange = uiRange;
+		updateEndStopRange(&_uiLeftEndStopRange);
 	}
 	else
 	{
-		_uiRightEndStopRange = uiRange;
+		updateEndStopRange(&_uiRightEndStopRange);
 	}
 }
 
@@ -74,14 +141,13 @@ void R5SensingHead::notifyHMovement(const unsigned char bScanDirection, const un
 
 void R5SensingHead::notifyVEndstop(const unsigned char bScanDirection, const unsigned char bServoPosition)
 {
-	unsigned int uiRange = _pUltrasonic->measureRange();
 	if (bScanDirection)
 	{
-		_uiBottomEndStopRange = uiRange;
+		updateEndStopRange(&_uiBottomEndStopRange);
 	}
 	else
 	{
-		_uiTopEndStopRange = uiRange;
+		updateEndStopRange(&_uiTopEndStopRange);
 	}
 }
 
@@ -90,30 +156,71 @@ void R5SensingHead::notifyVMovement(const unsigned char bScanDirection, const un
 	updateSenseMatrix(_pServoHHead->read(), bServoPosition);
 }
 
+// getHMinRange() works out each cell's angle from the servo range, so every cached row is out of date
+void R5SensingHead::notifyHScanParams(void)
+{
+	for (unsigned char v = 0; v < _bVCells; v++)
+		_pRowHMinValid[v] = false;
+}
+
+// the endstop range is measured at the same head position as the last matrix cell, so in asynchronous mode
+// it is filled in by the ping that cell started
+void R5SensingHead::updateEndStopRange(unsigned int *puiEndStopRange)
+{
+	if (!_pUltrasonic->getAsync())
+		*puiEndStopRange = _pUltrasonic->measureRange();
+	else if (_pUltrasonic->pingInProgress())
+		_puiPendingEndStopRange = puiEndStopRange;
+	else
+		*puiEndStopRange = _pUltrasonic->range();
+}
+
 // if the head has moved we need to take a new rangefinding, and then update the correct cell in the
-// sense matrix. The updating is done as a moving average
+// sense matrix. In asynchronous mode the cell is updated by driveHead() once the echo has returned
 void R5SensingHead::updateSenseMatrix(const unsigned char bHServoPosition, const unsigned char bVServoPosition)
 {
-	unsigned int uiRange;
 	unsigned char bHCoord;
 	unsigned char bVCoord;
-	unsigned int *pCell;
 
 	if (!_pSenseMatrix || !_bHCells || !_bVCells)
 		return;
 
-	// measure the range and bound result
-	uiRange = _pUltrasonic->measureRange();
-	uiRange = min(uiRange, R5_HEAD_MAXRANGE);
-	uiRange = max(uiRange, R5_HEAD_MINRANGE);
-
 	// calculate which cell we need to update
 	bHCoord = (_bHMaxServoPosition - bHServoPosition) / ((_bHMaxServoPosition - _bHMinServoPosition)/ (_bHCells - 1));
 	bHCoord = min(bHCoord, _bHCells - 1);
 	bVCoord = (_bVMaxServoPosition - bVServoPosition) / ((_bVMaxServoPosition - _bVMinServoPosition)/ (_bVCells - 1));
 	bVCoord = min(bVCoord, _bVCells - 1);
 
+	if (!_pUltrasonic->getAsync())
+	{
+		updateCell(bHCoord, bVCoord, _pUltrasonic->measureRange());
+	}
+	else if (_pUltrasonic->startPing())
+	{
+		_bPendingHCoord = bHCoord;
+		_bPendingVCoord = bVCoord;
+		_bPendingCell = true;
+	}
+	else if (!_pUltrasonic->pingInProgress())
+	{
+		// too soon to measure again, so use the previous reading just as measureRange() would
+		updateCell(bHCoord, bVCoord, _pUltrasonic->range());
+	}
+	// otherwise the last ping is still in flight and this position is skipped
+}
+
+// bound the range and update the cell. The updating is done as a moving average
+// the row, column and overall summaries are updated at the same time, so the queries don't need to scan
+void R5SensingHead::updateCell(const unsigned char bHCoord, const unsigned char bVCoord, unsigned int uiRange)
+{
+	unsigned int *pCell;
+	unsigned int uiOldRange;
+
+	uiRange = min(uiRange, R5_HEAD_MAXRANGE);
+	uiRange = max(uiRange, R5_HEAD_MINRANGE);
+
 	pCell = _pSenseMatrix + (bHCoord + (bVCoord * _bHCells));
+	uiOldRange = *pCell;
 	if (_bSmoothing && *pCell) // only do smoothing if we have a previous reading in the array
 	{
 		*pCell = (((100L - (unsigned long)_bSmoothing) * (unsigned long)uiRange) + ((unsigned long)_bSmoothing * (unsigned long)*pCell)) / 100L;
@@ -122,6 +229,81 @@ void R5SensingHead::updateSenseMatrix(const unsigned char bHServoPosition, const
 	{
 		*pCell = uiRange;
 	}
+	uiRange = *pCell;
+
+	if (uiRange != uiOldRange)
+		setDirtyCell(bHCoord + (bVCoord * _bHCells));
+
+	if (!uiOldRange) // a new cell has been filled
+	{
+		_pRowFilled[bVCoord]++;
+		_pColFilled[bHCoord]++;
+		_uiFilledCells++;
+	}
+
+	// a smaller range is the new minimum. If the minimum cell got larger we have to look again
+	if (uiRange <= _pRowMinRange[bVCoord])
+		_pRowMinRange[bVCoord] = uiRange;
+	else if (uiOldRange == _pRowMinRange[bVCoord])
+		_pRowMinRange[bVCoord] = scanRowMinRange(bVCoord);
+
+	if (uiRange <= _pColMinRange[bHCoord])
+		_pColMinRange[bHCoord] = uiRange;
+	else if (uiOldRange == _pColMinRange[bHCoord])
+		_pColMinRange[bHCoord] = scanColMinRange(bHCoord);
+
+	// the overall minimum is the smallest of the row minimums
+	if (uiRange <= _uiMinRange)
+		_uiMinRange = uiRange;
+	else if (uiOldRange == _uiMinRange)
+	{
+		_uiMinRange = R5_HEAD_MAXRANGE;
+		for (unsigned char v = 0; v < _bVCells; v++)
+			_uiMinRange = min(_uiMinRange, _pRowMinRange[v]);
+	}
+
+	_pRowHMinValid[bVCoord] = false; // recalculated when next asked for
+}
+
+void R5SensingHead::setDirtyCell(const unsigned int uiCell)
+{
+	unsigned char bMask = 1 << (uiCell % 8);
+
+	if (!(_pDirty[uiCell / 8] & bMask))
+	{
+		_pDirty[uiCell / 8] |= bMask;
+		_uiDirtyCells++;
+	}
+}
+
+// the smallest non zero value in a row
+unsigned int R5SensingHead::scanRowMinRange(const unsigned char bVCoord)
+{
+	unsigned int *pCell = _pSenseMatrix + (bVCoord * _bHCells);
+	unsigned int uiMinRange = R5_HEAD_MAXRANGE;
+
+	for (unsigned char i = 0; i < _bHCells; i++)
+	{
+		if (*pCell && (*pCell < uiMinRange))
+			uiMinRange = *pCell;
+		pCell++;
+	}
+	return uiMinRange;
+}
+
+// the smallest non zero value in a column
+unsigned int R5SensingHead::scanColMinRange(const unsigned char bHCoord)
+{
+	unsigned int *pCell = _pSenseMatrix + bHCoord;
+	unsigned int uiMinRange = R5_HEAD_MAXRANGE;
+
+	for (unsigned char i = 0; i < _bVCells; i++)
+	{
+		if (*pCell && (*pCell < uiMinRange))
+			uiMinRange = *pCell;
+		pCell += _bHCells;
+	}
+	return uiMinRange;
 }
 
 unsigned int R5SensingHead::getLeftEndStopRange(void)
@@ -205,70 +387,86 @@ unsigned char R5SensingHead::getHMostOpenAngle(const unsigned char bVCoord)
 	return bAngle;
 }
 
-// looks over the entire array and returns true if all values are present
+// returns true if all values are present
 unsigned char R5SensingHead::senseMatrixReady(void)
 {
-	unsigned char bReady = true;
-	unsigned int *pCell;
+	return (_uiFilledCells == (unsigned int)(_bHCells * _bVCells));
+}
 
-	pCell = _pSenseMatrix;
-	// scan over each cell and see if any are zero
-	for (unsigned char i = (_bHCells * _bVCells); i > 0; i--)
-	{
-		if (*pCell == 0)
-		{
-			bReady = false;
-		}
-		pCell++;
-	}
+unsigned int R5SensingHead::getSweeps(void)
+{
+	return _uiSweeps;
+}
 
-	return bReady;
+unsigned int R5SensingHead::getDirtyCells(void)
+{
+	return _uiDirtyCells;
 }
 
-// looks over the entire array and returns the minimum value
-unsigned int R5SensingHead::getMinRange(void)
+// returns the coordinates of a dirty cell and marks it clean. Whole bytes of clean cells are skipped
+unsigned char R5SensingHead::takeDirtyCell(unsigned char *pbHCoord, unsigned char *pbVCoord)
 {
-	unsigned int *pCell;
-	unsigned int uiMinRange = R5_HEAD_MAXRANGE;
+	if (!_uiDirtyCells)
+		return false;
+
+	unsigned int uiByte = 0;
+	while (!_pDirty[uiByte])
+		uiByte++;
+	unsigned char bBit = 0;
+	while (!(_pDirty[uiByte] & (1 << bBit)))
+		bBit++;
+	_pDirty[uiByte] &= ~(1 << bBit);
+	_uiDirtyCells--;
+
+	unsigned int uiCell = (uiByte * 8) + bBit;
+	*pbHCoord = uiCell % _bHCells;
+	*pbVCoord = uiCell / _bHCells;
+	return true;
+}
 
-	pCell = _pSenseMatrix;
-	// scan over each cell and see which one has the smallest value
-	for (unsigned char i = (_bHCells * _bVCells); i > 0; i--)
-	{
-		if (*pCell && (*pCell < uiMinRange)) // ignore sero values when looking for minimum
-		{
-			uiMinRange = *pCell;
-		}
-		pCell++;
-	}
+// after the whole matrix has been reported
+void R5SensingHead::clearDirtyCells(void)
+{
+	int nBytes = ((_bHCells * _bVCells) + 7) / 8;
+	for (int i = 0; i < nBytes; i++)
+		_pDirty[i] = 0;
+	_uiDirtyCells = 0;
+}
 
-	return uiMinRange;
+// returns the minimum value over the entire array
+unsigned int R5SensingHead::getMinRange(void)
+{
+	return _uiMinRange;
 }
 
 
-// looks over the horizontal array at bVCoord and returns true if all values are present
+// returns true if all values are present in the horizontal array at bVCoord
 unsigned char R5SensingHead::senseHMatrixReady(const unsigned char bVCoord)
 {
-	unsigned char bReady = true;
-	unsigned int *pCell;
+	if (bVCoord >= _bVCells)
+		return false;
 
-	pCell = _pSenseMatrix + (bVCoord * _bHCells); // point to the correct row
-	// scan over each cell and see if any are zero
-	for (unsigned char i = 0; i < _bHCells; i++)
+	return (_pRowFilled[bVCoord] == _bHCells);
+}
+
+// returns the minimum value ahead in the horizontal array at bVCoord
+// the value is only recalculated if the row has changed since it was last asked for
+unsigned int R5SensingHead::getHMinRange(const unsigned char bVCoord)
+{
+	if (bVCoord >= _bVCells)
+		return R5_HEAD_MAXRANGE;
+
+	if (!_pRowHMinValid[bVCoord])
 	{
-		if (*pCell == 0)
-		{
-			bReady = false;
-		}
-		pCell++;
+		_pRowHMinRange[bVCoord] = calculateHMinRange(bVCoord);
+		_pRowHMinValid[bVCoord] = true;
 	}
-
-	return bReady;
+	return _pRowHMinRange[bVCoord];
 }
 
 // looks over the horizontal array at bVCoord and returns the minimum value ahead
 // ranges in the side lobes are discounted if the robot will pass by unhindered
-unsigned int R5SensingHead::getHMinRange(const unsigned char bVCoord)
+unsigned int R5SensingHead::calculateHMinRange(const unsigned char bVCoord)
 {
 	unsigned int *pCell;
 	unsigned int uiMinRange = R5_HEAD_MAXRANGE;
@@ -287,22 +485,14 @@ unsigned int R5SensingHead::getHMinRange(const unsigned char bVCoord)
 
 			// get absolute value of this angle and find the sin
 			nAngle = (nAngle > 0) ? nAngle : -nAngle;
-			long lSine = taylorFPSin(nAngle);
-			int nMaxDist = (50L * R5_ROBOT_WIDTH) / (lSine ? lSine : 1L); // this is the max dist we care about
+			long lSine = R5FixedMath::sinDeg(nAngle);
+			// this is the max dist we care about. Half the robot width / sin(x)
+			long lMaxDist = ((long)(R5_ROBOT_WIDTH / 2) << R5_FM_SHIFT) / (lSine ? lSine : 1L);
 
-			if (*pCell < nMaxDist)
+			if (*pCell < lMaxDist)
 			{
-				if (nAngle)
-				{
-					// if we are offset from centre then the distance we need to use is reduced by sin(90-x)
-					lSine = taylorFPSin(90 - nAngle);
-					uiMinRange = (unsigned int)(((long)*pCell * lSine) / 100L);
-				}
-				else
-				{
-					// this is just an optimisation to avoid calling taylorFPSin(90) = 1
-					uiMinRange = *pCell;
-				}
+				// if we are offset from centre then the distance we need to use is reduced by cos(x)
+				uiMinRange = (unsigned int)(((long)*pCell * R5FixedMath::cosDeg(nAngle)) >> R5_FM_SHIFT);
 			}
 		}
 		pCell++;
@@ -311,54 +501,20 @@ unsigned int R5SensingHead::getHMinRange(const unsigned char bVCoord)
 	return uiMinRange;
 }
 
-// take an angle in degrees and return 100 * sin(nAngle)
-// uses Taylor expansion to 2nd term
-long R5SensingHead::taylorFPSin(const int nAngle)
-{
-	// for speed use integer maths and scale by 100
-	// scale by 100 * pi/180 = 1.7453 = 175/100
-	long lAngle = (nAngle * 175L) / 100L; // this is 100 * angle in rads
-	long lSine = lAngle - ((lAngle * lAngle * lAngle) / 60000L); // this is 100 * sin(angle) to within 3.5% at 80'
-
-	return lSine;
-}
-
-// looks over the vertical array at bHCoord and returns true if all values are present
+// returns true if all values are present in the vertical array at bHCoord
 unsigned char R5SensingHead::senseVMatrixReady(const unsigned char bHCoord)
 {
-	unsigned char bReady = true;
-	unsigned int *pCell;
+	if (bHCoord >= _bHCells)
+		return false;
 
-	pCell = _pSenseMatrix + bHCoord; // point to the column
-	// scan over each cell and see if any are zero
-	for (unsigned char i = 0; i < _bVCells; i++)
-	{
-		if (*pCell == 0)
-		{
-			bReady = false;
-		}
-		pCell += _bHCells; // move to the next row
-	}
-
-	return bReady;
+	return (_pColFilled[bHCoord] == _bVCells);
 }
 
-// looks over the vertical array at bHCoord and returns the minimum value
+// returns the minimum value in the vertical array at bHCoord
 unsigned int R5SensingHead::getVMinRange(const unsigned char bHCoord)
 {
-	unsigned int *pCell;
-	unsigned int uiMinRange = R5_HEAD_MAXRANGE;
+	if (bHCoord >= _bHCells)
+		return R5_HEAD_MAXRANGE;
 
-	pCell = _pSenseMatrix + bHCoord;
-	// scan over each cell and see which one has the smallest value
-	for (unsigned char i = 0; i < _bVCells; i++)
-	{
-		if (*pCell && (*pCell < uiMinRange)) // ignore sero values when looking for minimum
-		{
-			uiMinRange = *pCell;
-		}
-		pCell += _bHCells; // move to the next row
-	}
-
-	return uiMinRange;
+	return _pColMinRange[bHCoord];
 }
@@ -0,0 +1,109 @@
+// 	Library for Rover 5 Platform Sensor Frame
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// A snapshot of all the sensor values used by the planner, taken once before each plan cycle.
+// Every sense read during the cycle, and the sensor report, then see the same values, and the
+// cost of reading the hardware is paid once per cycle however many releasers are evaluated.
+//
+#ifndef _R5SENSORFRAME_H_
+#define _R5SENSORFRAME_H_
+
+class R5SensorFrame {
+public:
+	// link to the sensors. The head matrix summary is taken for the row ahead and the centre column
+	R5SensorFrame(R5CornerSensors *pSensors, R5MotorControl *pMotors, R5SensingHead *pHead, R5Ultrasonic *pRanger,
+			R5PIR *pPIR, const unsigned char bAheadRow, const unsigned char bCentreColumn);
+	void capture(void);		// read all the sensors into the frame
+	unsigned int getSequence(void) {return _uiSequence;}; // incremented by each capture
+	unsigned long getTime(void) {return _ulTime;}; // millis() when the frame was captured
+
+	// corner sensors
+	int getCornerDistance(const unsigned int nSensor) {return _nCornerDistance[nSensor % 4];};
+	int getEdgeDistance(const unsigned int nEdge) {return _nEdgeDistance[nEdge % 4];};
+	int getEdgeAngle(const unsigned int nEdge) {return _nEdgeAngle[nEdge % 4];};
+	unsigned int nearestCorner(void) {return _bNearestCorner;};
+	unsigned int nearestEdge(void) {return _bNearestEdge;};
+	int getRange(void) {return _nRange;};
+	unsigned char getPause(void) {return _bPause;};
+
+	// ultrasonic and PIR
+	unsigned int getUltrasonicRange(void) {return _uiUltrasonicRange;};
+	unsigned int getUltrasonicSequence(void) {return _uiUltrasonicSequence;}; // R5Ultrasonic::getSequence() of that range
+	unsigned char getPIRActivated(void) {return _bPIRActivated;};
+
+	// motors and odometry
+	int getMotorCurrent(const unsigned char bMotor) {return _nMotorCurrent[bMotor % 3];}; // 0 = both motors, 1 = left, 2 = right
+	int getSpeed(void) {return _nSpeed;};
+	int getRudder(void) {return _nRudder;};
+	long getDistanceTravelled(void) {return _lDistanceTravelled;};
+	int getWheelVelocity(const unsigned char bMotor) {return _nWheelVelocity[bMotor % 3];}; // mm/s. 0 = average, 1 = left, 2 = right
+	void getPose(R5PoseType *pPose) {*pPose = _sPose;};
+	int getHeading(void); // degrees, -180 to 180, clockwise positive
+	unsigned int getDisplacement(void); // straight line distance in mm from where the pose was reset
+	unsigned char getSegmentsQueued(void) {return _bSegmentsQueued;};
+	unsigned char getSegmentStatus(void) {return _bSegmentStatus;};
+
+	// head matrix summary
+	unsigned int getHScanInterval(void) {return _uiHScanInterval;};
+	unsigned int getVScanInterval(void) {return _uiVScanInterval;};
+	unsigned char senseMatrixReady(void) {return _bMatrixReady;};
+	unsigned int getMinRange(void) {return _uiMinRange;};
+	unsigned char senseHMatrixReady(void) {return _bHMatrixReady;}; // for the row ahead
+	unsigned int getHMinRange(void) {return _uiHMinRange;};
+	unsigned char senseVMatrixReady(void) {return _bVMatrixReady;}; // for the centre column
+	unsigned int getVMinRange(void) {return _uiVMinRange;};
+
+private:
+	R5CornerSensors *_pSensors;
+	R5MotorControl *_pMotors;
+	R5SensingHead *_pHead;
+	R5Ultrasonic *_pRanger;
+	R5PIR *_pPIR;
+	unsigned char _bAheadRow;
+	unsigned char _bCentreColumn;
+
+	unsigned int _uiSequence;
+	unsigned long _ulTime;
+	int _nCornerDistance[4];
+	int _nEdgeDistance[4];
+	int _nEdgeAngle[4];
+	unsigned char _bNearestCorner;
+	unsigned char _bNearestEdge;
+	int _nRange;
+	unsigned char _bPause;
+	unsigned int _uiUltrasonicRange;
+	unsigned int _uiUltrasonicSequence;
+	unsigned char _bPIRActivated;
+	int _nMotorCurrent[3];
+	int _nSpeed;
+	int _nRudder;
+	long _lDistanceTravelled;
+	int _nWheelVelocity[3];
+	R5PoseType _sPose;
+	unsigned char _bSegmentsQueued;
+	unsigned char _bSegmentStatus;
+	unsigned int _uiHScanInterval;
+	unsigned int _uiVScanInterval;
+	unsigned char _bMatrixReady;
+	unsigned int _uiMinRange;
+	unsigned char _bHMatrixReady;
+	unsigned int _uiHMinRange;
+	unsigned char _bVMatrixReady;
+	unsigned int _uiVMinRange;
+};
+
+#endif // _R5SENSORFRAME_H_
@@ -0,0 +1,134 @@
+// 	Library for Rover 5 Platform Sensor Frame
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5FixedMath.h"
+#include "R5AdcScheduler.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5HeadControl.h"
+#include "R5Ultrasonic.h"
+#include "R5SensingHead.h"
+#include "R5PIR.h"
+#include "R5SensorFrame.h"
+
+// constructor requires the sensors to read, and which row and column of the head matrix to summarise
+R5SensorFrame::R5SensorFrame(R5CornerSensors *pSensors, R5MotorControl *pMotors, R5SensingHead *pHead, R5Ultrasonic *pRanger,
+			R5PIR *pPIR, const unsigned char bAheadRow, const unsigned char bCentreColumn)
+{
+	_pSensors = pSensors;
+	_pMotors = pMotors;
+	_pHead = pHead;
+	_pRanger = pRanger;
+	_pPIR = pPIR;
+	_bAheadRow = bAheadRow;
+	_bCentreColumn = bCentreColumn;
+	_uiSequence = 0;
+	_ulTime = 0L;
+
+	for (int i = 0; i < 4; i++)
+	{
+		_nCornerDistance[i] = 0;
+		_nEdgeDistance[i] = 0;
+		_nEdgeAngle[i] = 0;
+	}
+	_bNearestCorner = R5_NONE;
+	_bNearestEdge = R5_NONE;
+	_nRange = 0;
+	_bPause = false;
+	_uiUltrasonicRange = _uiUltrasonicSequence = 0;
+	_bPIRActivated = false;
+	_nMotorCurrent[0] = _nMotorCurrent[1] = _nMotorCurrent[2] = 0;
+	_nSpeed = 0;
+	_nRudder = 0;
+	_lDistanceTravelled = 0L;
+	_nWheelVelocity[0] = _nWheelVelocity[1] = _nWheelVelocity[2] = 0;
+	_sPose.lX = _sPose.lY = 0L;
+	_sPose.nHeading = 0;
+	_bSegmentsQueued = 0;
+	_bSegmentStatus = R5_SUCCESS;
+	_uiHScanInterval = 0;
+	_uiVScanInterval = 0;
+	_bMatrixReady = false;
+	_uiMinRange = R5_HEAD_MAXRANGE;
+	_bHMatrixReady = false;
+	_uiHMinRange = R5_HEAD_MAXRANGE;
+	_bVMatrixReady = false;
+	_uiVMinRange = R5_HEAD_MAXRANGE;
+}
+
+// read every sensor once. Call this just before running the plan
+void R5SensorFrame::capture(void)
+{
+	_ulTime = millis();
+
+	for (int i = 0; i < 4; i++)
+	{
+		_nCornerDistance[i] = _pSensors->getCornerDistance(i);
+		_nEdgeDistance[i] = _pSensors->getEdgeDistance(i);
+		_nEdgeAngle[i] = _pSensors->getEdgeAngle(i);
+	}
+	_bNearestCorner = _pSensors->nearestCorner();
+	_bNearestEdge = _pSensors->nearestEdge();
+	_nRange = _pSensors->getRange();
+	_bPause = _pSensors->getPause();
+
+	// the head does the pinging, so this is the last completed ping and never waits for an echo
+	_uiUltrasonicRange = _pRanger->range();
+	_uiUltrasonicSequence = _pRanger->getSequence();
+	_bPIRActivated = _pPIR->activated();
+
+	for (unsigned char i = 0; i < 3; i++)
+		_nMotorCurrent[i] = _pMotors->getMotorCurrent(i);
+	_nSpeed = _pMotors->getSpeed();
+	_nRudder = _pMotors->getRudder();
+	_lDistanceTravelled = _pMotors->getDistanceTravelled();
+	_nWheelVelocity[1] = _pMotors->getWheelVelocity(1);
+	_nWheelVelocity[2] = _pMotors->getWheelVelocity(2);
+	_nWheelVelocity[0] = (_nWheelVelocity[1] + _nWheelVelocity[2]) / 2;
+	_pMotors->getPose(&_sPose);
+	_bSegmentsQueued = _pMotors->getSegmentsQueued();
+	_bSegmentStatus = _pMotors->getSegmentStatus();
+
+	_uiHScanInterval = _pHead->getHScanInterval();
+	_uiVScanInterval = _pHead->getVScanInterval();
+	_bMatrixReady = _pHead->senseMatrixReady();
+	_uiMinRange = _pHead->getMinRange();
+	_bHMatrixReady = _pHead->senseHMatrixReady(_bAheadRow);
+	_uiHMinRange = _pHead->getHMinRange(_bAheadRow);
+	_bVMatrixReady = _pHead->senseVMatrixReady(_bCentreColumn);
+	_uiVMinRange = _pHead->getVMinRange(_bCentreColumn);
+
+	_uiSequence++;
+}
+
+// the pose heading rounded to whole degrees, -180 to 180
+int R5SensorFrame::getHeading(void)
+{
+	int nHeading = (_sPose.nHeading + 50) / 100;
+
+	return (nHeading > 180) ? nHeading - 360 : nHeading;
+}
+
+// distance from the origin of the pose. Saturates at ~46m
+unsigned int R5SensorFrame::getDisplacement(void)
+{
+	long lX = constrain(_sPose.lX, -32767L, 32767L);
+	long lY = constrain(_sPose.lY, -32767L, 32767L);
+
+	return R5FixedMath::sqrtL((unsigned long)(lX * lX) + (unsigned long)(lY * lY));
+}
@@ -0,0 +1,95 @@
+// 	Library for Rover 5 Platform Telemetry Subscriptions
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Decides when each telemetry channel is reported, so that each can have its own rate regardless of
+// the plan rate. A channel is subscribed with a trigger, a period in mS and a decimation, 1 to send
+// every time the trigger fires, 2 every other time and so on:
+//
+//	R5_TRIGGER_PLAN		each plan cycle
+//	R5_TRIGGER_PERIOD	every period mS, 0 for every loop()
+//	R5_TRIGGER_CHANGE	when the values change, but no more often than every period mS
+//	R5_TRIGGER_SWEEP	each time the head reaches the end of a horizontal sweep
+//
+// The channels are reported as a text record of the channel letter and the values, e.g. "C 120 96 300 280",
+// or with setBinary() as R5Telemetry messages of type channel + 1. The plan monitor records are
+// written by the sketch, which asks due() whether to write each one; every monitor record is a change.
+//
+#ifndef _R5SUBSCRIPTIONS_H_
+#define _R5SUBSCRIPTIONS_H_
+
+#define R5_CHANNEL_SENSORS		0	// X, the 18 values of the sensor frame the plan sees
+#define R5_CHANNEL_HEADMATRIX	1	// Y, every cell of the head matrix
+#define R5_CHANNEL_CORNERS		2	// C, the 4 corner distances
+#define R5_CHANNEL_EDGES		3	// G, the 4 edge distances then the 4 edge angles
+#define R5_CHANNEL_ODOMETRY		4	// O, distance travelled, x, y, heading and left and right wheel velocity
+#define R5_CHANNEL_MOTORS		5	// M, left and right motor current, speed and rudder
+#define R5_CHANNEL_PIR			6	// H, PIR activated
+#define R5_CHANNEL_MONITOR		7	// P, the plan monitor records
+#define R5_CHANNELS				8
+#define R5_CHANNEL_LETTERS		R5_TELEMETRY_LETTERS "P"
+
+#define R5_TRIGGER_OFF		0
+#define R5_TRIGGER_PLAN		1
+#define R5_TRIGGER_PERIOD	2
+#define R5_TRIGGER_CHANGE	3
+#define R5_TRIGGER_SWEEP	4
+
+// what has happened since the channels were last reported, or'd together
+#define R5_EVENT_PLAN		0x01	// a plan cycle
+#define R5_EVENT_SWEEP		0x02	// the end of a sweep
+#define R5_EVENT_CHANGE		0x04	// send() works this out for itself
+
+#define R5_SUBSCRIPTION_TEXT	128	// longest text record
+
+typedef struct {
+	unsigned char bTrigger;
+	unsigned char bDecimation;
+	unsigned char bSkipped;		// times the trigger has fired since the channel was sent
+	unsigned int uiPeriod;
+	unsigned long ulLast;		// millis() the trigger last fired
+	unsigned int uiCRC;			// of the values when the trigger last fired
+} R5SubscriptionType;
+
+class R5Subscriptions {
+public:
+	R5Subscriptions(R5Output *pOut, R5Telemetry *pTelemetry);
+	unsigned char subscribe(const unsigned char bChannel, const unsigned char bTrigger, const unsigned int uiPeriod, const unsigned char bDecimation);
+	void unsubscribe(const unsigned char bChannel);
+	unsigned char isActive(const unsigned char bChannel);
+	void getSubscription(const unsigned char bChannel, R5SubscriptionType *pSub);
+	unsigned char getChannel(const char cLetter);	// R5_CHANNELS if there is no such channel
+	void setBinary(const unsigned char bBinary);
+	unsigned char getBinary(void);
+	// whether the channel is to be sent now, given the events since the last time it was asked
+	unsigned char due(const unsigned char bChannel, const unsigned long ulMillis, const unsigned char bEvents);
+	// due(), and if so write the values. Returns true if they were written
+	unsigned char send(const unsigned char bChannel, const unsigned long ulMillis, unsigned char bEvents, const long *plValues, const unsigned char bCount);
+	// write the values whether or not they are due, for a channel that decides for itself with due()
+	void write(const unsigned char bChannel, const unsigned long ulMillis, const long *plValues, const unsigned char bCount);
+
+private:
+	unsigned char _fired(R5SubscriptionType *pSub, const unsigned long ulMillis, const unsigned char bEvents);
+	unsigned char _decimate(R5SubscriptionType *pSub);
+
+	R5Output *_pOut;
+	R5Telemetry *_pTelemetry;
+	unsigned char _bBinary;
+	R5SubscriptionType _subs[R5_CHANNELS];
+};
+
+#endif // _R5SUBSCRIPTIONS_H_
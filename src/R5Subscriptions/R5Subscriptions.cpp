@@ -0,0 +1,178 @@
+// 	Library for Rover 5 Platform Telemetry Subscriptions
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5Crc.h"
+#include "R5Telemetry.h"
+#include "R5Subscriptions.h"
+
+R5Subscriptions::R5Subscriptions(R5Output *pOut, R5Telemetry *pTelemetry)
+{
+	_pOut = pOut;
+	_pTelemetry = pTelemetry;
+	_bBinary = false;
+	for (unsigned char i = 0; i < R5_CHANNELS; i++)
+		unsubscribe(i);
+}
+
+unsigned char R5Subscriptions::subscribe(const unsigned char bChannel, const unsigned char bTrigger, const unsigned int uiPeriod, const unsigned char bDecimation)
+{
+	if ((bChannel >= R5_CHANNELS) || (bTrigger > R5_TRIGGER_SWEEP))
+		return false;
+
+	R5SubscriptionType *pSub = &_subs[bChannel];
+	pSub->bTrigger = bTrigger;
+	pSub->uiPeriod = uiPeriod;
+	pSub->bDecimation = bDecimation ? bDecimation : 1;
+	pSub->bSkipped = 0;
+	pSub->ulLast = millis() - uiPeriod; // so a periodic channel is sent straight away
+	pSub->uiCRC = R5_CRC16_INIT;
+	return true;
+}
+
+void R5Subscriptions::unsubscribe(const unsigned char bChannel)
+{
+	if (bChannel < R5_CHANNELS)
+		subscribe(bChannel, R5_TRIGGER_OFF, 0, 1);
+}
+
+unsigned char R5Subscriptions::isActive(const unsigned char bChannel)
+{
+	return (bChannel < R5_CHANNELS) && (_subs[bChannel].bTrigger != R5_TRIGGER_OFF);
+}
+
+void R5Subscriptions::getSubscription(const unsigned char bChannel, R5SubscriptionType *pSub)
+{
+	*pSub = _subs[bChannel % R5_CHANNELS];
+}
+
+unsigned char R5Subscriptions::getChannel(const char cLetter)
+{
+	const char *pszLetters = R5_CHANNEL_LETTERS;
+	unsigned char i;
+
+	for (i = 0; (i < R5_CHANNELS) && (pszLetters[i] != cLetter); i++)
+		;
+	return i;
+}
+
+void R5Subscriptions::setBinary(const unsigned char bBinary)
+{
+	_bBinary = bBinary;
+}
+
+unsigned char R5Subscriptions::_fired(R5SubscriptionType *pSub, const unsigned long ulMillis, const unsigned char bEvents)
+{
+	unsigned char bFired;
+
+	switch (pSub->bTrigger)
+	{
+	case R5_TRIGGER_PLAN:
+		bFired = bEvents & R5_EVENT_PLAN;
+		break;
+	case R5_TRIGGER_PERIOD:
+		bFired = ((ulMillis - pSub->ulLast) >= pSub->uiPeriod);
+		break;
+	case R5_TRIGGER_CHANGE:
+		bFired = (bEvents & R5_EVENT_CHANGE) && ((ulMillis - pSub->ulLast) >= pSub->uiPeriod);
+		break;
+	case R5_TRIGGER_SWEEP:
+		bFired = bEvents & R5_EVENT_SWEEP;
+		break;
+	default:
+		bFired = false;
+		break;
+	}
+	if (bFired)
+		pSub->ulLast = ulMillis;
+	return bFired;
+}
+
+unsigned char R5Subscriptions::_decimate(R5SubscriptionType *pSub)
+{
+	if (++pSub->bSkipped < pSub->bDecimation)
+		return false;
+	pSub->bSkipped = 0;
+	return true;
+}
+
+unsigned char R5Subscriptions::due(const unsigned char bChannel, const unsigned long ulMillis, const unsigned char bEvents)
+{
+	if (bChannel >= R5_CHANNELS)
+		return false;
+	return _fired(&_subs[bChannel], ulMillis, bEvents) && _decimate(&_subs[bChannel]);
+}
+
+unsigned char R5Subscriptions::send(const unsigned char bChannel, const unsigned long ulMillis, unsigned char bEvents, const long *plValues, const unsigned char bCount)
+{
+	if ((bChannel >= R5_TELEMETRY_TYPES) || (_subs[bChannel].bTrigger == R5_TRIGGER_OFF))
+		return false;
+
+	R5SubscriptionType *pSub = &_subs[bChannel];
+	if (pSub->bTrigger == R5_TRIGGER_CHANGE)
+	{
+		if ((ulMillis - pSub->ulLast) < pSub->uiPeriod)
+			return false; // too soon to send, so don't spend time looking for a change
+		unsigned int uiCRC = R5_CRC16_INIT;
+		for (unsigned char i = 0; i < bCount; i++)
+			for (unsigned char j = 0; j < sizeof(long); j++)
+				uiCRC = crc16Update(uiCRC, (unsigned char)(plValues[i] >> (j * 8)));
+		if (uiCRC != pSub->uiCRC)
+			bEvents |= R5_EVENT_CHANGE;
+		if (!_fired(pSub, ulMillis, bEvents))
+			return false;
+		pSub->uiCRC = uiCRC;
+	}
+	else if (!_fired(pSub, ulMillis, bEvents))
+		return false;
+	if (!_decimate(pSub))
+		return false;
+
+	write(bChannel, ulMillis, plValues, bCount);
+	return true;
+}
+
+void R5Subscriptions::write(const unsigned char bChannel, const unsigned long ulMillis, const long *plValues, const unsigned char bCount)
+{
+	if (bChannel >= R5_TELEMETRY_TYPES)
+		return;
+
+	if (_bBinary && _pTelemetry)
+	{
+		_pTelemetry->begin(bChannel + 1, ulMillis, bCount);
+		for (unsigned char i = 0; i < bCount; i++)
+			_pTelemetry->add(plValues[i]);
+		_pTelemetry->send();
+		return;
+	}
+
+	char szRecord[R5_SUBSCRIPTION_TEXT];
+	unsigned int uiLen = 1;
+	static const char PROGMEM szFmt[] = {" %li"};
+	szRecord[0] = R5_CHANNEL_LETTERS[bChannel];
+	szRecord[1] = 0;
+	for (unsigned char i = 0; (i < bCount) && (uiLen < sizeof(szRecord) - 1); i++)
+		uiLen += snprintf_P(szRecord + uiLen, sizeof(szRecord) - uiLen, szFmt, plValues[i]);
+	_pOut->outputData(szRecord);
+}
+
+unsigned char R5Subscriptions::getBinary(void)
+{
+	return _bBinary && _pTelemetry;
+}
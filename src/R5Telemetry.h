@@ -0,0 +1,85 @@
+// 	Library for Rover 5 Platform Binary Telemetry
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+// Binary versions of the X and Y records, for when REPORT turns binary telemetry on. A message is
+//
+//	key		type | R5_TELEMETRY_KEY, sequence, millis, field count, fields, CRC16
+//	delta	type, sequence, millis, changed fields bitmap, changed fields, CRC16
+//
+// where the sequence byte counts the messages of that type, so a decoder can tell when one never
+// arrived, as when R5BufferedOutput drops a frame, and wait for the next key rather than apply the
+// deltas after it to the wrong values.
+// Millis, the count and the fields are varints, 7 bits a byte with the top bit set on all
+// but the last. Fields are zigzag encoded so small negative numbers stay short. Most messages are
+// deltas, with millis and each field that changed given as the change since the last message of
+// that type. The bitmap has a bit for each field, least significant bit first. A key message with
+// the values themselves is sent every R5_TELEMETRY_KEY_INTERVAL messages of a type, and whenever
+// its field count changes. The CRC16 is of everything before it. The message is COBS encoded,
+// so it has no zero bytes, and sent between two zeros.
+// Text lines never contain a zero, so frames and text can share the same link.
+//
+// extras/telemetry/R5TelemetryDecoder.h turns the frames back into X and Y records on the host.
+//
+#ifndef _R5TELEMETRY_H_
+#define _R5TELEMETRY_H_
+
+#define R5_TELEMETRY_SENSORS	1	// the X record of reportSensorValues()
+#define R5_TELEMETRY_HEADMATRIX	2	// the Y record of reportHeadMatrix()
+#define R5_TELEMETRY_CORNERS	3	// the other channels of R5Subscriptions.h
+#define R5_TELEMETRY_EDGES		4
+#define R5_TELEMETRY_ODOMETRY	5
+#define R5_TELEMETRY_MOTORS		6
+#define R5_TELEMETRY_PIR		7
+#define R5_TELEMETRY_TYPES		7
+#define R5_TELEMETRY_LETTERS	"XYCGOMH"	// the text record each type stands for
+#define R5_TELEMETRY_KEY		0x80	// in the type byte of a key message
+#define R5_TELEMETRY_FIELDS		20		// most fields in a message, more are dropped
+#define R5_TELEMETRY_KEY_INTERVAL 32	// messages of a type between key messages
+// a message can be no longer than this: type, sequence, millis, count, fields and CRC, then COBS and the zeros
+#define R5_TELEMETRY_MESSAGE	(1 + 1 + 5 + ((R5_TELEMETRY_FIELDS + 7) / 8) + (R5_TELEMETRY_FIELDS * 5) + 2)
+#define R5_TELEMETRY_FRAME		(R5_TELEMETRY_MESSAGE + 3)
+
+class R5Telemetry {
+public:
+	R5Telemetry(R5Output *pOut);
+	void reset(void);	// the next message of each type is a key message
+	void begin(const unsigned char bType, const unsigned long ulMillis, const unsigned char bFields);
+	void add(const long lValue);	// the next of the bFields fields
+	void send(void);	// frame the message and give it to R5Output::outputFrame()
+
+private:
+	void _putVarint(unsigned long ulValue);
+
+	R5Output *_pOut;
+	unsigned char _bFrame[R5_TELEMETRY_FRAME];	// the message is built at offset 2, then COBS encoded in place
+	unsigned char _bLength;
+	unsigned char _bType;		// index into the arrays below
+	unsigned char _bKey;
+	unsigned char _bFields;
+	unsigned char _bAdded;
+	unsigned char _bMask;		// where the changed field bits are in a delta
+
+	// the last message of each type, that deltas are from
+	unsigned long _ulLastMillis[R5_TELEMETRY_TYPES];
+	unsigned char _bLastFields[R5_TELEMETRY_TYPES];
+	unsigned char _bSinceKey[R5_TELEMETRY_TYPES];
+	unsigned char _bSequence[R5_TELEMETRY_TYPES];	// of the next message
+	long _lLast[R5_TELEMETRY_TYPES][R5_TELEMETRY_FIELDS];
+};
+
+#endif // _R5TELEMETRY_H_
@@ -0,0 +1,125 @@
+// 	Library for Rover 5 Platform Binary Telemetry
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5Crc.h"
+#include "R5Telemetry.h"
+
+R5Telemetry::R5Telemetry(R5Output *pOut)
+{
+	_pOut = pOut;
+	_bLength = 0;
+	_bFields = 0;
+	_bAdded = 0;
+	for (unsigned char i = 0; i < R5_TELEMETRY_TYPES; i++)
+		_bSequence[i] = 0;
+	reset();
+}
+
+void R5Telemetry::reset(void)
+{
+	for (unsigned char i = 0; i < R5_TELEMETRY_TYPES; i++)
+	{
+		_bLastFields[i] = 0;
+		_bSinceKey[i] = R5_TELEMETRY_KEY_INTERVAL;
+	}
+}
+
+void R5Telemetry::_putVarint(unsigned long ulValue)
+{
+	while ((ulValue >= 0x80) && (_bLength < (R5_TELEMETRY_FRAME - 4)))
+	{
+		_bFrame[_bLength++] = (unsigned char)(ulValue | 0x80);
+		ulValue >>= 7;
+	}
+	_bFrame[_bLength++] = (unsigned char)ulValue;
+}
+
+void R5Telemetry::begin(const unsigned char bType, const unsigned long ulMillis, const unsigned char bFields)
+{
+	_bType = (bType - 1) % R5_TELEMETRY_TYPES;
+	_bFields = (bFields > R5_TELEMETRY_FIELDS) ? R5_TELEMETRY_FIELDS : bFields;
+	_bAdded = 0;
+	_bKey = (_bSinceKey[_bType] >= R5_TELEMETRY_KEY_INTERVAL) || (_bFields != _bLastFields[_bType]);
+	_bSinceKey[_bType] = _bKey ? 1 : _bSinceKey[_bType] + 1;
+	_bLastFields[_bType] = _bFields;
+
+	_bLength = 2; // leave room for the leading zero and the first COBS code
+	_bFrame[_bLength++] = bType | (_bKey ? R5_TELEMETRY_KEY : 0);
+	_bFrame[_bLength++] = _bSequence[_bType]++;
+	_putVarint(_bKey ? ulMillis : ulMillis - _ulLastMillis[_bType]);
+	_ulLastMillis[_bType] = ulMillis;
+	if (_bKey)
+		_putVarint(_bFields);
+	else
+	{
+		// a bit for each field that has changed, and only those are sent
+		_bMask = _bLength;
+		for (unsigned char i = 0; i < ((_bFields + 7) / 8); i++)
+			_bFrame[_bLength++] = 0;
+	}
+}
+
+// zigzag maps 0, -1, 1, -2 ... to 0, 1, 2, 3 ...
+void R5Telemetry::add(const long lValue)
+{
+	if (_bAdded >= _bFields)
+		return;
+	long lField = _bKey ? lValue : lValue - _lLast[_bType][_bAdded];
+	_lLast[_bType][_bAdded] = lValue;
+	if (!_bKey)
+	{
+		if (!lField)
+		{
+			_bAdded++;
+			return;
+		}
+		_bFrame[_bMask + (_bAdded / 8)] |= 1 << (_bAdded % 8);
+	}
+	_bAdded++;
+	_putVarint((lField < 0) ? ((~(unsigned long)lField) << 1) | 1 : (unsigned long)lField << 1);
+}
+
+// COBS replaces each zero with the distance to the next zero, or to the end, and puts the distance
+// to the first zero in front. Messages are shorter than 254 bytes so every distance fits in a
+// byte, and the encoding is done in place
+void R5Telemetry::send(void)
+{
+	unsigned int uiCRC = R5_CRC16_INIT;
+
+	while (_bAdded < _bFields) // fields not given are 0 in a key, and unchanged in a delta
+		add(_bKey ? 0 : _lLast[_bType][_bAdded]);
+	for (unsigned char i = 2; i < _bLength; i++)
+		uiCRC = crc16Update(uiCRC, _bFrame[i]);
+	_bFrame[_bLength++] = (unsigned char)(uiCRC & 0xFF);
+	_bFrame[_bLength++] = (unsigned char)(uiCRC >> 8);
+
+	unsigned char bCode = 1;	// where the current distance goes
+	for (unsigned char i = 2; i < _bLength; i++)
+	{
+		if (_bFrame[i])
+			continue;
+		_bFrame[bCode] = i - bCode;
+		bCode = i;
+	}
+	_bFrame[bCode] = _bLength - bCode;
+	_bFrame[0] = 0;
+	_bFrame[_bLength++] = 0;
+	_pOut->outputFrame(_bFrame, _bLength);
+}
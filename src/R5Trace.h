@@ -0,0 +1,78 @@
+// 	Library for Rover 5 Platform Sensor Trace
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+// Records the raw sensor inputs, so that a run can be played back through the library on the host.
+// The X and Y records report what the robot made of its sensors; the trace records what it read.
+// Each record is a line written through R5Output, which adds the millis() timestamp, and starts
+// with T and a record type:
+//
+//	T B b0 b1 b2 b3					corner sensor bleed levels, written when the trace starts and after calibrateBleed()
+//	T C p0 p1 p2 p3 a0 a1 a2 a3		passive and active corner sensor levels of each completed sense cycle
+//	T M left right c1 c2			encoder counts and raw motor current samples, when they change
+//	T U echo						width in uS of each ultrasonic echo, 0 if none came back
+//	T P level						each edge of the PIR output
+//
+// Only changes are written, so a robot standing still produces little more than the corner records.
+// The encoder counts are written whenever they change, so a replay sees each click in the same
+// millisecond as the robot did. A change in the motor current alone is written at most every
+// R5_TRACE_MOTOR_INTERVAL mS, so a replay only sees the current, and what depends on it such as
+// SENSE_MOTOR_CURRENT and the stall check, that often, and a plan that reacts to the current can
+// go its own way. setMotorInterval(0) writes every change for an exact replay, as r5sim -T does,
+// but then a moving robot writes a motor record every loop, more than a 115200 baud link carries.
+// Times are to the millisecond, so clicks in different loops of the same millisecond replay together.
+// extras/sim/R5SimReplay feeds a trace back through the library classes.
+//
+#ifndef _R5TRACE_H_
+#define _R5TRACE_H_
+
+// shortest time in mS between motor records written only because the current changed
+#define R5_TRACE_MOTOR_INTERVAL 50
+
+class R5Trace {
+public:
+	R5Trace(R5Output *pOut, R5CornerSensors *pSensors, R5MotorControl *pMotors, R5Ultrasonic *pRanger, R5PIR *pPIR);
+	void setEnable(const unsigned char bEnable); // enabling writes the current state before any changes
+	unsigned char getEnable(void);
+	void setMotorInterval(const unsigned int uiInterval); // 0 writes every change of the current too
+	unsigned int getMotorInterval(void) {return _uiMotorInterval;};
+	// call once per loop(), with the encoder counts that are passed to R5MotorControl::driveMotors()
+	void record(const long lLeftCount, const long lRightCount);
+
+private:
+	R5Output *_pOut;
+	R5CornerSensors *_pSensors;
+	R5MotorControl *_pMotors;
+	R5Ultrasonic *_pRanger;
+	R5PIR *_pPIR;
+	unsigned char _bEnable;
+	unsigned char _bStarting;
+	unsigned int _uiMotorInterval;
+
+	// what was last written
+	int _nBleedLevel[4];
+	unsigned int _uiSenseSequence;
+	unsigned int _uiRangeSequence;
+	unsigned char _bPIR;
+	long _lCount[2];
+	int _nCurrent[2];
+	unsigned long _ulMotorMillis;
+
+	void _recordBleed(void);
+	void _recordMotors(const long lLeftCount, const long lRightCount, const int nLeftCurrent, const int nRightCurrent);
+};
+
+#endif // _R5TRACE_H_
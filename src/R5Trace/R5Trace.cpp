@@ -0,0 +1,162 @@
+// 	Library for Rover 5 Platform Sensor Trace
+//  Copyright (c) 2016  Robert H. Wortham <r.h.wortham@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+#include "R5Hal.h"
+#include "R5Output.h"
+#include "R5FixedMath.h"
+#include "R5AdcScheduler.h"
+#include "R5CornerSensors.h"
+#include "R5MotorControl.h"
+#include "R5Ultrasonic.h"
+#include "R5PIR.h"
+#include "R5Trace.h"
+
+// constructor requires the output for the records and the sensors to trace
+R5Trace::R5Trace(R5Output *pOut, R5CornerSensors *pSensors, R5MotorControl *pMotors, R5Ultrasonic *pRanger, R5PIR *pPIR)
+{
+	_pOut = pOut;
+	_pSensors = pSensors;
+	_pMotors = pMotors;
+	_pRanger = pRanger;
+	_pPIR = pPIR;
+	_bEnable = false;
+	_bStarting = false;
+	_uiMotorInterval = R5_TRACE_MOTOR_INTERVAL;
+
+	for (int i = 0; i < 4; i++)
+		_nBleedLevel[i] = 0;
+	_uiSenseSequence = 0;
+	_uiRangeSequence = 0;
+	_bPIR = false;
+	_lCount[0] = _lCount[1] = 0L;
+	_nCurrent[0] = _nCurrent[1] = 0;
+	_ulMotorMillis = 0L;
+}
+
+void R5Trace::setEnable(const unsigned char bEnable)
+{
+	if (bEnable && !_bEnable)
+		_bStarting = true;
+	_bEnable = bEnable;
+}
+
+unsigned char R5Trace::getEnable(void)
+{
+	return _bEnable;
+}
+
+void R5Trace::setMotorInterval(const unsigned int uiInterval)
+{
+	_uiMotorInterval = uiInterval;
+}
+
+// write a record for everything that has changed since the last call
+void R5Trace::record(const long lLeftCount, const long lRightCount)
+{
+	char szBuff[60];
+	unsigned long ulMillis = millis();
+
+	if (!_bEnable)
+		return;
+
+	// the current samples are raw, 5mA per unit
+	int nLeftCurrent = _pMotors->getMotorCurrent(1) / 5;
+	int nRightCurrent = _pMotors->getMotorCurrent(2) / 5;
+
+	// a new trace starts with everything a replay needs before the first change
+	if (_bStarting)
+	{
+		_bStarting = false;
+		_uiSenseSequence = _pSensors->getSequence();
+		_uiRangeSequence = _pRanger->getSequence();
+		_recordBleed();
+		_recordMotors(lLeftCount, lRightCount, nLeftCurrent, nRightCurrent);
+		_bPIR = _pPIR->activated();
+		static const char PROGMEM szFmt[] = {"T P %u"};
+		snprintf_P(szBuff, sizeof(szBuff), szFmt, (unsigned int)_bPIR);
+		_pOut->outputData(szBuff);
+		return;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (_pSensors->bleedLevel[i] != _nBleedLevel[i])
+		{
+			_recordBleed();
+			break;
+		}
+	}
+
+	if (_pSensors->getSequence() != _uiSenseSequence)
+	{
+		_uiSenseSequence = _pSensors->getSequence();
+		static const char PROGMEM szFmt[] = {"T C %i %i %i %i %i %i %i %i"};
+		snprintf_P(szBuff, sizeof(szBuff), szFmt,
+				_pSensors->passiveLevel[0], _pSensors->passiveLevel[1], _pSensors->passiveLevel[2], _pSensors->passiveLevel[3],
+				_pSensors->activeLevel[0], _pSensors->activeLevel[1], _pSensors->activeLevel[2], _pSensors->activeLevel[3]);
+		_pOut->outputData(szBuff);
+	}
+
+	if (_pRanger->getSequence() != _uiRangeSequence)
+	{
+		_uiRangeSequence = _pRanger->getSequence();
+		static const char PROGMEM szFmt[] = {"T U %lu"};
+		snprintf_P(szBuff, sizeof(szBuff), szFmt, _pRanger->getEchoDuration());
+		_pOut->outputData(szBuff);
+	}
+
+	if (_pPIR->activated() != _bPIR)
+	{
+		_bPIR = !_bPIR;
+		static const char PROGMEM szFmt[] = {"T P %u"};
+		snprintf_P(szBuff, sizeof(szBuff), szFmt, (unsigned int)_bPIR);
+		_pOut->outputData(szBuff);
+	}
+
+	// every click is written, as the velocity and pose depend on when each one came. The current changes
+	// with almost every sample, so a change in that alone waits for the interval
+	if ((lLeftCount != _lCount[0]) || (lRightCount != _lCount[1]) ||
+		(((ulMillis - _ulMotorMillis) >= _uiMotorInterval) && ((nLeftCurrent != _nCurrent[0]) || (nRightCurrent != _nCurrent[1]))))
+	{
+		_recordMotors(lLeftCount, lRightCount, nLeftCurrent, nRightCurrent);
+	}
+}
+
+void R5Trace::_recordBleed(void)
+{
+	char szBuff[40];
+
+	for (int i = 0; i < 4; i++)
+		_nBleedLevel[i] = _pSensors->bleedLevel[i];
+	static const char PROGMEM szFmt[] = {"T B %i %i %i %i"};
+	snprintf_P(szBuff, sizeof(szBuff), szFmt, _nBleedLevel[0], _nBleedLevel[1], _nBleedLevel[2], _nBleedLevel[3]);
+	_pOut->outputData(szBuff);
+}
+
+void R5Trace::_recordMotors(const long lLeftCount, const long lRightCount, const int nLeftCurrent, const int nRightCurrent)
+{
+	char szBuff[50];
+
+	_lCount[0] = lLeftCount;
+	_lCount[1] = lRightCount;
+	_nCurrent[0] = nLeftCurrent;
+	_nCurrent[1] = nRightCurrent;
+	_ulMotorMillis = millis();
+	static const char PROGMEM szFmt[] = {"T M %li %li %i %i"};
+	snprintf_P(szBuff, sizeof(szBuff), szFmt, lLeftCount, lRightCount, nLeftCurrent, nRightCurrent);
+	_pOut->outputData(szBuff);
+}
@@ -18,17 +18,51 @@
 #ifndef _R5ULTRASONIC_H_
 #define _R5ULTRASONIC_H_
 
+// states of an asynchronous ping, advanced by the echo interrupt and pollRange()
+#define R5_US_IDLE		0	// no ping in flight
+#define R5_US_WAIT_RISE	1	// trigger sent, waiting for the echo pulse to start
+#define R5_US_WAIT_FALL	2	// echo pulse started, waiting for it to end
+#define R5_US_ECHO_DONE	3	// echo pulse timed by the interrupt, waiting for pollRange()
+
+// called from pollRange() in the main loop (not from the interrupt) when a new range is measured
+typedef void (*R5RangeCallback)(const unsigned int uiRange);
+
 class R5Ultrasonic {
 public:
 	R5Ultrasonic(const unsigned char bSensorPin, const unsigned long ulMinMeasurementInterval);
-	unsigned int measureRange(void);
+	unsigned int measureRange(void); // blocking - returns when the range has been measured
 	unsigned int range(void);
 
+	// asynchronous mode times the echo with an external interrupt, so the sensor pin must be interrupt capable
+	// (on the Mega these are pins 2, 3, 18, 19, 20, 21). Each sensor in asynchronous mode needs its own pin
+	unsigned char setAsync(const unsigned char bAsync); // returns false if the pin has no interrupt
+	unsigned char getAsync(void);
+	unsigned char startPing(void); // send the trigger and return immediately. false if busy or too soon since last reading
+	unsigned char pollRange(void); // call regularly from the main loop. Returns true when a new range is ready
+	unsigned char pingInProgress(void);
+	void setRangeCallback(R5RangeCallback pfnCallback);
+	unsigned long getEchoDuration(void); // uS width of the echo that gave the last range, 0 if there was none
+	unsigned int getSequence(void); // incremented by each new measurement
+
 private:
 	unsigned char _bSensorPin;
 	unsigned int _uiRange;
 	unsigned long _ulMinMeasurementInterval;
     unsigned long _ulLastRangeMeasurement;
+	unsigned long _ulLastEchoDuration;
+	unsigned int _uiSequence;
+
+	unsigned char _bAsync;
+	volatile unsigned char _bPingState;
+	volatile unsigned long _ulEchoStart;	// micros() at the rising edge of the echo
+	volatile unsigned long _ulEchoDuration;	// width of the echo pulse in uS
+	unsigned long _ulPingStart;				// micros() when the trigger was sent
+	R5RangeCallback _pfnCallback;
+
+	unsigned char _measurementDue(void);
+	void _sendTrigger(void);
+	void _setRange(const unsigned long ulDurationUS);
+	static void _echoISR(void *pContext); // pContext is the sensor on the interrupting pin
 };
 
 #endif // _R5ULTRASONIC_H_
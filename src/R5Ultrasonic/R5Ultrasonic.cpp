@@ -15,47 +15,42 @@
 //  along with this program; if not, write to the Free Software
 //  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
-#include "Arduino.h"
+#include "R5Hal.h"
 #include "R5Ultrasonic.h"
 
 #define ULTRASONIC_TIMEOUT 35000L
 
+
 // uses the map above to map sensor readings to distances in mm
 unsigned int R5Ultrasonic::measureRange(void)
 {
 	unsigned long ulDurationUS;
-	unsigned long ulMillis = millis();
-
-	if (_ulLastRangeMeasurement > ulMillis) // fix rollover issue
-		_ulLastRangeMeasurement = 0L;
 
+	if (_bAsync)
+	{
+		// wait for any ping already in flight, then start our own and wait for that
+		while (pingInProgress())
+			pollRange();
+		if (startPing())
+		{
+			while (!pollRange())
+				;
+		}
+	}
     // if we last measured the range less than _ulMinMeasurementInterval milliseconds ago
     // then return the previous stored reading
-    if ( (ulMillis - _ulLastRangeMeasurement) >= _ulMinMeasurementInterval)
+    else if (_measurementDue())
     {
-		// Send out request pulse
-		pinMode( _bSensorPin, OUTPUT );
-		digitalWrite( _bSensorPin, LOW );
-		delayMicroseconds( 2 );
-		digitalWrite( _bSensorPin, HIGH );
-		delayMicroseconds( 5 );
-		digitalWrite( _bSensorPin, LOW );
+		_sendTrigger();
 
 		// Read in the response pulse
-		pinMode( _bSensorPin, INPUT );
 		ulDurationUS = pulseIn( _bSensorPin, HIGH, ULTRASONIC_TIMEOUT);
-
-		// Convert from US to mm
-		_uiRange = (5L*ulDurationUS)/29;
-
-		_ulLastRangeMeasurement = millis();
+		_setRange(ulDurationUS);
 	}
 
     return _uiRange;
 }
 
-
-
 // constructor requires identification of sensor pin
 R5Ultrasonic::R5Ultrasonic(const unsigned char bSensorPin, const unsigned long ulMinMeasurementInterval)
 {
@@ -63,6 +58,14 @@ R5Ultrasonic::R5Ultrasonic(const unsigned char bSensorPin, const unsigned long u
 	_ulMinMeasurementInterval = ulMinMeasurementInterval;
 	_uiRange = 0;
 	_ulLastRangeMeasurement = 0L;
+	_ulLastEchoDuration = 0L;
+	_uiSequence = 0;
+	_bAsync = false;
+	_bPingState = R5_US_IDLE;
+	_ulEchoStart = 0L;
+	_ulEchoDuration = 0L;
+	_ulPingStart = 0L;
+	_pfnCallback = 0;
 }
 
 // return the last measured range
@@ -70,3 +73,148 @@ unsigned int R5Ultrasonic::range(void)
 {
 	return _uiRange;
 }
+
+// switch between pulseIn() timing and interrupt timing of the echo
+unsigned char R5Ultrasonic::setAsync(const unsigned char bAsync)
+{
+	if (bAsync == _bAsync)
+		return true;
+
+	if (bAsync)
+	{
+		_bPingState = R5_US_IDLE;
+		pinMode( _bSensorPin, INPUT );
+		if (!R5Hal::attachPinChange(_bSensorPin, _echoISR, this))
+			return false;
+	}
+	else
+	{
+		R5Hal::detachPinChange(_bSensorPin);
+		_bPingState = R5_US_IDLE;
+	}
+	_bAsync = bAsync;
+	return true;
+}
+
+unsigned char R5Ultrasonic::getAsync(void)
+{
+	return _bAsync;
+}
+
+// the callback is made from pollRange(), so it runs in the main loop and may take its time
+void R5Ultrasonic::setRangeCallback(R5RangeCallback pfnCallback)
+{
+	_pfnCallback = pfnCallback;
+}
+
+unsigned long R5Ultrasonic::getEchoDuration(void)
+{
+	return _ulLastEchoDuration;
+}
+
+unsigned int R5Ultrasonic::getSequence(void)
+{
+	return _uiSequence;
+}
+
+unsigned char R5Ultrasonic::pingInProgress(void)
+{
+	return (_bPingState != R5_US_IDLE);
+}
+
+// send the trigger pulse and leave the interrupt to time the echo
+unsigned char R5Ultrasonic::startPing(void)
+{
+	if (!_bAsync || pingInProgress() || !_measurementDue())
+		return false;
+
+	_bPingState = R5_US_IDLE; // ignore our own trigger pulse
+	_sendTrigger();
+	_ulPingStart = micros();
+	_bPingState = R5_US_WAIT_RISE;
+	return true;
+}
+
+// check for a completed echo, or a timeout if the echo never came back
+unsigned char R5Ultrasonic::pollRange(void)
+{
+	unsigned long ulDurationUS;
+
+	switch (_bPingState)
+	{
+		case R5_US_ECHO_DONE:
+			noInterrupts(); // the duration is 4 bytes so read it atomically
+			ulDurationUS = _ulEchoDuration;
+			interrupts();
+			break;
+
+		case R5_US_WAIT_RISE:
+		case R5_US_WAIT_FALL:
+			if ((micros() - _ulPingStart) < ULTRASONIC_TIMEOUT)
+				return false;
+			ulDurationUS = 0L; // same as a pulseIn() timeout
+			break;
+
+		default:
+			return false;
+	}
+
+	_bPingState = R5_US_IDLE;
+	_setRange(ulDurationUS);
+	if (_pfnCallback)
+		(*_pfnCallback)(_uiRange);
+	return true;
+}
+
+// true if we last measured the range at least _ulMinMeasurementInterval milliseconds ago
+unsigned char R5Ultrasonic::_measurementDue(void)
+{
+	unsigned long ulMillis = millis();
+
+	if (_ulLastRangeMeasurement > ulMillis) // fix rollover issue
+		_ulLastRangeMeasurement = 0L;
+
+	return ((ulMillis - _ulLastRangeMeasurement) >= _ulMinMeasurementInterval);
+}
+
+// Send out request pulse and leave the pin ready to read the response
+void R5Ultrasonic::_sendTrigger(void)
+{
+	pinMode( _bSensorPin, OUTPUT );
+	digitalWrite( _bSensorPin, LOW );
+	delayMicroseconds( 2 );
+	digitalWrite( _bSensorPin, HIGH );
+	delayMicroseconds( 5 );
+	digitalWrite( _bSensorPin, LOW );
+	pinMode( _bSensorPin, INPUT );
+}
+
+// Convert from US to mm
+void R5Ultrasonic::_setRange(const unsigned long ulDurationUS)
+{
+	_uiRange = (5L*ulDurationUS)/29;
+	_ulLastRangeMeasurement = millis();
+	_ulLastEchoDuration = ulDurationUS;
+	_uiSequence++;
+}
+
+// timestamps both edges of the echo pulse
+void R5Ultrasonic::_echoISR(void *pContext)
+{
+	R5Ultrasonic *pRanger = (R5Ultrasonic *)pContext;
+	unsigned long ulNow = micros();
+
+	if (digitalRead(pRanger->_bSensorPin))
+	{
+		if (pRanger->_bPingState == R5_US_WAIT_RISE)
+		{
+			pRanger->_ulEchoStart = ulNow;
+			pRanger->_bPingState = R5_US_WAIT_FALL;
+		}
+	}
+	else if (pRanger->_bPingState == R5_US_WAIT_FALL)
+	{
+		pRanger->_ulEchoDuration = ulNow - pRanger->_ulEchoStart;
+		pRanger->_bPingState = R5_US_ECHO_DONE;
+	}
+}